@@ -17,6 +17,25 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+/**
+ * Stack allocated iterator on a CCM.Set, it becomes invalid as soon as
+ * a value is added or removed from the set.
+ */
+public struct CCM.SetIter
+{
+    public int block;
+    public int index;
+    public int stamp;
+}
+
+/**
+ * Ordered set stored in sorted blocks of values allocated from a slab.
+ * Blocks are kept in value order, a lookup is a binary search on blocks
+ * then on the values of one block and insertion or removal only shift
+ * the values of one block. Clearing only resets the slab, values of the
+ * previous generation are released when their slot is reused, on trim or
+ * when the set is destroyed.
+ */
 public class CCM.Set<V> : GLib.Object
 {
     // Types
@@ -27,184 +46,73 @@ public class CCM.Set<V> : GLib.Object
 
     public delegate bool ForeachFunc<V>          (V inData);
 
-    internal class Node<V>
-    {
-        // Properties
-        private unowned Node<V>?     m_Parent;
-        private Node<V>?             m_Right;
-        private Node<V>?             m_Left;
-        private int                  m_Depth;
-
-        public V                     val;
-
-        public Node<V> parent {
-            get {
-                return m_Parent;
-            }
-            set {
-                m_Parent = value;
-
-                calc_depth ();
-            }
-        }
-
-        public Node<V> left {
-            get {
-                return m_Left;
-            }
-            set {
-                m_Left = value;
-
-                calc_depth ();
-            }
-        }
-
-        public Node<V> right {
-            get {
-                return m_Right;
-            }
-            set {
-                m_Right = value;
-
-                calc_depth ();
-            }
-        }
-
-        public Node (V inValue, Node<V>? inParent = null)
-        {
-            val = inValue;
-            m_Depth = 1;
-            right = null;
-            left = null;
-            parent = inParent;
-        }
-
-        private inline void
-        calc_depth ()
-        {
-            int right_depth = m_Right != null ? m_Right.m_Depth : 0;
-            int left_depth = m_Left != null ? m_Left.m_Depth : 0;
-
-            m_Depth = int.max(right_depth, left_depth) + 1;
-
-            if (m_Parent != null) m_Parent.calc_depth ();
-        }
-
-        public inline int
-        balance_factor ()
-        {
-            int right_depth = m_Right != null ? m_Right.m_Depth : 0;
-            int left_depth = m_Left != null ? m_Left.m_Depth : 0;
-
-            return right_depth - left_depth;
-        }
-
-        public inline bool
-        is_left ()
-        {
-            return m_Parent != null && m_Parent.m_Left == this;
-        }
-
-        public unowned Node<V>
-        next ()
-        {
-            unowned Node<V> node = null;
-
-            if (m_Right != null)
-            {
-                node = m_Right;
-                while (node.m_Left != null)
-                    node = node.m_Left;
-            }
-            else
-            {
-                if (is_left ())
-                {
-                    node = m_Parent;
-                }
-                else if (m_Parent != null)
-                {
-                    Node<V> r = (owned)m_Parent.m_Right;
-                    m_Parent.m_Right = null;
-                    node = m_Parent.next ();
-                    m_Parent.m_Right = r;
-                }
-            }
-
-            return node;
-        }
-    }
-
     public class Iterator<V> : GLib.Object
     {
         private Set<V>          m_Set;
-        private unowned Node<V> m_Current;
-        private int             stamp;
+        private SetIter         m_Iter;
 
-        internal Iterator (Set<V>? inSet, Node<V>? inNode = null)
+        internal Iterator (Set<V>? inSet, int inBlock = 0, int inIndex = -1)
         {
             m_Set = inSet;
-            m_Current = inNode;
-            stamp = m_Set.stamp;
+            m_Iter = SetIter ();
+            m_Iter.block = inBlock;
+            m_Iter.index = inIndex;
+            m_Iter.stamp = m_Set.stamp;
         }
 
         public bool
         next ()
-            requires (m_Set.stamp == stamp)
+            requires (m_Set.stamp == m_Iter.stamp)
         {
-            bool ret = false;
-
-            if (m_Current == null && m_Set.m_Root != null)
-            {
-                m_Current = m_Set.m_Root;
-
-                while (m_Current.left != null)
-                    m_Current = m_Current.left;
-
-                ret = true;
-            }
-            else if (m_Current != null)
-            {
-                m_Current = m_Current.next ();
-                ret = m_Current != null;
-            }
-
-            return ret;
+            return m_Set.iter_next (ref m_Iter);
         }
 
         public new unowned V?
         @get ()
-            requires (m_Set.stamp == stamp)
+            requires (m_Set.stamp == m_Iter.stamp)
         {
-            return m_Current.val;
+            return m_Set.iter_get (m_Iter);
         }
 
         public void
         @foreach (ForeachFunc<V> inFunc)
         {
-            if (m_Current == null && m_Set.m_Root != null)
-            {
-                m_Current = m_Set.m_Root;
-
-                while (m_Current.left != null)
-                    m_Current = m_Current.left;
-            }
+            if (m_Iter.index < 0 && !m_Set.iter_next (ref m_Iter))
+                return;
 
-            for (;m_Current != null; m_Current = m_Current.next ())
+            do
             {
-                if (!inFunc (m_Current.val))
+                if (!inFunc (m_Set.iter_get (m_Iter)))
                     return;
-            }
+            } while (m_Set.iter_next (ref m_Iter));
         }
     }
 
+    // Constants
+    private const int BLOCK_SIZE = 64;
+
     // Properties
-    private int       m_Size = 0;
-    private Node<V>?  m_Root = null;
-    public int        stamp;
+    private V[]             m_Slab;
+    private int[]           m_Counts;
+    private int[]           m_Blocks;
+    private int             m_NbBlocks = 0;
+    private int[]           m_Free;
+    private int             m_NbFree = 0;
+    private int             m_NbAllocated = 0;
+    private V[]             m_Sort;
+    private int             m_Size = 0;
+    private CompareFunc<V>  m_CompareFunc;
+    public int              stamp;
 
     // Accessors
-    public CompareFunc<V> compare_func { get; set; }
+    public CompareFunc<V> compare_func {
+        get {
+            return m_CompareFunc;
+        }
+        set {
+            m_CompareFunc = value;
+        }
+    }
 
     public int length {
         get {
@@ -216,179 +124,310 @@ public class CCM.Set<V> : GLib.Object
     public Set (CompareFunc<V> inFunc)
     {
         compare_func = inFunc;
+        m_Slab = new V[BLOCK_SIZE];
+        m_Counts = new int[1];
+        m_Blocks = new int[1];
+        m_Free = new int[1];
+        m_Sort = new V[0];
+    }
+
+    private int
+    alloc_block ()
+    {
+        int id;
+
+        if (m_NbFree > 0)
+        {
+            id = m_Free[--m_NbFree];
+        }
+        else
+        {
+            id = m_NbAllocated++;
+            if (id >= m_Counts.length)
+            {
+                int nb = m_Counts.length * 2;
+                int old = m_Slab.length;
+
+                m_Slab.resize (nb * BLOCK_SIZE);
+                // New slots must be empty for release of previous generation
+                GLib.Memory.set (&m_Slab[old], 0, sizeof (V) * (m_Slab.length - old));
+                m_Counts.resize (nb);
+                m_Blocks.resize (nb);
+                m_Free.resize (nb);
+            }
+        }
+        m_Counts[id] = 0;
+
+        return id;
     }
 
-    private unowned Node<V>?
-    get_node (V inValue, out unowned Node<V>? outParent = null)
+    private void
+    insert_block (int inPos, int inId)
     {
-        unowned Node<V> node = m_Root;
-        CompareFunc<V> func = compare_func;
-        int res;
+        if (inPos < m_NbBlocks)
+            GLib.Memory.move (&m_Blocks[inPos + 1], &m_Blocks[inPos],
+                              sizeof (int) * (m_NbBlocks - inPos));
+        m_Blocks[inPos] = inId;
+        m_NbBlocks++;
+    }
 
-        outParent = null;
+    private void
+    split_block (int inBlock)
+    {
+        int half = BLOCK_SIZE / 2;
+        int id = m_Blocks[inBlock];
+        int next = alloc_block ();
+        int src = id * BLOCK_SIZE + half;
+        int dst = next * BLOCK_SIZE;
+
+        insert_block (inBlock + 1, next);
+
+        for (int cpt = 0; cpt < BLOCK_SIZE - half; ++cpt)
+            m_Slab[dst + cpt] = (owned)m_Slab[src + cpt];
 
-        while (node != null)
+        m_Counts[id] = half;
+        m_Counts[next] = BLOCK_SIZE - half;
+    }
+
+    private int
+    find_block (V inValue)
+    {
+        int low = 0, high = m_NbBlocks;
+
+        // First block which ends after value
+        while (low < high)
+        {
+            int mid = (low + high) / 2;
+            int id = m_Blocks[mid];
+
+            if (m_CompareFunc (m_Slab[id * BLOCK_SIZE + m_Counts[id] - 1], inValue) < 0)
+                low = mid + 1;
+            else
+                high = mid;
+        }
+
+        return low;
+    }
+
+    private bool
+    find_in_block (int inId, V inValue, out int outPos)
+    {
+        int base = inId * BLOCK_SIZE;
+        int low = 0, high = m_Counts[inId];
+
+        while (low < high)
         {
-            outParent = node;
+            int mid = (low + high) / 2;
+            int res = m_CompareFunc (m_Slab[base + mid], inValue);
 
-            res = func (inValue, node.val);
-            if (res > 0)
+            if (res < 0)
             {
-                node = node.right;
+                low = mid + 1;
             }
-            else if (res < 0)
+            else if (res > 0)
             {
-                node = node.left;
+                high = mid;
             }
             else
             {
-                return node;
+                outPos = mid;
+                return true;
             }
         }
 
-        return null;
+        outPos = low;
+
+        return false;
+    }
+
+    private bool
+    lookup (V inValue, out int outBlock, out int outPos)
+    {
+        outBlock = find_block (inValue);
+        outPos = 0;
+
+        return outBlock < m_NbBlocks &&
+               find_in_block (m_Blocks[outBlock], inValue, out outPos);
     }
 
     private void
-    remove_node (Node<V> inNode)
+    insert_at (int inBlock, int inPos, owned V inValue)
     {
-        unowned Node<V> parent = inNode.parent;
-        unowned Node<V> replace = inNode.left;
-        if (replace != null)
+        int block = inBlock;
+        int pos = inPos;
+        int id = m_Blocks[block];
+
+        if (m_Counts[id] == BLOCK_SIZE)
         {
-            while (replace.right != null)
-                replace = replace.right;
+            split_block (block);
+            if (pos > m_Counts[id])
+            {
+                pos -= m_Counts[id];
+                block++;
+                id = m_Blocks[block];
+            }
         }
 
-        if (replace == null)
-        {
-            if (inNode.right != null)
-                inNode.right.parent = inNode.parent;
+        int base = id * BLOCK_SIZE;
+        int count = m_Counts[id];
 
-            if (inNode == m_Root)
-                m_Root = inNode.right;
-            else if (inNode.parent.left == inNode)
-                inNode.parent.left = inNode.right;
-            else
-                inNode.parent.right = inNode.right;
-        }
-        else
+        // Release value of previous generation before shifting over it
+        m_Slab[base + count] = null;
+        if (pos < count)
         {
-            inNode.val = replace.val;
+            GLib.Memory.move (&m_Slab[base + pos + 1], &m_Slab[base + pos],
+                              sizeof (V) * (count - pos));
+            GLib.Memory.set (&m_Slab[base + pos], 0, sizeof (V));
+        }
+        m_Slab[base + pos] = (owned)inValue;
+        m_Counts[id]++;
+        m_Size++;
+    }
 
-            if (replace.left != null)
-                replace.left.parent = replace.parent;
+    private void
+    remove_at (int inBlock, int inPos)
+    {
+        int id = m_Blocks[inBlock];
+        int base = id * BLOCK_SIZE;
 
-            if (replace.parent.left == replace)
-                replace.parent.left = replace.left;
-            else
-                replace.parent.right = replace.left;
-        }
+        // value is destroyed once the set is consistent
+        V val = (owned)m_Slab[base + inPos];
 
-        balance (parent);
+        m_Counts[id]--;
+        int count = m_Counts[id];
+        if (inPos < count)
+        {
+            GLib.Memory.move (&m_Slab[base + inPos], &m_Slab[base + inPos + 1],
+                              sizeof (V) * (count - inPos));
+            GLib.Memory.set (&m_Slab[base + count], 0, sizeof (V));
+        }
 
+        // Empty block goes back to slab
+        if (count == 0)
+        {
+            m_NbBlocks--;
+            if (inBlock < m_NbBlocks)
+                GLib.Memory.move (&m_Blocks[inBlock], &m_Blocks[inBlock + 1],
+                                  sizeof (int) * (m_NbBlocks - inBlock));
+            m_Free[m_NbFree++] = id;
+        }
         m_Size--;
 
         stamp++;
+
+        val = null;
     }
 
     private void
-    rotate_left (owned Node<V> inNode)
+    add (owned V inValue)
     {
-        if (inNode == null)
+        int block, pos;
+
+        if (lookup (inValue, out block, out pos))
+        {
+            m_Slab[m_Blocks[block] * BLOCK_SIZE + pos] = (owned)inValue;
             return;
+        }
 
-        Node<V> pivot = inNode.right;
-        if (inNode.parent != null)
+        if (m_NbBlocks == 0)
         {
-            if (inNode.parent.right == inNode)
-                inNode.parent.right = pivot;
-            else
-                inNode.parent.left = pivot;
+            insert_block (0, alloc_block ());
+            block = 0;
+            pos = 0;
+        }
+        else if (block == m_NbBlocks)
+        {
+            // Greater than all values, append in last block
+            block = m_NbBlocks - 1;
+            pos = m_Counts[m_Blocks[block]];
         }
-        pivot.parent = inNode.parent;
 
-        if (pivot.left != null)
-            pivot.left.parent = inNode;
-        inNode.right = pivot.left;
+        insert_at (block, pos, (owned)inValue);
 
-        inNode.parent = pivot;
-        pivot.left = (owned)inNode;
-        if (pivot.left == m_Root)
-            m_Root = pivot;
+        stamp++;
+    }
+
+    private inline void
+    swap (int inA, int inB)
+    {
+        V tmp = (owned)m_Sort[inA];
+        m_Sort[inA] = (owned)m_Sort[inB];
+        m_Sort[inB] = (owned)tmp;
     }
 
     private void
-    rotate_right (owned Node<V>? inNode)
+    sift_down (int inRoot, int inLength)
     {
-        if (inNode == null)
-            return;
+        int root = inRoot;
 
-        Node<V> pivot = inNode.left;
-        if (inNode.parent != null)
+        while (true)
         {
-            if (inNode.parent.left == inNode)
-                inNode.parent.left = pivot;
-            else
-                inNode.parent.right = pivot;
-        }
-        pivot.parent = inNode.parent;
+            int child = root * 2 + 1;
+
+            if (child >= inLength) break;
 
-        if (pivot.right != null)
-            pivot.right.parent = inNode;
-        inNode.left = pivot.right;
+            if (child + 1 < inLength &&
+                m_CompareFunc (m_Sort[child], m_Sort[child + 1]) < 0)
+                child++;
 
-        inNode.parent = pivot;
-        pivot.right = (owned)inNode;
-        if (pivot.right == m_Root)
-            m_Root = pivot;
+            if (m_CompareFunc (m_Sort[root], m_Sort[child]) >= 0)
+                break;
+
+            swap (root, child);
+            root = child;
+        }
     }
 
     private void
-    balance (Node<V>? inNode)
+    sort (int inLength)
     {
-        if (inNode == null)
-            return;
+        // Heap sort, in place and without any allocation
+        for (int root = inLength / 2 - 1; root >= 0; --root)
+            sift_down (root, inLength);
 
-        int factor = inNode.balance_factor ();
-        if (factor == 2)
+        for (int end = inLength - 1; end > 0; --end)
         {
-            int right = inNode.right.balance_factor ();
-            if (right == -1)
-                rotate_right (inNode.right);
-            rotate_left (inNode);
+            swap (0, end);
+            sift_down (0, end);
         }
-        else if (factor == -2)
-        {
-            int left = inNode.left.balance_factor ();
-            if (left == 1)
-                rotate_left (inNode.left);
-            rotate_right (inNode);
-        }
-
-        balance (inNode.parent);
     }
 
     public unowned V?
     search<A> (A inValue, ValueCompareFunc<V, A> inFunc)
     {
-        unowned Node<V> node = m_Root;
-        int res;
+        int low = 0, high = m_NbBlocks;
 
-        while (node != null)
+        while (low < high)
         {
-            res = inFunc (node.val, inValue);
+            int mid = (low + high) / 2;
+            int id = m_Blocks[mid];
+
+            if (inFunc (m_Slab[id * BLOCK_SIZE + m_Counts[id] - 1], inValue) < 0)
+                low = mid + 1;
+            else
+                high = mid;
+        }
+        if (low == m_NbBlocks) return null;
+
+        int base = m_Blocks[low] * BLOCK_SIZE;
+        high = m_Counts[m_Blocks[low]];
+        low = 0;
+        while (low < high)
+        {
+            int mid = (low + high) / 2;
+            int res = inFunc (m_Slab[base + mid], inValue);
+
             if (res < 0)
             {
-                node = node.right;
+                low = mid + 1;
             }
             else if (res > 0)
             {
-                node = node.left;
+                high = mid;
             }
             else
             {
-                return node.val;
+                return m_Slab[base + mid];
             }
         }
 
@@ -398,55 +437,82 @@ public class CCM.Set<V> : GLib.Object
     public void
     insert (V inValue)
     {
-        unowned Node<V> parent = null;
-        Node<V> node = get_node (inValue, out parent);
+        add (inValue);
+    }
+
+    /**
+     * Insert all values at once: values are sorted in a scratch array kept
+     * by the set, an empty set is then filled block after block without
+     * any search.
+     */
+    public void
+    insert_all (V[] inValues)
+    {
+        int nb = inValues.length;
 
-        if (node == null)
+        if (nb == 0) return;
+
+        if (m_Sort.length < nb)
         {
-            node = new Node<V> (inValue, parent);
+            int old = m_Sort.length;
 
-            if (parent == null)
-            {
-                m_Root = node;
-            }
-            else if (compare_func (inValue, parent.val) > 0)
+            m_Sort.resize (nb);
+            GLib.Memory.set (&m_Sort[old], 0, sizeof (V) * (nb - old));
+        }
+        for (int cpt = 0; cpt < nb; ++cpt)
+            m_Sort[cpt] = inValues[cpt];
+        sort (nb);
+
+        if (m_Size > 0)
+        {
+            for (int cpt = 0; cpt < nb; ++cpt)
+                add ((owned)m_Sort[cpt]);
+            return;
+        }
+
+        int id = -1;
+        unowned V? last = null;
+        for (int cpt = 0; cpt < nb; ++cpt)
+        {
+            if (id >= 0 && m_CompareFunc (last, m_Sort[cpt]) == 0)
             {
-                parent.right = node;
+                m_Sort[cpt] = null;
+                continue;
             }
-            else
+
+            if (id < 0 || m_Counts[id] == BLOCK_SIZE)
             {
-                parent.left = node;
+                id = alloc_block ();
+                insert_block (m_NbBlocks, id);
             }
 
-            balance (node);
-
+            int slot = id * BLOCK_SIZE + m_Counts[id];
+            m_Slab[slot] = (owned)m_Sort[cpt];
+            last = m_Slab[slot];
+            m_Counts[id]++;
             m_Size++;
-
-            stamp++;
-        }
-        else
-        {
-            node.val = inValue;
         }
+
+        stamp++;
     }
 
     public void
     remove (V inValue)
     {
-        unowned Node<V> node = get_node (inValue);
+        int block, pos;
 
-        if (node != null) remove_node (node);
+        if (lookup (inValue, out block, out pos)) remove_at (block, pos);
     }
 
     public new Iterator<V>
     @get (V inValue)
     {
-        unowned Node<V> node = get_node (inValue);
+        int block, pos;
         Iterator<V> iterator = null;
 
-        if (node != null)
+        if (lookup (inValue, out block, out pos))
         {
-            iterator = new Iterator<V> (this, node);
+            iterator = new Iterator<V> (this, block, pos);
         }
 
         return iterator;
@@ -455,16 +521,41 @@ public class CCM.Set<V> : GLib.Object
     public bool
     contains (V inValue)
     {
-        return get_node (inValue) != null;
+        int block, pos;
+
+        return lookup (inValue, out block, out pos);
     }
 
+    /**
+     * Remove all values in O(1), the slab is kept for next insertions.
+     */
     public void
     clear ()
     {
-        while (m_Root != null)
-            remove_node (m_Root);
-        m_Root = null;
+        m_NbBlocks = 0;
+        m_NbFree = 0;
+        m_NbAllocated = 0;
         m_Size = 0;
+
+        stamp++;
+    }
+
+    /**
+     * Release the values of previous generations still held by the slab.
+     */
+    public void
+    trim ()
+    {
+        bool[] used = new bool[m_Counts.length];
+
+        for (int cpt = 0; cpt < m_NbBlocks; ++cpt)
+            used[m_Blocks[cpt]] = true;
+
+        for (int id = 0; id < m_Counts.length; ++id)
+        {
+            for (int cpt = used[id] ? m_Counts[id] : 0; cpt < BLOCK_SIZE; ++cpt)
+                m_Slab[id * BLOCK_SIZE + cpt] = null;
+        }
     }
 
     public Iterator<V>
@@ -472,4 +563,38 @@ public class CCM.Set<V> : GLib.Object
     {
         return new Iterator<V> (this);
     }
+
+    public void
+    iter_init (out SetIter outIter)
+    {
+        outIter = SetIter ();
+        outIter.block = 0;
+        outIter.index = -1;
+        outIter.stamp = stamp;
+    }
+
+    public bool
+    iter_next (ref SetIter ioIter)
+        requires (ioIter.stamp == stamp)
+    {
+        if (ioIter.block >= m_NbBlocks) return false;
+
+        ioIter.index++;
+        if (ioIter.index >= m_Counts[m_Blocks[ioIter.block]])
+        {
+            ioIter.block++;
+            ioIter.index = 0;
+        }
+
+        return ioIter.block < m_NbBlocks;
+    }
+
+    public unowned V?
+    iter_get (SetIter inIter)
+        requires (inIter.stamp == stamp)
+        requires (inIter.block < m_NbBlocks)
+        requires (inIter.index >= 0 && inIter.index < m_Counts[m_Blocks[inIter.block]])
+    {
+        return m_Slab[m_Blocks[inIter.block] * BLOCK_SIZE + inIter.index];
+    }
 }
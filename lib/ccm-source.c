@@ -17,6 +17,13 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <config.h>
+
+#ifdef HAVE_SYS_TIMERFD_H
+#include <sys/timerfd.h>
+#include <unistd.h>
+#endif
+
 #include "ccm-source.h"
 
 struct _CCMSource
@@ -24,6 +31,9 @@ struct _CCMSource
     GSource m_Source;
     CCMSourceFuncs m_Funcs;
     gpointer m_Data;
+    GPollFD m_Timer;
+    gint64 m_Deadline;
+    gboolean m_TimerFailed;
 };
 
 static gboolean
@@ -44,6 +54,17 @@ ccm_source_check (GSource* inSource)
 {
     CCMSource* source = (CCMSource*) inSource;
 
+#ifdef HAVE_SYS_TIMERFD_H
+    if (source->m_Timer.fd >= 0 && source->m_Timer.revents & G_IO_IN)
+    {
+        guint64 expirations;
+
+        // Timer expired, it must be armed again on next deadline
+        if (read (source->m_Timer.fd, &expirations, sizeof (guint64)) > 0)
+            source->m_Deadline = 0;
+    }
+#endif
+
     if (source->m_Funcs.check)
         return source->m_Funcs.check(source->m_Data);
     else
@@ -71,6 +92,11 @@ ccm_source_finalize (GSource* inSource)
 
     if (source->m_Funcs.finalize)
         source->m_Funcs.finalize(source->m_Data);
+
+#ifdef HAVE_SYS_TIMERFD_H
+    if (source->m_Timer.fd >= 0)
+        close (source->m_Timer.fd);
+#endif
 }
 
 static GSourceFuncs s_CCMSourceFuncs = {
@@ -90,6 +116,7 @@ ccm_source_new (CCMSourceFuncs inFuncs, gpointer inData)
     self = (CCMSource*)g_source_new (&s_CCMSourceFuncs, sizeof (CCMSource));
     self->m_Funcs = inFuncs;
     self->m_Data = inData;
+    self->m_Timer.fd = -1;
 
     return self;
 }
@@ -107,6 +134,7 @@ ccm_source_new_from_pollfd (CCMSourceFuncs inFuncs, GPollFD* inpFd,
     self = (CCMSource*)g_source_new (&s_CCMSourceFuncs, sizeof (CCMSource));
     self->m_Funcs = inFuncs;
     self->m_Data = inData;
+    self->m_Timer.fd = -1;
     g_source_add_poll ((GSource*) self, inpFd);
     g_source_set_can_recurse ((GSource*) self, TRUE);
 
@@ -138,3 +166,53 @@ ccm_source_destroy (CCMSource* self)
 
     g_source_destroy ((GSource*)self);
 }
+
+/**
+ * ccm_source_set_deadline:
+ * @self: #CCMSource
+ * @inDeadline: monotonic time in microseconds, 0 to disarm
+ *
+ * Wake up the main loop exactly at @inDeadline through a timerfd polled by
+ * the source instead of the millisecond poll timeout.
+ *
+ * Returns: %FALSE if timerfd is not available, the caller must then
+ *          return a poll timeout from its prepare function.
+ **/
+gboolean
+ccm_source_set_deadline (CCMSource* self, gint64 inDeadline)
+{
+    g_return_val_if_fail(self != NULL, FALSE);
+
+#ifdef HAVE_SYS_TIMERFD_H
+    if (self->m_Timer.fd < 0)
+    {
+        if (self->m_TimerFailed || !inDeadline) return FALSE;
+
+        self->m_Timer.fd = timerfd_create (CLOCK_MONOTONIC,
+                                           TFD_NONBLOCK | TFD_CLOEXEC);
+        if (self->m_Timer.fd < 0)
+        {
+            self->m_TimerFailed = TRUE;
+            return FALSE;
+        }
+        self->m_Timer.events = G_IO_IN;
+        g_source_add_poll ((GSource*) self, &self->m_Timer);
+    }
+
+    if (self->m_Deadline != inDeadline)
+    {
+        struct itimerspec spec = { { 0, 0 }, { 0, 0 } };
+
+        // A zero value disarms the timer
+        spec.it_value.tv_sec = inDeadline / G_USEC_PER_SEC;
+        spec.it_value.tv_nsec = (inDeadline % G_USEC_PER_SEC) * 1000;
+        if (timerfd_settime (self->m_Timer.fd, TFD_TIMER_ABSTIME, &spec, NULL) < 0)
+            return FALSE;
+        self->m_Deadline = inDeadline;
+    }
+
+    return TRUE;
+#else
+    return FALSE;
+#endif
+}
@@ -46,6 +46,8 @@ CCMSource* ccm_source_new_from_pollfd   (CCMSourceFuncs inFunc,
 CCMSource*  ccm_source_ref              (CCMSource* self);
 void        ccm_source_unref            (CCMSource* self);
 void        ccm_source_destroy          (CCMSource* self);
+gboolean    ccm_source_set_deadline     (CCMSource* self,
+                                         gint64 inDeadline);
 
 G_END_DECLS
 
@@ -29,12 +29,23 @@ public class CCM.Timeline : Object
     static bool        s_HaveDefault = false;
     static int         s_DefaultPriority = 0;
 
+    // Non master timelines are stepped by the playing master timeline
+    // just before its own frame so all animations share its frame clock
+    static unowned Timeline?              s_Clock = null;
+    static GLib.List<unowned Timeline?>   s_Slaves = null;
+    static bool                           s_Ticking = false;
+
     private Timeout? m_Timeout = null;
+    private bool m_Slaved = false;
     private TimelineDirection m_Direction = TimelineDirection.FORWARD;
     private int m_CurrentFrameNum = 0;
     private uint m_Fps = 60;
     private uint m_Duration = 0;
     private uint64 m_PrevFrameTimeVal;
+    // Slaved timeline frames are computed from master time elapsed since
+    // clock base so master jitter never skips or doubles a frame
+    private uint64 m_ClockTime = 0;
+    private uint m_ClockFrames = 0;
 
     /**
      * Timeline direction
@@ -63,9 +74,9 @@ public class CCM.Timeline : Object
             if (m_Fps != value)
             {
                 m_Fps = value;
-                if (m_Timeout != null)
+                if (is_playing)
                 {
-                    s_TimeoutPool.remove (m_Timeout);
+                    remove_timeout ();
                     add_timeout ();
                 }
             }
@@ -108,7 +119,29 @@ public class CCM.Timeline : Object
      */
     public bool is_playing {
         get {
-            return m_Timeout != null;
+            return m_Timeout != null || m_Slaved;
+        }
+    }
+
+    /**
+     * Lateness of the last frame dispatch in microseconds
+     */
+    public int64 jitter {
+        get {
+            if (m_Slaved) return s_Clock.jitter;
+
+            return m_Timeout != null ? m_Timeout.jitter : 0;
+        }
+    }
+
+    /**
+     * Maximum lateness of frame dispatch since timeline was started
+     */
+    public int64 max_jitter {
+        get {
+            if (m_Slaved) return s_Clock.max_jitter;
+
+            return m_Timeout != null ? m_Timeout.max_jitter : 0;
         }
     }
 
@@ -178,8 +211,7 @@ public class CCM.Timeline : Object
 
     ~Timeline ()
     {
-        if (m_Timeout != null)
-            s_TimeoutPool.remove (m_Timeout);
+        remove_timeout ();
     }
 
     private void
@@ -189,9 +221,77 @@ public class CCM.Timeline : Object
             m_PrevFrameTimeVal = GLib.get_monotonic_time ();
 
         if (master)
+        {
             m_Timeout = s_TimeoutPool.add_master (m_Fps, on_timeout, this, null);
+            if (s_Clock == null) s_Clock = this;
+        }
+        else if (s_Clock != null)
+        {
+            s_Slaves.prepend (this);
+            m_Slaved = true;
+            m_ClockTime = 0;
+        }
         else
+        {
             m_Timeout = s_TimeoutPool.add (m_Fps, on_timeout, this, null);
+        }
+    }
+
+    private void
+    remove_timeout ()
+    {
+        if (m_Slaved)
+        {
+            unowned GLib.List<unowned Timeline?> link = s_Slaves.find (this);
+
+            // Do not break the list while slaves are stepped
+            if (link != null && s_Ticking)
+                link.data = null;
+            else if (link != null)
+                s_Slaves.delete_link (link);
+            m_Slaved = false;
+        }
+
+        if (m_Timeout != null)
+        {
+            s_TimeoutPool.remove (m_Timeout);
+            m_Timeout = null;
+        }
+
+        if (s_Clock == this)
+        {
+            s_Clock = null;
+
+            // Slaves get back their own timeout
+            for (unowned GLib.List<unowned Timeline?> item = s_Slaves; item != null; item = item.next)
+            {
+                unowned Timeline? slave = item.data;
+
+                item.data = null;
+                if (slave != null)
+                {
+                    slave.m_Slaved = false;
+                    slave.add_timeout ();
+                }
+            }
+            if (!s_Ticking) s_Slaves = null;
+        }
+    }
+
+    private static void
+    tick_slaves (uint64 inTime)
+    {
+        s_Ticking = true;
+        // A slave which stops is removed from list by remove_timeout
+        for (unowned GLib.List<unowned Timeline?> item = s_Slaves; item != null; item = item.next)
+        {
+            unowned Timeline? slave = item.data;
+
+            if (slave != null) slave.step (inTime);
+        }
+        s_Ticking = false;
+
+        s_Slaves.remove_all (null);
     }
 
     private inline bool
@@ -207,17 +307,48 @@ public class CCM.Timeline : Object
     on_timeout ()
     {
         uint64 now = GLib.get_monotonic_time ();
+
+        // Animations are updated in one batch just before the master frame
+        if (s_Clock == this && s_Slaves != null) tick_slaves (now);
+
+        return step (now);
+    }
+
+    private bool
+    step (uint64 inTime)
+    {
+        uint64 now = inTime;
         uint nb_frames;
         ulong msecs, speed;
 
         if (m_PrevFrameTimeVal == 0 || now < m_PrevFrameTimeVal)
             m_PrevFrameTimeVal = now;
 
-        msecs = (ulong)(now - m_PrevFrameTimeVal) / 1000;
+        if (m_Slaved)
+        {
+            uint frames;
+
+            // First master frame is the first frame of slave
+            if (m_ClockTime == 0 || now < m_ClockTime)
+            {
+                m_ClockTime = now - (1000000 + m_Fps / 2) / m_Fps;
+                m_ClockFrames = 0;
+            }
+
+            frames = (uint)(((now - m_ClockTime) * m_Fps + 500000) / 1000000);
+            nb_frames = frames - m_ClockFrames;
+            m_ClockFrames = frames;
+
+            // Faster than slave rate, wait for next master frame
+            if (nb_frames == 0) return true;
+        }
+        else
+        {
+            msecs = (ulong)(now - m_PrevFrameTimeVal) / 1000;
 
-        speed = uint.max (1000 / m_Fps, 1);
-        nb_frames = (uint)(msecs / speed);
-        if (nb_frames == 0) nb_frames = 1;
+            speed = uint.max ((1000 + m_Fps / 2) / m_Fps, 1);
+            nb_frames = uint.max ((uint)(msecs / speed), 1);
+        }
 
         m_PrevFrameTimeVal = now;
 
@@ -230,7 +361,7 @@ public class CCM.Timeline : Object
         {
             new_frame (m_CurrentFrameNum);
 
-            if (m_Timeout == null)
+            if (!is_playing)
             {
                 return false;
             }
@@ -259,10 +390,9 @@ public class CCM.Timeline : Object
             if (m_CurrentFrameNum != end_frame)
                 return true;
 
-            if (!loop && m_Timeout != null)
+            if (!loop && is_playing)
             {
-                s_TimeoutPool.remove (m_Timeout);
-                m_Timeout = null;
+                remove_timeout ();
             }
 
             completed ();
@@ -304,7 +434,7 @@ public class CCM.Timeline : Object
     start ()
         requires (n_frames > 0)
     {
-        if (m_Timeout != null) return;
+        if (is_playing) return;
 
         add_timeout ();
 
@@ -317,11 +447,7 @@ public class CCM.Timeline : Object
     public void
     pause ()
     {
-        if (m_Timeout != null)
-        {
-            s_TimeoutPool.remove (m_Timeout);
-            m_Timeout = null;
-        }
+        remove_timeout ();
 
         m_PrevFrameTimeVal = 0;
 
@@ -23,20 +23,34 @@ internal delegate bool CCM.TimeoutFunc(void* inData);
 internal struct CCM.TimeoutInterval
 {
     public uint64  m_StartTime;
+    // interval in microseconds, a millisecond interval truncated 60 fps
+    // to 62.5 fps
     public long    m_Interval;
     public int     m_Delay;
 
     public TimeoutInterval(uint inFps)
     {
         m_StartTime = GLib.get_monotonic_time ();
-        m_Interval = (long)(1000.0 / (double)inFps);
-        m_Delay = (int)m_Interval;
+        m_Interval = (long)((1000000 + inFps / 2) / inFps);
+        m_Delay = get_delay ((ulong)m_Interval);
+    }
+
+    private static inline int
+    get_delay (ulong inTime)
+    {
+        return (int)((inTime + 999) / 1000);
     }
 
     private inline ulong
     get_ticks (uint64 inCurrentTime)
     {
-        return (ulong)(inCurrentTime - m_StartTime) / 1000;
+        return (ulong)(inCurrentTime - m_StartTime);
+    }
+
+    public inline uint64
+    get_deadline ()
+    {
+        return m_StartTime + (uint64)m_Interval;
     }
 
     public bool
@@ -44,19 +58,18 @@ internal struct CCM.TimeoutInterval
     {
         bool ret = false;
         ulong elapsed_time = get_ticks (inCurrentTime);
-        double diff = (double)elapsed_time / (double)m_Interval;
 
-        if (diff >= 1.0)
+        if (elapsed_time >= (ulong)m_Interval)
         {
-            double delta = (double)((int)diff) - diff;
-            m_StartTime = inCurrentTime + (uint64)((delta * (double)m_Interval) * 1000.0);
+            // Keep deadlines on interval grid
+            m_StartTime = inCurrentTime - elapsed_time % (ulong)m_Interval;
 
             m_Delay = 0;
             ret = true;
         }
         else
         {
-            m_Delay = int.max (((int)m_Interval - ((int)elapsed_time % (int)m_Interval)), 0);
+            m_Delay = get_delay ((ulong)m_Interval - elapsed_time);
         }
 
         outDelay = m_Delay;
@@ -74,7 +87,7 @@ internal struct CCM.TimeoutInterval
             ret = true;
         }
 
-        m_Delay = (int)m_Interval;
+        m_Delay = get_delay ((ulong)m_Interval);
 
         return ret;
     }
@@ -17,13 +17,20 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+/**
+ * Timeouts are kept in a binary heap ordered by deadline so adding,
+ * removing and rescheduling a timeout after its dispatch is O(log n).
+ * When timerfd is available the source wakes up exactly at the next
+ * deadline instead of rounding it to the millisecond poll timeout.
+ */
 internal class CCM.TimeoutPool
 {
     private CCM.Source            m_Source;
     private CCM.SourceFuncs       m_Funcs;
     private uint64                m_StartTime;
-    private List<Timeout>         m_Timeouts;
-    private int                   m_Ready;
+    private Timeout[]             m_Timeouts;
+    private int                   m_Size;
+    private Timeout[]             m_Dispatched;
 
     public TimeoutPool (int inPriority = GLib.Priority.DEFAULT,
                         GLib.MainContext? inContext = null)
@@ -38,109 +45,181 @@ internal class CCM.TimeoutPool
         m_StartTime = m_Source.get_time();
         m_Source.set_priority (inPriority);
         m_Source.unref ();
-        m_Timeouts = new List<Timeout>();
-        m_Ready = 0;
+        m_Timeouts = new Timeout[16];
+        m_Size = 0;
+        m_Dispatched = new Timeout[16];
     }
 
-    private bool
-    prepare (out int outTimeOut)
+    private inline void
+    place (int inIndex, owned Timeout inTimeout)
     {
-        bool ret = false;
+        inTimeout.index = inIndex;
+        m_Timeouts[inIndex] = (owned)inTimeout;
+    }
 
-        /* the pool is ready if the first timeout is ready */
-        if (m_Timeouts != null && m_Timeouts.data != null)
+    private void
+    sift_up (int inIndex)
+    {
+        int index = inIndex;
+        Timeout timeout = (owned)m_Timeouts[index];
+
+        while (index > 0)
+        {
+            int parent = (index - 1) / 2;
+
+            if (!Timeout.before (timeout, m_Timeouts[parent])) break;
+
+            place (index, (owned)m_Timeouts[parent]);
+            index = parent;
+        }
+
+        place (index, (owned)timeout);
+    }
+
+    private void
+    sift_down (int inIndex)
+    {
+        int index = inIndex;
+        Timeout timeout = (owned)m_Timeouts[index];
+
+        while (true)
         {
-            ret = m_Timeouts.data.prepare (m_Source, out outTimeOut);
-            if (ret) m_Timeouts.data.ready = true;
+            int child = index * 2 + 1;
+
+            if (child >= m_Size) break;
+
+            if (child + 1 < m_Size &&
+                Timeout.before (m_Timeouts[child + 1], m_Timeouts[child]))
+                child++;
+
+            if (!Timeout.before (m_Timeouts[child], timeout)) break;
+
+            place (index, (owned)m_Timeouts[child]);
+            index = child;
         }
-        else
+
+        place (index, (owned)timeout);
+    }
+
+    private void
+    push (Timeout inTimeout)
+    {
+        if (m_Size == m_Timeouts.length)
         {
-            outTimeOut = -1;
+            m_Timeouts.resize (m_Size * 2);
+            GLib.Memory.set (&m_Timeouts[m_Size], 0, sizeof (void*) * m_Size);
         }
 
-        return ret;
+        m_Timeouts[m_Size] = inTimeout;
+        m_Size++;
+        sift_up (m_Size - 1);
     }
 
-    private bool
-    check ()
+    private Timeout
+    pop (int inIndex)
     {
-        foreach (unowned Timeout timeout in m_Timeouts)
+        Timeout timeout = (owned)m_Timeouts[inIndex];
+
+        timeout.index = -1;
+        m_Size--;
+        if (inIndex < m_Size)
         {
-            int val;
-            /* since the timeouts are sorted by expiration, as soon
-             * as we get a check returning FALSE we know that the
-             * following timeouts are not expiring, so we break as
-             * soon as possible
-             */
-            if (timeout.ready || timeout.prepare (m_Source, out val))
-            {
-                timeout.ready = true;
-                m_Ready++;
-            }
+            place (inIndex, (owned)m_Timeouts[m_Size]);
+            if (inIndex > 0 &&
+                Timeout.before (m_Timeouts[inIndex], m_Timeouts[(inIndex - 1) / 2]))
+                sift_up (inIndex);
             else
-                break;
+                sift_down (inIndex);
         }
 
-        return m_Ready > 0;
+        return timeout;
     }
 
     private bool
-    dispatch (SourceFunc inCallback)
+    prepare (out int outTimeOut)
     {
-        List<unowned Timeout?> dispatched = new List<unowned Timeout?> ();
+        outTimeOut = -1;
 
-        /* the main loop might have predicted this, so we repeat the
-         * check for ready timeouts.
-         */
-        if (m_Ready <= 0) check ();
+        if (m_Size == 0)
+        {
+            m_Source.set_deadline (0);
+            return false;
+        }
 
-        /* Iterate by moving the actual start of the list along so that it
-         * can cope with adds and removes while a timeout is being dispatched
-         */
-        while (m_Timeouts != null && m_Timeouts.data != null && m_Ready-- > 0)
+        /* the pool is ready if the first timeout is ready */
+        uint64 now = m_Source.get_time ();
+        uint64 deadline = m_Timeouts[0].interval.get_deadline ();
+
+        if (deadline <= now)
         {
-            Timeout timeout = m_Timeouts.data;
+            outTimeOut = 0;
+            return true;
+        }
+
+        if (!m_Source.set_deadline ((int64)deadline))
+            outTimeOut = (int)((deadline - now + 999) / 1000);
 
-            /* One of the ready timeouts may have been removed during dispatch,
-             * in which case pool->ready will be wrong, but the ready timeouts
-             * are always kept at the start of the list so we can stop once
-             * we've reached the first non-ready timeout
-             */
-            if (!timeout.ready) break;
+        return false;
+    }
+
+    private bool
+    check ()
+    {
+        return m_Size > 0 &&
+               m_Timeouts[0].interval.get_deadline () <= m_Source.get_time ();
+    }
+
+    private bool
+    dispatch (SourceFunc inCallback)
+    {
+        uint64 now = m_Source.get_time ();
+        int nb = 0;
 
-            timeout.ready = false;
+        /* Take off all expired timeouts so the pool can cope with adds and
+         * removes while a timeout is being dispatched
+         */
+        while (m_Size > 0 && m_Timeouts[0].interval.get_deadline () <= now)
+        {
+            Timeout timeout = pop (0);
 
-            /* Move the list node to a list of dispatched timeouts */
-            dispatched.prepend(m_Timeouts.data);
-            m_Timeouts.delete_link(m_Timeouts);
+            timeout.expire (now);
+            timeout.index = Timeout.DISPATCHED;
 
-            if (!timeout.interval.dispatch(timeout.callback, timeout.data))
+            if (nb == m_Dispatched.length)
             {
-                /* The timeout may have already been removed, but nothing
-                 * can be added to the dispatched_timeout list except in this
-                 * function so it will always either be at the head of the
-                 * dispatched list or have been removed
-                 */
-                if (dispatched != null && dispatched.data == timeout)
-                {
-                    dispatched.delete_link (dispatched);
-                }
+                m_Dispatched.resize (nb * 2);
+                GLib.Memory.set (&m_Dispatched[nb], 0, sizeof (void*) * nb);
             }
+            m_Dispatched[nb] = (owned)timeout;
+            nb++;
         }
 
-        /* Re-insert the dispatched timeouts in sorted order */
-        foreach (Timeout timeout in dispatched)
+        /* Dispatch master timeouts first */
+        for (int pass = 0; pass < 2; ++pass)
         {
-            if (timeout != null)
+            for (int cpt = 0; cpt < nb; ++cpt)
             {
-                m_Timeouts.insert_sorted (timeout,
-                                          (CompareFunc)Timeout.compare);
+                unowned Timeout timeout = m_Dispatched[cpt];
+
+                if (timeout.master != (pass == 0)) continue;
+
+                /* Timeout may have been removed by a previous one */
+                if (timeout.index != Timeout.DISPATCHED) continue;
+
+                if (timeout.interval.dispatch (timeout.callback, timeout.data) &&
+                    timeout.index == Timeout.DISPATCHED)
+                {
+                    push (timeout);
+                }
+                else if (timeout.index == Timeout.DISPATCHED)
+                {
+                    timeout.index = -1;
+                }
             }
         }
 
-        dispatched = null;
-
-        m_Ready = 0;
+        for (int cpt = 0; cpt < nb; ++cpt)
+            m_Dispatched[cpt] = null;
 
         return true;
     }
@@ -148,7 +227,9 @@ internal class CCM.TimeoutPool
     private void
     finalize_ ()
     {
-        m_Timeouts = null;
+        for (int cpt = 0; cpt < m_Size; ++cpt)
+            m_Timeouts[cpt] = null;
+        m_Size = 0;
     }
 
     public void
@@ -166,7 +247,7 @@ internal class CCM.TimeoutPool
         timeout.data = inData;
         timeout.notify = inNotify;
 
-        m_Timeouts.insert_sorted(timeout, (CompareFunc)Timeout.compare);
+        push (timeout);
 
         return timeout;
     }
@@ -181,7 +262,7 @@ internal class CCM.TimeoutPool
         timeout.notify = inNotify;
         timeout.master = true;
 
-        m_Timeouts.insert_sorted(timeout, (CompareFunc)Timeout.compare);
+        push (timeout);
 
         return timeout;
     }
@@ -189,11 +270,15 @@ internal class CCM.TimeoutPool
     public void
     remove (Timeout inTimeout)
     {
-        weak GLib.List<Timeout>? l;
-
-        if ((l = m_Timeouts.find(inTimeout)) != null)
+        if (inTimeout.index >= 0 && inTimeout.index < m_Size &&
+            m_Timeouts[inTimeout.index] == inTimeout)
+        {
+            pop (inTimeout.index);
+        }
+        else if (inTimeout.index == Timeout.DISPATCHED)
         {
-            m_Timeouts.remove (inTimeout);
+            /* it will not be put back in pool after its dispatch */
+            inTimeout.index = -1;
         }
     }
 }
@@ -20,12 +20,14 @@
 enum CCM.TimeoutFlags
 {
     NONE = 0,
-    READY = 1 << 1,
     MASTER = 1 << 2
 }
 
 internal class CCM.Timeout
 {
+    /* index value of a timeout taken off the pool during its dispatch */
+    internal const int DISPATCHED = -2;
+
     private TimeoutFlags m_Flags;
 
     internal TimeoutInterval interval;
@@ -33,17 +35,12 @@ internal class CCM.Timeout
     internal void* data;
     internal new DestroyNotify notify;
 
-    internal bool ready {
-        get {
-            return (m_Flags & TimeoutFlags.READY) == TimeoutFlags.READY;
-        }
-        set {
-            if (value)
-                m_Flags |= TimeoutFlags.READY;
-            else
-                m_Flags &= ~(int)TimeoutFlags.READY;
-        }
-    }
+    /* position in pool heap, -1 if not in pool */
+    internal int index = -1;
+
+    /* lateness of dispatch in microseconds */
+    internal int64 jitter;
+    internal int64 max_jitter;
 
     internal bool master {
         get {
@@ -68,32 +65,24 @@ internal class CCM.Timeout
         if (notify != null) notify (data);
     }
 
-    internal static int
-    compare (Timeout inA, Timeout inB)
+    internal static inline bool
+    before (Timeout inA, Timeout inB)
     {
-        /* Keep 'master' and 'ready' timeouts at the front */
-        if (inA.ready && inA.master) return -1;
-
-        if (inB.ready && inB.master) return 1;
-
-        /* Keep 'ready' timeouts at the front */
-        if (inA.ready) return -1;
-
-        if (inB.ready) return 1;
+        uint64 a = inA.interval.get_deadline ();
+        uint64 b = inB.interval.get_deadline ();
 
-        /* Keep 'master' timeouts at the front */
-        if (inA.master) return -1;
-
-        if (inB.master) return 1;
-
-        return inA.interval.compare(inB.interval);
+        /* Keep 'master' timeouts at the front on same deadline */
+        return a < b || (a == b && inA.master && !inB.master);
     }
 
-    internal bool
-    prepare (Source inSource, out int outNextTimeout)
+    internal void
+    expire (uint64 inCurrentTime)
     {
-        uint64 now = inSource.get_time();
+        int delay;
+
+        jitter = (int64)(inCurrentTime - interval.get_deadline ());
+        if (jitter > max_jitter) max_jitter = jitter;
 
-        return interval.prepare(now, out outNextTimeout);
+        interval.prepare (inCurrentTime, out delay);
     }
 }
@@ -27,10 +27,10 @@ public abstract class CCM.Watch : GLib.Object
     private bool
     on_source_prepare (out int inTimeout)
     {
-        process_watch ();
         inTimeout = -1;
 
-        return false;
+        // Only dispatch without polling if data was already read from fd
+        return pending ();
     }
 
     private bool
@@ -42,10 +42,9 @@ public abstract class CCM.Watch : GLib.Object
         {
             m_Source = null;
         }
-        else if ((m_Fd.revents & IOCondition.IN) == IOCondition.IN)
+        else
         {
-            process_watch ();
-            ret = true;
+            ret = (m_Fd.revents & IOCondition.IN) == IOCondition.IN || pending ();
         }
 
         return ret;
@@ -54,14 +53,21 @@ public abstract class CCM.Watch : GLib.Object
     private bool
     on_source_dispatch(SourceFunc inCallback)
     {
-        if ((m_Fd.revents & IOCondition.IN) == IOCondition.IN)
-        {
-            process_watch ();
-        }
+        process_watch ();
 
         return true;
     }
 
+    /**
+     * Called before polling the fd, it must return true if data was already
+     * read from fd and wait to be processed. It must not read the fd.
+     */
+    protected virtual bool
+    pending ()
+    {
+        return false;
+    }
+
     public abstract void
     process_watch ();
 
@@ -0,0 +1,202 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4 -*- */
+/*
+ * test-set.c
+ * Copyright (C) Nicolas Bruguier 2007-2011 <gandalfn@club-internet.fr>
+ *
+ * cairo-compmgr is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * cairo-compmgr is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <glib-object.h>
+#include "ccm-timeline.h"
+
+#define N_VALUES 10000
+#define N_FRAMES 100
+
+static gint n_refs = 0;
+
+static int
+compare (gpointer a, gpointer b)
+{
+    return GPOINTER_TO_INT (a) - GPOINTER_TO_INT (b);
+}
+
+static gpointer
+value_ref (gpointer value)
+{
+    n_refs++;
+
+    return value;
+}
+
+static void
+value_unref (gpointer value)
+{
+    n_refs--;
+}
+
+static gboolean
+count_value (gpointer value, gpointer data)
+{
+    (*(gint *) data)++;
+
+    return TRUE;
+}
+
+static void
+check_sorted (CCMSet* set, gint expected)
+{
+    CCMSetIter iter;
+    CCMSetIterator* iterator;
+    gint prev = -1, nb = 0;
+
+    // Stack iterator
+    ccm_set_iter_init (set, &iter);
+    while (ccm_set_iter_next (set, &iter))
+    {
+        gint val = GPOINTER_TO_INT (ccm_set_iter_get (set, &iter));
+
+        if (val <= prev) g_error ("set is not sorted: %i after %i", val, prev);
+        prev = val;
+        nb++;
+    }
+
+    if (nb != expected || ccm_set_get_length (set) != expected)
+        g_error ("set length %i, expected %i", nb, expected);
+
+    // Iterator object must walk the same values
+    nb = 0;
+    iterator = ccm_set_iterator (set);
+    ccm_set_iterator_foreach (iterator, (CCMSetForeachFunc)count_value, &nb);
+    g_object_unref (iterator);
+    if (nb != expected)
+        g_error ("iterator walked %i values, expected %i", nb, expected);
+}
+
+gint
+main (gint argc, gchar ** argv)
+{
+    CCMSet* set;
+    CCMSetIterator* iterator;
+    gpointer* values;
+    gpointer* twice;
+    GTimer* timer;
+    gint cpt, frame, length;
+    gdouble elapsed;
+
+    g_type_init ();
+
+    set = ccm_set_new (G_TYPE_POINTER, value_ref, value_unref,
+                       (CCMSetCompareFunc)compare);
+    // Distinct values in random order
+    values = g_new (gpointer, N_VALUES);
+    for (cpt = 0; cpt < N_VALUES; ++cpt)
+        values[cpt] = GINT_TO_POINTER (cpt * 2 + 1);
+    for (cpt = N_VALUES - 1; cpt > 0; --cpt)
+    {
+        gint other = g_random_int_range (0, cpt + 1);
+        gpointer tmp = values[cpt];
+
+        values[cpt] = values[other];
+        values[other] = tmp;
+    }
+    twice = g_new (gpointer, N_VALUES * 2);
+    for (cpt = 0; cpt < N_VALUES * 2; ++cpt)
+        twice[cpt] = values[cpt % N_VALUES];
+
+    // Check insertion one by one against bulk insertion
+    for (cpt = 0; cpt < N_VALUES; ++cpt)
+        ccm_set_insert (set, values[cpt]);
+    length = N_VALUES;
+    check_sorted (set, length);
+
+    iterator = ccm_set_get (set, values[0]);
+    if (!iterator || ccm_set_iterator_get (iterator) != values[0])
+        g_error ("iterator on %i not found", GPOINTER_TO_INT (values[0]));
+    g_object_unref (iterator);
+
+    for (cpt = 0; cpt < N_VALUES; cpt += 2)
+        ccm_set_remove (set, values[cpt]);
+    for (cpt = 1; cpt < N_VALUES; cpt += 2)
+        if (!ccm_set_contains (set, values[cpt]))
+            g_error ("value %i lost", GPOINTER_TO_INT (values[cpt]));
+
+    // Removing all values gives every block back to the slab
+    for (cpt = 1; cpt < N_VALUES; cpt += 2)
+        ccm_set_remove (set, values[cpt]);
+    check_sorted (set, 0);
+    if (n_refs != 0)
+        g_error ("%i values still referenced after remove", n_refs);
+
+    // Bulk insertion in an empty set then in a filled set
+    ccm_set_insert_all (set, values, N_VALUES / 2);
+    check_sorted (set, N_VALUES / 2);
+    ccm_set_insert_all (set, twice, N_VALUES * 2);
+    check_sorted (set, length);
+    ccm_set_clear (set);
+    ccm_set_insert_all (set, twice, N_VALUES * 2);
+    check_sorted (set, length);
+
+    // Clear and reuse: values of previous generation are kept by the slab
+    // until their slot is reused or the set is trimmed
+    ccm_set_clear (set);
+    check_sorted (set, 0);
+    for (cpt = 0; cpt < N_VALUES; ++cpt)
+        ccm_set_insert (set, values[cpt]);
+    check_sorted (set, length);
+    if (n_refs < length)
+        g_error ("%i values referenced for %i values in set", n_refs, length);
+    ccm_set_clear (set);
+    ccm_set_trim (set);
+    if (n_refs != 0)
+        g_error ("%i values still referenced after trim", n_refs);
+
+    // Per frame usage: fill and clear the same set
+    timer = g_timer_new ();
+    for (frame = 0; frame < N_FRAMES; ++frame)
+    {
+        ccm_set_clear (set);
+        for (cpt = 0; cpt < N_VALUES; ++cpt)
+            ccm_set_insert (set, values[cpt]);
+    }
+    elapsed = g_timer_elapsed (timer, NULL);
+    g_print ("insert     : %6.1f ns/value\n",
+             elapsed * 1000000000.0 / (N_VALUES * N_FRAMES));
+
+    g_timer_start (timer);
+    for (frame = 0; frame < N_FRAMES; ++frame)
+    {
+        ccm_set_clear (set);
+        ccm_set_insert_all (set, values, N_VALUES);
+    }
+    elapsed = g_timer_elapsed (timer, NULL);
+    g_print ("insert all : %6.1f ns/value\n",
+             elapsed * 1000000000.0 / (N_VALUES * N_FRAMES));
+
+    g_timer_start (timer);
+    for (frame = 0; frame < N_FRAMES; ++frame)
+        ccm_set_clear (set);
+    elapsed = g_timer_elapsed (timer, NULL);
+    g_print ("clear      : %6.1f ns/set of %i values\n",
+             elapsed * 1000000000.0 / N_FRAMES, length);
+
+    g_timer_destroy (timer);
+    g_object_unref (set);
+    if (n_refs != 0)
+        g_error ("%i values still referenced after destroy", n_refs);
+    g_free (twice);
+    g_free (values);
+
+    return 0;
+}
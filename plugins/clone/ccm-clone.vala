@@ -413,6 +413,17 @@ namespace CCM
             ((CCM.ScreenPlugin) parent).screen_load_options (screen);
         }
 
+        /**
+         * Implement modify frame screen plugin interface, screen outputs
+         * are only refreshed when windows are painted
+         **/
+        bool
+        screen_modify_frame (CCM.Screen screen)
+        {
+            return (screen_outputs != null && screen_outputs.size > 0) ||
+                   ((CCM.ScreenPlugin) parent).screen_modify_frame (screen);
+        }
+
         /**
          * Implement paint window plugin interface
          **/
@@ -470,8 +481,7 @@ namespace CCM
                                     ctx.scale (scale_x, scale_y);
                                     surface.set_device_offset (output.x, output.y);
                                     ctx.translate (-area.x, -area.y);
-                                    window.get_damage_path (ctx);
-                                    ctx.clip ();
+                                    window.clip_damage (ctx);
 
                                     ctx.translate (area.x, area.y);
                                     ctx.set_source_surface (surface,
@@ -486,8 +496,7 @@ namespace CCM
                                     {
                                         CCM.Region region = new CCM.Region (output.x, output.y, (int)width, (int)height);
                                         window.undamage_region (region);
-                                        window.get_damage_path (context);
-                                        context.clip ();
+                                        window.clip_damage (context);
                                     }
                                 }
                             }
@@ -516,8 +525,7 @@ namespace CCM
                                                            -geometry.x * (1 - clipbox.width / width),
                                                            -geometry.y * (1 - clipbox.height / height));
                                     ctx.set_matrix (matrix);
-                                    window.get_damage_path (ctx);
-                                    ctx.clip ();
+                                    window.clip_damage (ctx);
                                     ctx.identity_matrix ();
                                     window.push_matrix ("CCMClone", matrix);
                                     ((CCM.WindowPlugin) parent).window_paint (window, ctx, surface);
@@ -20,7 +20,6 @@
 #include <math.h>
 #include <string.h>
 
-#include "ccm-property-async.h"
 #include "ccm-debug.h"
 #include "ccm-config.h"
 #include "ccm-drawable.h"
@@ -59,6 +58,7 @@ static void ccm_fade_on_property_changed (CCMFade * self,
                                           CCMPropertyType changed,
                                           CCMWindow * window);
 static void ccm_fade_on_option_changed (CCMPlugin * plugin, int index);
+static void ccm_fade_finish (CCMFade * self);
 
 CCM_DEFINE_PLUGIN_WITH_OPTIONS (CCMFade, ccm_fade, CCM_TYPE_PLUGIN,
                                 CCM_IMPLEMENT_INTERFACE (ccm_fade, CCM_TYPE_SCREEN_PLUGIN,
@@ -145,6 +145,16 @@ ccm_fade_finalize (GObject * object)
 {
     CCMFade *self = CCM_FADE (object);
 
+    // Plugin can be removed from chain on window type change, terminate
+    // current fade to release map or unmap of window
+    if (self->priv->timeline && ccm_timeline_get_is_playing (self->priv->timeline))
+    {
+        ccm_timeline_stop (self->priv->timeline);
+        if (CCM_IS_WINDOW (self->priv->window)
+            && G_OBJECT (self->priv->window)->ref_count)
+            ccm_fade_finish (self);
+    }
+
     if (CCM_IS_SCREEN (self->priv->screen)
         && G_OBJECT (self->priv->screen)->ref_count && self->priv->id_event)
     {
@@ -279,18 +289,11 @@ ccm_fade_on_option_changed (CCMPlugin * plugin, int index)
 }
 
 static void
-ccm_fade_on_get_fade_disable_property (CCMFade * self, guint n_items,
-                                       gchar * result, CCMPropertyASync * prop)
+ccm_fade_on_get_fade_disable_property (CCMFade * self, Atom property,
+                                       guint n_items, gchar * result)
 {
-    g_return_if_fail (CCM_IS_PROPERTY_ASYNC (prop));
-
     if (!CCM_IS_FADE (self))
-    {
-        g_object_unref (prop);
         return;
-    }
-
-    Atom property = ccm_property_async_get_property (prop);
 
     if (result)
     {
@@ -304,8 +307,6 @@ ccm_fade_on_get_fade_disable_property (CCMFade * self, guint n_items,
             self->priv->force_disable = disable == 1 ? TRUE : FALSE;
         }
     }
-
-    g_object_unref (prop);
 }
 
 static void
@@ -314,43 +315,14 @@ ccm_fade_query_force_disable (CCMFade * self)
     g_return_if_fail (self != NULL);
     g_return_if_fail (self->priv->window != NULL);
 
-    CCMDisplay *display =
-        ccm_drawable_get_display (CCM_DRAWABLE (self->priv->window));
-
-    Window child = _ccm_window_get_child(self->priv->window);
-
-    if (!child)
-    {
-        ccm_debug_window (self->priv->window, "QUERY FADE 0x%x", child);
-        CCMPropertyASync *prop = ccm_property_async_new (display,
-                                                         CCM_WINDOW_XWINDOW
-                                                         (self->priv->window),
-                                                         CCM_FADE_GET_CLASS
-                                                         (self)->
-                                                         fade_disable_atom,
-                                                         XA_CARDINAL, 32);
-
-        g_signal_connect (prop, "error", G_CALLBACK (g_object_unref), NULL);
-        g_signal_connect_swapped (prop, "reply",
-                                  G_CALLBACK
-                                  (ccm_fade_on_get_fade_disable_property),
-                                  self);
-    }
-    else
-    {
-        ccm_debug_window (self->priv->window, "QUERY CHILD FADE 0x%x", child);
-        CCMPropertyASync *prop = ccm_property_async_new (display, child,
-                                                         CCM_FADE_GET_CLASS
-                                                         (self)->
-                                                         fade_disable_atom,
-                                                         XA_CARDINAL, 32);
-
-        g_signal_connect (prop, "error", G_CALLBACK (g_object_unref), NULL);
-        g_signal_connect_swapped (prop, "reply",
-                                  G_CALLBACK
-                                  (ccm_fade_on_get_fade_disable_property),
-                                  self);
-    }
+    ccm_debug_window (self->priv->window, "QUERY FADE 0x%x",
+                      _ccm_window_get_child (self->priv->window));
+    ccm_window_get_property_async (self->priv->window,
+                                   CCM_FADE_GET_CLASS (self)->fade_disable_atom,
+                                   XA_CARDINAL, 32,
+                                   (CCMWindowPropertyFunc)
+                                   ccm_fade_on_get_fade_disable_property,
+                                   self);
 }
 
 static void
@@ -460,17 +432,27 @@ static void
 ccm_fade_window_map (CCMWindowPlugin * plugin, CCMWindow * window)
 {
     CCMFade *self = CCM_FADE (plugin);
+    guint duration = 0;
 
     if (!self->priv->force_disable)
+        duration = ccm_window_admit_animation (window,
+                                               (guint)(ccm_fade_get_option (self)->duration * 1000.0));
+
+    if (!duration && self->priv->timeline &&
+        ccm_timeline_get_is_playing (self->priv->timeline))
+    {
+        // Animation skipped by governor, terminate current one
+        ccm_timeline_stop (self->priv->timeline);
+        ccm_fade_finish (self);
+        ccm_window_set_opacity (window, self->priv->origin);
+    }
+    else if (duration)
     {
         guint current_frame = 0;
 
         if (!self->priv->timeline)
         {
-            self->priv->timeline =
-                ccm_timeline_new_for_duration ((guint)
-                                               (ccm_fade_get_option (self)->
-                                                duration * 1000.0));
+            self->priv->timeline = ccm_timeline_new_for_duration (duration);
 
             g_signal_connect_swapped (self->priv->timeline, "new-frame",
                                       G_CALLBACK (ccm_fade_on_new_frame), self);
@@ -489,6 +471,7 @@ ccm_fade_window_map (CCMWindowPlugin * plugin, CCMWindow * window)
             self->priv->origin = ccm_window_get_opacity (window);
             ccm_window_set_opacity (window, 0.0);
         }
+        ccm_timeline_set_duration (self->priv->timeline, duration);
 
         CCM_WINDOW_PLUGIN_LOCK_ROOT_METHOD (plugin, map,
                                             (CCMPluginUnlockFunc)
@@ -510,17 +493,27 @@ static void
 ccm_fade_window_unmap (CCMWindowPlugin * plugin, CCMWindow * window)
 {
     CCMFade *self = CCM_FADE (plugin);
+    guint duration = 0;
 
     if (!self->priv->force_disable)
+        duration = ccm_window_admit_animation (window,
+                                               (guint)(ccm_fade_get_option (self)->duration * 1000.0));
+
+    if (!duration && self->priv->timeline &&
+        ccm_timeline_get_is_playing (self->priv->timeline))
+    {
+        // Animation skipped by governor, terminate current one
+        ccm_timeline_stop (self->priv->timeline);
+        ccm_fade_finish (self);
+        ccm_window_set_opacity (window, self->priv->origin);
+    }
+    else if (duration)
     {
         guint current_frame = 0;
 
         if (!self->priv->timeline)
         {
-            self->priv->timeline =
-                ccm_timeline_new_for_duration ((guint)
-                                               (ccm_fade_get_option (self)->
-                                                duration * 1000.0));
+            self->priv->timeline = ccm_timeline_new_for_duration (duration);
 
             g_signal_connect_swapped (self->priv->timeline, "new-frame",
                                       G_CALLBACK (ccm_fade_on_new_frame), self);
@@ -536,6 +529,7 @@ ccm_fade_window_unmap (CCMWindowPlugin * plugin, CCMWindow * window)
         }
         else
             ccm_window_set_opacity (window, self->priv->origin);
+        ccm_timeline_set_duration (self->priv->timeline, duration);
 
         CCM_WINDOW_PLUGIN_LOCK_ROOT_METHOD (plugin, unmap,
                                             (CCMPluginUnlockFunc)
@@ -620,6 +614,7 @@ ccm_fade_screen_iface_init (CCMScreenPluginClass * iface)
     iface->add_window = NULL;
     iface->remove_window = NULL;
     iface->damage = NULL;
+    iface->modify_frame = NULL;
 }
 
 static void
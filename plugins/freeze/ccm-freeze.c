@@ -227,7 +227,7 @@ ccm_freeze_on_event (CCMFreeze * self, XEvent * event, CCMDisplay * display)
                 CCMFreeze* freeze = CCM_FREEZE(_ccm_window_get_plugin(window,
                                                                       CCM_TYPE_FREEZE));
 
-                if (freeze->priv->last_ping)
+                if (freeze && freeze->priv->last_ping)
                 {
                     ccm_debug_window (window, "PONG 0x%x",
                                       client_message_event->window);
@@ -425,8 +425,6 @@ ccm_freeze_window_paint (CCMWindowPlugin * plugin, CCMWindow * window,
         ccm_drawable_get_geometry_clipbox (CCM_DRAWABLE (window), &geometry))
     {
         CCMRegion *tmp = ccm_window_get_area_geometry (window);
-        int cpt, nb_rects;
-        cairo_rectangle_t *rects;
 
         if (self->priv->frozen == NULL)
         {
@@ -456,11 +454,7 @@ ccm_freeze_window_paint (CCMWindowPlugin * plugin, CCMWindow * window,
 
         cairo_save (context);
 
-        ccm_region_get_rectangles (tmp, &rects, &nb_rects);
-        for (cpt = 0; cpt < nb_rects; ++cpt)
-            cairo_rectangle (context, rects[cpt].x, rects[cpt].y, rects[cpt].width, rects[cpt].height);
-        cairo_clip (context);
-        cairo_rectangles_free (rects, nb_rects);
+        ccm_region_clip (tmp, context);
         ccm_region_destroy (tmp);
         if (!ccm_freeze_get_option (self)->color)
             cairo_set_source_rgb (context, 0, 0, 0);
@@ -558,6 +552,7 @@ ccm_freeze_screen_iface_init (CCMScreenPluginClass * iface)
     iface->add_window = NULL;
     iface->remove_window = NULL;
     iface->damage = NULL;
+    iface->modify_frame = NULL;
 }
 
 static void
@@ -20,7 +20,6 @@
 #include <math.h>
 #include <string.h>
 
-#include "ccm-property-async.h"
 #include "ccm-config.h"
 #include "ccm-debug.h"
 #include "ccm-drawable.h"
@@ -75,6 +74,7 @@ static void ccm_menu_animation_on_event (CCMMenuAnimation * self,
                                          XEvent * event);
 static void ccm_menu_animation_on_option_changed (CCMPlugin * plugin, 
                                                   int index);
+static void ccm_menu_animation_finish (CCMMenuAnimation * self);
 
 CCM_DEFINE_PLUGIN_WITH_OPTIONS (CCMMenuAnimation, ccm_menu_animation, CCM_TYPE_PLUGIN,
                                 CCM_IMPLEMENT_INTERFACE (ccm_menu_animation,
@@ -164,6 +164,16 @@ ccm_menu_animation_finalize (GObject * object)
 {
     CCMMenuAnimation *self = CCM_MENU_ANIMATION (object);
 
+    // Plugin can be removed from chain on window type change, terminate
+    // current animation to release map or unmap of window
+    if (self->priv->timeline && ccm_timeline_get_is_playing (self->priv->timeline))
+    {
+        ccm_timeline_stop (self->priv->timeline);
+        if (CCM_IS_WINDOW (self->priv->window)
+            && G_OBJECT (self->priv->window)->ref_count)
+            ccm_menu_animation_finish (self);
+    }
+
     if (CCM_IS_SCREEN (self->priv->screen)
         && G_OBJECT (self->priv->screen)->ref_count)
     {
@@ -207,18 +217,11 @@ ccm_menu_animation_class_init (CCMMenuAnimationClass * klass)
 
 static void
 ccm_menu_animation_on_get_animation_property (CCMMenuAnimation * self,
-                                              guint n_items, gchar * result,
-                                              CCMPropertyASync * prop)
+                                              Atom property, guint n_items,
+                                              gchar * result)
 {
-    g_return_if_fail (CCM_IS_PROPERTY_ASYNC (prop));
-
     if (!CCM_IS_MENU_ANIMATION (self))
-    {
-        g_object_unref (prop);
         return;
-    }
-
-    Atom property = ccm_property_async_get_property (prop);
 
     if (result)
     {
@@ -247,8 +250,6 @@ ccm_menu_animation_on_get_animation_property (CCMMenuAnimation * self,
                 self->priv->y_pos = CCM_MENU_ANIMATION_MIDDLE;
         }
     }
-
-    g_object_unref (prop);
 }
 
 static void
@@ -257,42 +258,14 @@ ccm_menu_animation_query_forced_animation (CCMMenuAnimation * self)
     g_return_if_fail (self != NULL);
     g_return_if_fail (self->priv->window != NULL);
 
-    CCMDisplay *display =
-        ccm_drawable_get_display (CCM_DRAWABLE (self->priv->window));
-
-    Window child = _ccm_window_get_child(self->priv->window);
-
-    if (!child)
-    {
-        ccm_debug_window (self->priv->window, "QUERY ANIMATION 0x%x", child);
-        CCMPropertyASync *prop = ccm_property_async_new (display,
-                                                         CCM_WINDOW_XWINDOW
-                                                         (self->priv->window),
-                                                         CCM_MENU_ANIMATION_GET_CLASS
-                                                         (self)->animation_atom,
-                                                         XA_CARDINAL, 32);
-
-        g_signal_connect (prop, "error", G_CALLBACK (g_object_unref), NULL);
-        g_signal_connect_swapped (prop, "reply",
-                                  G_CALLBACK
-                                  (ccm_menu_animation_on_get_animation_property),
-                                  self);
-    }
-    else
-    {
-        ccm_debug_window (self->priv->window, "QUERY CHILD ANIMATION 0x%x",
-                          child);
-        CCMPropertyASync *prop = ccm_property_async_new (display, child,
-                                                         CCM_MENU_ANIMATION_GET_CLASS
-                                                         (self)->animation_atom,
-                                                         XA_CARDINAL, 32);
-
-        g_signal_connect (prop, "error", G_CALLBACK (g_object_unref), NULL);
-        g_signal_connect_swapped (prop, "reply",
-                                  G_CALLBACK
-                                  (ccm_menu_animation_on_get_animation_property),
-                                  self);
-    }
+    ccm_debug_window (self->priv->window, "QUERY ANIMATION 0x%x",
+                      _ccm_window_get_child (self->priv->window));
+    ccm_window_get_property_async (self->priv->window,
+                                   CCM_MENU_ANIMATION_GET_CLASS (self)->animation_atom,
+                                   XA_CARDINAL, 32,
+                                   (CCMWindowPropertyFunc)
+                                   ccm_menu_animation_on_get_animation_property,
+                                   self);
 }
 
 static void
@@ -645,13 +618,26 @@ ccm_menu_animation_map (CCMWindowPlugin * plugin, CCMWindow * window)
         || self->priv->type == CCM_WINDOW_TYPE_POPUP_MENU)
     {
         guint current_frame = 0;
+        guint duration;
+
+        duration = ccm_window_admit_animation (window,
+                                               (guint)(ccm_menu_animation_get_option (self)->duration * 1000.0));
+        if (!duration)
+        {
+            // Animation skipped by governor, terminate current one
+            if (self->priv->timeline &&
+                ccm_timeline_get_is_playing (self->priv->timeline))
+            {
+                ccm_timeline_stop (self->priv->timeline);
+                ccm_menu_animation_finish (self);
+            }
+            ccm_window_plugin_map (CCM_WINDOW_PLUGIN_PARENT (plugin), window);
+            return;
+        }
 
         if (!self->priv->timeline)
         {
-            self->priv->timeline =
-                ccm_timeline_new_for_duration ((guint)
-                                               (ccm_menu_animation_get_option
-                                                (self)->duration * 1000.0));
+            self->priv->timeline = ccm_timeline_new_for_duration (duration);
 
             g_signal_connect_swapped (self->priv->timeline, "new-frame",
                                       G_CALLBACK
@@ -686,6 +672,7 @@ ccm_menu_animation_map (CCMWindowPlugin * plugin, CCMWindow * window)
 
         ccm_debug_window (window, "MENU ANIMATION MAP");
 
+        ccm_timeline_set_duration (self->priv->timeline, duration);
         ccm_timeline_set_direction (self->priv->timeline, CCM_TIMELINE_DIRECTION_FORWARD);
         ccm_timeline_rewind (self->priv->timeline);
         ccm_timeline_start (self->priv->timeline);
@@ -708,13 +695,26 @@ ccm_menu_animation_unmap (CCMWindowPlugin * plugin, CCMWindow * window)
         || self->priv->type == CCM_WINDOW_TYPE_POPUP_MENU)
     {
         guint current_frame = 0;
+        guint duration;
+
+        duration = ccm_window_admit_animation (window,
+                                               (guint)(ccm_menu_animation_get_option (self)->duration * 1000.0));
+        if (!duration)
+        {
+            // Animation skipped by governor, terminate current one
+            if (self->priv->timeline &&
+                ccm_timeline_get_is_playing (self->priv->timeline))
+            {
+                ccm_timeline_stop (self->priv->timeline);
+                ccm_menu_animation_finish (self);
+            }
+            ccm_window_plugin_unmap (CCM_WINDOW_PLUGIN_PARENT (plugin), window);
+            return;
+        }
 
         if (!self->priv->timeline)
         {
-            self->priv->timeline =
-                ccm_timeline_new_for_duration ((guint)
-                                               (ccm_menu_animation_get_option
-                                                (self)->duration * 1000.0));
+            self->priv->timeline = ccm_timeline_new_for_duration (duration);
 
             g_signal_connect_swapped (self->priv->timeline, "new-frame",
                                       G_CALLBACK
@@ -741,6 +741,7 @@ ccm_menu_animation_unmap (CCMWindowPlugin * plugin, CCMWindow * window)
                                             self);
 
         ccm_debug_window (window, "MENU ANIMATION UNMAP");
+        ccm_timeline_set_duration (self->priv->timeline, duration);
         ccm_timeline_set_direction (self->priv->timeline,
                                     CCM_TIMELINE_DIRECTION_BACKWARD);
         ccm_timeline_rewind (self->priv->timeline);
@@ -819,6 +820,7 @@ ccm_menu_animation_screen_iface_init (CCMScreenPluginClass * iface)
     iface->add_window = NULL;
     iface->remove_window = NULL;
     iface->damage = NULL;
+    iface->modify_frame = NULL;
 }
 
 static void
@@ -814,6 +814,16 @@ namespace CCM
             screen.activate_window_notify.connect (on_window_activate_notify);
         }
 
+        ////////////////////////////////////////////////////////////////////
+        ////////////////////////////////////////////////////////////////////
+        bool
+        screen_modify_frame (CCM.Screen screen)
+        {
+            // windows are moved in mosaic areas and shaded
+            return enabled ||
+                   ((CCM.ScreenPlugin) parent).screen_modify_frame (screen);
+        }
+
         ////////////////////////////////////////////////////////////////////
         ////////////////////////////////////////////////////////////////////
         bool
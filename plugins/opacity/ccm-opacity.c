@@ -545,6 +545,7 @@ ccm_opacity_screen_iface_init (CCMScreenPluginClass * iface)
     iface->add_window = NULL;
     iface->remove_window = NULL;
     iface->damage = NULL;
+    iface->modify_frame = NULL;
 }
 
 static void
@@ -90,6 +90,20 @@ struct _CCMPerfPrivate
     guint64 mem_size;
     guint64 mem_xorg;
 
+    guint64 x_reads;
+    guint64 x_frames;
+    gfloat x_reads_per_frame;
+    guint64 x_copied_bytes;
+    guint64 x_copy_frames;
+    gfloat x_copied_per_frame;
+    guint64 x_events;
+    guint64 x_dropped_events;
+    gfloat x_events_per_frame;
+    guint x_pdropped;
+    guint64 x_property_hits;
+    guint64 x_property_misses;
+    guint x_pproperty_hits;
+
 #ifdef HAVE_CUDA
     CUcontext cuda_ctx;
     guint mem_cuda_free_size;
@@ -150,9 +164,9 @@ ccm_perf_options_changed (CCMPerfOptions* self, CCMConfig* config)
         }
         self->area.width = 280;
 #ifdef HAVE_CUDA
-        self->area.height = 110;
+        self->area.height = 206;
 #else
-        self->area.height = 100;
+        self->area.height = 196;
 #endif
     }
 
@@ -184,6 +198,19 @@ ccm_perf_init (CCMPerf * self)
     self->priv->pcpu = 0;
     self->priv->mem_size = 0;
     self->priv->mem_xorg = 0;
+    self->priv->x_reads = 0;
+    self->priv->x_frames = 0;
+    self->priv->x_reads_per_frame = 0.0f;
+    self->priv->x_copied_bytes = 0;
+    self->priv->x_copy_frames = 0;
+    self->priv->x_copied_per_frame = 0.0f;
+    self->priv->x_events = 0;
+    self->priv->x_dropped_events = 0;
+    self->priv->x_events_per_frame = 0.0f;
+    self->priv->x_pdropped = 0;
+    self->priv->x_property_hits = 0;
+    self->priv->x_property_misses = 0;
+    self->priv->x_pproperty_hits = 0;
     self->priv->enabled = FALSE;
     self->priv->need_refresh = TRUE;
     self->priv->timer = NULL;
@@ -240,6 +267,66 @@ ccm_perf_class_init (CCMPerfClass * klass)
 #endif
 }
 
+static void
+ccm_perf_get_x_reads (CCMPerf * self)
+{
+    g_return_if_fail (self != NULL);
+
+    CCMDisplay *display = ccm_screen_get_display (self->priv->screen);
+    guint64 reads, frames, events, dropped;
+
+    ccm_display_get_io_counters (display, &reads, &frames);
+    ccm_display_get_event_counters (display, &events, &dropped);
+    if (frames > self->priv->x_frames)
+    {
+        self->priv->x_reads_per_frame = (gfloat) (reads - self->priv->x_reads) /
+                                        (gfloat) (frames - self->priv->x_frames);
+        self->priv->x_events_per_frame = (gfloat) (events - self->priv->x_events) /
+                                         (gfloat) (frames - self->priv->x_frames);
+    }
+    if (events > self->priv->x_events)
+        self->priv->x_pdropped = (dropped - self->priv->x_dropped_events) * 100 /
+                                 (events - self->priv->x_events);
+    self->priv->x_reads = reads;
+    self->priv->x_frames = frames;
+    self->priv->x_events = events;
+    self->priv->x_dropped_events = dropped;
+}
+
+static void
+ccm_perf_get_x_copies (CCMPerf * self)
+{
+    g_return_if_fail (self != NULL);
+
+    CCMDisplay *display = ccm_screen_get_display (self->priv->screen);
+    guint64 bytes, frames;
+
+    ccm_display_get_copy_counters (display, &bytes, &frames);
+    if (frames > self->priv->x_copy_frames)
+        self->priv->x_copied_per_frame = (gfloat) (bytes - self->priv->x_copied_bytes) /
+                                         (gfloat) (frames - self->priv->x_copy_frames);
+    self->priv->x_copied_bytes = bytes;
+    self->priv->x_copy_frames = frames;
+}
+
+static void
+ccm_perf_get_x_properties (CCMPerf * self)
+{
+    g_return_if_fail (self != NULL);
+
+    CCMDisplay *display = ccm_screen_get_display (self->priv->screen);
+    guint64 hits, misses, reads;
+
+    ccm_display_get_property_cache_counters (display, &hits, &misses);
+    reads = hits - self->priv->x_property_hits +
+            misses - self->priv->x_property_misses;
+    if (reads)
+        self->priv->x_pproperty_hits = (hits - self->priv->x_property_hits) * 100 /
+                                       reads;
+    self->priv->x_property_hits = hits;
+    self->priv->x_property_misses = misses;
+}
+
 static void
 ccm_perf_show_text (CCMPerf * self, cairo_t * context, gchar * text, int line)
 {
@@ -400,6 +487,9 @@ ccm_perf_screen_paint (CCMScreenPlugin * plugin, CCMScreen * screen,
         if (self->priv->elapsed > 1000)
         {
             self->priv->fps = (self->priv->frames / self->priv->elapsed) * 1000;
+            ccm_perf_get_x_reads (self);
+            ccm_perf_get_x_copies (self);
+            ccm_perf_get_x_properties (self);
             self->priv->elapsed = 0.0f;
             self->priv->frames = 0;
             self->priv->need_refresh = TRUE;
@@ -428,6 +518,8 @@ ccm_perf_screen_paint (CCMScreenPlugin * plugin, CCMScreen * screen,
         {
             cairo_surface_t *icon;
             gchar *text;
+            guint64 pixmaps, images, shadows;
+            guint64 admitted, shortened, skipped;
             CCMRegion *area = ccm_region_rectangle (&ccm_perf_get_option (self)->area);
 
             ccm_screen_add_damaged_region (screen, area);
@@ -465,13 +557,44 @@ ccm_perf_screen_paint (CCMScreenPlugin * plugin, CCMScreen * screen,
             text = g_strdup_printf ("XMem : %li Kb", (glong) (self->priv->mem_xorg / 1024));
             ccm_perf_show_text (self, context, text, 3);
             g_free (text);
+            text = g_strdup_printf ("XRead : %.2f/frame", self->priv->x_reads_per_frame);
+            ccm_perf_show_text (self, context, text, 4);
+            g_free (text);
+            text = g_strdup_printf ("XCopy : %.1f Kb/frame", self->priv->x_copied_per_frame / 1024.0f);
+            ccm_perf_show_text (self, context, text, 5);
+            g_free (text);
+            text = g_strdup_printf ("XEvent : %.1f/frame %i %% merged",
+                                    self->priv->x_events_per_frame,
+                                    self->priv->x_pdropped);
+            ccm_perf_show_text (self, context, text, 6);
+            g_free (text);
+            text = g_strdup_printf ("XProp : %i %% cached",
+                                    self->priv->x_pproperty_hits);
+            ccm_perf_show_text (self, context, text, 7);
+            g_free (text);
+
+            ccm_screen_get_memory_usage (screen, &pixmaps, &images, &shadows);
+            text = g_strdup_printf ("Pixmap : %li/%li/%li Kb",
+                                    (glong) (pixmaps / 1024),
+                                    (glong) (images / 1024),
+                                    (glong) (shadows / 1024));
+            ccm_perf_show_text (self, context, text, 8);
+            g_free (text);
+
+            ccm_screen_get_animation_counters (screen, &admitted, &shortened,
+                                               &skipped);
+            text = g_strdup_printf ("Anim : %li/%li/%li",
+                                    (glong) admitted, (glong) shortened,
+                                    (glong) skipped);
+            ccm_perf_show_text (self, context, text, 9);
+            g_free (text);
 
 #ifdef HAVE_CUDA
             ccm_perf_get_cuda_info (self);
             text = g_strdup_printf ("Cuda : %li/%li Mb",
                                     (glong) (self->priv->mem_cuda_free_size / (1024*1024)),
                                     (glong) (self->priv->mem_cuda_used_size / (1024*1024)));
-            ccm_perf_show_text (self, context, text, 4);
+            ccm_perf_show_text (self, context, text, 10);
             g_free (text);
 #endif
 
@@ -483,6 +606,16 @@ ccm_perf_screen_paint (CCMScreenPlugin * plugin, CCMScreen * screen,
     return ret;
 }
 
+static gboolean
+ccm_perf_screen_modify_frame (CCMScreenPlugin * plugin, CCMScreen * screen)
+{
+    CCMPerf *self = CCM_PERF (plugin);
+
+    return self->priv->enabled ||
+           ccm_screen_plugin_modify_frame (CCM_SCREEN_PLUGIN_PARENT (plugin),
+                                           screen);
+}
+
 static void
 ccm_perf_screen_iface_init (CCMScreenPluginClass * iface)
 {
@@ -491,4 +624,5 @@ ccm_perf_screen_iface_init (CCMScreenPluginClass * iface)
     iface->add_window = NULL;
     iface->remove_window = NULL;
     iface->damage = NULL;
+    iface->modify_frame = ccm_perf_screen_modify_frame;
 }
@@ -20,7 +20,6 @@
 #include <math.h>
 #include <string.h>
 
-#include "ccm-property-async.h"
 #include "ccm-drawable.h"
 #include "ccm-display.h"
 #include "ccm-screen.h"
@@ -105,6 +104,8 @@ struct _CCMShadowPrivate
     gboolean have_shadow;
     CCMPixmap *pixmap;
     CCMPixmap *shadow;
+    CCMRegion *damaged;
+    gboolean   redraw;
 
     CCMRegion *geometry;
 
@@ -204,6 +205,8 @@ ccm_shadow_init (CCMShadow * self)
     self->priv->have_shadow = FALSE;
     self->priv->window = NULL;
     self->priv->shadow = NULL;
+    self->priv->damaged = NULL;
+    self->priv->redraw = FALSE;
     self->priv->geometry = NULL;
     self->priv->builder = NULL;
     self->priv->id_event = 0;
@@ -238,6 +241,10 @@ ccm_shadow_finalize (GObject * object)
         self->priv->geometry = NULL;
     }
 
+    if (self->priv->damaged)
+        ccm_region_destroy (self->priv->damaged);
+    self->priv->damaged = NULL;
+
     if (self->priv->shadow)
         g_object_unref (self->priv->shadow);
     self->priv->shadow = NULL;
@@ -376,18 +383,11 @@ ccm_shadow_check_needed (CCMShadow * self)
 }
 
 static void
-ccm_shadow_on_get_shadow_property (CCMShadow * self, guint n_items,
-                                   gchar * result, CCMPropertyASync * prop)
+ccm_shadow_on_get_shadow_property (CCMShadow * self, Atom property,
+                                   guint n_items, gchar * result)
 {
-    g_return_if_fail (CCM_IS_PROPERTY_ASYNC (prop));
-
     if (!CCM_IS_SHADOW (self))
-    {
-        g_object_unref (prop);
         return;
-    }
-
-    Atom property = ccm_property_async_get_property (prop);
 
     if (result)
     {
@@ -425,8 +425,6 @@ ccm_shadow_on_get_shadow_property (CCMShadow * self, guint n_items,
             }
         }
     }
-
-    g_object_unref (prop);
 }
 
 static void
@@ -435,34 +433,13 @@ ccm_shadow_query_force_shadow (CCMShadow * self)
     g_return_if_fail (self != NULL);
     g_return_if_fail (self->priv->window != NULL);
 
-    CCMDisplay *display = ccm_drawable_get_display (CCM_DRAWABLE (self->priv->window));
-
-    Window child = _ccm_window_get_child(self->priv->window);
-
-    if (!child)
-    {
-        ccm_debug_window (self->priv->window, "QUERY SHADOW 0x%x", child);
-        CCMPropertyASync *prop = ccm_property_async_new (display,
-                                                         CCM_WINDOW_XWINDOW(self->priv->window),
-                                                         CCM_SHADOW_GET_CLASS(self)->shadow_enable_atom,
-                                                         XA_CARDINAL, 32);
-
-        g_signal_connect (prop, "error", G_CALLBACK (g_object_unref), NULL);
-        g_signal_connect_swapped (prop, "reply",
-                                  G_CALLBACK
-                                  (ccm_shadow_on_get_shadow_property), self);
-    }
-    else
-    {
-        ccm_debug_window (self->priv->window, "QUERY CHILD SHADOW 0x%x", child);
-        CCMPropertyASync *prop = ccm_property_async_new (display, child,
-                                                         CCM_SHADOW_GET_CLASS(self)->shadow_enable_atom,
-                                                         XA_CARDINAL, 32);
-
-        g_signal_connect (prop, "error", G_CALLBACK (g_object_unref), NULL);
-        g_signal_connect_swapped (prop, "reply",
-                                  G_CALLBACK(ccm_shadow_on_get_shadow_property), self);
-    }
+    ccm_debug_window (self->priv->window, "QUERY SHADOW 0x%x",
+                      _ccm_window_get_child (self->priv->window));
+    ccm_window_get_property_async (self->priv->window,
+                                   CCM_SHADOW_GET_CLASS (self)->shadow_enable_atom,
+                                   XA_CARDINAL, 32,
+                                   (CCMWindowPropertyFunc)
+                                   ccm_shadow_on_get_shadow_property, self);
 }
 
 static void
@@ -471,33 +448,13 @@ ccm_shadow_query_avoid_shadow (CCMShadow * self)
     g_return_if_fail (self != NULL);
     g_return_if_fail (self->priv->window != NULL);
 
-    CCMDisplay *display = ccm_drawable_get_display (CCM_DRAWABLE (self->priv->window));
-
-    Window child = _ccm_window_get_child(self->priv->window);
-
-    if (!child)
-    {
-        ccm_debug_window (self->priv->window, "QUERY SHADOW 0x%x", child);
-        CCMPropertyASync *prop = ccm_property_async_new (display,
-                                                         CCM_WINDOW_XWINDOW(self->priv->window),
-                                                         CCM_SHADOW_GET_CLASS(self)->shadow_disable_atom,
-                                                         XA_CARDINAL, 32);
-
-        g_signal_connect (prop, "error", G_CALLBACK (g_object_unref), NULL);
-        g_signal_connect_swapped (prop, "reply",
-                                  G_CALLBACK(ccm_shadow_on_get_shadow_property), self);
-    }
-    else
-    {
-        ccm_debug_window (self->priv->window, "QUERY CHILD SHADOW 0x%x", child);
-        CCMPropertyASync *prop = ccm_property_async_new (display, child,
-                                                         CCM_SHADOW_GET_CLASS(self)->shadow_disable_atom,
-                                                         XA_CARDINAL, 32);
-
-        g_signal_connect (prop, "error", G_CALLBACK (g_object_unref), NULL);
-        g_signal_connect_swapped (prop, "reply",
-                                  G_CALLBACK(ccm_shadow_on_get_shadow_property), self);
-    }
+    ccm_debug_window (self->priv->window, "QUERY SHADOW 0x%x",
+                      _ccm_window_get_child (self->priv->window));
+    ccm_window_get_property_async (self->priv->window,
+                                   CCM_SHADOW_GET_CLASS (self)->shadow_disable_atom,
+                                   XA_CARDINAL, 32,
+                                   (CCMWindowPropertyFunc)
+                                   ccm_shadow_on_get_shadow_property, self);
 }
 
 static void
@@ -633,18 +590,18 @@ ccm_shadow_on_pixmap_destroyed (CCMShadow * self)
     self->priv->shadow = NULL;
 }
 
+/* Redraw damaged area of window content and shadow in shadow pixmap */
 static void
-ccm_shadow_on_pixmap_damage (CCMShadow* self, CCMRegion* area)
+ccm_shadow_repair (CCMShadow* self)
 {
     g_return_if_fail (self != NULL);
 
-    if (self->priv->shadow && self->priv->pixmap)
+    CCMRegion *area = self->priv->redraw ? NULL : self->priv->damaged;
+
+    if ((self->priv->redraw || area) && self->priv->shadow && self->priv->pixmap)
     {
-        CCMDisplay* display = ccm_drawable_get_display (CCM_DRAWABLE (self->priv->pixmap));
         cairo_surface_t *surface;
         cairo_t *ctx;
-        cairo_rectangle_t *rects = NULL;
-        gint cpt, nb_rects;
         cairo_rectangle_t clipbox;
         gint border = ccm_shadow_get_option (self)->border;
 
@@ -664,12 +621,7 @@ ccm_shadow_on_pixmap_damage (CCMShadow* self, CCMRegion* area)
         if (area)
         {
             cairo_translate (ctx, border, border);
-            ccm_region_get_rectangles (area, &rects, &nb_rects);
-            for (cpt = 0; cpt < nb_rects; ++cpt)
-                cairo_rectangle (ctx, rects[cpt].x, rects[cpt].y, rects[cpt].width, rects[cpt].height);
-            cairo_clip (ctx);
-            if (rects) cairo_rectangles_free (rects, nb_rects);
-            rects = NULL;
+            ccm_region_clip (area, ctx);
         }
         else
         {
@@ -690,12 +642,7 @@ ccm_shadow_on_pixmap_damage (CCMShadow* self, CCMRegion* area)
             cairo_translate (ctx, border, border);
             cairo_translate (ctx, -clipbox.x, -clipbox.y);
 
-            ccm_region_get_rectangles (self->priv->geometry, &rects, &nb_rects);
-            for (cpt = 0; cpt < nb_rects; ++cpt)
-                cairo_rectangle (ctx, rects[cpt].x, rects[cpt].y, rects[cpt].width, rects[cpt].height);
-            cairo_clip (ctx);
-            if (rects) cairo_rectangles_free (rects, nb_rects);
-            rects = NULL;
+            ccm_region_clip (self->priv->geometry, ctx);
             cairo_translate (ctx, clipbox.x, clipbox.y);
 
             cairo_surface_destroy (shadow_image);
@@ -709,7 +656,46 @@ ccm_shadow_on_pixmap_damage (CCMShadow* self, CCMRegion* area)
         }
         cairo_destroy (ctx);
         cairo_surface_destroy (surface);
-        ccm_display_sync (display);
+    }
+
+    if (self->priv->damaged)
+        ccm_region_destroy (self->priv->damaged);
+    self->priv->damaged = NULL;
+    self->priv->redraw = FALSE;
+}
+
+static void
+ccm_shadow_on_pixmap_damage (CCMShadow* self, CCMRegion* area)
+{
+    g_return_if_fail (self != NULL);
+
+    // Only record damage, window content is copied in shadow pixmap when
+    // window is painted so pixmap is not fetched for each damage event
+    if (self->priv->shadow && self->priv->pixmap)
+    {
+        gint border = ccm_shadow_get_option (self)->border;
+        CCMRegion *damage;
+
+        if (!area)
+            self->priv->redraw = TRUE;
+        else if (!self->priv->redraw)
+        {
+            if (self->priv->damaged)
+                ccm_region_union (self->priv->damaged, area);
+            else
+                self->priv->damaged = ccm_region_copy (area);
+        }
+
+        if (area)
+        {
+            damage = ccm_region_copy (area);
+            ccm_region_offset (damage, border, border);
+            ccm_drawable_damage_region (CCM_DRAWABLE (self->priv->shadow),
+                                        damage);
+            ccm_region_destroy (damage);
+        }
+        else
+            ccm_drawable_damage (CCM_DRAWABLE (self->priv->shadow));
     }
 }
 
@@ -855,8 +841,13 @@ ccm_shadow_window_resize (CCMWindowPlugin * plugin, CCMWindow * window,
             ccm_region_resize (self->priv->geometry, width, height);
             border = ccm_shadow_get_option (self)->border;
 
-            if (self->priv->pixmap) g_object_unref (self->priv->pixmap);
-            self->priv->pixmap = NULL;
+            // Window keeps its pixmap during a resize burst, shadow pixmap
+            // is released with it on rebind
+            if (!_ccm_window_rebind_deferred (window))
+            {
+                if (self->priv->pixmap) g_object_unref (self->priv->pixmap);
+                self->priv->pixmap = NULL;
+            }
         }
         else
             return;
@@ -867,6 +858,18 @@ ccm_shadow_window_resize (CCMWindowPlugin * plugin, CCMWindow * window,
 }
 
 
+static gboolean
+ccm_shadow_window_paint (CCMWindowPlugin * plugin, CCMWindow * window,
+                         cairo_t * context, cairo_surface_t * surface)
+{
+    CCMShadow *self = CCM_SHADOW (plugin);
+
+    ccm_shadow_repair (self);
+
+    return ccm_window_plugin_paint (CCM_WINDOW_PLUGIN_PARENT (plugin), window,
+                                    context, surface);
+}
+
 static void
 ccm_shadow_window_set_opaque_region (CCMWindowPlugin * plugin,
                                      CCMWindow * window, const CCMRegion * area)
@@ -932,6 +935,7 @@ ccm_shadow_window_get_pixmap (CCMWindowPlugin * plugin, CCMWindow * window)
 
         ccm_debug_window (window, "CREATE SHADOW PIXMAP");
         self->priv->shadow = ccm_window_create_pixmap (window, swidth, sheight, 32);
+        ccm_pixmap_set_memory_type (self->priv->shadow, CCM_PIXMAP_MEMORY_SHADOW);
 
         g_object_set_qdata_full (G_OBJECT (self->priv->shadow),
                                  CCMShadowPixmapQuark, self,
@@ -1003,7 +1007,7 @@ ccm_shadow_window_iface_init (CCMWindowPluginClass * iface)
 {
     iface->load_options = ccm_shadow_window_load_options;
     iface->query_geometry = ccm_shadow_window_query_geometry;
-    iface->paint = NULL;
+    iface->paint = ccm_shadow_window_paint;
     iface->map = NULL;
     iface->unmap = NULL;
     iface->query_opacity = NULL;
@@ -1022,6 +1026,7 @@ ccm_shadow_screen_iface_init (CCMScreenPluginClass * iface)
     iface->add_window = NULL;
     iface->remove_window = NULL;
     iface->damage = NULL;
+    iface->modify_frame = NULL;
 }
 
 static void
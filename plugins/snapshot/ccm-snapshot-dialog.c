@@ -19,6 +19,7 @@
 
 #include <X11/Xatom.h>
 #include <string.h>
+#include <math.h>
 #include <gtk/gtk.h>
 #include <gdk/gdkx.h>
 
@@ -26,14 +27,29 @@
 #include "ccm-cairo-utils.h"
 #include "ccm-snapshot-dialog.h"
 
+#define CCM_SNAPSHOT_DIALOG_MAX_WRITERS 4
+
 G_DEFINE_TYPE (CCMSnapshotDialog, ccm_snapshot_dialog, G_TYPE_OBJECT);
 
 struct _CCMSnapshotDialogPrivate
 {
     cairo_surface_t *surface;
+    GArray *outputs;
     GtkBuilder *builder;
 };
 
+typedef struct
+{
+    cairo_surface_t *surface;
+    gchar *filename;
+} CCMSnapshotDialogJob;
+
+static cairo_user_data_key_t ccm_snapshot_dialog_parent_key;
+
+// Snapshots are encoded out of main loop, outputs of a snapshot in
+// parallel
+static GThreadPool *CCMSnapshotDialogWriters = NULL;
+
 #define CCM_SNAPSHOT_DIALOG_GET_PRIVATE(o)  \
 (G_TYPE_INSTANCE_GET_PRIVATE ((o), CCM_TYPE_SNAPSHOT_DIALOG, CCMSnapshotDialogPrivate))
 
@@ -42,6 +58,7 @@ ccm_snapshot_dialog_init (CCMSnapshotDialog * self)
 {
     self->priv = CCM_SNAPSHOT_DIALOG_GET_PRIVATE (self);
     self->priv->surface = NULL;
+    self->priv->outputs = NULL;
     self->priv->builder = NULL;
     CCM_SNAPSHOT_DIALOG_GET_CLASS (self)->nb++;
 }
@@ -53,6 +70,8 @@ ccm_snapshot_dialog_finalize (GObject * object)
 
     if (self->priv->surface)
         cairo_surface_destroy (self->priv->surface);
+    if (self->priv->outputs)
+        g_array_free (self->priv->outputs, TRUE);
     if (self->priv->builder)
         g_object_unref (self->priv->builder);
     CCM_SNAPSHOT_DIALOG_GET_CLASS (self)->nb--;
@@ -72,6 +91,91 @@ ccm_snapshot_dialog_class_init (CCMSnapshotDialogClass * klass)
     object_class->finalize = ccm_snapshot_dialog_finalize;
 }
 
+/* Encode a snapshot in a writer thread, job owns its surface */
+static void
+ccm_snapshot_dialog_write (CCMSnapshotDialogJob * job, gpointer data)
+{
+    cairo_status_t status;
+
+    status = cairo_surface_write_to_png (job->surface, job->filename);
+    if (status != CAIRO_STATUS_SUCCESS)
+        g_warning ("Error on write snapshot %s: %s", job->filename,
+                   cairo_status_to_string (status));
+
+    cairo_surface_destroy (job->surface);
+    g_free (job->filename);
+    g_slice_free (CCMSnapshotDialogJob, job);
+}
+
+static void
+ccm_snapshot_dialog_push_write (cairo_surface_t * surface,
+                                const gchar * filename)
+{
+    CCMSnapshotDialogJob *job = g_slice_new (CCMSnapshotDialogJob);
+
+    if (!CCMSnapshotDialogWriters)
+        CCMSnapshotDialogWriters =
+            g_thread_pool_new ((GFunc) ccm_snapshot_dialog_write, NULL,
+                               CCM_SNAPSHOT_DIALOG_MAX_WRITERS, FALSE, NULL);
+
+    job->surface = surface;
+    job->filename = g_strdup (filename);
+    g_thread_pool_push (CCMSnapshotDialogWriters, job, NULL);
+}
+
+/* Get image of an area of snapshot which shares snapshot pixels */
+static cairo_surface_t *
+ccm_snapshot_dialog_get_sub_surface (CCMSnapshotDialog * self,
+                                     cairo_rectangle_t * area)
+{
+    cairo_surface_t *surface;
+    guchar *data = cairo_image_surface_get_data (self->priv->surface);
+    gint stride = cairo_image_surface_get_stride (self->priv->surface);
+    cairo_format_t format = cairo_image_surface_get_format (self->priv->surface);
+
+    surface = cairo_image_surface_create_for_data (data + (gint) area->y * stride +
+                                                   (gint) area->x * 4, format,
+                                                   area->width, area->height,
+                                                   stride);
+    cairo_surface_set_user_data (surface, &ccm_snapshot_dialog_parent_key,
+                                 cairo_surface_reference (self->priv->surface),
+                                 (cairo_destroy_func_t) cairo_surface_destroy);
+
+    return surface;
+}
+
+static void
+ccm_snapshot_dialog_save (CCMSnapshotDialog * self, const gchar * filename)
+{
+    guint cpt;
+
+    cairo_surface_flush (self->priv->surface);
+
+    // Outputs share pixels of snapshot which must be 32 bits
+    if (!self->priv->outputs || self->priv->outputs->len < 2 ||
+        (cairo_image_surface_get_format (self->priv->surface) != CAIRO_FORMAT_ARGB32 &&
+         cairo_image_surface_get_format (self->priv->surface) != CAIRO_FORMAT_RGB24))
+    {
+        ccm_snapshot_dialog_push_write (cairo_surface_reference (self->priv->surface),
+                                        filename);
+        return;
+    }
+
+    for (cpt = 0; cpt < self->priv->outputs->len; ++cpt)
+    {
+        cairo_rectangle_t *area = &g_array_index (self->priv->outputs,
+                                                  cairo_rectangle_t, cpt);
+        const gchar *ext = g_str_has_suffix (filename, ".png") ?
+                           filename + strlen (filename) - 4 : "";
+        gchar *base = g_strndup (filename, strlen (filename) - strlen (ext));
+        gchar *output = g_strdup_printf ("%s-%u%s", base, cpt + 1, ext);
+
+        ccm_snapshot_dialog_push_write (ccm_snapshot_dialog_get_sub_surface (self, area),
+                                        output);
+        g_free (output);
+        g_free (base);
+    }
+}
 
 static void
 ccm_snapshot_dialog_on_close (CCMSnapshotDialog * self, GtkWidget * widget)
@@ -105,7 +209,7 @@ ccm_snapshot_dialog_on_response (CCMSnapshotDialog * self, int response,
         if (dir && file && strlen (file))
         {
             gchar *filename = g_strdup_printf ("%s/%s", dir, file);
-            cairo_surface_write_to_png (self->priv->surface, filename);
+            ccm_snapshot_dialog_save (self, filename);
             g_free (filename);
             g_free (dir);
         }
@@ -276,3 +380,55 @@ ccm_snapshot_dialog_new (cairo_surface_t * surface, CCMScreen * screen)
 
     return self;
 }
+
+/**
+ * ccm_snapshot_dialog_wait_writers:
+ *
+ * Wait snapshots being saved are written and free writer threads.
+ **/
+void
+ccm_snapshot_dialog_wait_writers (void)
+{
+    if (CCMSnapshotDialogWriters)
+        g_thread_pool_free (CCMSnapshotDialogWriters, FALSE, TRUE);
+    CCMSnapshotDialogWriters = NULL;
+}
+
+/**
+ * ccm_snapshot_dialog_set_outputs:
+ * @self: #CCMSnapshotDialog
+ * @outputs: area of each output in snapshot
+ * @n_outputs: number of outputs
+ *
+ * Save one image for each output of snapshot instead of the whole
+ * snapshot.
+ **/
+void
+ccm_snapshot_dialog_set_outputs (CCMSnapshotDialog * self,
+                                 cairo_rectangle_t * outputs,
+                                 gint n_outputs)
+{
+    g_return_if_fail (self != NULL);
+
+    gint width = cairo_image_surface_get_width (self->priv->surface);
+    gint height = cairo_image_surface_get_height (self->priv->surface);
+    gint cpt;
+
+    if (self->priv->outputs)
+        g_array_free (self->priv->outputs, TRUE);
+    self->priv->outputs = g_array_new (FALSE, FALSE,
+                                       sizeof (cairo_rectangle_t));
+
+    for (cpt = 0; cpt < n_outputs; ++cpt)
+    {
+        cairo_rectangle_t area;
+
+        // Keep only the part of output inside snapshot
+        area.x = MAX (floor (outputs[cpt].x), 0);
+        area.y = MAX (floor (outputs[cpt].y), 0);
+        area.width = MIN (ceil (outputs[cpt].x + outputs[cpt].width), width) - area.x;
+        area.height = MIN (ceil (outputs[cpt].y + outputs[cpt].height), height) - area.y;
+        if (area.width > 0 && area.height > 0)
+            g_array_append_val (self->priv->outputs, area);
+    }
+}
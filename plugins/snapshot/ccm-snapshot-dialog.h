@@ -54,6 +54,10 @@ GType ccm_snapshot_dialog_get_type (void) G_GNUC_CONST;
 
 CCMSnapshotDialog* ccm_snapshot_dialog_new (cairo_surface_t *surface, 
                                             CCMScreen *screen);
+void               ccm_snapshot_dialog_set_outputs (CCMSnapshotDialog *self,
+                                                    cairo_rectangle_t *outputs,
+                                                    gint n_outputs);
+void               ccm_snapshot_dialog_wait_writers (void);
 
 G_END_DECLS
 #endif                          /* _CCM_SNAPSHOT_DIALOG_H_ */
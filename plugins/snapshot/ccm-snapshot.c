@@ -18,6 +18,7 @@
  */
 
 #include <X11/Xatom.h>
+#include <X11/extensions/Xrandr.h>
 
 #include "ccm-drawable.h"
 #include "ccm-config.h"
@@ -31,6 +32,7 @@
 #include "ccm-marshallers.h"
 #include "ccm-preferences-page-plugin.h"
 #include "ccm-config-color-button.h"
+#include "ccm-config-check-button.h"
 #include "ccm-config-entry-shortcut.h"
 #include "ccm.h"
 
@@ -40,6 +42,7 @@ enum
     CCM_SNAPSHOT_WINDOW,
     CCM_SNAPSHOT_SCREEN,
     CCM_SNAPSHOT_COLOR,
+    CCM_SNAPSHOT_PER_OUTPUT,
     CCM_SNAPSHOT_OPTION_N
 };
 
@@ -47,7 +50,8 @@ static const gchar *CCMSnapshotOptionKeys[CCM_SNAPSHOT_OPTION_N] = {
     "area",
     "window",
     "screen",
-    "color"
+    "color",
+    "per_output"
 };
 
 typedef struct
@@ -59,6 +63,7 @@ typedef struct
     gchar* screen_shortcut;
 
     GdkColor *color;
+    gboolean per_output;
 } CCMSnapshotOptions;
 
 static void ccm_snapshot_screen_iface_init (CCMScreenPluginClass * iface);
@@ -98,6 +103,7 @@ ccm_snapshot_options_init (CCMSnapshotOptions* self)
     self->window_shortcut = NULL;
     self->screen_shortcut = NULL;
     self->color = NULL;
+    self->per_output = FALSE;
 }
 
 static void
@@ -172,6 +178,18 @@ ccm_snapshot_options_changed (CCMSnapshotOptions* self, CCMConfig* config)
             g_error_free (error);
         }
     }
+
+    if (config == ccm_plugin_options_get_config(CCM_PLUGIN_OPTIONS(self),
+                                                CCM_SNAPSHOT_PER_OUTPUT))
+    {
+        self->per_output = ccm_config_get_boolean (config, &error);
+        if (error)
+        {
+            g_warning ("Error on get snapshot per output configuration value");
+            g_error_free (error);
+            self->per_output = FALSE;
+        }
+    }
 }
 
 static void
@@ -208,6 +226,9 @@ ccm_snapshot_finalize (GObject * object)
         g_object_unref (self->priv->builder);
     self->priv->builder = NULL;
 
+    // Do not lose snapshots being saved on exit
+    ccm_snapshot_dialog_wait_writers ();
+
     G_OBJECT_CLASS (ccm_snapshot_parent_class)->finalize (object);
 }
 
@@ -275,13 +296,43 @@ ccm_snapshot_on_area_key_motion (CCMSnapshot * self, gint x, gint y)
                self->priv->area.height);
 }
 
+/* Get surface where screen is composited, frame of a headless screen or
+ * back buffer of overlay window */
+static cairo_surface_t *
+ccm_snapshot_get_screen_surface (CCMSnapshot * self, cairo_format_t * format,
+                                 cairo_rectangle_t * clipbox)
+{
+    cairo_surface_t *surface = ccm_screen_get_frame (self->priv->screen);
+    CCMWindow *overlay;
+
+    if (surface)
+    {
+        *format = cairo_image_surface_get_format (surface);
+        clipbox->x = 0;
+        clipbox->y = 0;
+        clipbox->width = cairo_image_surface_get_width (surface);
+        clipbox->height = cairo_image_surface_get_height (surface);
+        return surface;
+    }
+
+    overlay = ccm_screen_get_overlay_window (self->priv->screen);
+    if (!overlay ||
+        !ccm_drawable_get_geometry_clipbox (CCM_DRAWABLE (overlay), clipbox))
+        return NULL;
+
+    *format = ccm_drawable_get_format (CCM_DRAWABLE (overlay));
+    return ccm_drawable_get_surface (CCM_DRAWABLE (overlay));
+}
+
 static void
 ccm_snapshot_on_area_key_release (CCMSnapshot * self)
 {
     gint x, y;
     gdouble x1, y1, x2, y2;
-    CCMWindow *overlay = ccm_screen_get_overlay_window (self->priv->screen);
-    cairo_surface_t *src = ccm_drawable_get_surface (CCM_DRAWABLE (overlay));
+    cairo_format_t format;
+    cairo_rectangle_t clipbox;
+    cairo_surface_t *src = ccm_snapshot_get_screen_surface (self, &format,
+                                                            &clipbox);
     cairo_surface_t *dst;
     cairo_t *ctx;
     CCMRegion *damage;
@@ -303,7 +354,7 @@ ccm_snapshot_on_area_key_release (CCMSnapshot * self)
     self->priv->area.width = x2 - x1;
     self->priv->area.height = y2 - y1;
 
-    if (self->priv->area.width > 10 && self->priv->area.height > 10)
+    if (src && self->priv->area.width > 10 && self->priv->area.height > 10)
     {
         damage = ccm_region_rectangle (&self->priv->area);
         ccm_region_offset (damage, -4, -4);
@@ -316,8 +367,8 @@ ccm_snapshot_on_area_key_release (CCMSnapshot * self)
                    self->priv->area.y, self->priv->area.width,
                    self->priv->area.height);
 
-        dst = cairo_image_surface_create (ccm_drawable_get_format (CCM_DRAWABLE (overlay)),
-                                          self->priv->area.width, self->priv->area.height);
+        dst = cairo_image_surface_create (format, self->priv->area.width,
+                                          self->priv->area.height);
         ctx = cairo_create (dst);
         cairo_set_source_surface (ctx, src, -self->priv->area.x, -self->priv->area.y);
         cairo_paint (ctx);
@@ -394,44 +445,91 @@ ccm_snapshot_on_window_key_release (CCMSnapshot * self)
     }
 }
 
+/* Get area of each enabled output of screen */
+static GArray *
+ccm_snapshot_get_outputs (CCMSnapshot * self)
+{
+    CCMDisplay *display = ccm_screen_get_display (self->priv->screen);
+    Screen *xscreen = ccm_screen_get_xscreen (self->priv->screen);
+    XRRScreenResources *res;
+    GArray *outputs;
+    gboolean have_randr;
+    int cpt;
+
+    g_object_get (G_OBJECT (display), "use_randr", &have_randr, NULL);
+    if (!have_randr) return NULL;
+
+    res = XRRGetScreenResources (CCM_DISPLAY_XDISPLAY (display),
+                                 RootWindowOfScreen (xscreen));
+    if (!res) return NULL;
+
+    outputs = g_array_new (FALSE, FALSE, sizeof (cairo_rectangle_t));
+    for (cpt = 0; cpt < res->ncrtc; ++cpt)
+    {
+        XRRCrtcInfo *crtc = XRRGetCrtcInfo (CCM_DISPLAY_XDISPLAY (display),
+                                            res, res->crtcs[cpt]);
+
+        if (crtc == NULL) continue;
+
+        if (crtc->mode != None && crtc->width && crtc->height)
+        {
+            cairo_rectangle_t area = { crtc->x, crtc->y,
+                                       crtc->width, crtc->height };
+
+            g_array_append_val (outputs, area);
+        }
+        XRRFreeCrtcInfo (crtc);
+    }
+    XRRFreeScreenResources (res);
+
+    return outputs;
+}
+
 static void
 ccm_snapshot_on_screen_key_release (CCMSnapshot * self)
 {
-    CCMWindow *overlay = ccm_screen_get_overlay_window (self->priv->screen);
-    cairo_surface_t *src = ccm_drawable_get_surface (CCM_DRAWABLE (overlay));
+    cairo_format_t format;
+    cairo_rectangle_t clipbox;
+    cairo_surface_t *src = ccm_snapshot_get_screen_surface (self, &format,
+                                                            &clipbox);
     cairo_surface_t *dst;
     cairo_t *ctx;
-    cairo_rectangle_t clipbox;
 
     ccm_screen_damage (self->priv->screen);
 
     ccm_log ("SCREEN RELEASE");
 
-    if (src && ccm_drawable_get_geometry_clipbox (CCM_DRAWABLE (overlay), &clipbox))
+    if (src)
     {
-        cairo_rectangle_t *rects = NULL;
-        gint cpt, nb_rects;
         CCMRegion* screen_geometry = ccm_screen_get_geometry (self->priv->screen);
+        CCMSnapshotDialog *dialog;
 
-        dst = cairo_image_surface_create (ccm_drawable_get_format (CCM_DRAWABLE (overlay)),
-                                          clipbox.width, clipbox.height);
+        // New image is already cleared, only copy outputs area of back
+        // buffer, encoding is done by dialog out of main loop
+        dst = cairo_image_surface_create (format, clipbox.width,
+                                          clipbox.height);
         ctx = cairo_create (dst);
-        cairo_set_operator (ctx, CAIRO_OPERATOR_CLEAR);
-        cairo_paint (ctx);
         cairo_set_operator (ctx, CAIRO_OPERATOR_SOURCE);
 
-        ccm_region_get_rectangles (screen_geometry, &rects, &nb_rects);
-        for (cpt = 0; cpt < nb_rects; ++cpt)
-            cairo_rectangle (ctx, rects[cpt].x, rects[cpt].y,
-                             rects[cpt].width, rects[cpt].height);
-        if (rects) cairo_rectangles_free (rects, nb_rects);
-        cairo_clip (ctx);
+        ccm_region_clip (screen_geometry, ctx);
 
         cairo_set_source_surface (ctx, src, 0, 0);
         cairo_paint (ctx);
         cairo_destroy (ctx);
 
-        ccm_snapshot_dialog_new (dst, self->priv->screen);
+        dialog = ccm_snapshot_dialog_new (dst, self->priv->screen);
+        if (dialog && ccm_snapshot_get_option (self)->per_output)
+        {
+            GArray *outputs = ccm_snapshot_get_outputs (self);
+
+            if (outputs)
+            {
+                ccm_snapshot_dialog_set_outputs (dialog,
+                                                 (cairo_rectangle_t *) outputs->data,
+                                                 outputs->len);
+                g_array_free (outputs, TRUE);
+            }
+        }
     }
 
     if (src) cairo_surface_destroy (src);
@@ -589,6 +687,18 @@ ccm_snapshot_screen_paint (CCMScreenPlugin * plugin, CCMScreen * screen,
     return ret;
 }
 
+static gboolean
+ccm_snapshot_screen_modify_frame (CCMScreenPlugin * plugin, CCMScreen * screen)
+{
+    CCMSnapshot *self = CCM_SNAPSHOT (plugin);
+
+    // Selection area or window is painted over frame
+    return self->priv->area.height > 0 || self->priv->area.width > 0 ||
+           self->priv->selected ||
+           ccm_screen_plugin_modify_frame (CCM_SCREEN_PLUGIN_PARENT (plugin),
+                                           screen);
+}
+
 static void
 ccm_snapshot_preferences_page_init_utilities_section (CCMPreferencesPagePlugin *
                                                       plugin,
@@ -646,6 +756,12 @@ ccm_snapshot_preferences_page_init_utilities_section (CCMPreferencesPagePlugin *
                                           "color"));
             g_object_set (color, "screen", screen_num, NULL);
 
+            CCMConfigCheckButton *per_output =
+                CCM_CONFIG_CHECK_BUTTON (gtk_builder_get_object
+                                         (self->priv->builder,
+                                          "per_output"));
+            g_object_set (per_output, "screen", screen_num, NULL);
+
             ccm_preferences_page_section_register_widget (preferences,
                                                           CCM_PREFERENCES_PAGE_SECTION_UTILITIES,
                                                           widget, "snapshot");
@@ -664,6 +780,7 @@ ccm_snapshot_screen_iface_init (CCMScreenPluginClass * iface)
     iface->add_window = NULL;
     iface->remove_window = NULL;
     iface->damage = NULL;
+    iface->modify_frame = ccm_snapshot_screen_modify_frame;
 }
 
 static void
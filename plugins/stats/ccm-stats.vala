@@ -175,6 +175,16 @@ namespace CCM
 
             return ret;
         }
+
+        ////////////////////////////////////////////////////////////////////
+        ////////////////////////////////////////////////////////////////////
+        bool
+        screen_modify_frame (CCM.Screen inScreen)
+        {
+            // watchers are painted over frame
+            return m_Enabled ||
+                   ((CCM.ScreenPlugin) parent).screen_modify_frame (inScreen);
+        }
     }
 }
 
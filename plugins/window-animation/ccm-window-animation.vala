@@ -235,10 +235,24 @@ namespace CCM
                 (type == CCM.WindowType.NORMAL || type == CCM.WindowType.DIALOG))
             {
                 uint current_frame = 0;
+                uint duration = window.admit_animation ((uint)(((WindowAnimationOptions) get_option ()).duration * 1000.0));
+
+                if (duration == 0)
+                {
+                    // Animation skipped by governor, terminate current one
+                    if (timeline != null && timeline.is_playing)
+                    {
+                        timeline.stop ();
+                        on_finish ();
+                    }
+                    desktop_changed = false;
+                    (parent as CCM.WindowPlugin).map (window);
+                    return;
+                }
 
                 if (timeline == null)
                 {
-                    timeline = new CCM.Timeline.for_duration ((uint)(((WindowAnimationOptions) get_option ()).duration * 1000.0));
+                    timeline = new CCM.Timeline.for_duration (duration);
                     timeline.new_frame.connect (on_new_frame);
                     timeline.completed.connect (on_finish);
                 }
@@ -263,6 +277,7 @@ namespace CCM
 
                 lock_map (on_unlock);
 
+                timeline.duration = duration;
                 timeline.direction = CCM.TimelineDirection.FORWARD;
                 timeline.rewind ();
                 timeline.start ();
@@ -282,10 +297,24 @@ namespace CCM
                 (type == CCM.WindowType.NORMAL || type == CCM.WindowType.DIALOG))
             {
                 uint current_frame = 0;
+                uint duration = window.admit_animation ((uint)(((WindowAnimationOptions) get_option ()).duration * 1000.0));
+
+                if (duration == 0)
+                {
+                    // Animation skipped by governor, terminate current one
+                    if (timeline != null && timeline.is_playing)
+                    {
+                        timeline.stop ();
+                        on_finish ();
+                    }
+                    desktop_changed = false;
+                    (parent as CCM.WindowPlugin).unmap (window);
+                    return;
+                }
 
                 if (timeline == null)
                 {
-                    timeline = new CCM.Timeline.for_duration ((uint)(((WindowAnimationOptions) get_option ()).duration * 1000.0));
+                    timeline = new CCM.Timeline.for_duration (duration);
                     timeline.new_frame.connect (on_new_frame);
                     timeline.completed.connect (on_finish);
                 }
@@ -301,6 +330,7 @@ namespace CCM
 
                 lock_unmap (on_unlock);
 
+                timeline.duration = duration;
                 timeline.direction = CCM.TimelineDirection.BACKWARD;
                 timeline.rewind ();
                 timeline.start ();
@@ -24,6 +24,7 @@
 #include <X11/extensions/Xfixes.h>
 #include <X11/extensions/XInput.h>
 #include <X11/extensions/shape.h>
+#include <X11/extensions/XShm.h>
 #include <X11/extensions/Xrandr.h>
 #include <GL/glx.h>
 #include <gtk/gtk.h>
@@ -34,6 +35,7 @@
 #include "ccm-config.h"
 #include "ccm-window.h"
 #include "ccm-timeline.h"
+#include "ccm-xid-table.h"
 
 G_DEFINE_TYPE (CCMDisplay, ccm_display, CCM_TYPE_WATCH);
 
@@ -71,6 +73,7 @@ static guint signals[N_SIGNALS] = { 0 };
 typedef struct
 {
     gboolean available;
+    int major_opcode;
     int event_base;
     int error_base;
 } CCMExtension;
@@ -101,7 +104,7 @@ struct _CCMDisplayPrivate
     CCMExtension     randr;
     CCMExtension     glx;
 
-    CCMSet*          registered_damage;
+    CCMXidTable*     registered_damage;
 
     GSList*          pointers;
     int              type_button_press;
@@ -111,12 +114,33 @@ struct _CCMDisplayPrivate
 
     gboolean         use_shm;
     CCMConfig*       options[CCM_DISPLAY_OPTION_N];
+
+    GArray*          events;
+    GHashTable*      pending_events;
+    GHashTable*      barriers;
+    guint64          n_events;
+    guint64          n_dropped_events;
+
+    guint            n_frame_clocks;
+    gpointer         frame_clock;
+    guint64          n_reads;
+    guint64          n_frames;
+
+    guint64          n_property_hits;
+    guint64          n_property_misses;
+
+    guint64          n_copied_bytes;
 };
 
 static gint CCMLastXError = 0;
 static CCMDisplay* CCMDefaultDisplay = NULL;
 
 static void ccm_display_process_events (CCMWatch* watch);
+static guint ccm_display_event_hash (XEvent* event);
+static gboolean ccm_display_event_equal (XEvent* a, XEvent* b);
+
+/* Type of event dropped by compression, never used by X */
+#define CCM_DISPLAY_EVENT_DROPPED 0
 
 #define CCM_DISPLAY_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), CCM_TYPE_DISPLAY, CCMDisplayPrivate))
 
@@ -128,18 +152,6 @@ typedef struct
     CCMDrawable*          drawable;
 } CCMDamageCallback;
 
-static int
-ccm_damage_callback_compare (CCMDamageCallback* a, CCMDamageCallback* b)
-{
-    return a->damage - b->damage;
-}
-
-static int
-ccm_damage_callback_compare_with_damage (CCMDamageCallback* self, guint damage)
-{
-    return self->damage - damage;
-}
-
 static CCMDamageCallback*
 ccm_damage_callback_new ()
 {
@@ -235,10 +247,20 @@ ccm_display_init (CCMDisplay * self)
     self->priv->last_events.press = 0;
     self->priv->last_events.release = 0;
     self->priv->last_events.motion = 0;
-    self->priv->registered_damage = ccm_set_new (G_TYPE_POINTER,
-                                                 (GBoxedCopyFunc)ccm_damage_callback_ref,
-                                                 (GDestroyNotify)ccm_damage_callback_unref,
-                                                 (CCMSetCompareFunc)ccm_damage_callback_compare);
+    self->priv->registered_damage = ccm_xid_table_new ((GDestroyNotify)ccm_damage_callback_unref);
+    self->priv->events = g_array_sized_new (FALSE, FALSE, sizeof (XEvent), 64);
+    self->priv->pending_events = g_hash_table_new ((GHashFunc)ccm_display_event_hash,
+                                                   (GEqualFunc)ccm_display_event_equal);
+    self->priv->barriers = g_hash_table_new (g_direct_hash, g_direct_equal);
+    self->priv->n_events = 0;
+    self->priv->n_dropped_events = 0;
+    self->priv->n_frame_clocks = 0;
+    self->priv->frame_clock = NULL;
+    self->priv->n_reads = 0;
+    self->priv->n_frames = 0;
+    self->priv->n_property_hits = 0;
+    self->priv->n_property_misses = 0;
+    self->priv->n_copied_bytes = 0;
 }
 
 static void
@@ -253,7 +275,7 @@ ccm_display_finalize (GObject * object)
         CCMDefaultDisplay = NULL;
 
     if (self->priv->registered_damage)
-        g_object_unref (self->priv->registered_damage);
+        ccm_xid_table_free (self->priv->registered_damage);
 
     if (self->priv->nb_screens)
     {
@@ -274,6 +296,13 @@ ccm_display_finalize (GObject * object)
     for (cpt = 0; cpt < CCM_DISPLAY_OPTION_N; ++cpt)
         g_object_unref (self->priv->options[cpt]);
 
+    if (self->priv->events)
+        g_array_free (self->priv->events, TRUE);
+    if (self->priv->pending_events)
+        g_hash_table_destroy (self->priv->pending_events);
+    if (self->priv->barriers)
+        g_hash_table_destroy (self->priv->barriers);
+
     G_OBJECT_CLASS (ccm_display_parent_class)->finalize (object);
 }
 
@@ -285,6 +314,7 @@ ccm_display_class_init (CCMDisplayClass * klass)
     g_type_class_add_private (klass, sizeof (CCMDisplayPrivate));
 
     CCM_WATCH_CLASS (klass)->process_watch = ccm_display_process_events;
+    CCM_WATCH_CLASS (klass)->pending = ccm_display_pending;
     object_class->get_property = ccm_display_get_property;
     object_class->set_property = ccm_display_set_property;
     object_class->finalize = ccm_display_finalize;
@@ -358,7 +388,14 @@ ccm_display_init_shape (CCMDisplay * self)
                               &self->priv->shape.event_base,
                               &self->priv->shape.error_base))
     {
+        int event_base, error_base;
+
         self->priv->shape.available = TRUE;
+        // Opcode is needed to send shape requests without xext
+        if (!XQueryExtension (self->priv->xdisplay, SHAPENAME,
+                              &self->priv->shape.major_opcode,
+                              &event_base, &error_base))
+            self->priv->shape.major_opcode = 0;
         ccm_debug ("SHAPE EVENT BASE: %i", self->priv->shape.event_base);
         ccm_debug ("SHAPE ERROR BASE: %i", self->priv->shape.error_base);
         return TRUE;
@@ -518,30 +555,235 @@ ccm_display_error_handler (Display * dpy, XErrorEvent * evt)
     return 0;
 }
 
+static guint
+ccm_display_event_hash (XEvent* event)
+{
+    if (event->type == ConfigureNotify)
+        return (event->xconfigure.event * 31 + event->xconfigure.window) ^ ConfigureNotify;
+
+    return (event->xproperty.window * 31 + event->xproperty.atom) ^ PropertyNotify;
+}
+
+static gboolean
+ccm_display_event_equal (XEvent* a, XEvent* b)
+{
+    if (a->type != b->type)
+        return FALSE;
+
+    if (a->type == ConfigureNotify)
+        return a->xconfigure.event == b->xconfigure.event &&
+               a->xconfigure.window == b->xconfigure.window;
+
+    return a->xproperty.window == b->xproperty.window &&
+           a->xproperty.atom == b->xproperty.atom;
+}
+
+/*
+ * Return TRUE if a barrier was seen on @window after the event at
+ * @index of events buffer
+ */
+static gboolean
+ccm_display_barrier_after (CCMDisplay* self, Window window, guint index)
+{
+    guint last = GPOINTER_TO_UINT (g_hash_table_lookup (self->priv->barriers,
+                                                        GSIZE_TO_POINTER (window)));
+
+    return last > index + 1;
+}
+
+/*
+ * Return the window on which the event changes the structure, pending
+ * events of this window must not be compressed across it.
+ */
+static Window
+ccm_display_event_get_barrier (XEvent* event)
+{
+    switch (event->type)
+    {
+        case CreateNotify:
+            return event->xcreatewindow.window;
+        case DestroyNotify:
+            return event->xdestroywindow.window;
+        case MapNotify:
+            return event->xmap.window;
+        case UnmapNotify:
+            return event->xunmap.window;
+        case ReparentNotify:
+            return event->xreparent.window;
+        case CirculateNotify:
+            return event->xcirculate.window;
+        case GravityNotify:
+            return event->xgravity.window;
+        case ConfigureNotify:
+            /* window is restacked relatively to the sibling */
+            return event->xconfigure.above;
+        default:
+            return None;
+    }
+}
+
+/*
+ * Compress the drained event at @index of events buffer: the previous
+ * ConfigureNotify of the same window or PropertyNotify of the same window
+ * property is superseded by it and marked as dropped unless a barrier on
+ * its window was seen in between. Barriers only record the position of
+ * the last structure change of each window, so nothing is scanned.
+ * Returns TRUE if an event has been dropped.
+ */
+static gboolean
+ccm_display_compress_event (CCMDisplay* self, guint index)
+{
+    XEvent* events = &g_array_index (self->priv->events, XEvent, 0);
+    XEvent* event = &events[index];
+    Window barrier = ccm_display_event_get_barrier (event);
+    gboolean dropped = FALSE;
+
+    if (barrier != None)
+        g_hash_table_replace (self->priv->barriers, GSIZE_TO_POINTER (barrier),
+                              GUINT_TO_POINTER (index + 1));
+
+    if (event->type == ConfigureNotify || event->type == PropertyNotify)
+    {
+        XEvent* previous = g_hash_table_lookup (self->priv->pending_events,
+                                                event);
+
+        g_hash_table_replace (self->priv->pending_events, event, event);
+        if (previous)
+        {
+            guint last = previous - events;
+            gboolean crossed;
+
+            if (event->type == ConfigureNotify)
+                crossed = ccm_display_barrier_after (self, event->xconfigure.window, last) ||
+                          ccm_display_barrier_after (self, event->xconfigure.event, last);
+            else
+                crossed = ccm_display_barrier_after (self, event->xproperty.window, last);
+
+            if (!crossed)
+            {
+                previous->type = CCM_DISPLAY_EVENT_DROPPED;
+                dropped = TRUE;
+            }
+        }
+    }
+
+    return dropped;
+}
+
+/*
+ * Move events already read from the connection by xlib in the events
+ * buffer, it never read the connection.
+ */
+static gint
+ccm_display_drain_events (CCMDisplay* self)
+{
+    Display* xdisplay = CCM_DISPLAY_XDISPLAY (self);
+    gint n_events = XEventsQueued (xdisplay, QueuedAlready);
+    guint first = self->priv->events->len;
+    gint cpt;
+
+    if (n_events <= 0) return 0;
+
+    g_array_set_size (self->priv->events, first + n_events);
+    for (cpt = 0; cpt < n_events; ++cpt)
+        XNextEvent (xdisplay, &g_array_index (self->priv->events, XEvent,
+                                              first + cpt));
+
+    return n_events;
+}
+
+/*
+ * Send the setup requests of all windows created in events buffer before
+ * dispatching, so a storm of new windows costs one round trip per screen
+ */
 static void
-ccm_display_process_events (CCMWatch* watch)
+ccm_display_prefetch_windows (CCMDisplay* self)
 {
-    g_return_if_fail (watch != NULL);
+    GArray* windows = g_array_new (FALSE, FALSE, sizeof (Window));
+    guint cpt;
+    gint screen;
 
-    CCMDisplay* self = CCM_DISPLAY (watch);
-    XEvent xevent;
-    gboolean have_create_notify = FALSE;
+    for (screen = 0; screen < self->priv->nb_screens; ++screen)
+    {
+        Window root;
+
+        if (!self->priv->screens[screen]) continue;
 
-    while (!have_create_notify && XEventsQueued (CCM_DISPLAY_XDISPLAY (self), QueuedAfterReading))
+        root = RootWindowOfScreen (CCM_SCREEN_XSCREEN (self->priv->screens[screen]));
+        g_array_set_size (windows, 0);
+        for (cpt = 0; cpt < self->priv->events->len; ++cpt)
+        {
+            XEvent* xevent = &g_array_index (self->priv->events, XEvent, cpt);
+
+            if (xevent->type == CreateNotify &&
+                xevent->xcreatewindow.parent == root)
+                g_array_append_val (windows, xevent->xcreatewindow.window);
+        }
+
+        if (windows->len)
+            _ccm_screen_prefetch_windows (self->priv->screens[screen],
+                                          (Window*)windows->data,
+                                          windows->len);
+    }
+
+    g_array_free (windows, TRUE);
+}
+
+/*
+ * Compress and dispatch in order all events of the events buffer
+ */
+static void
+ccm_display_dispatch_events (CCMDisplay* self)
+{
+    guint n_events = self->priv->events->len, n_dropped = 0, cpt;
+
+    if (!n_events) return;
+
+    /* Drop events superseded by a later event */
+    for (cpt = 0; cpt < n_events; ++cpt)
+    {
+        if (ccm_display_compress_event (self, cpt))
+            n_dropped++;
+    }
+    g_hash_table_remove_all (self->priv->pending_events);
+    g_hash_table_remove_all (self->priv->barriers);
+
+    self->priv->n_events += n_events;
+    self->priv->n_dropped_events += n_dropped;
+    ccm_debug ("EVENTS %i dropped %i", n_events, n_dropped);
+
+    ccm_display_prefetch_windows (self);
+
+    for (cpt = 0; cpt < n_events; ++cpt)
     {
-        XNextEvent (CCM_DISPLAY_XDISPLAY (self), &xevent);
+        XEvent xevent = g_array_index (self->priv->events, XEvent, cpt);
+
+        if (xevent.type == CCM_DISPLAY_EVENT_DROPPED) continue;
+
         ccm_debug ("EVENT %i", xevent.type);
 
+        // Cached values are dropped before anyone handles the change
+        if (xevent.type == PropertyNotify)
+        {
+            gint screen;
+
+            for (screen = 0; screen < self->priv->nb_screens; ++screen)
+            {
+                if (self->priv->screens[screen])
+                    _ccm_screen_invalidate_property (self->priv->screens[screen],
+                                                     xevent.xproperty.window,
+                                                     xevent.xproperty.atom);
+            }
+        }
+
         if (xevent.type == self->priv->damage.event_base + XDamageNotify)
         {
             XDamageNotifyEvent* event_damage = (XDamageNotifyEvent *)&xevent;
 
             CCMDamageCallback* callback;
 
-            callback = (CCMDamageCallback*)ccm_set_search (self->priv->registered_damage,
-                                                           G_TYPE_UINT, NULL, NULL,
-                                                           (gpointer)event_damage->damage,
-                                                           (CCMSetValueCompareFunc)ccm_damage_callback_compare_with_damage);
+            callback = ccm_xid_table_lookup (self->priv->registered_damage,
+                                             event_damage->damage);
             if (callback)
             {
                 g_signal_emit (self, signals[DAMAGE_EVENT], 0, event_damage->damage, callback->drawable);
@@ -550,10 +792,52 @@ ccm_display_process_events (CCMWatch* watch)
         else
         {
             g_signal_emit (self, signals[EVENT], 0, &xevent);
-            if (xevent.type == CreateNotify)
-                have_create_notify = TRUE;
         }
     }
+
+    /* Replies of windows not created are useless now */
+    for (cpt = 0; cpt < (guint)self->priv->nb_screens; ++cpt)
+    {
+        if (self->priv->screens[cpt])
+            _ccm_screen_prefetch_windows (self->priv->screens[cpt], NULL, 0);
+    }
+
+    g_array_set_size (self->priv->events, 0);
+}
+
+static gboolean
+ccm_display_pending (CCMWatch* watch)
+{
+    CCMDisplay* self = CCM_DISPLAY (watch);
+
+    /* Send requests before main loop sleeps, it does nothing if output
+     * buffer is empty */
+    XFlush (CCM_DISPLAY_XDISPLAY (self));
+
+    /* With a frame clock events read by xlib wait the next frame */
+    return !self->priv->n_frame_clocks &&
+           (self->priv->events->len > 0 ||
+            XEventsQueued (CCM_DISPLAY_XDISPLAY (self), QueuedAlready) > 0);
+}
+
+static void
+ccm_display_process_events (CCMWatch* watch)
+{
+    g_return_if_fail (watch != NULL);
+
+    CCMDisplay* self = CCM_DISPLAY (watch);
+
+    /* Read the connection only if xlib queue is empty, else the connection
+     * is read on next main loop iteration if it is still readable */
+    if (!ccm_display_drain_events (self))
+    {
+        XEventsQueued (CCM_DISPLAY_XDISPLAY (self), QueuedAfterReading);
+        self->priv->n_reads++;
+        ccm_display_drain_events (self);
+    }
+
+    if (!self->priv->n_frame_clocks)
+        ccm_display_dispatch_events (self);
 }
 
 CCMDisplay *
@@ -673,6 +957,107 @@ ccm_display_get_screen (CCMDisplay * self, guint number)
     return self->priv->screens[number];
 }
 
+/**
+ * ccm_display_get_event_counters:
+ * @self: #CCMDisplay
+ * @received: number of X events read
+ * @dropped: number of X events dropped by compression
+ *
+ * Get event compression counters since display creation.
+ **/
+void
+ccm_display_get_event_counters (CCMDisplay * self, guint64 * received,
+                                guint64 * dropped)
+{
+    g_return_if_fail (self != NULL);
+
+    if (received) *received = self->priv->n_events;
+    if (dropped) *dropped = self->priv->n_dropped_events;
+}
+
+/**
+ * ccm_display_get_io_counters:
+ * @self: #CCMDisplay
+ * @reads: number of X connection reads
+ * @frames: number of frames which have processed events
+ *
+ * Get X connection read counters since display creation.
+ **/
+void
+ccm_display_get_io_counters (CCMDisplay * self, guint64 * reads,
+                             guint64 * frames)
+{
+    g_return_if_fail (self != NULL);
+
+    if (reads) *reads = self->priv->n_reads;
+    if (frames) *frames = self->priv->n_frames;
+}
+
+/**
+ * ccm_display_get_property_cache_counters:
+ * @self: #CCMDisplay
+ * @hits: number of window property reads served from cache
+ * @misses: number of window property reads sent to server
+ *
+ * Get window property cache counters since display creation.
+ **/
+void
+ccm_display_get_property_cache_counters (CCMDisplay * self, guint64 * hits,
+                                         guint64 * misses)
+{
+    g_return_if_fail (self != NULL);
+
+    if (hits) *hits = self->priv->n_property_hits;
+    if (misses) *misses = self->priv->n_property_misses;
+}
+
+void
+_ccm_display_count_property_read (CCMDisplay * self, gboolean hit)
+{
+    g_return_if_fail (self != NULL);
+
+    if (hit)
+        self->priv->n_property_hits++;
+    else
+        self->priv->n_property_misses++;
+}
+
+/**
+ * ccm_display_get_copy_counters:
+ * @self: #CCMDisplay
+ * @bytes: number of pixel bytes copied between server and compositor
+ * @frames: number of frames which have processed events
+ *
+ * Get composited bytes copy counters since display creation.
+ **/
+void
+ccm_display_get_copy_counters (CCMDisplay * self, guint64 * bytes,
+                               guint64 * frames)
+{
+    g_return_if_fail (self != NULL);
+
+    if (bytes) *bytes = self->priv->n_copied_bytes;
+    if (frames) *frames = self->priv->n_frames;
+}
+
+void
+_ccm_display_count_copy (CCMDisplay * self, guint64 bytes)
+{
+    g_return_if_fail (self != NULL);
+
+    self->priv->n_copied_bytes += bytes;
+}
+
+gboolean
+_ccm_display_use_shm_pixmap (CCMDisplay * self)
+{
+    g_return_val_if_fail (self != NULL, FALSE);
+
+    // Shared pixmaps are only usable when server store them as ZPixmap
+    return self->priv->use_shm && self->priv->shm_shared_pixmap &&
+           XShmPixmapFormat (self->priv->xdisplay) == ZPixmap;
+}
+
 G_GNUC_PURE int
 ccm_display_get_shape_notify_event_type (CCMDisplay * self)
 {
@@ -681,6 +1066,14 @@ ccm_display_get_shape_notify_event_type (CCMDisplay * self)
     return self->priv->shape.event_base + ShapeNotify;
 }
 
+int
+_ccm_display_get_shape_opcode (CCMDisplay * self)
+{
+    g_return_val_if_fail (self != NULL, 0);
+
+    return self->priv->shape.available ? self->priv->shape.major_opcode : 0;
+}
+
 void
 ccm_display_flush (CCMDisplay * self)
 {
@@ -758,10 +1151,7 @@ ccm_display_register_damage (CCMDisplay* self, CCMDrawable* drawable, CCMDamageC
         gboolean found = FALSE;
         CCMDamageCallback* callback;
 
-        callback = (CCMDamageCallback*)ccm_set_search (self->priv->registered_damage,
-                                                       G_TYPE_UINT, NULL, NULL,
-                                                       (gpointer)damage,
-                                                       (CCMSetValueCompareFunc)ccm_damage_callback_compare_with_damage);
+        callback = ccm_xid_table_lookup (self->priv->registered_damage, damage);
         if (callback == NULL)
         {
             callback = ccm_damage_callback_new ();
@@ -770,7 +1160,7 @@ ccm_display_register_damage (CCMDisplay* self, CCMDrawable* drawable, CCMDamageC
             callback->func = func;
             callback->drawable = drawable;
 
-            ccm_set_insert (self->priv->registered_damage, callback);
+            ccm_xid_table_insert (self->priv->registered_damage, damage, callback);
         }
         else
         {
@@ -789,29 +1179,86 @@ ccm_display_unregister_damage (CCMDisplay* self, guint32 damage, CCMDrawable* dr
 {
     CCMDamageCallback* callback;
 
-    callback = (CCMDamageCallback*)ccm_set_search (self->priv->registered_damage,
-                                                   G_TYPE_UINT, NULL, NULL,
-                                                   GINT_TO_POINTER (damage),
-                                                   (CCMSetValueCompareFunc)ccm_damage_callback_compare_with_damage);
+    callback = ccm_xid_table_lookup (self->priv->registered_damage, damage);
 
     if (callback && callback->drawable == drawable)
     {
-        ccm_set_remove (self->priv->registered_damage, callback);
+        ccm_xid_table_remove (self->priv->registered_damage, damage);
     }
 }
 
+/**
+ * ccm_display_add_frame_clock:
+ * @self: #CCMDisplay
+ * @clock: owner of frame clock
+ *
+ * Tell display that a frame clock calls ccm_display_process_frame_events()
+ * on each frame. While a frame clock is attached, the X connection is
+ * only read when readable and events are dispatched once per frame.
+ **/
+void
+ccm_display_add_frame_clock (CCMDisplay* self, gpointer clock)
+{
+    g_return_if_fail (self != NULL);
+    g_return_if_fail (clock != NULL);
+
+    self->priv->n_frame_clocks++;
+    if (!self->priv->frame_clock)
+        self->priv->frame_clock = clock;
+}
+
+/**
+ * ccm_display_remove_frame_clock:
+ * @self: #CCMDisplay
+ * @clock: owner of frame clock
+ *
+ * Detach a frame clock previously attached by ccm_display_add_frame_clock().
+ **/
+void
+ccm_display_remove_frame_clock (CCMDisplay* self, gpointer clock)
+{
+    g_return_if_fail (self != NULL);
+    g_return_if_fail (self->priv->n_frame_clocks > 0);
+
+    self->priv->n_frame_clocks--;
+    // Next clock which processes events counts frames
+    if (self->priv->frame_clock == clock)
+        self->priv->frame_clock = NULL;
+}
+
+/**
+ * ccm_display_process_frame_events:
+ * @self: #CCMDisplay
+ * @clock: owner of frame clock
+ *
+ * Dispatch all events read since the last frame in one pass. Each screen
+ * has its own frame clock, display frames are counted on one of them.
+ **/
+void
+ccm_display_process_frame_events (CCMDisplay* self, gpointer clock)
+{
+    g_return_if_fail (self != NULL);
+
+    if (!self->priv->frame_clock)
+        self->priv->frame_clock = clock;
+    if (self->priv->frame_clock == clock)
+        self->priv->n_frames++;
+    ccm_display_drain_events (self);
+    ccm_display_dispatch_events (self);
+}
+
 void
 ccm_display_process_damage (CCMDisplay* self, guint32 damage)
 {
     CCMDamageCallback* callback;
 
-    callback = (CCMDamageCallback*)ccm_set_search (self->priv->registered_damage,
-                                                   G_TYPE_UINT, NULL, NULL,
-                                                   GINT_TO_POINTER (damage),
-                                                   (CCMSetValueCompareFunc)ccm_damage_callback_compare_with_damage);
+    callback = ccm_xid_table_lookup (self->priv->registered_damage, damage);
 
     if (callback)
     {
+        // callback can be unregistered by func
+        ccm_damage_callback_ref (callback);
         callback->func (callback->drawable, callback->damage);
+        ccm_damage_callback_unref (callback);
     }
 }
@@ -52,7 +52,14 @@ struct _CCMDisplay
 
 GType ccm_display_get_type (void) G_GNUC_CONST;
 
-void ccm_display_process_damage (CCMDisplay* self, guint32 damage);
+void ccm_display_process_damage       (CCMDisplay* self, guint32 damage);
+void ccm_display_add_frame_clock      (CCMDisplay* self, gpointer clock);
+void ccm_display_remove_frame_clock   (CCMDisplay* self, gpointer clock);
+void ccm_display_process_frame_events (CCMDisplay* self, gpointer clock);
+int  _ccm_display_get_shape_opcode    (CCMDisplay* self);
+void _ccm_display_count_property_read (CCMDisplay* self, gboolean hit);
+void _ccm_display_count_copy          (CCMDisplay* self, guint64 bytes);
+gboolean _ccm_display_use_shm_pixmap  (CCMDisplay* self);
 
 G_END_DECLS
 
@@ -70,6 +70,12 @@ enum
 
 static guint signals[N_SIGNALS] = { 0 };
 
+typedef struct
+{
+    CCMDrawableDamageFunc func;
+    gpointer data;
+} CCMDrawableDamageHandler;
+
 G_DEFINE_TYPE (CCMDrawable, ccm_drawable, CCM_TYPE_OBJECT);
 
 struct _CCMDrawablePrivate
@@ -86,6 +92,10 @@ struct _CCMDrawablePrivate
 
     CCMRegion *damaged;
     GData *transform;
+
+    GSList *damage_handlers;
+    guint damage_emitting;
+    gboolean damage_handlers_removed;
 };
 
 #define CCM_DRAWABLE_GET_PRIVATE(o)  \
@@ -198,6 +208,9 @@ ccm_drawable_init (CCMDrawable * self)
     self->priv->last_pos_size.width = 0;
     self->priv->last_pos_size.height = 0;
     self->priv->transform = NULL;
+    self->priv->damage_handlers = NULL;
+    self->priv->damage_emitting = 0;
+    self->priv->damage_handlers_removed = FALSE;
     g_datalist_init (&self->priv->transform);
     cairo_matrix_init_identity (&init);
     ccm_drawable_push_matrix (self, "CCMDrawable", &init);
@@ -236,6 +249,15 @@ ccm_drawable_finalize (GObject * object)
         g_datalist_clear (&self->priv->transform);
         g_datalist_init (&self->priv->transform);
     }
+    if (self->priv->damage_handlers)
+    {
+        GSList *item;
+
+        for (item = self->priv->damage_handlers; item; item = item->next)
+            g_slice_free (CCMDrawableDamageHandler, item->data);
+        g_slist_free (self->priv->damage_handlers);
+        self->priv->damage_handlers = NULL;
+    }
 
     G_OBJECT_CLASS (ccm_drawable_parent_class)->finalize (object);
 }
@@ -382,6 +404,8 @@ __ccm_drawable_query_geometry (CCMDrawable * self)
     self->priv->device = ccm_region_rectangle (&rectangle);
     self->priv->geometry = ccm_region_rectangle (&rectangle);
     ccm_region_device_transform (self->priv->geometry, &matrix);
+
+    g_object_notify (G_OBJECT (self), "geometry");
 }
 
 static void
@@ -401,6 +425,7 @@ __ccm_drawable_move (CCMDrawable * self, int x, int y)
         ccm_region_destroy (self->priv->geometry);
         self->priv->geometry = ccm_region_copy (self->priv->device);
         ccm_region_transform (self->priv->geometry, &matrix);
+        g_object_notify (G_OBJECT (self), "geometry");
     }
 }
 
@@ -417,6 +442,7 @@ __ccm_drawable_resize (CCMDrawable * self, int width, int height)
         ccm_region_destroy (self->priv->geometry);
         self->priv->geometry = ccm_region_copy (self->priv->device);
         ccm_region_transform (self->priv->geometry, &matrix);
+        g_object_notify (G_OBJECT (self), "geometry");
     }
 }
 
@@ -803,6 +829,109 @@ ccm_drawable_is_damaged (CCMDrawable * self)
     return self->priv->damaged && !ccm_region_empty (self->priv->damaged);
 }
 
+static void
+ccm_drawable_emit_damage (CCMDrawable * self, CCMRegion * area)
+{
+    GSList *item;
+
+    g_object_ref (self);
+    self->priv->damage_emitting++;
+
+    for (item = self->priv->damage_handlers; item; item = item->next)
+    {
+        CCMDrawableDamageHandler *handler = item->data;
+
+        if (handler->func)
+            handler->func (self, area, handler->data);
+    }
+
+    /* Purge handlers removed during emission */
+    if (!--self->priv->damage_emitting && self->priv->damage_handlers_removed)
+    {
+        GSList *next;
+
+        for (item = self->priv->damage_handlers; item; item = next)
+        {
+            CCMDrawableDamageHandler *handler = item->data;
+
+            next = item->next;
+            if (!handler->func)
+            {
+                g_slice_free (CCMDrawableDamageHandler, handler);
+                self->priv->damage_handlers =
+                    g_slist_delete_link (self->priv->damage_handlers, item);
+            }
+        }
+        self->priv->damage_handlers_removed = FALSE;
+    }
+
+    g_object_unref (self);
+}
+
+/**
+ * ccm_drawable_add_damage_func:
+ * @self: #CCMDrawable
+ * @func: #CCMDrawableDamageFunc
+ * @data: user data passed to @func
+ *
+ * Add a function called each time a region of drawable is damaged. Unlike
+ * the damaged signal, it is invoked directly without any marshalling, after
+ * the damaged signal handlers.
+ **/
+void
+ccm_drawable_add_damage_func (CCMDrawable * self, CCMDrawableDamageFunc func,
+                              gpointer data)
+{
+    g_return_if_fail (self != NULL);
+    g_return_if_fail (func != NULL);
+
+    CCMDrawableDamageHandler *handler = g_slice_new (CCMDrawableDamageHandler);
+
+    handler->func = func;
+    handler->data = data;
+    self->priv->damage_handlers = g_slist_append (self->priv->damage_handlers,
+                                                  handler);
+}
+
+/**
+ * ccm_drawable_remove_damage_func:
+ * @self: #CCMDrawable
+ * @func: #CCMDrawableDamageFunc
+ * @data: user data passed to @func
+ *
+ * Remove a damage function previously added with
+ * ccm_drawable_add_damage_func().
+ **/
+void
+ccm_drawable_remove_damage_func (CCMDrawable * self, CCMDrawableDamageFunc func,
+                                 gpointer data)
+{
+    g_return_if_fail (self != NULL);
+
+    GSList *item;
+
+    for (item = self->priv->damage_handlers; item; item = item->next)
+    {
+        CCMDrawableDamageHandler *handler = item->data;
+
+        if (handler->func == func && handler->data == data)
+        {
+            if (self->priv->damage_emitting)
+            {
+                handler->func = NULL;
+                self->priv->damage_handlers_removed = TRUE;
+            }
+            else
+            {
+                g_slice_free (CCMDrawableDamageHandler, handler);
+                self->priv->damage_handlers =
+                    g_slist_delete_link (self->priv->damage_handlers, item);
+            }
+            break;
+        }
+    }
+}
+
 /**
  * ccm_drawable_damage_region:
  * @self: #CCMDrawable
@@ -819,7 +948,14 @@ ccm_drawable_damage_region (CCMDrawable * self, const CCMRegion * area)
     if (!ccm_region_empty ((CCMRegion *) area))
     {
         ccm_drawable_damage_region_silently (self, area);
-        g_signal_emit (self, signals[DAMAGED], 0, area);
+
+        /* Signal is only emitted for external listeners, internal ones are
+         * called directly after them */
+        if (g_signal_has_handler_pending (self, signals[DAMAGED], 0, FALSE))
+            g_signal_emit (self, signals[DAMAGED], 0, area);
+
+        if (self->priv->damage_handlers)
+            ccm_drawable_emit_damage (self, (CCMRegion *) area);
     }
 }
 
@@ -1003,6 +1139,29 @@ ccm_drawable_get_damage_path (CCMDrawable * self, cairo_t * context)
     }
 }
 
+/**
+ * ccm_drawable_clip_damage:
+ * @self: #CCMDrawable
+ * @context: #cairo_t
+ *
+ * Intersect current clip of context with damaged region, without building
+ * a path of damaged rectangles before.
+ **/
+void
+ccm_drawable_clip_damage (CCMDrawable * self, cairo_t * context)
+{
+    g_return_if_fail (self != NULL);
+    g_return_if_fail (context != NULL);
+
+    if (self->priv->damaged)
+        ccm_region_clip (self->priv->damaged, context);
+    else
+    {
+        cairo_new_path (context);
+        cairo_clip (context);
+    }
+}
+
 G_GNUC_PURE const CCMRegion*
 ccm_drawable_get_damaged (CCMDrawable * self)
 {
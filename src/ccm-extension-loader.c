@@ -231,6 +231,9 @@ ccm_extension_loader_get_window_plugins (CCMExtensionLoader * self,
 
             if (g_type_is_a (plugin, CCM_TYPE_WINDOW_PLUGIN))
             {
+                _ccm_window_plugin_set_filter (plugin,
+                                               ccm_extension_get_window_types (item->data),
+                                               ccm_extension_get_window_states (item->data));
                 window_plugins = g_slist_prepend (window_plugins, item->data);
             }
         }
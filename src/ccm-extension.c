@@ -32,6 +32,8 @@ struct _CCMExtensionPrivate
     gchar *filename;
     gchar **backends;
     gchar **depends;
+    gchar **window_types;
+    gchar **window_states;
     GType type;
     GModule *module;
     CCMExtensionGetType get_type;
@@ -57,6 +59,8 @@ ccm_extension_init (CCMExtension * self)
     self->priv->module = NULL;
     self->priv->backends = NULL;
     self->priv->depends = NULL;
+    self->priv->window_types = NULL;
+    self->priv->window_states = NULL;
     self->priv->type = 0;
     self->priv->get_type = NULL;
 }
@@ -82,6 +86,10 @@ ccm_extension_finalize (GObject * object)
         g_strfreev (self->priv->backends);
     if (self->priv->depends)
         g_strfreev (self->priv->depends);
+    if (self->priv->window_types)
+        g_strfreev (self->priv->window_types);
+    if (self->priv->window_states)
+        g_strfreev (self->priv->window_states);
 
     G_OBJECT_CLASS (ccm_extension_parent_class)->finalize (object);
 }
@@ -195,6 +203,14 @@ ccm_extension_new (gchar * filename)
         g_key_file_get_string_list (plugin_file, PLUGIN_SECTION, "Depends",
                                     NULL, NULL);
 
+    /* Get window types and states on which plugin applies */
+    self->priv->window_types =
+        g_key_file_get_string_list (plugin_file, PLUGIN_SECTION, "WindowTypes",
+                                    NULL, NULL);
+    self->priv->window_states =
+        g_key_file_get_string_list (plugin_file, PLUGIN_SECTION, "WindowStates",
+                                    NULL, NULL);
+
     g_key_file_free (plugin_file);
 
     dirname = g_path_get_dirname (filename);
@@ -239,6 +255,22 @@ ccm_extension_get_backends (CCMExtension * self)
     return (const gchar **) self->priv->backends;
 }
 
+G_GNUC_PURE const gchar **
+ccm_extension_get_window_types (CCMExtension * self)
+{
+    g_return_val_if_fail (self != NULL, NULL);
+
+    return (const gchar **) self->priv->window_types;
+}
+
+G_GNUC_PURE const gchar **
+ccm_extension_get_window_states (CCMExtension * self)
+{
+    g_return_val_if_fail (self != NULL, NULL);
+
+    return (const gchar **) self->priv->window_states;
+}
+
 G_GNUC_PURE GType
 ccm_extension_get_type_object (CCMExtension * self)
 {
@@ -56,6 +56,8 @@ G_GNUC_PURE const gchar*  ccm_extension_get_label       (CCMExtension* self);
 G_GNUC_PURE const gchar*  ccm_extension_get_description (CCMExtension* self);
 G_GNUC_PURE const gchar*  ccm_extension_get_version     (CCMExtension* self);
 G_GNUC_PURE const gchar** ccm_extension_get_backends    (CCMExtension* self);
+G_GNUC_PURE const gchar** ccm_extension_get_window_types (CCMExtension* self);
+G_GNUC_PURE const gchar** ccm_extension_get_window_states (CCMExtension* self);
 
 gint                      _ccm_extension_compare        (CCMExtension* self, 
                                                          CCMExtension* other);
@@ -0,0 +1,273 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4 -*- */
+/*
+ * ccm-frame-export.c
+ * Copyright (C) Nicolas Bruguier 2007-2011 <gandalfn@club-internet.fr>
+ *
+ * cairo-compmgr is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * cairo-compmgr is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/uio.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "ccm-debug.h"
+#include "ccm-frame-export.h"
+
+typedef struct
+{
+    gint fd;
+    gint shmid;
+    gboolean synced;
+} CCMFrameExportClient;
+
+struct _CCMFrameExport
+{
+    gchar*      path;
+    gint        fd;
+    GIOChannel* channel;
+    guint       id_accept;
+    GSList*     clients;
+};
+
+static void
+ccm_frame_export_client_free (CCMFrameExportClient* client)
+{
+    close (client->fd);
+    g_slice_free (CCMFrameExportClient, client);
+}
+
+static gboolean
+ccm_frame_export_on_accept (GIOChannel* source, GIOCondition condition,
+                            CCMFrameExport* self)
+{
+    gint fd = accept (self->fd, NULL, NULL);
+
+    if (fd >= 0)
+    {
+        CCMFrameExportClient* client = g_slice_new (CCMFrameExportClient);
+
+        // Export never waits a slow client
+        fcntl (fd, F_SETFL, fcntl (fd, F_GETFL) | O_NONBLOCK);
+        client->fd = fd;
+        client->shmid = -1;
+        client->synced = FALSE;
+        self->clients = g_slist_prepend (self->clients, client);
+        ccm_debug ("FRAME EXPORT CLIENT %i", fd);
+    }
+
+    return TRUE;
+}
+
+/* Send a whole message, return FALSE if client is gone, sent is set to
+ * FALSE if message was dropped because client socket is full */
+static gboolean
+ccm_frame_export_send (CCMFrameExportClient* client, struct iovec* iov,
+                       gint n_iov, gboolean* sent)
+{
+    struct msghdr msg;
+
+    memset (&msg, 0, sizeof (msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = n_iov;
+
+    *sent = sendmsg (client->fd, &msg, MSG_NOSIGNAL) >= 0;
+    if (!*sent)
+    {
+        // Client does not read fast enough, it will see a gap in frame
+        // sequence and can read the whole frame in the ring slot
+        return errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS;
+    }
+
+    return TRUE;
+}
+
+/**
+ * ccm_frame_export_new:
+ * @path: path of export unix socket
+ *
+ * Create frame export and listen for clients on a sequenced packet unix
+ * socket. A previous socket file at path is removed.
+ *
+ * Returns: #CCMFrameExport or %NULL on error
+ **/
+CCMFrameExport*
+ccm_frame_export_new (const gchar* path)
+{
+    g_return_val_if_fail (path != NULL, NULL);
+
+    CCMFrameExport* self;
+    struct sockaddr_un addr;
+
+    if (strlen (path) >= sizeof (addr.sun_path))
+        return NULL;
+
+    self = g_new0 (CCMFrameExport, 1);
+    self->fd = socket (AF_UNIX, SOCK_SEQPACKET, 0);
+    if (self->fd < 0)
+    {
+        g_free (self);
+        return NULL;
+    }
+
+    memset (&addr, 0, sizeof (addr));
+    addr.sun_family = AF_UNIX;
+    strcpy (addr.sun_path, path);
+    unlink (path);
+
+    if (bind (self->fd, (struct sockaddr*) &addr, sizeof (addr)) < 0 ||
+        listen (self->fd, 4) < 0)
+    {
+        close (self->fd);
+        g_free (self);
+        return NULL;
+    }
+    fcntl (self->fd, F_SETFL, fcntl (self->fd, F_GETFL) | O_NONBLOCK);
+
+    self->path = g_strdup (path);
+    self->channel = g_io_channel_unix_new (self->fd);
+    self->id_accept = g_io_add_watch (self->channel, G_IO_IN,
+                                      (GIOFunc) ccm_frame_export_on_accept,
+                                      self);
+
+    return self;
+}
+
+void
+ccm_frame_export_destroy (CCMFrameExport* self)
+{
+    g_return_if_fail (self != NULL);
+
+    g_slist_foreach (self->clients, (GFunc) ccm_frame_export_client_free,
+                     NULL);
+    g_slist_free (self->clients);
+    g_source_remove (self->id_accept);
+    g_io_channel_unref (self->channel);
+    close (self->fd);
+    unlink (self->path);
+    g_free (self->path);
+    g_free (self);
+}
+
+gboolean
+ccm_frame_export_has_clients (CCMFrameExport* self)
+{
+    g_return_val_if_fail (self != NULL, FALSE);
+
+    return self->clients != NULL;
+}
+
+/**
+ * ccm_frame_export_notify:
+ * @self: #CCMFrameExport
+ * @ring: #CCMFrameRing where frame has been pushed
+ * @sequence: frame sequence
+ *
+ * Send frame number and damage rectangles of frame to all clients. Clients
+ * which have not received the current ring yet get a hello message before.
+ * The first frame received by a client damages the whole screen.
+ **/
+void
+ccm_frame_export_notify (CCMFrameExport* self, CCMFrameRing* ring,
+                         guint32 sequence)
+{
+    g_return_if_fail (self != NULL);
+    g_return_if_fail (ring != NULL);
+
+    const CCMFrameRingHeader* header = ccm_frame_ring_get_header (ring);
+    const CCMFrameRingSlot* slot = ccm_frame_ring_get_slot (ring, sequence);
+    CCMFrameExportHello hello;
+    CCMFrameExportFrame frame, full;
+    CCMFrameRingRect screen;
+    struct iovec iov[2];
+    GSList *item, *next;
+
+    memset (&hello, 0, sizeof (hello));
+    hello.magic = CCM_FRAME_EXPORT_MAGIC;
+    hello.type = CCM_FRAME_EXPORT_HELLO;
+    hello.shmid = ccm_frame_ring_get_id (ring);
+    hello.n_slots = header->n_slots;
+    hello.width = header->width;
+    hello.height = header->height;
+    hello.stride = header->stride;
+    hello.format = header->format;
+
+    memset (&frame, 0, sizeof (frame));
+    frame.magic = CCM_FRAME_EXPORT_MAGIC;
+    frame.type = CCM_FRAME_EXPORT_FRAME;
+    frame.sequence = sequence;
+    frame.slot = sequence % header->n_slots;
+    frame.time = slot->time;
+    frame.n_rects = slot->n_rects;
+
+    // Slots always hold whole frames, a client which missed previous
+    // frames reads the whole slot
+    full = frame;
+    full.n_rects = 1;
+    screen.x = 0;
+    screen.y = 0;
+    screen.width = header->width;
+    screen.height = header->height;
+
+    for (item = self->clients; item; item = next)
+    {
+        CCMFrameExportClient* client = item->data;
+        gboolean alive = TRUE, sent;
+
+        next = item->next;
+
+        if (client->shmid != hello.shmid)
+        {
+            iov[0].iov_base = &hello;
+            iov[0].iov_len = sizeof (hello);
+            alive = ccm_frame_export_send (client, iov, 1, &sent);
+            if (sent)
+            {
+                client->shmid = hello.shmid;
+                client->synced = FALSE;
+            }
+        }
+
+        // Frames are only meaningful once client knows the ring
+        if (alive && client->shmid == hello.shmid)
+        {
+            if (client->synced)
+            {
+                iov[0].iov_base = &frame;
+                iov[0].iov_len = sizeof (frame);
+                iov[1].iov_base = (gpointer) slot->rects;
+                iov[1].iov_len = slot->n_rects * sizeof (CCMFrameRingRect);
+            }
+            else
+            {
+                iov[0].iov_base = &full;
+                iov[0].iov_len = sizeof (full);
+                iov[1].iov_base = &screen;
+                iov[1].iov_len = sizeof (screen);
+            }
+            alive = ccm_frame_export_send (client, iov, 2, &sent);
+            if (sent) client->synced = TRUE;
+        }
+
+        if (!alive)
+        {
+            ccm_debug ("FRAME EXPORT CLIENT GONE %i", client->fd);
+            self->clients = g_slist_delete_link (self->clients, item);
+            ccm_frame_export_client_free (client);
+        }
+    }
+}
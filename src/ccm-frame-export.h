@@ -0,0 +1,81 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4 -*- */
+/*
+ * ccm-frame-export.h
+ * Copyright (C) Nicolas Bruguier 2007-2011 <gandalfn@club-internet.fr>
+ *
+ * cairo-compmgr is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * cairo-compmgr is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CCM_FRAME_EXPORT_H_
+#define _CCM_FRAME_EXPORT_H_
+
+#include <glib.h>
+
+#include "ccm-frame-ring.h"
+
+G_BEGIN_DECLS
+
+#define CCM_FRAME_EXPORT_MAGIC    0x58454343
+
+/*
+ * Messages sent on the export socket, a sequenced packet socket so each
+ * message is received whole. A hello message gives the shared memory ring
+ * before the first frame and each time the ring changes. A frame message
+ * is followed by its damage rectangles, pixels of these rectangles are in
+ * the ring slot of the frame.
+ */
+typedef enum
+{
+    CCM_FRAME_EXPORT_HELLO,
+    CCM_FRAME_EXPORT_FRAME
+} CCMFrameExportMessageType;
+
+typedef struct _CCMFrameExportHello CCMFrameExportHello;
+typedef struct _CCMFrameExportFrame CCMFrameExportFrame;
+
+struct _CCMFrameExportHello
+{
+    guint32 magic;
+    guint32 type;
+    gint32  shmid;
+    guint32 n_slots;
+    guint32 width;
+    guint32 height;
+    guint32 stride;
+    guint32 format;
+};
+
+struct _CCMFrameExportFrame
+{
+    guint32 magic;
+    guint32 type;
+    guint32 sequence;
+    guint32 slot;
+    gint64  time;
+    guint32 n_rects;
+    guint32 padding;
+};
+
+typedef struct _CCMFrameExport CCMFrameExport;
+
+CCMFrameExport* ccm_frame_export_new     (const gchar* path);
+void            ccm_frame_export_destroy (CCMFrameExport* self);
+gboolean        ccm_frame_export_has_clients (CCMFrameExport* self);
+void            ccm_frame_export_notify  (CCMFrameExport* self,
+                                          CCMFrameRing* ring,
+                                          guint32 sequence);
+
+G_END_DECLS
+
+#endif                          /* _CCM_FRAME_EXPORT_H_ */
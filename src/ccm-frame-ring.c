@@ -0,0 +1,261 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4 -*- */
+/*
+ * ccm-frame-ring.c
+ * Copyright (C) Nicolas Bruguier 2007-2011 <gandalfn@club-internet.fr>
+ *
+ * cairo-compmgr is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * cairo-compmgr is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Ring of full frames in a shared memory segment. Each slot keeps its own
+ * pending region, the union of damages pushed since the slot was last
+ * written, so only this region is copied when the slot is reused and
+ * every slot always holds a complete frame.
+ */
+
+#include <string.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+#include "ccm-debug.h"
+#include "ccm-frame-ring.h"
+
+struct _CCMFrameRing
+{
+    gint                shmid;
+    guchar*             addr;
+    CCMFrameRingHeader* header;
+    CCMFrameRingSlot*   slots;
+    CCMRegion**         pending;
+    guint32             sequence;
+};
+
+static inline guchar*
+ccm_frame_ring_get_slot_data (CCMFrameRing* self, guint index)
+{
+    return self->addr + self->header->data_offset +
+           (gsize) index * self->header->stride * self->header->height;
+}
+
+/**
+ * ccm_frame_ring_new:
+ * @n_slots: number of frames in ring
+ * @width: frame width
+ * @height: frame height
+ * @format: frame format, only 32 bits formats are supported
+ *
+ * Create a new frame ring in a private shared memory segment. The segment
+ * is marked to be removed when last process detach it.
+ *
+ * Returns: #CCMFrameRing or %NULL on error
+ **/
+CCMFrameRing*
+ccm_frame_ring_new (guint n_slots, gint width, gint height,
+                    cairo_format_t format)
+{
+    g_return_val_if_fail (n_slots > 0, NULL);
+    g_return_val_if_fail (width > 0 && height > 0, NULL);
+    g_return_val_if_fail (format == CAIRO_FORMAT_ARGB32 ||
+                          format == CAIRO_FORMAT_RGB24, NULL);
+
+    CCMFrameRing* self;
+    gsize offset, size;
+    guint cpt;
+
+    offset = sizeof (CCMFrameRingHeader) + n_slots * sizeof (CCMFrameRingSlot);
+    offset = (offset + CCM_FRAME_RING_ALIGN - 1) & ~(CCM_FRAME_RING_ALIGN - 1);
+    size = offset + (gsize) n_slots * width * 4 * height;
+
+    self = g_new0 (CCMFrameRing, 1);
+    self->shmid = shmget (IPC_PRIVATE, size, IPC_CREAT | 0600);
+    if (self->shmid == -1)
+    {
+        ccm_debug ("FRAME RING SHMGET ERROR");
+        g_free (self);
+        return NULL;
+    }
+
+    self->addr = shmat (self->shmid, 0, 0);
+    // Segment is destroyed on last detach, readers can still attach it
+    shmctl (self->shmid, IPC_RMID, 0);
+    if (self->addr == (gpointer) - 1)
+    {
+        ccm_debug ("FRAME RING SHMAT ERROR");
+        g_free (self);
+        return NULL;
+    }
+
+    self->header = (CCMFrameRingHeader*) self->addr;
+    self->slots = (CCMFrameRingSlot*) (self->addr + sizeof (CCMFrameRingHeader));
+    memset (self->addr, 0, offset);
+
+    self->header->n_slots = n_slots;
+    self->header->width = width;
+    self->header->height = height;
+    self->header->stride = width * 4;
+    self->header->format = format;
+    self->header->data_offset = offset;
+
+    // No slot has been written yet, all need the whole frame
+    self->pending = g_new0 (CCMRegion*, n_slots);
+    for (cpt = 0; cpt < n_slots; ++cpt)
+        self->pending[cpt] = ccm_region_create (0, 0, width, height);
+
+    g_atomic_int_set ((volatile gint*) &self->header->magic,
+                      CCM_FRAME_RING_MAGIC);
+
+    return self;
+}
+
+void
+ccm_frame_ring_destroy (CCMFrameRing* self)
+{
+    g_return_if_fail (self != NULL);
+
+    guint cpt;
+
+    for (cpt = 0; cpt < self->header->n_slots; ++cpt)
+        ccm_region_destroy (self->pending[cpt]);
+    g_free (self->pending);
+    shmdt (self->addr);
+    g_free (self);
+}
+
+gint
+ccm_frame_ring_get_id (CCMFrameRing* self)
+{
+    g_return_val_if_fail (self != NULL, -1);
+
+    return self->shmid;
+}
+
+/**
+ * ccm_frame_ring_push:
+ * @self: #CCMFrameRing
+ * @frame: image surface of frame
+ * @damage: #CCMRegion damaged since previous frame
+ *
+ * Write frame in next slot of ring and publish it.
+ *
+ * Returns: sequence number of frame, 0 on error
+ **/
+guint32
+ccm_frame_ring_push (CCMFrameRing* self, cairo_surface_t* frame,
+                     CCMRegion* damage)
+{
+    g_return_val_if_fail (self != NULL, 0);
+    g_return_val_if_fail (frame != NULL, 0);
+    g_return_val_if_fail (damage != NULL, 0);
+
+    CCMFrameRingSlot* slot;
+    guchar *src, *dst;
+    gint src_stride;
+    XRectangle* rects = NULL;
+    gint nb_rects, cpt, line;
+    guint index;
+
+    if (cairo_surface_get_type (frame) != CAIRO_SURFACE_TYPE_IMAGE ||
+        cairo_image_surface_get_width (frame) != self->header->width ||
+        cairo_image_surface_get_height (frame) != self->header->height)
+        return 0;
+
+    cairo_surface_flush (frame);
+    src = cairo_image_surface_get_data (frame);
+    src_stride = cairo_image_surface_get_stride (frame);
+
+    // Sequence 0 marks a slot in progress, never use it
+    if (!++self->sequence) self->sequence = 1;
+    index = self->sequence % self->header->n_slots;
+    slot = &self->slots[index];
+
+    for (cpt = 0; cpt < self->header->n_slots; ++cpt)
+        ccm_region_union (self->pending[cpt], damage);
+
+    g_atomic_int_set ((volatile gint*) &slot->sequence, 0);
+
+    dst = ccm_frame_ring_get_slot_data (self, index);
+    ccm_region_get_xrectangles (self->pending[index], &rects, &nb_rects);
+    for (cpt = 0; cpt < nb_rects; ++cpt)
+    {
+        gint x1 = MAX (0, rects[cpt].x);
+        gint y1 = MAX (0, rects[cpt].y);
+        gint x2 = MIN ((gint) self->header->width, rects[cpt].x + rects[cpt].width);
+        gint y2 = MIN ((gint) self->header->height, rects[cpt].y + rects[cpt].height);
+
+        for (line = y1; line < y2 && x1 < x2; ++line)
+            memcpy (dst + line * self->header->stride + x1 * 4,
+                    src + line * src_stride + x1 * 4, (x2 - x1) * 4);
+    }
+    if (rects) x_rectangles_free (rects, nb_rects);
+    ccm_region_destroy (self->pending[index]);
+    self->pending[index] = ccm_region_new ();
+
+    // Publish damage of this frame, too many rectangles are merged
+    ccm_region_get_xrectangles (damage, &rects, &nb_rects);
+    if (nb_rects > CCM_FRAME_RING_MAX_RECTS)
+    {
+        cairo_rectangle_t clipbox;
+
+        ccm_region_get_clipbox (damage, &clipbox);
+        slot->n_rects = 1;
+        slot->rects[0].x = clipbox.x;
+        slot->rects[0].y = clipbox.y;
+        slot->rects[0].width = clipbox.width;
+        slot->rects[0].height = clipbox.height;
+    }
+    else
+    {
+        slot->n_rects = nb_rects;
+        for (cpt = 0; cpt < nb_rects; ++cpt)
+        {
+            slot->rects[cpt].x = rects[cpt].x;
+            slot->rects[cpt].y = rects[cpt].y;
+            slot->rects[cpt].width = rects[cpt].width;
+            slot->rects[cpt].height = rects[cpt].height;
+        }
+    }
+    if (rects) x_rectangles_free (rects, nb_rects);
+    slot->time = g_get_monotonic_time ();
+
+    g_atomic_int_set ((volatile gint*) &slot->sequence, self->sequence);
+    g_atomic_int_set ((volatile gint*) &self->header->sequence, self->sequence);
+
+    return self->sequence;
+}
+
+const CCMFrameRingHeader*
+ccm_frame_ring_get_header (CCMFrameRing* self)
+{
+    g_return_val_if_fail (self != NULL, NULL);
+
+    return self->header;
+}
+
+/**
+ * ccm_frame_ring_get_slot:
+ * @self: #CCMFrameRing
+ * @sequence: frame sequence number
+ *
+ * Get slot where frame has been written, the slot may already be reused
+ * by a newer frame if its sequence differs.
+ *
+ * Returns: #CCMFrameRingSlot
+ **/
+const CCMFrameRingSlot*
+ccm_frame_ring_get_slot (CCMFrameRing* self, guint32 sequence)
+{
+    g_return_val_if_fail (self != NULL, NULL);
+
+    return &self->slots[sequence % self->header->n_slots];
+}
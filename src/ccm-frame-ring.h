@@ -0,0 +1,85 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4 -*- */
+/*
+ * ccm-frame-ring.h
+ * Copyright (C) Nicolas Bruguier 2007-2011 <gandalfn@club-internet.fr>
+ *
+ * cairo-compmgr is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * cairo-compmgr is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CCM_FRAME_RING_H_
+#define _CCM_FRAME_RING_H_
+
+#include <glib.h>
+#include <cairo.h>
+
+#include "ccm.h"
+
+G_BEGIN_DECLS
+
+#define CCM_FRAME_RING_MAGIC      0x46524343
+#define CCM_FRAME_RING_MAX_RECTS  64
+#define CCM_FRAME_RING_ALIGN      64
+
+/*
+ * Layout of the shared memory segment, readers attach it with shmat and
+ * find the segment id in the _CCM_FRAME_RING property of root window.
+ * A slot is being written while its sequence is 0, a reader must check
+ * the slot sequence is unchanged after copy of pixels.
+ */
+typedef struct _CCMFrameRingRect CCMFrameRingRect;
+typedef struct _CCMFrameRingSlot CCMFrameRingSlot;
+typedef struct _CCMFrameRingHeader CCMFrameRingHeader;
+
+struct _CCMFrameRingRect
+{
+    gint32 x, y;
+    gint32 width, height;
+};
+
+struct _CCMFrameRingSlot
+{
+    volatile guint32 sequence;
+    guint32          n_rects;
+    gint64           time;
+    CCMFrameRingRect rects[CCM_FRAME_RING_MAX_RECTS];
+};
+
+struct _CCMFrameRingHeader
+{
+    guint32          magic;
+    guint32          n_slots;
+    guint32          width;
+    guint32          height;
+    guint32          stride;
+    guint32          format;
+    volatile guint32 sequence;
+    guint32          data_offset;
+};
+
+typedef struct _CCMFrameRing CCMFrameRing;
+
+CCMFrameRing* ccm_frame_ring_new     (guint n_slots, gint width, gint height,
+                                      cairo_format_t format);
+void          ccm_frame_ring_destroy (CCMFrameRing* self);
+gint          ccm_frame_ring_get_id  (CCMFrameRing* self);
+guint32       ccm_frame_ring_push    (CCMFrameRing* self,
+                                      cairo_surface_t* frame,
+                                      CCMRegion* damage);
+const CCMFrameRingHeader* ccm_frame_ring_get_header (CCMFrameRing* self);
+const CCMFrameRingSlot*   ccm_frame_ring_get_slot   (CCMFrameRing* self,
+                                                     guint32 sequence);
+
+G_END_DECLS
+
+#endif                          /* _CCM_FRAME_RING_H_ */
@@ -40,6 +40,8 @@ struct _CCMImage
     int height;
     XImage *image;
     XShmSegmentInfo shminfo;
+    Pixmap pixmap;
+    GC gc;
 
     pixman_image_t *pimage;
 };
@@ -70,6 +72,16 @@ ccm_image_get_pixman_format (cairo_format_t format)
     return ret;
 }
 
+/* Count pixels bytes of area transfered between server and image */
+static void
+ccm_image_count_copy (CCMImage * image, int width, int height)
+{
+    if (image->image)
+        _ccm_display_count_copy (image->display,
+                                 (guint64) width * height *
+                                 (image->image->bits_per_pixel / 8));
+}
+
 CCMImage *
 ccm_image_new (CCMDisplay * display, Visual * visual, cairo_format_t format,
                int width, int height, int depth)
@@ -144,6 +156,10 @@ ccm_image_destroy (CCMImage * image)
     if (image->image)
     {
         pixman_image_unref (image->pimage);
+        if (image->gc)
+            XFreeGC (CCM_DISPLAY_XDISPLAY (image->display), image->gc);
+        if (image->pixmap)
+            XFreePixmap (CCM_DISPLAY_XDISPLAY (image->display), image->pixmap);
         if (image->xshm)
         {
             XShmDetach (CCM_DISPLAY_XDISPLAY (image->display), &image->shminfo);
@@ -162,8 +178,19 @@ ccm_image_get_image (CCMImage * image, CCMPixmap * pixmap, int x, int y)
     g_return_val_if_fail (image != NULL, FALSE);
     g_return_val_if_fail (pixmap != NULL, FALSE);
 
-    if (image->xshm)
+    if (image->pixmap)
+    {
+        // Server write pixmap content directly in shared memory
+        XCopyArea (CCM_DISPLAY_XDISPLAY (image->display),
+                   CCM_PIXMAP_XPIXMAP (pixmap), image->pixmap, image->gc,
+                   x, y, image->width, image->height, 0, 0);
+        ccm_display_sync (image->display);
+        ccm_image_count_copy (image, image->width, image->height);
+        return TRUE;
+    }
+    else if (image->xshm)
     {
+        ccm_image_count_copy (image, image->width, image->height);
         return XShmGetImage (CCM_DISPLAY_XDISPLAY (image->display),
                              CCM_PIXMAP_XPIXMAP (pixmap), image->image, x, y,
                              AllPlanes);
@@ -188,10 +215,13 @@ ccm_image_get_image (CCMImage * image, CCMPixmap * pixmap, int x, int y)
                        image->height, AllPlanes, ZPixmap);
 
         if (image->image)
+        {
             image->pimage =
             pixman_image_create_bits (pformat, image->width, image->height,
                                       (guint32 *) image->image->data,
                                       image->image->bytes_per_line);
+            ccm_image_count_copy (image, image->width, image->height);
+        }
         return image->image != NULL;
     }
 }
@@ -205,9 +235,23 @@ ccm_image_get_sub_image (CCMImage * image, CCMPixmap * pixmap, int x, int y,
     g_return_val_if_fail (width > 0 && height > 0, FALSE);
 
     gboolean ret = FALSE;
-    cairo_format_t format = ccm_drawable_get_format (CCM_DRAWABLE (pixmap));
-    CCMImage *sub_image = ccm_image_new (image->display, image->visual,
-                                         format, width, height, image->depth);
+    cairo_format_t format;
+    CCMImage *sub_image;
+
+    // Copy area in place, no intermediate image is needed. Caller must
+    // sync display before reading image data.
+    if (image->pixmap)
+    {
+        XCopyArea (CCM_DISPLAY_XDISPLAY (image->display),
+                   CCM_PIXMAP_XPIXMAP (pixmap), image->pixmap, image->gc,
+                   x, y, width, height, x, y);
+        ccm_image_count_copy (image, width, height);
+        return TRUE;
+    }
+
+    format = ccm_drawable_get_format (CCM_DRAWABLE (pixmap));
+    sub_image = ccm_image_new (image->display, image->visual,
+                               format, width, height, image->depth);
     if (sub_image)
     {
         if (ccm_image_get_image (sub_image, pixmap, x, y))
@@ -215,6 +259,7 @@ ccm_image_get_sub_image (CCMImage * image, CCMPixmap * pixmap, int x, int y,
             pixman_image_composite (PIXMAN_OP_SRC, sub_image->pimage, NULL,
                                     image->pimage, 0, 0, 0, 0, x, y, width,
                                     height);
+            ccm_image_count_copy (image, width, height);
             ret = TRUE;
         }
         else
@@ -239,6 +284,15 @@ ccm_image_put_image (CCMImage * image, CCMPixmap * pixmap, int x_src, int y_src,
     GC gc;
     gboolean ret = FALSE;
 
+    if (image->pixmap)
+    {
+        XCopyArea (CCM_DISPLAY_XDISPLAY (image->display), image->pixmap,
+                   CCM_PIXMAP_XPIXMAP (pixmap), image->gc,
+                   x_src, y_src, width, height, x, y);
+        ccm_image_count_copy (image, width, height);
+        return TRUE;
+    }
+
     gcv.graphics_exposures = FALSE;
     gcv.subwindow_mode = IncludeInferiors;
 
@@ -264,11 +318,63 @@ ccm_image_put_image (CCMImage * image, CCMPixmap * pixmap, int x_src, int y_src,
 
     XFreeGC (CCM_DISPLAY_XDISPLAY (image->display), gc);
 
-    if (!ret)
+    if (ret)
+        ccm_image_count_copy (image, width, height);
+    else
         ccm_debug ("ERROR ON FLUSH PIXMAP");
     return ret;
 }
 
+/**
+ * ccm_image_use_shm_pixmap:
+ * @image: #CCMImage
+ * @drawable: drawable on the screen of the shared pixmap
+ *
+ * Create a server pixmap on shared memory of image, then image content is
+ * transfered with copy area requests directly from or to the shared memory.
+ *
+ * Returns: %TRUE if image is now backed by a shared pixmap
+ **/
+gboolean
+ccm_image_use_shm_pixmap (CCMImage * image, Drawable drawable)
+{
+    g_return_val_if_fail (image != NULL, FALSE);
+
+    if (!image->pixmap && image->xshm && image->image &&
+        _ccm_display_use_shm_pixmap (image->display))
+    {
+        XGCValues gcv;
+
+        image->pixmap = XShmCreatePixmap (CCM_DISPLAY_XDISPLAY (image->display),
+                                          drawable, image->shminfo.shmaddr,
+                                          &image->shminfo, image->width,
+                                          image->height, image->depth);
+        if (!image->pixmap)
+            return FALSE;
+
+        gcv.graphics_exposures = FALSE;
+        gcv.subwindow_mode = IncludeInferiors;
+        image->gc = XCreateGC (CCM_DISPLAY_XDISPLAY (image->display),
+                               image->pixmap,
+                               GCGraphicsExposures | GCSubwindowMode, &gcv);
+        if (!image->gc)
+        {
+            XFreePixmap (CCM_DISPLAY_XDISPLAY (image->display), image->pixmap);
+            image->pixmap = None;
+        }
+    }
+
+    return image->pixmap != None;
+}
+
+G_GNUC_PURE Pixmap
+ccm_image_get_xpixmap (CCMImage * image)
+{
+    g_return_val_if_fail (image != NULL, None);
+
+    return image->pixmap;
+}
+
 G_GNUC_PURE guchar *
 ccm_image_get_data (CCMImage * image)
 {
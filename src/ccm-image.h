@@ -39,6 +39,8 @@ gboolean            ccm_image_get_sub_image (CCMImage* image, CCMPixmap* pixmap,
 gboolean            ccm_image_put_image     (CCMImage* image, CCMPixmap* pixmap, 
                                              int x_src, int y_src, int x, int y, 
                                              int width, int height);
+gboolean            ccm_image_use_shm_pixmap(CCMImage* image, Drawable drawable);
+G_GNUC_PURE Pixmap    ccm_image_get_xpixmap (CCMImage* image);
 G_GNUC_PURE guchar*   ccm_image_get_data    (CCMImage* image);
 G_GNUC_PURE gint      ccm_image_get_width   (CCMImage* image);
 G_GNUC_PURE gint      ccm_image_get_height  (CCMImage* image);
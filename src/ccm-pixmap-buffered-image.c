@@ -40,6 +40,7 @@ struct _CCMPixmapBufferedImagePrivate
 {
     gboolean buffered;
     cairo_surface_t *surface;
+    gint64 surface_memory;
     CCMRegion *need_to_sync;
 };
 
@@ -77,6 +78,7 @@ ccm_pixmap_buffered_image_init (CCMPixmapBufferedImage * self)
 
     self->priv->buffered = FALSE;
     self->priv->surface = NULL;
+    self->priv->surface_memory = 0;
     self->priv->need_to_sync = NULL;
 }
 
@@ -89,6 +91,8 @@ ccm_pixmap_buffered_image_finalize (GObject * object)
     {
         ccm_debug ("FINALIZE BUFFERED IMAGE : %i",
                    cairo_surface_get_reference_count (self->priv->surface));
+        _ccm_pixmap_add_image_memory (CCM_PIXMAP (self),
+                                      -self->priv->surface_memory);
         cairo_surface_destroy (self->priv->surface);
         self->priv->surface = NULL;
     }
@@ -174,6 +178,9 @@ ccm_pixmap_buffered_image_sync (CCMPixmapBufferedImage * self,
 
             self->priv->surface = cairo_surface_create_similar (target, content,
                                                                 width, height);
+            self->priv->surface_memory = (gint64) width * (gint64) height * 4;
+            _ccm_pixmap_add_image_memory (CCM_PIXMAP (self),
+                                          self->priv->surface_memory);
             cairo_surface_destroy (target);
             sync_all = TRUE;
         }
@@ -217,6 +224,9 @@ ccm_pixmap_buffered_image_get_surface (CCMDrawable * drawable)
     CCMPixmapBufferedImage *self = CCM_PIXMAP_BUFFERED_IMAGE (drawable);
     cairo_surface_t *surface = NULL;
 
+    // Damage is repaired on demand, fetch it now to use buffered surface
+    ccm_drawable_repair (drawable);
+
     if (self->priv->buffered && !ccm_drawable_is_damaged (drawable))
     {
         surface = CCM_DRAWABLE_CLASS (ccm_pixmap_buffered_image_parent_class)->get_surface (drawable);
@@ -48,6 +48,7 @@ static void ccm_pixmap_image_flush_region (CCMDrawable * drawable,
                                            CCMRegion * area);
 static void ccm_pixmap_image_bind (CCMPixmap * self);
 static void ccm_pixmap_image_release (CCMPixmap * self);
+static void ccm_pixmap_image_destroy_image (CCMPixmapImage * self);
 
 static void
 ccm_pixmap_image_init (CCMPixmapImage * self)
@@ -82,6 +83,19 @@ ccm_pixmap_image_class_init (CCMPixmapImageClass * klass)
     object_class->finalize = ccm_pixmap_image_finalize;
 }
 
+static void
+ccm_pixmap_image_destroy_image (CCMPixmapImage * self)
+{
+    if (self->priv->image)
+    {
+        _ccm_pixmap_add_image_memory (CCM_PIXMAP (self),
+                                      -(gint64) ccm_image_get_stride (self->priv->image) *
+                                      ccm_image_get_height (self->priv->image));
+        ccm_image_destroy (self->priv->image);
+        self->priv->image = NULL;
+    }
+}
+
 static void
 ccm_pixmap_image_bind (CCMPixmap * pixmap)
 {
@@ -100,6 +114,19 @@ ccm_pixmap_image_bind (CCMPixmap * pixmap)
                                            depth);
     else
         ccm_debug ("PIXMAP BIND ERROR");
+
+    if (self->priv->image)
+    {
+        CCMScreen *screen = ccm_drawable_get_screen (CCM_DRAWABLE (pixmap));
+
+        _ccm_pixmap_add_image_memory (pixmap,
+                                      (gint64) ccm_image_get_stride (self->priv->image) *
+                                      ccm_image_get_height (self->priv->image));
+
+        if (_ccm_screen_use_shm_pixmap (screen) &&
+            !ccm_image_use_shm_pixmap (self->priv->image, CCM_PIXMAP_XPIXMAP (pixmap)))
+            ccm_debug ("PIXMAP SHM BIND ERROR");
+    }
 }
 
 static void
@@ -111,8 +138,8 @@ ccm_pixmap_image_release (CCMPixmap * pixmap)
 
     if (self->priv->surface)
         cairo_surface_destroy (self->priv->surface);
-    if (self->priv->image)
-        ccm_image_destroy (self->priv->image);
+    self->priv->surface = NULL;
+    ccm_pixmap_image_destroy_image (self);
 }
 
 static gboolean
@@ -133,8 +160,7 @@ ccm_pixmap_image_repair (CCMDrawable * drawable, CCMRegion * area)
             {
                 ccm_debug ("IMAGE_REPAIR ERROR");
                 ret = FALSE;
-                ccm_image_destroy (self->priv->image);
-                self->priv->image = NULL;
+                ccm_pixmap_image_destroy_image (self);
             }
             else
                 self->priv->synced = TRUE;
@@ -153,13 +179,16 @@ ccm_pixmap_image_repair (CCMDrawable * drawable, CCMRegion * area)
                                               rects[cpt].width, rects[cpt].height))
                 {
                     ccm_debug ("SUB IMAGE_REPAIR ERROR");
-                    ccm_image_destroy (self->priv->image);
-                    self->priv->image = NULL;
+                    ccm_pixmap_image_destroy_image (self);
                     ret = FALSE;
                     break;
                 }
             }
             if (rects) x_rectangles_free (rects, nb_rects);
+
+            // Wait the end of copies in shared memory
+            if (self->priv->image && ccm_image_get_xpixmap (self->priv->image))
+                ccm_display_sync (ccm_drawable_get_display (drawable));
         }
     }
 
@@ -209,6 +238,8 @@ ccm_pixmap_image_flush (CCMDrawable * drawable)
 
         ccm_image_put_image (self->priv->image, CCM_PIXMAP (self), 0, 0, 0, 0,
                              clipbox.width, clipbox.height);
+        if (ccm_image_get_xpixmap (self->priv->image))
+            ccm_display_sync (ccm_drawable_get_display (drawable));
     }
 }
 
@@ -232,5 +263,7 @@ ccm_pixmap_image_flush_region (CCMDrawable * drawable, CCMRegion * area)
                                  rects[cpt].y, rects[cpt].width,
                                  rects[cpt].height);
         if (rects) x_rectangles_free (rects, nb_rects);
+        if (ccm_image_get_xpixmap (self->priv->image))
+            ccm_display_sync (ccm_drawable_get_display (drawable));
     }
 }
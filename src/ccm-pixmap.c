@@ -48,6 +48,10 @@ struct _CCMPixmapPrivate
     XserverRegion region;
 
     gboolean freeze;
+
+    CCMPixmapMemory memory_type;
+    gint64 memory;
+    gint64 image_memory;
 };
 
 #define CCM_PIXMAP_GET_PRIVATE(o)  \
@@ -56,6 +60,10 @@ struct _CCMPixmapPrivate
 static void ccm_pixmap_bind (CCMPixmap * self);
 static void ccm_pixmap_release (CCMPixmap * self);
 static void ccm_pixmap_on_damage (CCMPixmap * self, Damage damage);
+static void ccm_pixmap_update_memory (CCMPixmap * self);
+static CCMPixmapMemory ccm_pixmap_get_image_memory_type (CCMPixmap * self);
+static void ccm_pixmap_account_memory (CCMPixmap * self, CCMPixmapMemory type,
+                                       gint64 size);
 
 static void
 ccm_pixmap_set_property (GObject * object, guint prop_id, const GValue * value,
@@ -73,7 +81,9 @@ ccm_pixmap_set_property (GObject * object, guint prop_id, const GValue * value,
         case PROP_FOREIGN:
             {
                 self->priv->foreign = g_value_get_boolean (value);
+                ccm_pixmap_update_memory (self);
             }
+            break;
         default:
             break;
     }
@@ -110,6 +120,9 @@ ccm_pixmap_init (CCMPixmap * self)
     self->priv->foreign = FALSE;
     self->priv->damage = 0;
     self->priv->freeze = FALSE;
+    self->priv->memory_type = CCM_PIXMAP_MEMORY_PIXMAP;
+    self->priv->memory = 0;
+    self->priv->image_memory = 0;
 }
 
 static void
@@ -120,6 +133,13 @@ ccm_pixmap_finalize (GObject * object)
 
     ccm_pixmap_release (self);
 
+    ccm_pixmap_account_memory (self, self->priv->memory_type,
+                               -self->priv->memory);
+    ccm_pixmap_account_memory (self, ccm_pixmap_get_image_memory_type (self),
+                               -self->priv->image_memory);
+    self->priv->memory = 0;
+    self->priv->image_memory = 0;
+
     if (CCM_IS_DISPLAY (display) &&  G_OBJECT (display)->ref_count && self->priv->damage)
     {
         ccm_display_unregister_damage (display, self->priv->damage, CCM_DRAWABLE (self));
@@ -173,6 +193,46 @@ ccm_pixmap_class_init (CCMPixmapClass * klass)
     object_class->finalize = ccm_pixmap_finalize;
 }
 
+static CCMPixmapMemory
+ccm_pixmap_get_image_memory_type (CCMPixmap * self)
+{
+    // Client side copy of a shadow is accounted with shadow
+    return self->priv->memory_type == CCM_PIXMAP_MEMORY_SHADOW ?
+           CCM_PIXMAP_MEMORY_SHADOW : CCM_PIXMAP_MEMORY_IMAGE;
+}
+
+static void
+ccm_pixmap_account_memory (CCMPixmap * self, CCMPixmapMemory type, gint64 size)
+{
+    CCMScreen *screen = ccm_drawable_get_screen (CCM_DRAWABLE (self));
+
+    if (size && CCM_IS_SCREEN (screen) && G_OBJECT (screen)->ref_count)
+        _ccm_screen_add_memory (screen, type, size);
+}
+
+static void
+ccm_pixmap_update_memory (CCMPixmap * self)
+{
+    g_return_if_fail (self != NULL);
+
+    cairo_rectangle_t clipbox;
+    gint64 memory = 0;
+
+    // Foreign pixmap memory is not owned by us
+    if (!self->priv->foreign && self->priv->damage &&
+        ccm_drawable_get_geometry_clipbox (CCM_DRAWABLE (self), &clipbox))
+    {
+        gint depth = ccm_drawable_get_depth (CCM_DRAWABLE (self));
+
+        memory = (gint64) clipbox.width * (gint64) clipbox.height;
+        memory *= depth > 16 ? 4 : depth > 8 ? 2 : 1;
+    }
+
+    ccm_pixmap_account_memory (self, self->priv->memory_type,
+                               memory - self->priv->memory);
+    self->priv->memory = memory;
+}
+
 static void
 ccm_pixmap_bind (CCMPixmap * self)
 {
@@ -180,6 +240,8 @@ ccm_pixmap_bind (CCMPixmap * self)
 
     if (CCM_PIXMAP_GET_CLASS (self)->bind)
         CCM_PIXMAP_GET_CLASS (self)->bind (self);
+
+    ccm_pixmap_update_memory (self);
 }
 
 static void
@@ -228,7 +290,11 @@ ccm_pixmap_on_damage (CCMPixmap * self, Damage damage)
                 XFree (rects);
 
                 ccm_drawable_damage_region (CCM_DRAWABLE (self), damaged);
-                ccm_drawable_repair(CCM_DRAWABLE (self));
+                // Backends which download pixels repair on demand when
+                // their surface is requested, so windows which are not
+                // painted or sampled by a plugin cost nothing
+                if (!CCM_DRAWABLE_GET_CLASS (self)->repair)
+                    ccm_drawable_repair(CCM_DRAWABLE (self));
                 ccm_region_destroy (damaged);
             }
         }
@@ -386,6 +452,7 @@ ccm_pixmap_set_foreign (CCMPixmap * self, gboolean foreign)
     g_return_if_fail (self != NULL);
 
     self->priv->foreign = foreign;
+    ccm_pixmap_update_memory (self);
 
     g_object_notify (G_OBJECT (self), "foreign");
 }
@@ -407,3 +474,42 @@ ccm_pixmap_set_freeze (CCMPixmap * self, gboolean freeze)
 
     g_object_notify (G_OBJECT (self), "freeze");
 }
+
+/**
+ * ccm_pixmap_set_memory_type:
+ * @self: #CCMPixmap
+ * @type: #CCMPixmapMemory
+ *
+ * Set the category in which the memory used by pixmap is accounted in screen
+ * memory usage.
+ **/
+void
+ccm_pixmap_set_memory_type (CCMPixmap * self, CCMPixmapMemory type)
+{
+    g_return_if_fail (self != NULL);
+    g_return_if_fail (type < CCM_PIXMAP_MEMORY_N);
+
+    if (type == self->priv->memory_type) return;
+
+    ccm_pixmap_account_memory (self, self->priv->memory_type,
+                               -self->priv->memory);
+    ccm_pixmap_account_memory (self, ccm_pixmap_get_image_memory_type (self),
+                               -self->priv->image_memory);
+
+    self->priv->memory_type = type;
+
+    ccm_pixmap_account_memory (self, self->priv->memory_type,
+                               self->priv->memory);
+    ccm_pixmap_account_memory (self, ccm_pixmap_get_image_memory_type (self),
+                               self->priv->image_memory);
+}
+
+void
+_ccm_pixmap_add_image_memory (CCMPixmap * self, gint64 size)
+{
+    g_return_if_fail (self != NULL);
+
+    self->priv->image_memory += size;
+    ccm_pixmap_account_memory (self, ccm_pixmap_get_image_memory_type (self),
+                               size);
+}
@@ -61,6 +61,11 @@ G_GNUC_PURE gboolean   ccm_pixmap_get_foreign     (CCMPixmap* self);
 void                   ccm_pixmap_set_foreign     (CCMPixmap* self, gboolean foreign);
 G_GNUC_PURE gboolean   ccm_pixmap_get_freeze      (CCMPixmap * self);
 void                   ccm_pixmap_set_freeze      (CCMPixmap * self, gboolean freeze);
+void                   ccm_pixmap_set_memory_type (CCMPixmap* self,
+                                                   CCMPixmapMemory type);
+
+void                   _ccm_pixmap_add_image_memory (CCMPixmap* self,
+                                                     gint64 size);
 
 G_END_DECLS
 
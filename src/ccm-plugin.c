@@ -215,6 +215,12 @@ typedef struct
     GSList *callbacks;
 } CCMPluginLock;
 
+typedef struct
+{
+    CCMPluginLockNotifyFunc func;
+    gpointer data;
+} CCMPluginLockNotify;
+
 G_DEFINE_TYPE(CCMPlugin, ccm_plugin, G_TYPE_OBJECT);
 
 struct _CCMPluginPrivate
@@ -222,9 +228,11 @@ struct _CCMPluginPrivate
     GObject *parent;
     guint screen;
     gulong *id_options_changed;
+    gpointer dispatch;
 };
 
 static GQuark CCMPLuginLockTable;
+static GQuark CCMPLuginLockNotifyQuark;
 
 #define CCM_PLUGIN_GET_PRIVATE(o) \
     (G_TYPE_INSTANCE_GET_PRIVATE ((o), CCM_TYPE_PLUGIN, CCMPluginPrivate))
@@ -273,6 +281,7 @@ ccm_plugin_init (CCMPlugin * self)
     self->priv = CCM_PLUGIN_GET_PRIVATE (self);
     self->priv->parent = NULL;
     self->priv->screen = 0;
+    self->priv->dispatch = NULL;
 }
 
 static void
@@ -299,6 +308,7 @@ ccm_plugin_class_init (CCMPluginClass * klass)
     GObjectClass *object_class = G_OBJECT_CLASS (klass);
 
     CCMPLuginLockTable = g_quark_from_static_string ("CCMPluginLockTable");
+    CCMPLuginLockNotifyQuark = g_quark_from_static_string ("CCMPluginLockNotify");
 
     g_type_class_add_private (klass, sizeof (CCMPluginPrivate));
 
@@ -416,6 +426,21 @@ _ccm_plugin_get_lock_table (GObject * obj, gboolean create)
     return lock_table;
 }
 
+static void
+_ccm_plugin_lock_notify_free (CCMPluginLockNotify * notify)
+{
+    g_slice_free (CCMPluginLockNotify, notify);
+}
+
+static void
+_ccm_plugin_lock_changed (GObject * obj)
+{
+    CCMPluginLockNotify *notify = g_object_get_qdata (obj, CCMPLuginLockNotifyQuark);
+
+    if (notify && notify->func)
+        notify->func (obj, notify->data);
+}
+
 gboolean
 _ccm_plugin_method_locked (GObject * obj, gpointer func)
 {
@@ -455,6 +480,7 @@ _ccm_plugin_lock_method (GObject * obj, gpointer func,
         lock->count = 1;
         lock->callbacks = NULL;
         g_hash_table_insert (lock_table, func, lock);
+        _ccm_plugin_lock_changed (obj);
     }
 
     if (callback)
@@ -495,7 +521,37 @@ _ccm_plugin_unlock_method (GObject * obj, gpointer func)
             }
         }
         g_hash_table_remove (lock_table, func);
+        _ccm_plugin_lock_changed (obj);
+    }
+}
+
+/**
+ * _ccm_plugin_set_lock_notify:
+ * @obj: object which own the lock table
+ * @func: function called when a method of @obj is locked or unlocked
+ * @data: user data passed to @func
+ *
+ * Set the function called each time a method of @obj change its lock state.
+ * Only the first lock and the last unlock of a method are notified. Passing
+ * %NULL as @func remove the previous notify.
+ **/
+void
+_ccm_plugin_set_lock_notify (GObject * obj, CCMPluginLockNotifyFunc func,
+                             gpointer data)
+{
+    g_return_if_fail (obj != NULL);
+
+    CCMPluginLockNotify *notify = NULL;
+
+    if (func)
+    {
+        notify = g_slice_new (CCMPluginLockNotify);
+        notify->func = func;
+        notify->data = data;
     }
+
+    g_object_set_qdata_full (obj, CCMPLuginLockNotifyQuark, notify,
+                             (GDestroyNotify) _ccm_plugin_lock_notify_free);
 }
 
 void
@@ -583,6 +639,20 @@ ccm_plugin_get_parent (CCMPlugin * self)
     return self->priv->parent;
 }
 
+G_GNUC_PURE gpointer
+_ccm_plugin_get_dispatch (CCMPlugin * self)
+{
+    return self->priv->dispatch;
+}
+
+void
+_ccm_plugin_set_dispatch (CCMPlugin * self, gpointer dispatch)
+{
+    g_return_if_fail (self != NULL);
+
+    self->priv->dispatch = dispatch;
+}
+
 void
 ccm_plugin_set_parent (CCMPlugin * self, GObject * parent)
 {
@@ -50,6 +50,7 @@ typedef struct _CCMPluginOptions        CCMPluginOptions;
 
 typedef void (*CCMPluginOptionsChangedFunc) (CCMPlugin* plugin, int index);
 typedef void (*CCMPluginUnlockFunc) (gpointer data);
+typedef void (*CCMPluginLockNotifyFunc) (GObject* obj, gpointer data);
 
 struct _CCMPluginClass
 {
@@ -275,6 +276,13 @@ void     _ccm_plugin_lock_method   (GObject* obj, gpointer func,
                                     CCMPluginUnlockFunc callback, 
                                     gpointer data);
 void     _ccm_plugin_unlock_method (GObject* obj, gpointer func);
+void     _ccm_plugin_set_lock_notify (GObject* obj,
+                                      CCMPluginLockNotifyFunc func,
+                                      gpointer data);
+
+G_GNUC_PURE gpointer _ccm_plugin_get_dispatch (CCMPlugin* self);
+void                 _ccm_plugin_set_dispatch (CCMPlugin* self,
+                                               gpointer dispatch);
 
 G_END_DECLS
 
@@ -805,6 +805,16 @@ ccm_preferences_page_change_backend (CCMPreferencesPage * self, gchar * name)
         ccm_config_set_string (self->priv->screen_options[CCM_SCREEN_BACKEND],
                                "xrender", NULL);
     }
+    else if (!g_ascii_strcasecmp (name, "shm"))
+    {
+        ccm_config_set_boolean (self->priv->screen_options[CCM_SCREEN_PIXMAP],
+                                FALSE, NULL);
+        ccm_config_set_boolean (self->priv->
+                                screen_options[CCM_SCREEN_USE_BUFFERED], FALSE,
+                                NULL);
+        ccm_config_set_string (self->priv->screen_options[CCM_SCREEN_BACKEND],
+                               "shm", NULL);
+    }
     else if (!g_ascii_strcasecmp (name, "xrender"))
     {
         ccm_config_set_boolean (self->priv->screen_options[CCM_SCREEN_PIXMAP],
@@ -41,8 +41,10 @@ struct _CCMPropertyASyncPrivate
     gulong request_seq;
 
     guint id;
+    gboolean error;
     gchar *data;
     gulong n_items;
+    int format;
 };
 
 #define CCM_PROPERTY_ASYNC_GET_PRIVATE(o)  \
@@ -60,6 +62,8 @@ ccm_property_async_init (CCMPropertyASync * self)
     self->priv->request_seq = 0;
     self->priv->data = NULL;
     self->priv->n_items = 0;
+    self->priv->format = 0;
+    self->priv->error = FALSE;
     self->priv->id = 0;
 }
 
@@ -119,6 +123,14 @@ ccm_property_async_idle (CCMPropertyASync * self)
     if (!CCM_IS_PROPERTY_ASYNC (self))
         return FALSE;
 
+    self->priv->id = 0;
+
+    if (self->priv->error)
+    {
+        g_signal_emit (self, signals[ERROR], 0);
+        return FALSE;
+    }
+
     ccm_debug ("IDLE DATA %i %x", self->priv->n_items, self->priv->data);
 
     g_signal_emit (self, signals[REPLY], 0, self->priv->n_items,
@@ -127,6 +139,19 @@ ccm_property_async_idle (CCMPropertyASync * self)
     return FALSE;
 }
 
+/*
+ * Signals are never emitted from the Xlib async handler, handlers are free
+ * to send new requests.
+ */
+static void
+ccm_property_async_schedule (CCMPropertyASync * self, gboolean error)
+{
+    self->priv->error = error;
+    self->priv->id = g_idle_add_full (G_PRIORITY_HIGH,
+                                      (GSourceFunc) ccm_property_async_idle,
+                                      self, NULL);
+}
+
 static Bool
 ccm_property_async_handler (Display * dpy, xReply * rep, char *buf, int len,
                             XPointer dta)
@@ -144,7 +169,7 @@ ccm_property_async_handler (Display * dpy, xReply * rep, char *buf, int len,
     {
         _XGetAsyncReply (dpy, (char *) &replbuf, rep, buf, len,
                          (sizeof (xError) - sizeof (xReply)) >> 2, False);
-        g_signal_emit (self, signals[ERROR], 0);
+        ccm_property_async_schedule (self, TRUE);
         return True;
     }
 
@@ -160,6 +185,7 @@ ccm_property_async_handler (Display * dpy, xReply * rep, char *buf, int len,
     {
         gulong nbytes, netbytes;
 
+        self->priv->format = reply->format;
         switch (reply->format)
         {
             case 8:
@@ -231,22 +257,21 @@ ccm_property_async_handler (Display * dpy, xReply * rep, char *buf, int len,
             (self->priv->data)[nbytes] = '\0';
             self->priv->n_items = reply->nItems;
             ccm_debug ("DATA %i", self->priv->n_items);
-            self->priv->id = g_idle_add_full (G_PRIORITY_HIGH,
-                                              (GSourceFunc) ccm_property_async_idle, 
-                                              self, NULL);
+            ccm_property_async_schedule (self, FALSE);
         }
         else
         {
             ccm_debug ("BAD ALLOC");
             _XGetAsyncData (dpy, NULL, buf, len, sizeof (xGetPropertyReply), 0,
                             netbytes);
-            g_signal_emit (self, signals[ERROR], 0);
+            ccm_property_async_schedule (self, TRUE);
             return BadAlloc;
         }
     }
     else
     {
-        g_signal_emit (self, signals[ERROR], 0);
+        // Property does not exist, reply without data
+        ccm_property_async_schedule (self, FALSE);
     }
 
     return True;
@@ -297,3 +322,11 @@ ccm_property_async_get_property (CCMPropertyASync * self)
 
     return self->priv ? self->priv->property : None;
 }
+
+G_GNUC_PURE int
+ccm_property_async_get_format (CCMPropertyASync * self)
+{
+    g_return_val_if_fail (self != NULL, 0);
+
+    return self->priv ? self->priv->format : 0;
+}
@@ -55,6 +55,7 @@ CCMPropertyASync* ccm_property_async_new          (CCMDisplay* display, Window w
                                                    Atom property, Atom req_type, 
                                                    long length);
 G_GNUC_PURE Atom  ccm_property_async_get_property (CCMPropertyASync * self);
+G_GNUC_PURE int   ccm_property_async_get_format   (CCMPropertyASync * self);
 
 G_END_DECLS
 
@@ -0,0 +1,458 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4 -*- */
+/*
+ * ccm-property-cache.c
+ * Copyright (C) Nicolas Bruguier 2007-2011 <gandalfn@club-internet.fr>
+ *
+ * cairo-compmgr is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * cairo-compmgr is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Window property cache: the last value read of each property is kept by
+ * atom until a PropertyNotify of this atom invalidates it. Asynchronous
+ * reads of a property already in flight share its request, callbacks are
+ * all called with the same reply. A request invalidated before its reply
+ * still calls its callbacks but its value is not cached.
+ */
+
+#include <string.h>
+
+#include "ccm-debug.h"
+#include "ccm-display.h"
+#include "ccm-xid-table.h"
+#include "ccm-property-async.h"
+#include "ccm-property-cache.h"
+
+typedef struct _CCMPropertyCacheEntry CCMPropertyCacheEntry;
+typedef struct _CCMPropertyCacheRequest CCMPropertyCacheRequest;
+
+struct _CCMPropertyCacheEntry
+{
+    CCMPropertyCacheEntry*   next;
+    Window                   window;
+    Atom                     property;
+    Atom                     req_type;
+    long                     length;
+
+    gboolean                 valid;
+    guint                    n_items;
+    gchar*                   data;
+    gsize                    size;
+
+    CCMPropertyCacheRequest* request;
+};
+
+typedef struct
+{
+    CCMWindowPropertyFunc func;
+    gpointer              data;
+} CCMPropertyCacheWaiter;
+
+struct _CCMPropertyCacheRequest
+{
+    CCMPropertyCache*      cache;
+    CCMPropertyCacheEntry* entry;
+    Atom                   property;
+    Atom                   req_type;
+    long                   length;
+    CCMPropertyASync*      fetch;
+    GSList*                waiters;
+};
+
+struct _CCMPropertyCache
+{
+    CCMDisplay*  display;
+    CCMXidTable* entries;
+    GSList*      requests;
+};
+
+static void
+ccm_property_cache_entry_reset (CCMPropertyCacheEntry* entry)
+{
+    if (entry->request)
+    {
+        entry->request->entry = NULL;
+        entry->request = NULL;
+    }
+    if (entry->data) g_free (entry->data);
+    entry->data = NULL;
+    entry->size = 0;
+    entry->n_items = 0;
+    entry->valid = FALSE;
+}
+
+static void
+ccm_property_cache_entry_set (CCMPropertyCacheEntry* entry, Atom req_type,
+                              long length, guint n_items, const gchar* data,
+                              gsize size)
+{
+    if (entry->data) g_free (entry->data);
+
+    entry->req_type = req_type;
+    entry->length = length;
+    entry->n_items = n_items;
+    entry->size = data ? size : 0;
+    entry->data = NULL;
+    // Keep values nul terminated like xlib replies
+    if (data)
+    {
+        entry->data = g_malloc (size + 1);
+        memcpy (entry->data, data, size);
+        entry->data[size] = '\0';
+    }
+    entry->valid = TRUE;
+}
+
+static CCMPropertyCacheEntry*
+ccm_property_cache_find (CCMPropertyCache* self, Window window, Atom property,
+                         gboolean create)
+{
+    CCMPropertyCacheEntry* head = ccm_xid_table_lookup (self->entries, property);
+    CCMPropertyCacheEntry* entry;
+
+    for (entry = head; entry; entry = entry->next)
+    {
+        if (entry->window == window) return entry;
+    }
+
+    if (!create) return NULL;
+
+    entry = g_slice_new0 (CCMPropertyCacheEntry);
+    entry->window = window;
+    entry->property = property;
+    entry->next = head;
+    ccm_xid_table_insert (self->entries, property, entry);
+
+    return entry;
+}
+
+static gboolean
+ccm_property_cache_entry_match (CCMPropertyCacheEntry* entry, Atom req_type,
+                                long length)
+{
+    return entry->req_type == req_type && entry->length >= length;
+}
+
+static void
+ccm_property_cache_request_free (CCMPropertyCacheRequest* request)
+{
+    GSList* item;
+
+    if (request->entry) request->entry->request = NULL;
+    if (request->fetch)
+    {
+        g_signal_handlers_disconnect_matched (request->fetch,
+                                              G_SIGNAL_MATCH_DATA, 0, 0,
+                                              NULL, NULL, request);
+        g_object_unref (request->fetch);
+    }
+    for (item = request->waiters; item; item = item->next)
+        g_slice_free (CCMPropertyCacheWaiter, item->data);
+    g_slist_free (request->waiters);
+    g_slice_free (CCMPropertyCacheRequest, request);
+}
+
+static void
+ccm_property_cache_request_complete (CCMPropertyCacheRequest* request,
+                                     guint n_items, gchar* data)
+{
+    CCMPropertyCache* self = request->cache;
+    GSList* waiters, *item;
+
+    // Detach request before calling waiters, they can query property again
+    self->requests = g_slist_remove (self->requests, request);
+    if (request->entry) request->entry->request = NULL;
+    request->entry = NULL;
+    waiters = g_slist_reverse (request->waiters);
+    request->waiters = NULL;
+
+    for (item = waiters; item; item = item->next)
+    {
+        CCMPropertyCacheWaiter* waiter = item->data;
+
+        waiter->func (waiter->data, request->property, n_items, data);
+        g_slice_free (CCMPropertyCacheWaiter, waiter);
+    }
+    g_slist_free (waiters);
+
+    ccm_property_cache_request_free (request);
+}
+
+static void
+ccm_property_cache_on_reply (CCMPropertyCacheRequest* request, guint n_items,
+                             gchar* data, CCMPropertyASync* fetch)
+{
+    CCMPropertyCacheEntry* entry = request->entry;
+
+    if (entry)
+    {
+        gsize size = 0;
+
+        switch (ccm_property_async_get_format (fetch))
+        {
+            case 8:
+                size = n_items;
+                break;
+            case 16:
+                size = n_items * sizeof (short);
+                break;
+            case 32:
+                size = n_items * sizeof (long);
+                break;
+            default:
+                n_items = 0;
+                break;
+        }
+        ccm_property_cache_entry_set (entry, request->req_type,
+                                      request->length, n_items, data, size);
+    }
+
+    ccm_property_cache_request_complete (request, n_items, data);
+}
+
+static void
+ccm_property_cache_on_error (CCMPropertyCacheRequest* request,
+                             CCMPropertyASync* fetch)
+{
+    ccm_debug ("PROPERTY CACHE ERROR");
+
+    ccm_property_cache_request_complete (request, 0, NULL);
+}
+
+static void
+ccm_property_cache_free_entries (XID property, CCMPropertyCacheEntry* entry,
+                                 gpointer data)
+{
+    while (entry)
+    {
+        CCMPropertyCacheEntry* next = entry->next;
+
+        ccm_property_cache_entry_reset (entry);
+        g_slice_free (CCMPropertyCacheEntry, entry);
+        entry = next;
+    }
+}
+
+/**
+ * ccm_property_cache_new:
+ * @display: #CCMDisplay
+ *
+ * Create a new empty property cache.
+ *
+ * Returns: #CCMPropertyCache
+ **/
+CCMPropertyCache*
+ccm_property_cache_new (CCMDisplay* display)
+{
+    g_return_val_if_fail (display != NULL, NULL);
+
+    CCMPropertyCache* self = g_slice_new0 (CCMPropertyCache);
+
+    self->display = display;
+    self->entries = ccm_xid_table_new (NULL);
+    self->requests = NULL;
+
+    return self;
+}
+
+/**
+ * ccm_property_cache_free:
+ * @self: #CCMPropertyCache
+ *
+ * Destroy cache, callbacks of requests in flight are not called.
+ **/
+void
+ccm_property_cache_free (CCMPropertyCache* self)
+{
+    g_return_if_fail (self != NULL);
+
+    ccm_property_cache_clear (self);
+    g_slist_foreach (self->requests, (GFunc)ccm_property_cache_request_free,
+                     NULL);
+    g_slist_free (self->requests);
+    ccm_xid_table_free (self->entries);
+
+    g_slice_free (CCMPropertyCache, self);
+}
+
+/**
+ * ccm_property_cache_lookup:
+ * @self: #CCMPropertyCache
+ * @window: window of property
+ * @property: property atom
+ * @req_type: property type
+ * @n_items: number of items of cached value
+ * @data: cached value, %NULL if property does not exist
+ * @size: size of cached value
+ *
+ * Lookup a value of @property read with @req_type on @window.
+ *
+ * Returns: %TRUE if a valid value was found
+ **/
+gboolean
+ccm_property_cache_lookup (CCMPropertyCache* self, Window window,
+                           Atom property, Atom req_type, guint* n_items,
+                           const gchar** data, gsize* size)
+{
+    g_return_val_if_fail (self != NULL, FALSE);
+
+    CCMPropertyCacheEntry* entry;
+
+    entry = ccm_property_cache_find (self, window, property, FALSE);
+    if (!entry || !entry->valid ||
+        !ccm_property_cache_entry_match (entry, req_type, G_MAXLONG))
+    {
+        _ccm_display_count_property_read (self->display, FALSE);
+        return FALSE;
+    }
+
+    _ccm_display_count_property_read (self->display, TRUE);
+    if (n_items) *n_items = entry->n_items;
+    if (data) *data = entry->data;
+    if (size) *size = entry->size;
+
+    return TRUE;
+}
+
+/**
+ * ccm_property_cache_store:
+ * @self: #CCMPropertyCache
+ * @window: window of property
+ * @property: property atom
+ * @req_type: property type
+ * @length: length in long asked to server
+ * @n_items: number of items
+ * @data: value, %NULL if property does not exist
+ * @size: size of value
+ *
+ * Keep a value of @property read synchronously.
+ **/
+void
+ccm_property_cache_store (CCMPropertyCache* self, Window window,
+                          Atom property, Atom req_type, long length,
+                          guint n_items, const gchar* data, gsize size)
+{
+    g_return_if_fail (self != NULL);
+
+    CCMPropertyCacheEntry* entry;
+
+    entry = ccm_property_cache_find (self, window, property, TRUE);
+    ccm_property_cache_entry_set (entry, req_type, length, n_items, data, size);
+}
+
+/**
+ * ccm_property_cache_get_async:
+ * @self: #CCMPropertyCache
+ * @window: window of property
+ * @property: property atom
+ * @req_type: property type
+ * @length: length in long to read
+ * @func: function called with property value
+ * @data: user data
+ *
+ * Get value of @property, @func is called immediately if value is cached
+ * else on reply of server. All reads of a property in flight share the
+ * same request.
+ **/
+void
+ccm_property_cache_get_async (CCMPropertyCache* self, Window window,
+                              Atom property, Atom req_type, long length,
+                              CCMWindowPropertyFunc func, gpointer data)
+{
+    g_return_if_fail (self != NULL);
+    g_return_if_fail (func != NULL);
+
+    CCMPropertyCacheEntry* entry;
+    CCMPropertyCacheRequest* request;
+    CCMPropertyCacheWaiter* waiter;
+
+    entry = ccm_property_cache_find (self, window, property, TRUE);
+    if (entry->valid && ccm_property_cache_entry_match (entry, req_type, length))
+    {
+        _ccm_display_count_property_read (self->display, TRUE);
+        func (data, property, entry->n_items, entry->data);
+        return;
+    }
+
+    _ccm_display_count_property_read (self->display, FALSE);
+
+    request = entry->request;
+    if (!request || request->req_type != req_type || request->length < length)
+    {
+        // A request for another type or length keeps its own callbacks
+        // but its reply is no more cached
+        if (request) request->entry = NULL;
+
+        request = g_slice_new0 (CCMPropertyCacheRequest);
+        request->cache = self;
+        request->entry = entry;
+        request->property = property;
+        request->req_type = req_type;
+        request->length = length;
+        request->fetch = ccm_property_async_new (self->display, window,
+                                                 property, req_type, length);
+        g_signal_connect_swapped (request->fetch, "reply",
+                                  G_CALLBACK (ccm_property_cache_on_reply),
+                                  request);
+        g_signal_connect_swapped (request->fetch, "error",
+                                  G_CALLBACK (ccm_property_cache_on_error),
+                                  request);
+        self->requests = g_slist_prepend (self->requests, request);
+
+        entry->request = request;
+    }
+
+    waiter = g_slice_new (CCMPropertyCacheWaiter);
+    waiter->func = func;
+    waiter->data = data;
+    request->waiters = g_slist_prepend (request->waiters, waiter);
+}
+
+/**
+ * ccm_property_cache_invalidate:
+ * @self: #CCMPropertyCache
+ * @property: property atom
+ *
+ * Drop cached values of @property, must be called on each PropertyNotify
+ * of @property.
+ **/
+void
+ccm_property_cache_invalidate (CCMPropertyCache* self, Atom property)
+{
+    g_return_if_fail (self != NULL);
+
+    CCMPropertyCacheEntry* entry;
+
+    for (entry = ccm_xid_table_lookup (self->entries, property); entry;
+         entry = entry->next)
+    {
+        ccm_property_cache_entry_reset (entry);
+    }
+}
+
+/**
+ * ccm_property_cache_clear:
+ * @self: #CCMPropertyCache
+ *
+ * Drop all cached values.
+ **/
+void
+ccm_property_cache_clear (CCMPropertyCache* self)
+{
+    g_return_if_fail (self != NULL);
+
+    ccm_xid_table_foreach (self->entries,
+                           (CCMXidTableFunc)ccm_property_cache_free_entries,
+                           NULL);
+    ccm_xid_table_remove_all (self->entries);
+}
@@ -0,0 +1,57 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4 -*- */
+/*
+ * ccm-property-cache.h
+ * Copyright (C) Nicolas Bruguier 2007-2011 <gandalfn@club-internet.fr>
+ *
+ * cairo-compmgr is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * cairo-compmgr is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CCM_PROPERTY_CACHE_H_
+#define _CCM_PROPERTY_CACHE_H_
+
+#include <glib.h>
+#include <X11/Xlib.h>
+
+#include "ccm.h"
+
+G_BEGIN_DECLS
+
+typedef struct _CCMPropertyCache CCMPropertyCache;
+
+CCMPropertyCache* ccm_property_cache_new        (CCMDisplay* display);
+void              ccm_property_cache_free       (CCMPropertyCache* self);
+gboolean          ccm_property_cache_lookup     (CCMPropertyCache* self,
+                                                 Window window, Atom property,
+                                                 Atom req_type,
+                                                 guint* n_items,
+                                                 const gchar** data,
+                                                 gsize* size);
+void              ccm_property_cache_store      (CCMPropertyCache* self,
+                                                 Window window, Atom property,
+                                                 Atom req_type, long length,
+                                                 guint n_items,
+                                                 const gchar* data,
+                                                 gsize size);
+void              ccm_property_cache_get_async  (CCMPropertyCache* self,
+                                                 Window window, Atom property,
+                                                 Atom req_type, long length,
+                                                 CCMWindowPropertyFunc func,
+                                                 gpointer data);
+void              ccm_property_cache_invalidate (CCMPropertyCache* self,
+                                                 Atom property);
+void              ccm_property_cache_clear      (CCMPropertyCache* self);
+
+G_END_DECLS
+
+#endif                          /* _CCM_PROPERTY_CACHE_H_ */
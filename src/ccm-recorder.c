@@ -0,0 +1,304 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4 -*- */
+/*
+ * ccm-recorder.c
+ * Copyright (C) Nicolas Bruguier 2007-2011 <gandalfn@club-internet.fr>
+ *
+ * cairo-compmgr is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * cairo-compmgr is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Screen recorder. The compositor thread copies damaged area of each frame
+ * in a free buffer and queues it, a writer thread converts queued buffers
+ * and writes them in a YUV4MPEG2 stream. Like frame ring slots, each buffer
+ * keeps the region damaged since it was last filled so it always holds a
+ * complete frame. When no buffer is free the frame is dropped, its damage
+ * is still added to pending regions, and the writer repeats the previous
+ * frame to keep stream timing.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "ccm-debug.h"
+#include "ccm-recorder.h"
+
+typedef struct
+{
+    cairo_surface_t* image;
+    CCMRegion*       pending;
+    gint64           time;
+} CCMRecorderBuffer;
+
+struct _CCMRecorder
+{
+    gchar*            filename;
+    FILE*             file;
+    gint              width;
+    gint              height;
+    guint             rate;
+
+    CCMRecorderBuffer buffers[CCM_RECORDER_N_BUFFERS];
+    GAsyncQueue*      free;
+    GAsyncQueue*      full;
+    GThread*          thread;
+
+    gint64            start;
+    guint64           n_frames;
+    guint64           n_dropped;
+};
+
+/* Convert a RGB24 frame in full range BT.601 planar YUV 4:4:4 */
+static void
+ccm_recorder_convert (CCMRecorder* self, CCMRecorderBuffer* buffer,
+                      guchar* yuv)
+{
+    guchar *data = cairo_image_surface_get_data (buffer->image);
+    gint stride = cairo_image_surface_get_stride (buffer->image);
+    gsize size = (gsize) self->width * self->height;
+    guchar *y = yuv, *u = yuv + size, *v = yuv + size * 2;
+    gint line, col;
+
+    for (line = 0; line < self->height; ++line)
+    {
+        guint32 *pixel = (guint32 *) (data + line * stride);
+
+        for (col = 0; col < self->width; ++col)
+        {
+            gint r = (pixel[col] >> 16) & 0xFF;
+            gint g = (pixel[col] >> 8) & 0xFF;
+            gint b = pixel[col] & 0xFF;
+
+            *y++ = (77 * r + 150 * g + 29 * b) >> 8;
+            *u++ = ((-43 * r - 85 * g + 128 * b) >> 8) + 128;
+            *v++ = ((128 * r - 107 * g - 21 * b) >> 8) + 128;
+        }
+    }
+}
+
+static gboolean
+ccm_recorder_write_frame (CCMRecorder* self, guchar* yuv)
+{
+    gsize size = (gsize) self->width * self->height * 3;
+
+    return fputs ("FRAME\n", self->file) >= 0 &&
+           fwrite (yuv, 1, size, self->file) == size;
+}
+
+/* Writer thread, only this thread touches the file so opening it never
+ * blocks the compositor */
+static gpointer
+ccm_recorder_thread (CCMRecorder* self)
+{
+    guchar *yuv = g_malloc ((gsize) self->width * self->height * 3);
+    gboolean has_frame = FALSE, ok;
+    gint64 written = 0;
+    gpointer item;
+
+    self->file = fopen (self->filename, "wb");
+    if (!self->file)
+        g_warning ("Error on create screen record %s", self->filename);
+
+    // On open error queued buffers are still given back until the end
+    ok = self->file &&
+         fprintf (self->file, "YUV4MPEG2 W%i H%i F%u:1 Ip A1:1 C444 "
+                  "XCOLORRANGE=FULL\n", self->width, self->height,
+                  self->rate) > 0;
+
+    // Recorder itself marks the end of stream
+    while ((item = g_async_queue_pop (self->full)) != self)
+    {
+        CCMRecorderBuffer *buffer = item;
+        gint64 index = (buffer->time - self->start) * self->rate /
+                       G_USEC_PER_SEC;
+
+        // Previous frame stays on screen until this one
+        while (ok && has_frame && written < index)
+        {
+            ok = ccm_recorder_write_frame (self, yuv);
+            ++written;
+        }
+
+        if (ok)
+        {
+            ccm_recorder_convert (self, buffer, yuv);
+            has_frame = TRUE;
+        }
+        g_async_queue_push (self->free, buffer);
+    }
+
+    if (ok && has_frame)
+        ok = ccm_recorder_write_frame (self, yuv);
+    if (self->file)
+    {
+        if (fclose (self->file) != 0)
+            ok = FALSE;
+        if (!ok)
+            g_warning ("Error on write screen record %s", self->filename);
+        self->file = NULL;
+    }
+
+    g_free (yuv);
+
+    return NULL;
+}
+
+/**
+ * ccm_recorder_new:
+ * @filename: path of record file
+ * @width: frame width
+ * @height: frame height
+ * @rate: frame rate of stream
+ *
+ * Create a new screen recorder which writes frames pushed from compositor
+ * in a YUV4MPEG2 file from a writer thread. The file is opened by the
+ * writer thread, an open error is only reported there.
+ *
+ * Returns: #CCMRecorder
+ **/
+CCMRecorder*
+ccm_recorder_new (const gchar* filename, gint width, gint height, guint rate)
+{
+    g_return_val_if_fail (filename != NULL, NULL);
+    g_return_val_if_fail (width > 0 && height > 0, NULL);
+    g_return_val_if_fail (rate > 0, NULL);
+
+    CCMRecorder *self;
+    gint cpt;
+
+    self = g_new0 (CCMRecorder, 1);
+    self->filename = g_strdup (filename);
+    self->width = width;
+    self->height = height;
+    self->rate = rate;
+
+    self->free = g_async_queue_new ();
+    self->full = g_async_queue_new ();
+    for (cpt = 0; cpt < CCM_RECORDER_N_BUFFERS; ++cpt)
+    {
+        self->buffers[cpt].image =
+            cairo_image_surface_create (CAIRO_FORMAT_RGB24, width, height);
+        self->buffers[cpt].pending = ccm_region_create (0, 0, width, height);
+        g_async_queue_push (self->free, &self->buffers[cpt]);
+    }
+
+    self->thread = g_thread_new ("ccm-recorder",
+                                 (GThreadFunc) ccm_recorder_thread, self);
+
+    return self;
+}
+
+/**
+ * ccm_recorder_destroy:
+ * @self: #CCMRecorder
+ *
+ * Wait the writer thread has written queued frames and close record.
+ **/
+void
+ccm_recorder_destroy (CCMRecorder* self)
+{
+    g_return_if_fail (self != NULL);
+
+    gint cpt;
+
+    g_async_queue_push (self->full, self);
+    g_thread_join (self->thread);
+
+    for (cpt = 0; cpt < CCM_RECORDER_N_BUFFERS; ++cpt)
+    {
+        cairo_surface_destroy (self->buffers[cpt].image);
+        ccm_region_destroy (self->buffers[cpt].pending);
+    }
+    g_async_queue_unref (self->free);
+    g_async_queue_unref (self->full);
+    g_free (self->filename);
+    g_free (self);
+}
+
+/**
+ * ccm_recorder_push:
+ * @self: #CCMRecorder
+ * @source: surface of frame
+ * @damage: #CCMRegion damaged since previous frame or %NULL for whole frame
+ *
+ * Copy damaged area of frame in a free buffer and queue it to writer
+ * thread. This never waits the writer, frame is dropped when no buffer
+ * is free.
+ **/
+void
+ccm_recorder_push (CCMRecorder* self, cairo_surface_t* source,
+                   CCMRegion* damage)
+{
+    g_return_if_fail (self != NULL);
+    g_return_if_fail (source != NULL);
+
+    CCMRecorderBuffer *buffer;
+    cairo_t *ctx;
+    gint cpt;
+
+    // Buffers owned by writer get damage too, pending regions are only
+    // used by compositor thread
+    for (cpt = 0; cpt < CCM_RECORDER_N_BUFFERS; ++cpt)
+    {
+        if (damage)
+            ccm_region_union (self->buffers[cpt].pending, damage);
+        else
+        {
+            ccm_region_destroy (self->buffers[cpt].pending);
+            self->buffers[cpt].pending =
+                ccm_region_create (0, 0, self->width, self->height);
+        }
+    }
+
+    self->n_frames++;
+    buffer = g_async_queue_try_pop (self->free);
+    if (!buffer)
+    {
+        self->n_dropped++;
+        ccm_debug ("RECORDER DROP FRAME %lu", (gulong) self->n_frames);
+        return;
+    }
+
+    ctx = cairo_create (buffer->image);
+    ccm_region_clip (buffer->pending, ctx);
+    cairo_set_operator (ctx, CAIRO_OPERATOR_SOURCE);
+    cairo_set_source_surface (ctx, source, 0, 0);
+    cairo_paint (ctx);
+    cairo_destroy (ctx);
+    cairo_surface_flush (buffer->image);
+
+    ccm_region_destroy (buffer->pending);
+    buffer->pending = ccm_region_new ();
+
+    buffer->time = g_get_monotonic_time ();
+    if (!self->start) self->start = buffer->time;
+    g_async_queue_push (self->full, buffer);
+}
+
+/**
+ * ccm_recorder_get_counters:
+ * @self: #CCMRecorder
+ * @frames: number of frames pushed
+ * @dropped: number of frames dropped because writer was late
+ *
+ * Get recorder counters.
+ **/
+void
+ccm_recorder_get_counters (CCMRecorder* self, guint64* frames,
+                           guint64* dropped)
+{
+    g_return_if_fail (self != NULL);
+
+    if (frames) *frames = self->n_frames;
+    if (dropped) *dropped = self->n_dropped;
+}
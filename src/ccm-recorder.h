@@ -0,0 +1,45 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4 -*- */
+/*
+ * ccm-recorder.h
+ * Copyright (C) Nicolas Bruguier 2007-2011 <gandalfn@club-internet.fr>
+ *
+ * cairo-compmgr is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * cairo-compmgr is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CCM_RECORDER_H_
+#define _CCM_RECORDER_H_
+
+#include <glib.h>
+#include <cairo.h>
+
+#include "ccm.h"
+
+G_BEGIN_DECLS
+
+#define CCM_RECORDER_N_BUFFERS 4
+
+typedef struct _CCMRecorder CCMRecorder;
+
+CCMRecorder* ccm_recorder_new          (const gchar* filename, gint width,
+                                        gint height, guint rate);
+void         ccm_recorder_destroy      (CCMRecorder* self);
+void         ccm_recorder_push         (CCMRecorder* self,
+                                        cairo_surface_t* source,
+                                        CCMRegion* damage);
+void         ccm_recorder_get_counters (CCMRecorder* self, guint64* frames,
+                                        guint64* dropped);
+
+G_END_DECLS
+
+#endif                          /* _CCM_RECORDER_H_ */
@@ -242,6 +242,38 @@ ccm_region_get_boxes (CCMRegion * self, gint * n_boxes)
     return rboxes;
 }
 
+/**
+ * ccm_region_clip:
+ * @self: #CCMRegion
+ * @context: #cairo_t
+ *
+ * Intersect current clip of context with region. Boxes of region are
+ * emitted pixel aligned so cairo keeps a region clip without path
+ * tessellation when context matrix is an integer translation.
+ **/
+void
+ccm_region_clip (CCMRegion * self, cairo_t * context)
+{
+    pixman_box32_t *boxes;
+    int cpt, nb_boxes;
+
+    g_return_if_fail (self != NULL);
+    g_return_if_fail (context != NULL);
+
+    cairo_new_path (context);
+    boxes = pixman_region32_rectangles (&self->reg, &nb_boxes);
+    for (cpt = 0; cpt < nb_boxes; ++cpt)
+    {
+        int x1 = pixman_fixed_to_int (pixman_fixed_floor (boxes[cpt].x1));
+        int y1 = pixman_fixed_to_int (pixman_fixed_floor (boxes[cpt].y1));
+        int x2 = pixman_fixed_to_int (pixman_fixed_ceil (boxes[cpt].x2));
+        int y2 = pixman_fixed_to_int (pixman_fixed_ceil (boxes[cpt].y2));
+
+        cairo_rectangle (context, x1, y1, x2 - x1, y2 - y1);
+    }
+    cairo_clip (context);
+}
+
 gboolean
 ccm_region_empty (CCMRegion * self)
 {
@@ -0,0 +1,595 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4 -*- */
+/*
+ * ccm-rtree.c
+ * Copyright (C) Nicolas Bruguier 2007-2011 <gandalfn@club-internet.fr>
+ *
+ * cairo-compmgr is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * cairo-compmgr is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * R-tree of rectangles keyed by XID (Guttman, quadratic split). Each leaf
+ * entry holds the bounding box of a value, inner entries hold the box
+ * of their child node. The leaf of each key is kept in a XID table so
+ * update and remove do not have to search the tree.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "ccm-xid-table.h"
+#include "ccm-rtree.h"
+
+#define CCM_RTREE_MAX_ENTRIES 8
+#define CCM_RTREE_MIN_ENTRIES 3
+
+typedef struct _CCMRTreeNode CCMRTreeNode;
+
+typedef struct
+{
+    gint x1, y1;
+    gint x2, y2;
+} CCMRTreeBox;
+
+typedef struct
+{
+    CCMRTreeBox box;
+    XID         xid;
+    gpointer    child;
+} CCMRTreeEntry;
+
+struct _CCMRTreeNode
+{
+    CCMRTreeNode* parent;
+    gboolean      leaf;
+    guint         n_entries;
+    /* one more entry than allowed, node is split when it overflows */
+    CCMRTreeEntry entries[CCM_RTREE_MAX_ENTRIES + 1];
+};
+
+struct _CCMRTree
+{
+    CCMRTreeNode* root;
+    CCMXidTable*  leaves;
+};
+
+static inline void
+ccm_rtree_box_set (CCMRTreeBox* box, const cairo_rectangle_t* area)
+{
+    box->x1 = (gint) floor (area->x);
+    box->y1 = (gint) floor (area->y);
+    box->x2 = (gint) ceil (area->x + area->width);
+    box->y2 = (gint) ceil (area->y + area->height);
+}
+
+static inline CCMRTreeBox
+ccm_rtree_box_union (const CCMRTreeBox* a, const CCMRTreeBox* b)
+{
+    CCMRTreeBox box;
+
+    box.x1 = MIN (a->x1, b->x1);
+    box.y1 = MIN (a->y1, b->y1);
+    box.x2 = MAX (a->x2, b->x2);
+    box.y2 = MAX (a->y2, b->y2);
+
+    return box;
+}
+
+static inline gint64
+ccm_rtree_box_area (const CCMRTreeBox* box)
+{
+    return (gint64) (box->x2 - box->x1) * (gint64) (box->y2 - box->y1);
+}
+
+static inline gint64
+ccm_rtree_box_enlargement (const CCMRTreeBox* box, const CCMRTreeBox* add)
+{
+    CCMRTreeBox u = ccm_rtree_box_union (box, add);
+
+    return ccm_rtree_box_area (&u) - ccm_rtree_box_area (box);
+}
+
+static inline gboolean
+ccm_rtree_box_intersects (const CCMRTreeBox* a, const CCMRTreeBox* b)
+{
+    return a->x1 < b->x2 && b->x1 < a->x2 && a->y1 < b->y2 && b->y1 < a->y2;
+}
+
+static inline gboolean
+ccm_rtree_box_contains (const CCMRTreeBox* a, const CCMRTreeBox* b)
+{
+    return a->x1 <= b->x1 && a->y1 <= b->y1 && a->x2 >= b->x2 && a->y2 >= b->y2;
+}
+
+static CCMRTreeNode*
+ccm_rtree_node_new (gboolean leaf)
+{
+    CCMRTreeNode* node = g_slice_new (CCMRTreeNode);
+
+    node->parent = NULL;
+    node->leaf = leaf;
+    node->n_entries = 0;
+
+    return node;
+}
+
+static void
+ccm_rtree_node_free (CCMRTreeNode* node)
+{
+    guint cpt;
+
+    if (!node->leaf)
+    {
+        for (cpt = 0; cpt < node->n_entries; ++cpt)
+            ccm_rtree_node_free (node->entries[cpt].child);
+    }
+    g_slice_free (CCMRTreeNode, node);
+}
+
+static CCMRTreeBox
+ccm_rtree_node_box (CCMRTreeNode* node)
+{
+    CCMRTreeBox box = node->entries[0].box;
+    guint cpt;
+
+    for (cpt = 1; cpt < node->n_entries; ++cpt)
+        box = ccm_rtree_box_union (&box, &node->entries[cpt].box);
+
+    return box;
+}
+
+static guint
+ccm_rtree_node_index (CCMRTreeNode* node, CCMRTreeNode* child)
+{
+    guint cpt;
+
+    for (cpt = 0; cpt < node->n_entries; ++cpt)
+    {
+        if (node->entries[cpt].child == child) break;
+    }
+
+    return cpt;
+}
+
+static void
+ccm_rtree_node_append (CCMRTree* self, CCMRTreeNode* node,
+                       const CCMRTreeEntry* entry)
+{
+    node->entries[node->n_entries++] = *entry;
+
+    if (node->leaf)
+        ccm_xid_table_insert (self->leaves, entry->xid, node);
+    else
+        ((CCMRTreeNode*) entry->child)->parent = node;
+}
+
+static inline void
+ccm_rtree_node_remove_index (CCMRTreeNode* node, guint index)
+{
+    node->entries[index] = node->entries[--node->n_entries];
+}
+
+static CCMRTreeNode*
+ccm_rtree_choose_leaf (CCMRTree* self, const CCMRTreeBox* box)
+{
+    CCMRTreeNode* node = self->root;
+
+    while (!node->leaf)
+    {
+        gint64 best_enlargement = G_MAXINT64, best_area = G_MAXINT64;
+        guint cpt, best = 0;
+
+        for (cpt = 0; cpt < node->n_entries; ++cpt)
+        {
+            gint64 area = ccm_rtree_box_area (&node->entries[cpt].box);
+            gint64 enlargement =
+                ccm_rtree_box_enlargement (&node->entries[cpt].box, box);
+
+            if (enlargement < best_enlargement ||
+                (enlargement == best_enlargement && area < best_area))
+            {
+                best_enlargement = enlargement;
+                best_area = area;
+                best = cpt;
+            }
+        }
+        node = node->entries[best].child;
+    }
+
+    return node;
+}
+
+/* Quadratic split: the two entries which would waste the most area
+ * together seed the groups, the others go where they enlarge the least */
+static CCMRTreeNode*
+ccm_rtree_split (CCMRTree* self, CCMRTreeNode* node)
+{
+    CCMRTreeEntry entries[CCM_RTREE_MAX_ENTRIES + 1];
+    gboolean assigned[CCM_RTREE_MAX_ENTRIES + 1] = { FALSE };
+    CCMRTreeNode* sibling = ccm_rtree_node_new (node->leaf);
+    CCMRTreeBox box1, box2;
+    guint n = node->n_entries, remaining, seed1 = 0, seed2 = 1, i, j;
+    gint64 worst = G_MININT64;
+
+    memcpy (entries, node->entries, sizeof (CCMRTreeEntry) * n);
+
+    for (i = 0; i < n; ++i)
+    {
+        for (j = i + 1; j < n; ++j)
+        {
+            CCMRTreeBox u = ccm_rtree_box_union (&entries[i].box,
+                                                 &entries[j].box);
+            gint64 waste = ccm_rtree_box_area (&u) -
+                           ccm_rtree_box_area (&entries[i].box) -
+                           ccm_rtree_box_area (&entries[j].box);
+
+            if (waste > worst)
+            {
+                worst = waste;
+                seed1 = i;
+                seed2 = j;
+            }
+        }
+    }
+
+    node->n_entries = 0;
+    ccm_rtree_node_append (self, node, &entries[seed1]);
+    ccm_rtree_node_append (self, sibling, &entries[seed2]);
+    assigned[seed1] = assigned[seed2] = TRUE;
+    box1 = entries[seed1].box;
+    box2 = entries[seed2].box;
+
+    for (remaining = n - 2; remaining > 0; --remaining)
+    {
+        CCMRTreeNode* group;
+        gint64 best_diff = -1, d1 = 0, d2 = 0;
+        guint next = 0;
+
+        // One group needs all the remaining entries to reach the minimum
+        if (node->n_entries + remaining <= CCM_RTREE_MIN_ENTRIES ||
+            sibling->n_entries + remaining <= CCM_RTREE_MIN_ENTRIES)
+        {
+            group = node->n_entries + remaining <= CCM_RTREE_MIN_ENTRIES ?
+                    node : sibling;
+            for (i = 0; i < n; ++i)
+            {
+                if (!assigned[i]) ccm_rtree_node_append (self, group,
+                                                         &entries[i]);
+            }
+            break;
+        }
+
+        for (i = 0; i < n; ++i)
+        {
+            gint64 e1, e2;
+
+            if (assigned[i]) continue;
+
+            e1 = ccm_rtree_box_enlargement (&box1, &entries[i].box);
+            e2 = ccm_rtree_box_enlargement (&box2, &entries[i].box);
+            if (ABS (e1 - e2) > best_diff)
+            {
+                best_diff = ABS (e1 - e2);
+                next = i;
+                d1 = e1;
+                d2 = e2;
+            }
+        }
+
+        if (d1 < d2)
+            group = node;
+        else if (d2 < d1)
+            group = sibling;
+        else if (ccm_rtree_box_area (&box1) != ccm_rtree_box_area (&box2))
+            group = ccm_rtree_box_area (&box1) < ccm_rtree_box_area (&box2) ?
+                    node : sibling;
+        else
+            group = node->n_entries <= sibling->n_entries ? node : sibling;
+
+        ccm_rtree_node_append (self, group, &entries[next]);
+        assigned[next] = TRUE;
+        if (group == node)
+            box1 = ccm_rtree_box_union (&box1, &entries[next].box);
+        else
+            box2 = ccm_rtree_box_union (&box2, &entries[next].box);
+    }
+
+    return sibling;
+}
+
+static void
+ccm_rtree_adjust (CCMRTree* self, CCMRTreeNode* node)
+{
+    while (node)
+    {
+        CCMRTreeNode *parent = node->parent, *sibling = NULL;
+        CCMRTreeEntry entry;
+
+        if (node->n_entries > CCM_RTREE_MAX_ENTRIES)
+            sibling = ccm_rtree_split (self, node);
+
+        if (!parent)
+        {
+            // Root has been split, tree grows by one level
+            if (sibling)
+            {
+                self->root = ccm_rtree_node_new (FALSE);
+                entry.box = ccm_rtree_node_box (node);
+                entry.xid = None;
+                entry.child = node;
+                ccm_rtree_node_append (self, self->root, &entry);
+                entry.box = ccm_rtree_node_box (sibling);
+                entry.child = sibling;
+                ccm_rtree_node_append (self, self->root, &entry);
+            }
+            break;
+        }
+
+        parent->entries[ccm_rtree_node_index (parent, node)].box =
+            ccm_rtree_node_box (node);
+        if (sibling)
+        {
+            entry.box = ccm_rtree_node_box (sibling);
+            entry.xid = None;
+            entry.child = sibling;
+            ccm_rtree_node_append (self, parent, &entry);
+        }
+        node = parent;
+    }
+}
+
+static void
+ccm_rtree_insert_entry (CCMRTree* self, const CCMRTreeEntry* entry)
+{
+    CCMRTreeNode* leaf = ccm_rtree_choose_leaf (self, &entry->box);
+
+    ccm_rtree_node_append (self, leaf, entry);
+    ccm_rtree_adjust (self, leaf);
+}
+
+static void
+ccm_rtree_collect (CCMRTree* self, CCMRTreeNode* node, GSList** orphans)
+{
+    guint cpt;
+
+    for (cpt = 0; cpt < node->n_entries; ++cpt)
+    {
+        if (node->leaf)
+        {
+            ccm_xid_table_remove (self->leaves, node->entries[cpt].xid);
+            *orphans = g_slist_prepend (*orphans,
+                                        g_slice_dup (CCMRTreeEntry,
+                                                     &node->entries[cpt]));
+        }
+        else
+            ccm_rtree_collect (self, node->entries[cpt].child, orphans);
+    }
+    g_slice_free (CCMRTreeNode, node);
+}
+
+/* Walk up from a node which lost an entry, underfull nodes are dropped
+ * and their entries inserted again */
+static void
+ccm_rtree_condense (CCMRTree* self, CCMRTreeNode* node)
+{
+    GSList *orphans = NULL, *item;
+
+    while (node->parent)
+    {
+        CCMRTreeNode* parent = node->parent;
+        guint index = ccm_rtree_node_index (parent, node);
+
+        if (node->n_entries < CCM_RTREE_MIN_ENTRIES)
+        {
+            ccm_rtree_node_remove_index (parent, index);
+            ccm_rtree_collect (self, node, &orphans);
+        }
+        else
+            parent->entries[index].box = ccm_rtree_node_box (node);
+        node = parent;
+    }
+
+    while (!self->root->leaf && self->root->n_entries == 1)
+    {
+        CCMRTreeNode* root = self->root;
+
+        self->root = root->entries[0].child;
+        self->root->parent = NULL;
+        g_slice_free (CCMRTreeNode, root);
+    }
+    if (self->root->n_entries == 0) self->root->leaf = TRUE;
+
+    for (item = orphans; item; item = item->next)
+    {
+        ccm_rtree_insert_entry (self, item->data);
+        g_slice_free (CCMRTreeEntry, item->data);
+    }
+    g_slist_free (orphans);
+}
+
+static guint
+ccm_rtree_node_query (CCMRTreeNode* node, const CCMRTreeBox* box,
+                      CCMRTreeFunc func, gpointer data)
+{
+    guint cpt, count = 0;
+
+    for (cpt = 0; cpt < node->n_entries; ++cpt)
+    {
+        if (!ccm_rtree_box_intersects (&node->entries[cpt].box, box))
+            continue;
+
+        if (node->leaf)
+        {
+            if (func) func (node->entries[cpt].xid,
+                            node->entries[cpt].child, data);
+            count++;
+        }
+        else
+            count += ccm_rtree_node_query (node->entries[cpt].child, box,
+                                           func, data);
+    }
+
+    return count;
+}
+
+CCMRTree*
+ccm_rtree_new (void)
+{
+    CCMRTree* self = g_slice_new (CCMRTree);
+
+    self->root = ccm_rtree_node_new (TRUE);
+    self->leaves = ccm_xid_table_new (NULL);
+
+    return self;
+}
+
+void
+ccm_rtree_free (CCMRTree* self)
+{
+    g_return_if_fail (self != NULL);
+
+    ccm_rtree_node_free (self->root);
+    ccm_xid_table_free (self->leaves);
+    g_slice_free (CCMRTree, self);
+}
+
+guint
+ccm_rtree_size (CCMRTree* self)
+{
+    g_return_val_if_fail (self != NULL, 0);
+
+    return ccm_xid_table_size (self->leaves);
+}
+
+gboolean
+ccm_rtree_contains (CCMRTree* self, XID xid)
+{
+    g_return_val_if_fail (self != NULL, FALSE);
+
+    return ccm_xid_table_contains (self->leaves, xid);
+}
+
+/**
+ * ccm_rtree_insert:
+ * @self: #CCMRTree
+ * @xid: key of value
+ * @value: value
+ * @area: bounding box of value
+ *
+ * Insert value with its bounding box in tree. If key is already in tree
+ * its value and bounding box are replaced.
+ **/
+void
+ccm_rtree_insert (CCMRTree* self, XID xid, gpointer value,
+                  const cairo_rectangle_t* area)
+{
+    g_return_if_fail (self != NULL);
+    g_return_if_fail (xid != None);
+    g_return_if_fail (area != NULL);
+
+    CCMRTreeNode* leaf = ccm_xid_table_lookup (self->leaves, xid);
+    CCMRTreeEntry entry;
+
+    ccm_rtree_box_set (&entry.box, area);
+    entry.xid = xid;
+    entry.child = value;
+
+    if (leaf)
+    {
+        CCMRTreeNode* parent = leaf->parent;
+        guint cpt;
+
+        for (cpt = 0; leaf->entries[cpt].xid != xid; ++cpt);
+
+        // Box still inside leaf bounds, tree does not change
+        if (!parent ||
+            ccm_rtree_box_contains (&parent->entries[ccm_rtree_node_index (parent, leaf)].box,
+                                    &entry.box))
+        {
+            leaf->entries[cpt] = entry;
+            return;
+        }
+
+        ccm_rtree_node_remove_index (leaf, cpt);
+        ccm_xid_table_remove (self->leaves, xid);
+        ccm_rtree_condense (self, leaf);
+    }
+
+    ccm_rtree_insert_entry (self, &entry);
+}
+
+/**
+ * ccm_rtree_remove:
+ * @self: #CCMRTree
+ * @xid: key of value
+ *
+ * Remove value of key from tree.
+ *
+ * Returns: FALSE if key was not in tree
+ **/
+gboolean
+ccm_rtree_remove (CCMRTree* self, XID xid)
+{
+    g_return_val_if_fail (self != NULL, FALSE);
+
+    CCMRTreeNode* leaf;
+    guint cpt;
+
+    if (xid == None) return FALSE;
+
+    leaf = ccm_xid_table_lookup (self->leaves, xid);
+    if (!leaf) return FALSE;
+
+    for (cpt = 0; leaf->entries[cpt].xid != xid; ++cpt);
+    ccm_rtree_node_remove_index (leaf, cpt);
+    ccm_xid_table_remove (self->leaves, xid);
+    ccm_rtree_condense (self, leaf);
+
+    return TRUE;
+}
+
+void
+ccm_rtree_clear (CCMRTree* self)
+{
+    g_return_if_fail (self != NULL);
+
+    ccm_rtree_node_free (self->root);
+    self->root = ccm_rtree_node_new (TRUE);
+    ccm_xid_table_remove_all (self->leaves);
+}
+
+/**
+ * ccm_rtree_query:
+ * @self: #CCMRTree
+ * @area: searched area
+ * @func: function called for each value which intersects area or %NULL
+ * @data: user data
+ *
+ * Find all values of tree whose bounding box intersects area, in no
+ * particular order. The tree must not be modified from @func.
+ *
+ * Returns: number of values found
+ **/
+guint
+ccm_rtree_query (CCMRTree* self, const cairo_rectangle_t* area,
+                 CCMRTreeFunc func, gpointer data)
+{
+    g_return_val_if_fail (self != NULL, 0);
+    g_return_val_if_fail (area != NULL, 0);
+
+    CCMRTreeBox box;
+
+    ccm_rtree_box_set (&box, area);
+
+    return ccm_rtree_node_query (self->root, &box, func, data);
+}
@@ -0,0 +1,46 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4 -*- */
+/*
+ * ccm-rtree.h
+ * Copyright (C) Nicolas Bruguier 2007-2011 <gandalfn@club-internet.fr>
+ *
+ * cairo-compmgr is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * cairo-compmgr is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CCM_RTREE_H_
+#define _CCM_RTREE_H_
+
+#include <glib.h>
+#include <X11/X.h>
+#include <cairo.h>
+
+G_BEGIN_DECLS
+
+typedef struct _CCMRTree CCMRTree;
+
+typedef void (*CCMRTreeFunc) (XID xid, gpointer value, gpointer data);
+
+CCMRTree* ccm_rtree_new      (void);
+void      ccm_rtree_free     (CCMRTree* self);
+guint     ccm_rtree_size     (CCMRTree* self);
+gboolean  ccm_rtree_contains (CCMRTree* self, XID xid);
+void      ccm_rtree_insert   (CCMRTree* self, XID xid, gpointer value,
+                              const cairo_rectangle_t* area);
+gboolean  ccm_rtree_remove   (CCMRTree* self, XID xid);
+void      ccm_rtree_clear    (CCMRTree* self);
+guint     ccm_rtree_query    (CCMRTree* self, const cairo_rectangle_t* area,
+                              CCMRTreeFunc func, gpointer data);
+
+G_END_DECLS
+
+#endif                          /* _CCM_RTREE_H_ */
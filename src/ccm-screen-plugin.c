@@ -190,3 +190,39 @@ ccm_screen_plugin_damage (CCMScreenPlugin * self, CCMScreen * screen,
             plugin_class->damage (plugin, screen, area, window);
     }
 }
+
+/**
+ * ccm_screen_plugin_modify_frame:
+ * @self: #CCMScreenPlugin
+ * @screen: #CCMScreen
+ *
+ * Check if a plugin of chain currently paints over or transforms the screen
+ * frame after windows were painted. Pixels of back buffer are then not only
+ * windows content and cannot be copied to move a window.
+ *
+ * Returns: %TRUE if frame is modified by a plugin
+ **/
+gboolean
+ccm_screen_plugin_modify_frame (CCMScreenPlugin * self, CCMScreen * screen)
+{
+    g_return_val_if_fail (CCM_IS_SCREEN_PLUGIN (self), FALSE);
+    g_return_val_if_fail (screen != NULL, FALSE);
+
+    CCMScreenPlugin *plugin;
+    CCMScreenPluginClass *plugin_class;
+
+    for (plugin = self; plugin_class = CCM_SCREEN_PLUGIN_GET_INTERFACE (plugin), !plugin_class->is_screen;
+         plugin = CCM_SCREEN_PLUGIN_PARENT (plugin))
+    {
+        if (plugin_class->modify_frame)
+            break;
+    }
+
+    if (plugin_class->modify_frame)
+    {
+        if (!_ccm_plugin_method_locked ((GObject *) plugin, plugin_class->modify_frame))
+            return plugin_class->modify_frame (plugin, screen);
+    }
+
+    return FALSE;
+}
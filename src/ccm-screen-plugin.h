@@ -72,6 +72,7 @@ struct _CCMScreenPluginClass
                                 CCMWindow * window);
     void     (*damage)         (CCMScreenPlugin * self, CCMScreen * screen,
                                 CCMRegion * area, CCMWindow * window);
+    gboolean (*modify_frame)   (CCMScreenPlugin * self, CCMScreen * screen);
 };
 
 GType ccm_screen_plugin_get_type (void) G_GNUC_CONST;
@@ -93,6 +94,8 @@ void             ccm_screen_plugin_damage        (CCMScreenPlugin* self,
                                                   CCMScreen* screen,
                                                   CCMRegion* area,
                                                   CCMWindow* window);
+gboolean         ccm_screen_plugin_modify_frame  (CCMScreenPlugin* self,
+                                                  CCMScreen* screen);
 
 G_END_DECLS
 
@@ -41,6 +41,12 @@
 #include "ccm-extension-loader.h"
 #include "ccm-keybind.h"
 #include "ccm-timeline.h"
+#include "ccm-xid-table.h"
+#include "ccm-rtree.h"
+#include "ccm-window-prefetch.h"
+#include "ccm-frame-ring.h"
+#include "ccm-frame-export.h"
+#include "ccm-recorder.h"
 #include "ccm-marshallers.h"
 
 #include "ccm-window-xrender.h"
@@ -48,6 +54,21 @@
 #include "ccm-pixmap-buffered-image.h"
 #include "ccm-pixmap-image.h"
 
+/* Animation governor: frame load over which new animations are skipped,
+ * load over which they are shortened and number of animations started in
+ * one frame which is considered as a storm */
+#define CCM_SCREEN_ANIMATION_SKIP_LOAD     1.0
+#define CCM_SCREEN_ANIMATION_SHORTEN_LOAD  0.5
+#define CCM_SCREEN_ANIMATION_STORM         8
+#define CCM_SCREEN_ANIMATION_MAX_PER_FRAME 32
+
+/* Stack is maintained from events, the server stack is only queried at
+ * this interval in seconds to check nothing has been missed */
+#define CCM_SCREEN_STACK_CHECK_INTERVAL    10
+
+// Number of frames in ring of export socket when no ring size is given
+#define CCM_SCREEN_EXPORT_RING_SIZE        3
+
 #define DEFAULT_PLUGINS "perf,stats,snapshot,mosaic,freeze,decoration,window-animation,menu-animation,shadow,fade,opacity,clone"
 
 typedef gint (*WaitVideoSyncFunc) (gint, gint, guint*);
@@ -73,6 +94,7 @@ enum
     ACTIVATE_WINDOW_NOTIFY,
     COMPOSITE_MESSAGE,
     DESKTOP_CHANGED,
+    FRAME_PAINTED,
     N_SIGNALS
 };
 
@@ -85,8 +107,14 @@ static GSList*  ccm_screen_get_window_plugins         (CCMScreen* self);
 static void     ccm_screen_paint                      (CCMScreen* self, int num_frame, CCMTimeline* timeline);
 static void     ccm_screen_unset_selection_owner      (CCMScreen* self);
 static void     ccm_screen_on_window_error            (CCMScreen* self, CCMWindow* window);
+static void     ccm_screen_add_sort_pending           (CCMScreen* self);
 static void     ccm_screen_on_window_property_changed (CCMScreen* self, CCMPropertyType changed, CCMWindow* window);
 static void     ccm_screen_on_window_redirect_input   (CCMScreen* self, gboolean redirected, CCMWindow* window);
+static void     ccm_screen_untrack_window             (CCMScreen* self, CCMWindow* window);
+static void     ccm_screen_destroy_frame              (CCMScreen* self);
+static void     ccm_screen_destroy_ring               (CCMScreen* self);
+static void     ccm_screen_stop_record                (CCMScreen* self);
+static void     ccm_screen_restart_record             (CCMScreen* self);
 
 CCMWindow*      ccm_screen_find_window_from_input     (CCMScreen* self, Window xwindow);
 
@@ -106,6 +134,14 @@ enum
     CCM_SCREEN_COLOR_BACKGROUND,
     CCM_SCREEN_BACKGROUND_X,
     CCM_SCREEN_BACKGROUND_Y,
+    CCM_SCREEN_DAMAGE_RATE,
+    CCM_SCREEN_BACKGROUND_DAMAGE_RATE,
+    CCM_SCREEN_PIXMAP_MEMORY_BUDGET,
+    CCM_SCREEN_RESIZE_REBIND_DELAY,
+    CCM_SCREEN_HEADLESS,
+    CCM_SCREEN_HEADLESS_RING_SIZE,
+    CCM_SCREEN_EXPORT_SOCKET,
+    CCM_SCREEN_RECORD_FILE,
     CCM_SCREEN_OPTION_N
 };
 
@@ -121,7 +157,15 @@ static gchar *CCMScreenOptions[CCM_SCREEN_OPTION_N] = {
     "background",
     "color_background",
     "background_x",
-    "background_y"
+    "background_y",
+    "damage_rate",
+    "background_damage_rate",
+    "pixmap_memory_budget",
+    "resize_rebind_delay",
+    "headless",
+    "headless_ring_size",
+    "export_socket",
+    "record_file"
 };
 
 struct _CCMScreenPrivate
@@ -130,12 +174,34 @@ struct _CCMScreenPrivate
     Screen*             xscreen;
     guint               number;
 
-    CCMSet*             damages;
+    CCMXidTable*        damages;
+    CCMXidTable*        damages_back;
+    CCMXidTable*        damage_frames;
+    guint               damage_rate;
+    guint               background_damage_rate;
+    guint               n_frames;
+
+    guint64             memory[CCM_PIXMAP_MEMORY_N];
+    guint64             memory_budget;
+    gint64              memory_check;
+    guint               rebind_delay;
+    gboolean            use_shm_pixmap;
 
     cairo_t*            ctx;
+    gboolean            blitted;
 
     CCMWindow*          root;
     CCMWindow*          cow;
+    gboolean            headless;
+    guint               ring_size;
+    cairo_surface_t*    frame;
+    CCMFrameRing*       ring;
+    CCMFrameExport*     export;
+    cairo_surface_t*    export_image;
+    gboolean            ring_synced;
+    CCMRecorder*        recorder;
+    gchar*              record_file;
+    guint               record_segment;
     Window              selection_owner;
     CCMWindow*          fullscreen;
     CCMWindow*          active;
@@ -152,6 +218,11 @@ struct _CCMScreenPrivate
     GList*              windows;
     GList*              last_windows;
     GList*              removed;
+    CCMRTree*           index;
+    CCMXidTable*        positions;
+    GPtrArray*          stacked;
+    gboolean            stack_changed;
+    CCMWindowPrefetch*  prefetch;
     gboolean            redirect_input;
     gint                nb_redirect_input;
 
@@ -163,6 +234,17 @@ struct _CCMScreenPrivate
     guint               refresh_rate;
     CCMTimeline*        paint;
     guint               id_pendings;
+    guint               id_check_stack;
+
+    gint64              frame_start;
+    gdouble             frame_load;
+    gdouble             frame_missed;
+    gint64              animation_end;
+    guint               nb_frame_animations;
+    guint               frame_animation_duration;
+    guint64             n_animations;
+    guint64             n_shortened_animations;
+    guint64             n_skipped_animations;
 
     CCMExtensionLoader* plugin_loader;
     CCMScreenPlugin*    plugin;
@@ -180,15 +262,9 @@ static gboolean impl_ccm_screen_add_window      (CCMScreenPlugin* plugin, CCMScr
 static void     impl_ccm_screen_remove_window   (CCMScreenPlugin* plugin, CCMScreen* self, CCMWindow* window);
 static void     impl_ccm_screen_damage          (CCMScreenPlugin* plugin, CCMScreen* self, CCMRegion* area, CCMWindow* window);
 
-static void     ccm_screen_on_window_damaged    (CCMScreen* self, CCMRegion* area, CCMWindow* window);
+static void     ccm_screen_on_window_damaged    (CCMWindow* window, CCMRegion* area, CCMScreen* self);
 static void     ccm_screen_on_option_changed    (CCMScreen* self, CCMConfig* config);
 
-static int
-_direct_compare (int inA, int inB)
-{
-    return inA - inB;
-}
-
 static void
 ccm_screen_set_property (GObject* object, guint prop_id, const GValue* value, GParamSpec* pspec)
 {
@@ -252,15 +328,39 @@ ccm_screen_get_property (GObject* object, guint prop_id, GValue* value, GParamSp
 static void
 ccm_screen_init (CCMScreen* self)
 {
+    gint cpt;
+
     self->priv = CCM_SCREEN_GET_PRIVATE (self);
 
     self->priv->display = NULL;
     self->priv->xscreen = NULL;
     self->priv->number = 0;
     self->priv->ctx = NULL;
+    self->priv->blitted = FALSE;
     self->priv->root = NULL;
     self->priv->cow = NULL;
-    self->priv->damages = ccm_set_new (G_TYPE_INT, NULL, NULL, (CCMSetCompareFunc)_direct_compare);
+    self->priv->headless = FALSE;
+    self->priv->ring_size = 0;
+    self->priv->frame = NULL;
+    self->priv->ring = NULL;
+    self->priv->export = NULL;
+    self->priv->export_image = NULL;
+    self->priv->ring_synced = FALSE;
+    self->priv->recorder = NULL;
+    self->priv->record_file = NULL;
+    self->priv->record_segment = 0;
+    self->priv->damages = ccm_xid_table_new (NULL);
+    self->priv->damages_back = ccm_xid_table_new (NULL);
+    self->priv->damage_frames = ccm_xid_table_new (NULL);
+    self->priv->damage_rate = 0;
+    self->priv->background_damage_rate = 0;
+    self->priv->n_frames = 0;
+    for (cpt = 0; cpt < CCM_PIXMAP_MEMORY_N; ++cpt)
+        self->priv->memory[cpt] = 0;
+    self->priv->memory_budget = 0;
+    self->priv->memory_check = 0;
+    self->priv->rebind_delay = 0;
+    self->priv->use_shm_pixmap = FALSE;
     self->priv->selection_owner = None;
     self->priv->fullscreen = NULL;
     self->priv->active = NULL;
@@ -274,6 +374,11 @@ ccm_screen_init (CCMScreen* self)
     self->priv->windows = NULL;
     self->priv->last_windows = NULL;
     self->priv->removed = NULL;
+    self->priv->index = ccm_rtree_new ();
+    self->priv->positions = ccm_xid_table_new (NULL);
+    self->priv->stacked = g_ptr_array_new ();
+    self->priv->stack_changed = TRUE;
+    self->priv->prefetch = NULL;
     self->priv->redirect_input = FALSE;
     self->priv->nb_redirect_input = 0;
     self->priv->refresh_rate = 0;
@@ -284,6 +389,16 @@ ccm_screen_init (CCMScreen* self)
     self->priv->vblank_window = None;
     self->priv->paint = NULL;
     self->priv->id_pendings = 0;
+    self->priv->id_check_stack = 0;
+    self->priv->frame_start = 0;
+    self->priv->frame_load = 0.0;
+    self->priv->frame_missed = 0.0;
+    self->priv->animation_end = 0;
+    self->priv->nb_frame_animations = 0;
+    self->priv->frame_animation_duration = 0;
+    self->priv->n_animations = 0;
+    self->priv->n_shortened_animations = 0;
+    self->priv->n_skipped_animations = 0;
     self->priv->plugin_loader = NULL;
     self->priv->plugin = NULL;
     self->priv->background = NULL;
@@ -311,10 +426,17 @@ ccm_screen_finalize (GObject * object)
     if (self->priv->id_pendings)
         g_source_remove (self->priv->id_pendings);
 
+    if (self->priv->id_check_stack)
+        g_source_remove (self->priv->id_check_stack);
+
+    if (self->priv->prefetch)
+        ccm_window_prefetch_free (self->priv->prefetch);
+
     if (self->priv->paint)
     {
         ccm_timeline_stop (self->priv->paint);
         g_object_unref (self->priv->paint);
+        ccm_display_remove_frame_clock (self->priv->display, self);
     }
 
     if (self->priv->ctx)
@@ -328,8 +450,10 @@ ccm_screen_finalize (GObject * object)
     }
     if (self->priv->windows)
     {
-        GList *tmp = self->priv->windows;
+        GList *tmp = self->priv->windows, *item;
         self->priv->windows = NULL;
+        for (item = tmp; item; item = item->next)
+            ccm_screen_untrack_window (self, item->data);
         g_list_foreach (tmp, (GFunc) g_object_unref, NULL);
         g_list_free (tmp);
     }
@@ -338,6 +462,9 @@ ccm_screen_finalize (GObject * object)
         g_list_foreach (self->priv->removed, (GFunc) g_object_unref, NULL);
         g_list_free (self->priv->removed);
     }
+    ccm_rtree_free (self->priv->index);
+    ccm_xid_table_free (self->priv->positions);
+    g_ptr_array_free (self->priv->stacked, TRUE);
 
     if (self->priv->geometry)
         ccm_region_destroy (self->priv->geometry);
@@ -365,6 +492,11 @@ ccm_screen_finalize (GObject * object)
         ccm_display_sync (self->priv->display);
         g_object_unref (self->priv->cow);
     }
+    ccm_screen_destroy_frame (self);
+    if (self->priv->export)
+        ccm_frame_export_destroy (self->priv->export);
+    ccm_screen_stop_record (self);
+    g_free (self->priv->record_file);
 
     if (self->priv->root)
     {
@@ -377,7 +509,11 @@ ccm_screen_finalize (GObject * object)
         g_object_unref (self->priv->background);
 
     if (self->priv->damages)
-        g_object_unref (self->priv->damages);
+        ccm_xid_table_free (self->priv->damages);
+    if (self->priv->damages_back)
+        ccm_xid_table_free (self->priv->damages_back);
+    if (self->priv->damage_frames)
+        ccm_xid_table_free (self->priv->damage_frames);
 
     G_OBJECT_CLASS (ccm_screen_parent_class)->finalize (object);
 }
@@ -473,6 +609,12 @@ ccm_screen_class_init (CCMScreenClass * klass)
         g_signal_new ("desktop-changed", G_OBJECT_CLASS_TYPE (object_class),
                       G_SIGNAL_RUN_LAST, 0, NULL, NULL,
                       g_cclosure_marshal_VOID__INT, G_TYPE_NONE, 1, G_TYPE_INT);
+
+    signals[FRAME_PAINTED] =
+        g_signal_new ("frame-painted", G_OBJECT_CLASS_TYPE (object_class),
+                      G_SIGNAL_RUN_LAST, 0, NULL, NULL,
+                      ccm_cclosure_marshal_VOID__POINTER_POINTER,
+                      G_TYPE_NONE, 2, G_TYPE_POINTER, G_TYPE_POINTER);
 }
 
 static void
@@ -484,6 +626,7 @@ ccm_screen_iface_init (CCMScreenPluginClass * iface)
     iface->add_window = impl_ccm_screen_add_window;
     iface->remove_window = impl_ccm_screen_remove_window;
     iface->damage = impl_ccm_screen_damage;
+    iface->modify_frame = NULL;
 }
 
 static void
@@ -607,6 +750,7 @@ static void
 ccm_screen_update_backend (CCMScreen * self)
 {
     GError *error = NULL;
+    gboolean use_shm;
 
     gchar* backend = ccm_config_get_string (self->priv->options[CCM_SCREEN_BACKEND], &error);
     if (error)
@@ -638,11 +782,25 @@ ccm_screen_update_backend (CCMScreen * self)
     ccm_object_unregister (CCM_TYPE_WINDOW);
     ccm_object_unregister (CCM_TYPE_PIXMAP);
 
+    // Software rendering in shared memory, images are read and written
+    // by server through shared pixmaps
+    use_shm = backend && !g_ascii_strcasecmp (backend, "shm");
+    self->priv->use_shm_pixmap = use_shm &&
+                                 _ccm_display_use_shm_pixmap (self->priv->display);
+    if (use_shm && !self->priv->use_shm_pixmap)
+        g_warning ("Shared pixmaps are not supported, fallback to image backend");
+    g_free (backend);
+
     //if (!g_ascii_strcasecmp (backend, "xrender"))
     {
         ccm_object_register (CCM_TYPE_WINDOW, CCM_TYPE_WINDOW_X_RENDER);
 
-        if (native_pixmap_bind)
+        // Buffered pixmaps would only add a copy of shared memory images,
+        // headless frame is an image which is faster to fill from images.
+        // Without shared pixmaps software rendering still uses images.
+        if (use_shm || self->priv->headless)
+            ccm_object_register (CCM_TYPE_PIXMAP, CCM_TYPE_PIXMAP_IMAGE);
+        else if (native_pixmap_bind)
             ccm_object_register (CCM_TYPE_PIXMAP, CCM_TYPE_PIXMAP_XRENDER);
         else if (use_buffered)
             ccm_object_register (CCM_TYPE_PIXMAP, CCM_TYPE_PIXMAP_BUFFERED_IMAGE);
@@ -750,6 +908,8 @@ ccm_screen_update_refresh_rate (CCMScreen * self)
             ccm_timeline_stop (self->priv->paint);
             g_object_unref (self->priv->paint);
         }
+        else
+            ccm_display_add_frame_clock (self->priv->display, self);
 
         self->priv->paint = ccm_timeline_new (refresh_rate, refresh_rate);
 
@@ -759,6 +919,10 @@ ccm_screen_update_refresh_rate (CCMScreen * self)
         ccm_timeline_set_loop (self->priv->paint, TRUE);
         ccm_screen_wait_vblank (self);
         ccm_timeline_start (self->priv->paint);
+
+        // Record stream has a fixed frame rate
+        ccm_screen_restart_record (self);
+
         g_signal_emit (self, signals[REFRESH_RATE_CHANGED], 0);
 
         return TRUE;
@@ -890,6 +1054,230 @@ ccm_screen_update_sync_with_vblank (CCMScreen * self)
     return FALSE;
 }
 
+static void
+ccm_screen_update_damage_rate (CCMScreen * self)
+{
+    g_return_if_fail (self != NULL);
+
+    GError *error = NULL;
+    gint rate;
+
+    rate = ccm_config_get_integer (self->priv->options[CCM_SCREEN_DAMAGE_RATE],
+                                   &error);
+    if (error)
+    {
+        g_warning ("Error on get damage rate configuration");
+        g_error_free (error);
+        error = NULL;
+        rate = 0;
+    }
+    self->priv->damage_rate = MAX (0, rate);
+
+    rate = ccm_config_get_integer (self->priv->options[CCM_SCREEN_BACKGROUND_DAMAGE_RATE],
+                                   &error);
+    if (error)
+    {
+        g_warning ("Error on get background damage rate configuration");
+        g_error_free (error);
+        rate = 0;
+    }
+    self->priv->background_damage_rate = MAX (0, rate);
+}
+
+static void
+ccm_screen_update_memory_budget (CCMScreen * self)
+{
+    g_return_if_fail (self != NULL);
+
+    GError *error = NULL;
+    gint budget;
+
+    budget = ccm_config_get_integer (self->priv->options[CCM_SCREEN_PIXMAP_MEMORY_BUDGET],
+                                     &error);
+    if (error)
+    {
+        g_warning ("Error on get pixmap memory budget configuration");
+        g_error_free (error);
+        budget = 0;
+    }
+    self->priv->memory_budget = (guint64) MAX (0, budget) * 1024 * 1024;
+}
+
+static void
+ccm_screen_update_rebind_delay (CCMScreen * self)
+{
+    g_return_if_fail (self != NULL);
+
+    GError *error = NULL;
+    gint delay;
+
+    delay = ccm_config_get_integer (self->priv->options[CCM_SCREEN_RESIZE_REBIND_DELAY],
+                                    &error);
+    if (error)
+    {
+        g_warning ("Error on get resize rebind delay configuration");
+        g_error_free (error);
+        delay = 0;
+    }
+    self->priv->rebind_delay = MAX (0, delay);
+}
+
+static void
+ccm_screen_update_headless (CCMScreen * self)
+{
+    GError *error = NULL;
+    gboolean headless;
+
+    headless = ccm_config_get_boolean (self->priv->options[CCM_SCREEN_HEADLESS],
+                                       &error);
+    if (error)
+    {
+        g_warning ("Error on get headless configuration");
+        g_error_free (error);
+        headless = FALSE;
+    }
+    self->priv->headless = headless;
+}
+
+static void
+ccm_screen_update_ring_size (CCMScreen * self)
+{
+    GError *error = NULL;
+    gint size;
+
+    size = ccm_config_get_integer (self->priv->options[CCM_SCREEN_HEADLESS_RING_SIZE],
+                                   &error);
+    if (error)
+    {
+        g_warning ("Error on get headless ring size configuration");
+        g_error_free (error);
+        size = 0;
+    }
+    size = MAX (0, size);
+
+    // Ring is recreated on next frame with the new size
+    if (self->priv->ring_size != size)
+        ccm_screen_destroy_ring (self);
+    self->priv->ring_size = size;
+}
+
+static void
+ccm_screen_update_export (CCMScreen * self)
+{
+    GError *error = NULL;
+    gchar *path;
+
+    path = ccm_config_get_string (self->priv->options[CCM_SCREEN_EXPORT_SOCKET],
+                                  &error);
+    if (error)
+    {
+        g_warning ("Error on get export socket configuration");
+        g_error_free (error);
+        path = NULL;
+    }
+
+    if (self->priv->export)
+        ccm_frame_export_destroy (self->priv->export);
+    self->priv->export = NULL;
+    self->priv->ring_synced = FALSE;
+
+    if (path && strlen (path))
+    {
+        self->priv->export = ccm_frame_export_new (path);
+        if (!self->priv->export)
+            g_warning ("Error on create frame export socket %s", path);
+    }
+    g_free (path);
+}
+
+static void
+ccm_screen_stop_record (CCMScreen * self)
+{
+    if (self->priv->recorder)
+    {
+        guint64 frames, dropped;
+
+        ccm_recorder_get_counters (self->priv->recorder, &frames, &dropped);
+        ccm_recorder_destroy (self->priv->recorder);
+        self->priv->recorder = NULL;
+
+        if (dropped)
+            g_warning ("Screen record dropped %lu of %lu frames",
+                       (gulong) dropped, (gulong) frames);
+    }
+}
+
+static void
+ccm_screen_start_record (CCMScreen * self)
+{
+    gchar *filename;
+
+    if (!self->priv->record_file) return;
+
+    // Each restart writes a new segment beside the first record file
+    if (self->priv->record_segment)
+    {
+        gchar *basename = strrchr (self->priv->record_file, '/');
+        gchar *extension = strrchr (basename ? basename : self->priv->record_file, '.');
+        gint len = extension ? extension - self->priv->record_file
+                             : (gint) strlen (self->priv->record_file);
+
+        filename = g_strdup_printf ("%.*s-%u%s", len, self->priv->record_file,
+                                    self->priv->record_segment,
+                                    extension ? extension : "");
+    }
+    else
+        filename = g_strdup (self->priv->record_file);
+
+    self->priv->recorder = ccm_recorder_new (filename,
+                                             self->priv->xscreen->width,
+                                             self->priv->xscreen->height,
+                                             MAX (1, self->priv->refresh_rate));
+    g_free (filename);
+}
+
+/*
+ * Restart a running record with current screen size and refresh rate
+ */
+static void
+ccm_screen_restart_record (CCMScreen * self)
+{
+    if (!self->priv->recorder) return;
+
+    ccm_screen_stop_record (self);
+    self->priv->record_segment++;
+    ccm_screen_start_record (self);
+}
+
+static void
+ccm_screen_update_record (CCMScreen * self)
+{
+    GError *error = NULL;
+    gchar *filename;
+
+    filename = ccm_config_get_string (self->priv->options[CCM_SCREEN_RECORD_FILE],
+                                      &error);
+    if (error)
+    {
+        g_warning ("Error on get record file configuration");
+        g_error_free (error);
+        filename = NULL;
+    }
+
+    ccm_screen_stop_record (self);
+
+    g_free (self->priv->record_file);
+    self->priv->record_file = NULL;
+    self->priv->record_segment = 0;
+    if (filename && strlen (filename))
+    {
+        self->priv->record_file = filename;
+        ccm_screen_start_record (self);
+    }
+    else
+        g_free (filename);
+}
+
 static void
 ccm_screen_load_config (CCMScreen * self)
 {
@@ -907,9 +1295,16 @@ ccm_screen_load_config (CCMScreen * self)
                                       self);
     }
 
+    ccm_screen_update_headless (self);
+    ccm_screen_update_ring_size (self);
     ccm_screen_update_backend (self);
     ccm_screen_update_refresh_rate (self);
     ccm_screen_update_sync_with_vblank (self);
+    ccm_screen_update_damage_rate (self);
+    ccm_screen_update_memory_budget (self);
+    ccm_screen_update_rebind_delay (self);
+    ccm_screen_update_export (self);
+    ccm_screen_update_record (self);
 }
 
 static gboolean
@@ -950,6 +1345,24 @@ ccm_screen_create_overlay_window (CCMScreen * self)
     g_return_val_if_fail (root != NULL, FALSE);
     g_return_val_if_fail (self->priv->display != NULL, FALSE);
 
+    // Headless screen composites in an offscreen image instead of overlay
+    if (self->priv->headless)
+    {
+        if (!self->priv->frame)
+        {
+            self->priv->frame = cairo_image_surface_create (CAIRO_FORMAT_RGB24,
+                                                            self->priv->xscreen->width,
+                                                            self->priv->xscreen->height);
+            if (cairo_surface_status (self->priv->frame) != CAIRO_STATUS_SUCCESS)
+            {
+                cairo_surface_destroy (self->priv->frame);
+                self->priv->frame = NULL;
+            }
+        }
+
+        return self->priv->frame != NULL;
+    }
+
     window = XCompositeGetOverlayWindow (CCM_DISPLAY_XDISPLAY (self->priv->display),
                                          CCM_WINDOW_XWINDOW (root));
     if (!window)
@@ -971,6 +1384,7 @@ ccm_screen_resize (CCMScreen* self, int width, int height)
         if (self->priv->cow)
             g_object_unref (self->priv->cow);
         self->priv->cow = NULL;
+        ccm_screen_destroy_frame (self);
 
         // Destroy old root
         if (self->priv->root)
@@ -992,6 +1406,9 @@ ccm_screen_resize (CCMScreen* self, int width, int height)
         CCM_SCREEN_XSCREEN (self)->width = width;
         CCM_SCREEN_XSCREEN (self)->height = height;
 
+        // Record stream has a fixed frame size
+        ccm_screen_restart_record (self);
+
         // Recreate overlay window
         ccm_screen_create_overlay_window (self);
 
@@ -1074,19 +1491,185 @@ ccm_screen_print_real_stack (CCMScreen * self)
 
 #endif
 
+/*
+ * Viewable windows are found from their geometry in the spatial index
+ * and ordered by their position in stack, positions are computed again
+ * on first lookup after stack has changed.
+ */
+typedef struct
+{
+    XID        xid;
+    CCMWindow* window;
+    gint       position;
+} CCMScreenStackWindow;
+
+static void
+ccm_screen_stack_changed (CCMScreen * self)
+{
+    self->priv->last_windows = g_list_last (self->priv->windows);
+    self->priv->stack_changed = TRUE;
+}
+
+static gint
+ccm_screen_get_stack_position (CCMScreen * self, XID xid, CCMWindow * window)
+{
+    guint position;
+
+    if (self->priv->stack_changed)
+    {
+        GList *item;
+
+        ccm_xid_table_remove_all (self->priv->positions);
+        g_ptr_array_set_size (self->priv->stacked, 0);
+        for (item = self->priv->windows; item; item = item->next)
+        {
+            g_ptr_array_add (self->priv->stacked, item->data);
+            ccm_xid_table_insert (self->priv->positions,
+                                  CCM_WINDOW_XWINDOW (item->data),
+                                  GUINT_TO_POINTER (self->priv->stacked->len));
+        }
+        self->priv->stack_changed = FALSE;
+    }
+
+    // Window is compared only by pointer, it can be an outdated entry
+    position = GPOINTER_TO_UINT (ccm_xid_table_lookup (self->priv->positions, xid));
+    if (!position || g_ptr_array_index (self->priv->stacked, position - 1) != window)
+        return -1;
+
+    return (gint) position - 1;
+}
+
+static void
+ccm_screen_index_window (CCMScreen * self, CCMWindow * window)
+{
+    cairo_rectangle_t area, device;
+    gboolean have_area, have_device;
+
+    have_area = ccm_drawable_get_geometry_clipbox (CCM_DRAWABLE (window),
+                                                   &area);
+    have_device = ccm_drawable_get_device_geometry_clipbox (CCM_DRAWABLE (window),
+                                                            &device);
+
+    if (ccm_window_is_input_only (window) || (!have_area && !have_device))
+    {
+        ccm_rtree_remove (self->priv->index, CCM_WINDOW_XWINDOW (window));
+        return;
+    }
+
+    // Index covers both transformed and untransformed geometry
+    if (!have_area)
+        area = device;
+    else if (have_device)
+    {
+        gdouble x2 = MAX (area.x + area.width, device.x + device.width);
+        gdouble y2 = MAX (area.y + area.height, device.y + device.height);
+
+        area.x = MIN (area.x, device.x);
+        area.y = MIN (area.y, device.y);
+        area.width = x2 - area.x;
+        area.height = y2 - area.y;
+    }
+
+    ccm_rtree_insert (self->priv->index, CCM_WINDOW_XWINDOW (window), window,
+                      &area);
+}
+
+static void
+ccm_screen_on_window_geometry_changed (CCMScreen * self, GParamSpec * pspec,
+                                       CCMWindow * window)
+{
+    ccm_screen_index_window (self, window);
+}
+
+static void
+ccm_screen_track_window (CCMScreen * self, CCMWindow * window)
+{
+    ccm_screen_index_window (self, window);
+
+    g_signal_connect_swapped (window, "notify::geometry",
+                              G_CALLBACK (ccm_screen_on_window_geometry_changed),
+                              self);
+    g_signal_connect_swapped (window, "notify::transform",
+                              G_CALLBACK (ccm_screen_on_window_geometry_changed),
+                              self);
+}
+
+static void
+ccm_screen_untrack_window (CCMScreen * self, CCMWindow * window)
+{
+    if (CCM_IS_WINDOW (window))
+    {
+        g_signal_handlers_disconnect_by_func (window,
+                                              ccm_screen_on_window_geometry_changed,
+                                              self);
+        ccm_rtree_remove (self->priv->index, CCM_WINDOW_XWINDOW (window));
+    }
+}
+
+static void
+ccm_screen_on_query_window (XID xid, CCMWindow * window, GArray * windows)
+{
+    CCMScreenStackWindow stack_window = { xid, window, -1 };
+
+    g_array_append_val (windows, stack_window);
+}
+
+static gint
+ccm_screen_compare_stack_window (CCMScreenStackWindow * a,
+                                 CCMScreenStackWindow * b)
+{
+    return b->position - a->position;
+}
+
+/*
+ * Returns viewable windows of stack which intersect area, from top to
+ * bottom
+ */
+static GArray *
+ccm_screen_get_windows_in_area (CCMScreen * self, const cairo_rectangle_t * area,
+                                CCMWindow * exclude)
+{
+    GArray *windows = g_array_new (FALSE, FALSE, sizeof (CCMScreenStackWindow));
+    guint cpt = 0;
+
+    ccm_rtree_query (self->priv->index, area,
+                     (CCMRTreeFunc) ccm_screen_on_query_window, windows);
+
+    while (cpt < windows->len)
+    {
+        CCMScreenStackWindow *stack_window =
+            &g_array_index (windows, CCMScreenStackWindow, cpt);
+
+        stack_window->position =
+            ccm_screen_get_stack_position (self, stack_window->xid,
+                                           stack_window->window);
+        if (stack_window->position < 0 || stack_window->window == exclude ||
+            !ccm_window_is_viewable (stack_window->window) ||
+            ccm_window_is_input_only (stack_window->window))
+            g_array_remove_index_fast (windows, cpt);
+        else
+            cpt++;
+    }
+    g_array_sort (windows, (GCompareFunc) ccm_screen_compare_stack_window);
+
+    return windows;
+}
+
 static void
 ccm_screen_destroy_window (CCMScreen * self, CCMWindow * window)
 {
     ccm_debug_window (window, "DESTROY WINDOW");
 
     self->priv->windows = g_list_remove (self->priv->windows, window);
-    self->priv->last_windows = g_list_last (self->priv->windows);
+    ccm_screen_stack_changed (self);
 
     if (CCM_IS_WINDOW (window))
     {
-        g_signal_handlers_disconnect_by_func (window,
-                                              ccm_screen_on_window_damaged,
-                                              self);
+        ccm_screen_untrack_window (self, window);
+        ccm_drawable_remove_damage_func (CCM_DRAWABLE (window),
+                                         (CCMDrawableDamageFunc)
+                                         ccm_screen_on_window_damaged,
+                                         self);
         g_signal_handlers_disconnect_by_func (window,
                                               ccm_screen_on_window_error, self);
         g_signal_handlers_disconnect_by_func (window,
@@ -1185,23 +1768,23 @@ ccm_screen_find_window_at_pos (CCMScreen * self, int x, int y)
 {
     g_return_val_if_fail (self != NULL, NULL);
 
-    GList *item;
+    cairo_rectangle_t point = { x, y, 1, 1 };
+    GArray *windows;
     CCMWindow *found = NULL;
+    guint cpt;
 
-    for (item = self->priv->last_windows; item && !found;
-         item = item->prev)
+    windows = ccm_screen_get_windows_in_area (self, &point, NULL);
+    for (cpt = 0; cpt < windows->len && !found; ++cpt)
     {
-        if (ccm_window_is_viewable (item->data) &&
-            !ccm_window_is_input_only (item->data))
-        {
-            CCMRegion *geometry = (CCMRegion *)ccm_drawable_get_geometry (item->data);
+        CCMWindow *window = g_array_index (windows, CCMScreenStackWindow, cpt).window;
+        CCMRegion *geometry = (CCMRegion *)ccm_drawable_get_geometry (CCM_DRAWABLE (window));
 
-            if (geometry && ccm_region_point_in (geometry, x, y))
-            {
-                found = CCM_WINDOW (item->data);
-            }
+        if (geometry && ccm_region_point_in (geometry, x, y))
+        {
+            found = window;
         }
     }
+    g_array_free (windows, TRUE);
 
     return found;
 }
@@ -1298,26 +1881,127 @@ ccm_screen_set_selection_owner (CCMScreen * self)
     return TRUE;
 }
 
-static void
-ccm_screen_update_stack (CCMScreen * self)
+/*
+ * Send setup requests of all windows unknown by screen in one batch
+ */
+static CCMWindowPrefetch*
+ccm_screen_prefetch_unknown_windows (CCMScreen * self, const Window * windows,
+                                     guint n_windows)
 {
-    g_return_if_fail (self != NULL);
-
-    Window *stack = NULL;
-    Window w, p;
-    guint n_windows = 0;
-    CCMWindow *root = ccm_screen_get_root_window (self);
+    CCMWindowPrefetch *prefetch = NULL;
+    Window *unknown = g_new (Window, MAX (n_windows, 1));
+    guint cpt, n_unknown = 0;
 
-    if (XQueryTree (CCM_DISPLAY_XDISPLAY (self->priv->display),
-                    CCM_WINDOW_XWINDOW (root),
-                    &w, &p, &stack, &n_windows) && stack && n_windows)
+    for (cpt = 0; cpt < n_windows; ++cpt)
     {
-        if (self->priv->stack)
-            g_slice_free1 (sizeof (Window) * self->priv->n_windows, self->priv->stack);
-
-        self->priv->n_windows = n_windows;
-        self->priv->stack = g_slice_copy (sizeof (Window) * n_windows, stack);
-        XFree (stack);
+        if (!ccm_screen_find_window_or_child (self, windows[cpt]))
+            unknown[n_unknown++] = windows[cpt];
+    }
+
+    if (n_unknown)
+        prefetch = ccm_window_prefetch_new (self->priv->display, unknown,
+                                            n_unknown);
+    g_free (unknown);
+
+    return prefetch;
+}
+
+/**
+ * _ccm_screen_prefetch_windows:
+ * @self: #CCMScreen
+ * @windows: windows which will be created
+ * @n_windows: number of windows
+ *
+ * Send the setup requests of @windows so they are all created with the
+ * replies of one round trip, the previous prefetch is dropped. A %NULL
+ * @windows only drops the previous prefetch.
+ **/
+void
+_ccm_screen_prefetch_windows (CCMScreen * self, const Window * windows,
+                              guint n_windows)
+{
+    g_return_if_fail (self != NULL);
+
+    if (self->priv->prefetch)
+        ccm_window_prefetch_free (self->priv->prefetch);
+    self->priv->prefetch = NULL;
+
+    if (windows && n_windows)
+        self->priv->prefetch = ccm_screen_prefetch_unknown_windows (self,
+                                                                    windows,
+                                                                    n_windows);
+}
+
+/**
+ * _ccm_screen_invalidate_property:
+ * @self: #CCMScreen
+ * @xwindow: window which property has changed
+ * @property: property atom
+ *
+ * Drop cached values of @property of the window or frame of @xwindow.
+ **/
+void
+_ccm_screen_invalidate_property (CCMScreen * self, Window xwindow,
+                                 Atom property)
+{
+    g_return_if_fail (self != NULL);
+
+    CCMWindow *window = NULL;
+
+    if (xwindow == None)
+        return;
+
+    if (self->priv->root && xwindow == CCM_WINDOW_XWINDOW (self->priv->root))
+        window = self->priv->root;
+    else
+        window = ccm_screen_find_window_or_child (self, xwindow);
+
+    if (window)
+        _ccm_window_invalidate_property (window, property);
+}
+
+static CCMWindow *
+ccm_screen_create_window (CCMScreen * self, Window xwindow)
+{
+    CCMWindowPrefetch *prefetch = self->priv->prefetch;
+    CCMWindow *window;
+
+    if (!prefetch || !ccm_window_prefetch_contains (prefetch, xwindow))
+        return ccm_window_new (self, xwindow);
+
+    window = _ccm_window_new_from_prefetch (self, xwindow, prefetch);
+
+    // Replies are used once, xid can be reused by a later window
+    ccm_window_prefetch_remove (prefetch, xwindow);
+    if (!ccm_window_prefetch_get_length (prefetch))
+    {
+        ccm_window_prefetch_free (prefetch);
+        self->priv->prefetch = NULL;
+    }
+
+    return window;
+}
+
+static void
+ccm_screen_update_stack (CCMScreen * self)
+{
+    g_return_if_fail (self != NULL);
+
+    Window *stack = NULL;
+    Window w, p;
+    guint n_windows = 0;
+    CCMWindow *root = ccm_screen_get_root_window (self);
+
+    if (XQueryTree (CCM_DISPLAY_XDISPLAY (self->priv->display),
+                    CCM_WINDOW_XWINDOW (root),
+                    &w, &p, &stack, &n_windows) && stack && n_windows)
+    {
+        if (self->priv->stack)
+            g_slice_free1 (sizeof (Window) * self->priv->n_windows, self->priv->stack);
+
+        self->priv->n_windows = n_windows;
+        self->priv->stack = g_slice_copy (sizeof (Window) * n_windows, stack);
+        XFree (stack);
     }
 }
 
@@ -1326,22 +2010,38 @@ ccm_screen_query_stack (CCMScreen * self)
 {
     g_return_if_fail (self != NULL);
 
+    CCMWindowPrefetch *prefetch;
     guint cpt;
 
     ccm_debug ("QUERY_STACK");
 
     if (self->priv->windows)
     {
+        GList *item;
+
+        for (item = self->priv->windows; item; item = item->next)
+            ccm_screen_untrack_window (self, item->data);
         g_list_foreach (self->priv->windows, (GFunc) g_object_unref, NULL);
         g_list_free (self->priv->windows);
         self->priv->windows = NULL;
+        ccm_screen_stack_changed (self);
     }
 
     ccm_screen_update_stack (self);
 
+    if (!self->priv->n_windows)
+        return;
+
+    // All windows of stack are setup with the replies of one round trip
+    prefetch = ccm_window_prefetch_new (self->priv->display,
+                                        self->priv->stack,
+                                        self->priv->n_windows);
+
     for (cpt = 0; cpt < self->priv->n_windows; ++cpt)
     {
-        CCMWindow *window = ccm_window_new (self, self->priv->stack[cpt]);
+        CCMWindow *window = _ccm_window_new_from_prefetch (self,
+                                                           self->priv->stack[cpt],
+                                                           prefetch);
         if (window)
         {
             if (!ccm_screen_add_window (self, window))
@@ -1351,6 +2051,9 @@ ccm_screen_query_stack (CCMScreen * self)
                 ccm_window_map (window);
         }
     }
+
+    ccm_window_prefetch_free (prefetch);
+    ccm_display_flush (self->priv->display);
 }
 
 static int
@@ -1398,19 +2101,174 @@ ccm_screen_compare_window(CCMWindow* a, CCMWindow* b)
     return 0;
 }
 
+/*
+ * Replace windows list by stack ordered by window types, transients and
+ * group leaders, windows which have changed of place are damaged.
+ */
+static void
+ccm_screen_set_stack (CCMScreen * self, GList * stack)
+{
+    GList *item, *last, *viewable = NULL, *old_viewable = NULL;
+
+    for (item = self->priv->windows; item; item = item->next)
+    {
+        if (ccm_window_is_viewable (item->data) &&
+            !ccm_window_is_input_only (item->data))
+        {
+            ccm_debug_window (item->data, "OLD VIEWABLE");
+            old_viewable = g_list_prepend (old_viewable, item->data);
+        }
+    }
+
+    for (item = stack; item; item = item->next)
+    {
+        if (ccm_window_is_viewable (item->data) &&
+            !ccm_window_is_input_only (item->data) &&
+            !g_list_find (self->priv->removed, item->data))
+        {
+            ccm_debug_window (item->data, "STACK IS VIEWABLE");
+            viewable = g_list_prepend (viewable, item->data);
+        }
+    }
+    viewable = g_list_reverse (viewable);
+
+    stack = g_list_sort(stack, (GCompareFunc)ccm_screen_compare_window);
+
+    for (item = viewable; item; item = item->next)
+    {
+        const CCMWindow *transient = ccm_window_transient_for (item->data);
+        const CCMWindow *leader = ccm_window_get_group_leader (item->data);
+
+        if (transient &&
+            ccm_window_is_viewable((CCMWindow*)transient) &&
+            !ccm_window_is_input_only((CCMWindow*)transient) &&
+            g_list_index (stack, item->data) < g_list_index (stack, transient))
+        {
+            ccm_debug ("RESTACK TRANSIENT");
+            stack = g_list_remove (stack, item->data);
+            stack = g_list_insert_before (stack,
+                                          g_list_find (stack, transient)->next,
+                                          item->data);
+        }
+        if (leader && leader != self->priv->root &&
+            ccm_window_get_hint_type (item->data) == CCM_WINDOW_TYPE_DIALOG)
+        {
+            GList *iter;
+
+            for (iter = item; iter; iter = iter->next)
+            {
+                if (leader == ccm_window_get_group_leader (iter->data) &&
+                    ccm_window_is_viewable(iter->data) &&
+                    !ccm_window_is_input_only(iter->data)
+                    && ccm_window_get_hint_type (iter->data) == CCM_WINDOW_TYPE_NORMAL)
+                {
+                    ccm_debug ("RESTACK LEADER");
+                    stack = g_list_remove (stack, item->data);
+                    stack = g_list_insert_before (stack,
+                                                  g_list_find (stack, iter->data)->next,
+                                                  item->data);
+                    break;
+                }
+            }
+        }
+    }
+
+    if (self->priv->windows) g_list_free (self->priv->windows);
+    self->priv->windows = stack;
+    ccm_screen_stack_changed (self);
+
+    viewable = g_list_sort (viewable, (GCompareFunc)ccm_screen_compare_window);
+    viewable = g_list_reverse (viewable);
+
+    last = old_viewable;
+    ccm_debug ("LIST VIEWABLE");
+    for (item = viewable; item; item = item->next)
+    {
+        ccm_debug_window (item->data, "VIEWABLE 0x%x",
+                          last ? CCM_WINDOW_XWINDOW (last->data) : 0);
+        if (!last || item->data != last->data)
+        {
+            ccm_debug_window (item->data, "DAMAGE");
+            ccm_drawable_damage (item->data);
+        }
+        if (last)
+            last = last->next;
+    }
+
+    g_list_free (viewable);
+    g_list_free (old_viewable);
+}
+
+/*
+ * Count windows out of place in stack compared to previous one: windows
+ * which are not in the longest sequence kept in same order. New and
+ * removed windows are not counted.
+ */
+static guint
+ccm_screen_count_drift (GList * old, GList * stack)
+{
+    GHashTable *positions = g_hash_table_new (g_direct_hash, g_direct_equal);
+    GArray *tails = g_array_new (FALSE, FALSE, sizeof (guint));
+    guint n = 0, cpt = 0;
+    GList *item;
+
+    for (item = old; item; item = item->next)
+        g_hash_table_insert (positions, item->data, GUINT_TO_POINTER (++cpt));
+
+    for (item = stack; item; item = item->next)
+    {
+        guint pos = GPOINTER_TO_UINT (g_hash_table_lookup (positions,
+                                                           item->data));
+        guint low = 0, high = tails->len;
+
+        if (!pos) continue;
+        n++;
+
+        // Smallest tail greater than position is replaced by it
+        while (low < high)
+        {
+            guint middle = (low + high) / 2;
+
+            if (g_array_index (tails, guint, middle) < pos)
+                low = middle + 1;
+            else
+                high = middle;
+        }
+        if (low == tails->len)
+            g_array_append_val (tails, pos);
+        else
+            g_array_index (tails, guint, low) = pos;
+    }
+
+    cpt = n - tails->len;
+    g_array_free (tails, TRUE);
+    g_hash_table_destroy (positions);
+
+    return cpt;
+}
+
+/*
+ * Consistency check of the stack maintained from events against the
+ * server stack
+ */
 static void
 ccm_screen_check_stack (CCMScreen * self)
 {
     g_return_if_fail (self != NULL);
 
-    guint cpt;
-    GList *stack = NULL, *item, *last = NULL;
-    GList *viewable = NULL, *old_viewable = NULL;
+    guint cpt, drift = 0;
+    GList *stack = NULL, *item, *last = NULL, *old;
+    CCMWindowPrefetch *prefetch;
 
     ccm_debug ("CHECK_STACK");
 
+    old = g_list_copy (self->priv->windows);
+
     ccm_screen_update_stack (self);
 
+    prefetch = ccm_screen_prefetch_unknown_windows (self, self->priv->stack,
+                                                    self->priv->n_windows);
+
     for (cpt = 0; cpt < self->priv->n_windows; ++cpt)
     {
         CCMWindow *window = ccm_screen_find_window (self, self->priv->stack[cpt]);
@@ -1419,28 +2277,22 @@ ccm_screen_check_stack (CCMScreen * self)
             !g_list_find (stack, window))
         {
             stack = g_list_prepend (stack, window);
-            if (ccm_window_is_viewable (window))
-            {
-                ccm_debug_window (window, "STACK IS VIEWABLE");
-                viewable = g_list_prepend (viewable, window);
-            }
         }
         else if (!window)
         {
-            window = ccm_window_new (self, self->priv->stack[cpt]);
+            window = prefetch ?
+                _ccm_window_new_from_prefetch (self, self->priv->stack[cpt],
+                                               prefetch) :
+                ccm_window_new (self, self->priv->stack[cpt]);
             if (window && !ccm_window_is_input_only (window) &&
                 ccm_screen_valid_window (self, window))
             {
                 ccm_debug_window (window, "CHECK STACK NEW WINDOW");
-                if (ccm_window_is_viewable (window) &&
-                    !ccm_window_is_input_only (window))
-                {
-                    ccm_debug_window (window, "CHECK STACK NEW WINDOW MAP");
-                    viewable = g_list_prepend (viewable, window);
-                }
-                g_signal_connect_swapped (window, "damaged",
-                                          G_CALLBACK
-                                          (ccm_screen_on_window_damaged), self);
+                ccm_screen_track_window (self, window);
+                ccm_drawable_add_damage_func (CCM_DRAWABLE (window),
+                                              (CCMDrawableDamageFunc)
+                                              ccm_screen_on_window_damaged,
+                                              self);
                 g_signal_connect_swapped (window, "error",
                                           G_CALLBACK
                                           (ccm_screen_on_window_error), self);
@@ -1460,17 +2312,16 @@ ccm_screen_check_stack (CCMScreen * self)
     }
     stack = g_list_reverse (stack);
 
+    if (prefetch)
+        ccm_window_prefetch_free (prefetch);
+
     for (item = self->priv->windows; item && stack; item = item->next)
     {
         GList *link = g_list_find (stack, item->data);
 
         if (link && ccm_window_is_viewable (item->data) &&
             !ccm_window_is_input_only (item->data))
-        {
-            ccm_debug_window (item->data, "OLD VIEWABLE");
             last = link;
-            old_viewable = g_list_prepend (old_viewable, item->data);
-        }
         else if (!link)
         {
             gboolean found = FALSE;
@@ -1487,7 +2338,6 @@ ccm_screen_check_stack (CCMScreen * self)
                         stack = g_list_insert_before (stack, last_viewable->next,
                                                       item->data);
                 }
-                old_viewable = g_list_prepend (old_viewable, item->data);
                 if (!last_viewable)
                     stack = g_list_prepend (stack, item->data);
                 found = TRUE;
@@ -1500,86 +2350,73 @@ ccm_screen_check_stack (CCMScreen * self)
         }
     }
 
-    viewable = g_list_reverse (viewable);
+    ccm_screen_set_stack (self, stack);
 
-    stack = g_list_sort(stack, (GCompareFunc)ccm_screen_compare_window);
+    drift = ccm_screen_count_drift (old, self->priv->windows);
+    g_list_free (old);
 
-    for (item = viewable; item; item = item->next)
-    {
-        const CCMWindow *transient = ccm_window_transient_for (item->data);
-        const CCMWindow *leader = ccm_window_get_group_leader (item->data);
+    if (drift)
+        ccm_log ("STACK DRIFT: %u windows out of place", drift);
 
-        if (transient &&
-            ccm_window_is_viewable((CCMWindow*)transient) &&
-            !ccm_window_is_input_only((CCMWindow*)transient) &&
-            g_list_index (stack, item->data) < g_list_index (stack, transient))
-        {
-            ccm_debug ("RESTACK TRANSIENT");
-            stack = g_list_remove (stack, item->data);
-            stack = g_list_insert_before (stack,
-                                          g_list_find (stack, transient)->next,
-                                          item->data);
-        }
-        if (leader && leader != self->priv->root &&
-            ccm_window_get_hint_type (item->data) == CCM_WINDOW_TYPE_DIALOG)
-        {
-            GList *iter;
+#if 0
+    g_print ("Stack\n");
+    ccm_screen_print_stack (self);
+#endif
+#if 0
+    g_print ("Real stack\n");
+    ccm_screen_print_real_stack (self);
+#endif
+}
 
-            for (iter = item; iter; iter = iter->next)
-            {
-                if (leader == ccm_window_get_group_leader (iter->data) &&
-                    ccm_window_is_viewable(iter->data) &&
-                    !ccm_window_is_input_only(iter->data)
-                    && ccm_window_get_hint_type (iter->data) == CCM_WINDOW_TYPE_NORMAL)
-                {
-                    ccm_debug ("RESTACK LEADER");
-                    stack = g_list_remove (stack, item->data);
-                    stack = g_list_insert_before (stack,
-                                                  g_list_find (stack, iter->data)->next,
-                                                  item->data);
-                    break;
-                }
-            }
-        }
-    }
+/*
+ * Move window just above sibling like server does on ConfigureNotify, at
+ * bottom of stack if sibling is NULL
+ */
+static void
+ccm_screen_restack_above (CCMScreen * self, CCMWindow * window,
+                          CCMWindow * sibling)
+{
+    g_return_if_fail (self != NULL);
+    g_return_if_fail (window != NULL);
 
-    if (self->priv->windows) g_list_free (self->priv->windows);
-    self->priv->windows = stack;
-    if (self->priv->windows)
-        self->priv->last_windows = g_list_last(self->priv->windows);
-    else
-        self->priv->last_windows = NULL;
+    GList *link = g_list_find (self->priv->windows, window);
+    GList *sibling_link = NULL;
 
-    viewable = g_list_sort (viewable, (GCompareFunc)ccm_screen_compare_window);
-    viewable = g_list_reverse (viewable);
+    if (!link || window == sibling)
+        return;
 
-    last = old_viewable;
-    ccm_debug ("LIST VIEWABLE");
-    for (item = viewable; item; item = item->next)
+    if (sibling)
     {
-        ccm_debug_window (item->data, "VIEWABLE 0x%x",
-                          last ? CCM_WINDOW_XWINDOW (last->data) : 0);
-        if (!last || item->data != last->data)
-        {
-            ccm_debug_window (item->data, "DAMAGE");
-            ccm_drawable_damage (item->data);
-        }
-        if (last)
-            last = last->next;
+        sibling_link = g_list_find (self->priv->windows, sibling);
+        if (!sibling_link || sibling_link->next == link)
+            return;
     }
+    else if (link == self->priv->windows)
+        return;
 
+    ccm_debug_window (window, "RESTACK ABOVE 0x%x",
+                      sibling ? CCM_WINDOW_XWINDOW (sibling) : None);
 
-    g_list_free (viewable);
-    g_list_free (old_viewable);
+    self->priv->windows = g_list_remove_link (self->priv->windows, link);
+    if (sibling_link)
+    {
+        link->next = sibling_link->next;
+        link->prev = sibling_link;
+        if (sibling_link->next) sibling_link->next->prev = link;
+        sibling_link->next = link;
+    }
+    else
+    {
+        link->next = self->priv->windows;
+        if (self->priv->windows) self->priv->windows->prev = link;
+        self->priv->windows = link;
+    }
+    ccm_screen_stack_changed (self);
 
-#if 0
-    g_print ("Stack\n");
-    ccm_screen_print_stack (self);
-#endif
-#if 0
-    g_print ("Real stack\n");
-    ccm_screen_print_real_stack (self);
-#endif
+    ccm_drawable_damage (CCM_DRAWABLE (window));
+
+    // Window types, transients and groups are applied on next idle
+    ccm_screen_add_sort_pending (self);
 }
 
 static void
@@ -1637,11 +2474,40 @@ ccm_screen_restack (CCMScreen * self, CCMWindow * window, CCMWindow * sibling)
             }
         }
     }
-    self->priv->last_windows = g_list_last(self->priv->windows);
+    ccm_screen_stack_changed (self);
 
     ccm_drawable_damage (CCM_DRAWABLE (window));
 }
 
+/*
+ * Forget damage of window which lies outside of all outputs, its pixmap
+ * is not repaired until it becomes visible
+ */
+static void
+ccm_screen_undamage_offscreen (CCMScreen * self, CCMWindow * window)
+{
+    const CCMRegion *damaged = ccm_drawable_get_damaged (CCM_DRAWABLE (window));
+    CCMRegion *outside;
+
+    if (!damaged) return;
+
+    outside = ccm_region_copy ((CCMRegion *) damaged);
+    if (self->priv->geometry)
+        ccm_region_subtract (outside, self->priv->geometry);
+    else
+    {
+        CCMRegion *screen = ccm_region_create (0, 0,
+                                               self->priv->xscreen->width,
+                                               self->priv->xscreen->height);
+
+        ccm_region_subtract (outside, screen);
+        ccm_region_destroy (screen);
+    }
+    if (!ccm_region_empty (outside))
+        ccm_drawable_undamage_region (CCM_DRAWABLE (window), outside);
+    ccm_region_destroy (outside);
+}
+
 static gboolean
 impl_ccm_screen_paint (CCMScreenPlugin * plugin, CCMScreen * self, cairo_t * ctx)
 {
@@ -1659,6 +2525,8 @@ impl_ccm_screen_paint (CCMScreenPlugin * plugin, CCMScreen * self, cairo_t * ctx
 
         if (ccm_window_is_viewable (window) && !ccm_window_is_input_only (window))
         {
+            ccm_screen_undamage_offscreen (self, window);
+
             if (ccm_drawable_is_damaged (CCM_DRAWABLE (window)))
             {
                 CCMRegion *damaged = (CCMRegion*)ccm_drawable_get_damaged (CCM_DRAWABLE (window));
@@ -1697,32 +2565,40 @@ impl_ccm_screen_paint (CCMScreenPlugin * plugin, CCMScreen * self, cairo_t * ctx
 }
 
 static gboolean
-ccm_screen_on_check_stack_pendings (CCMScreen * self)
+ccm_screen_on_sort_stack_pendings (CCMScreen * self)
 {
-    ccm_screen_check_stack (self);
-
     self->priv->id_pendings = 0;
 
+    ccm_screen_set_stack (self, g_list_copy (self->priv->windows));
+
     return FALSE;
 }
 
 static void
-ccm_screen_add_check_pending (CCMScreen * self)
+ccm_screen_add_sort_pending (CCMScreen * self)
 {
     if (!self->priv->id_pendings)
         self->priv->id_pendings = g_idle_add_full (G_PRIORITY_LOW,
-                                                   (GSourceFunc)ccm_screen_on_check_stack_pendings,
+                                                   (GSourceFunc)ccm_screen_on_sort_stack_pendings,
                                                    self, NULL);
 }
 
+static gboolean
+ccm_screen_on_check_stack (CCMScreen * self)
+{
+    ccm_screen_check_stack (self);
+
+    return TRUE;
+}
+
 static void
 ccm_screen_on_window_error (CCMScreen * self, CCMWindow * window)
 {
     g_return_if_fail (self != NULL);
 
+    // Destroyed windows are removed on their DestroyNotify, anything else
+    // is fixed by the next stack check
     ccm_debug_window (window, "ON WINDOW ERROR");
-
-    ccm_screen_add_check_pending (self);
 }
 
 static void
@@ -1764,7 +2640,7 @@ ccm_screen_on_window_property_changed (CCMScreen * self,
     }
     else if (changed == CCM_PROPERTY_HINT_TYPE)
     {
-        ccm_screen_add_check_pending (self);
+        ccm_screen_add_sort_pending (self);
     }
     else if (changed == CCM_PROPERTY_TRANSIENT)
     {
@@ -1785,11 +2661,15 @@ impl_ccm_screen_add_window (CCMScreenPlugin * plugin, CCMScreen * self,
 
     ccm_debug_window (window, "ADD");
 
+    // New windows are created or reparented on top of stack
     self->priv->windows = g_list_append (self->priv->windows, window);
-    self->priv->last_windows = g_list_last(self->priv->windows);
+    ccm_screen_stack_changed (self);
+    ccm_screen_add_sort_pending (self);
+    ccm_screen_track_window (self, window);
 
-    g_signal_connect_swapped (window, "damaged",
-                              G_CALLBACK (ccm_screen_on_window_damaged), self);
+    ccm_drawable_add_damage_func (CCM_DRAWABLE (window),
+                                  (CCMDrawableDamageFunc)
+                                  ccm_screen_on_window_damaged, self);
     g_signal_connect_swapped (window, "error",
                               G_CALLBACK (ccm_screen_on_window_error), self);
     g_signal_connect_swapped (window, "property-changed",
@@ -1818,93 +2698,454 @@ impl_ccm_screen_remove_window (CCMScreenPlugin * plugin, CCMScreen * self,
         else if (!g_list_find (self->priv->removed, window))
             self->priv->removed = g_list_prepend (self->priv->removed, window);
     }
-}
+}
+
+static GSList *
+ccm_screen_get_window_plugins (CCMScreen * self)
+{
+    g_return_val_if_fail (self != NULL, NULL);
+
+    GSList *filter, *plugins = NULL;
+    GError *error = NULL;
+
+    filter =
+        ccm_config_get_string_list (self->priv->options[CCM_SCREEN_PLUGINS],
+                                    &error);
+    if (error)
+    {
+        gchar **default_plugins = g_strsplit (DEFAULT_PLUGINS, ",", -1);
+        gint cpt;
+
+        g_error_free (error);
+        g_warning ("Error on get plugins list set default");
+        for (cpt = 0; default_plugins[cpt]; ++cpt)
+        {
+            filter = g_slist_prepend (filter, g_strdup (default_plugins[cpt]));
+        }
+        g_strfreev (default_plugins);
+        filter = g_slist_reverse (filter);
+    }
+    if (filter)
+    {
+        plugins = ccm_extension_loader_get_window_plugins (self->priv->plugin_loader,
+                                                           filter);
+        g_slist_foreach (filter, (GFunc) g_free, NULL);
+        g_slist_free (filter);
+    }
+    return plugins;
+}
+
+static void
+ccm_screen_get_plugins (CCMScreen * self)
+{
+    g_return_if_fail (self != NULL);
+
+    GSList *filter = NULL, *plugins = NULL, *item;
+    GError *error = NULL;
+
+    if (self->priv->plugin && CCM_IS_PLUGIN (self->priv->plugin))
+        g_object_unref (self->priv->plugin);
+
+    self->priv->plugin = (CCMScreenPlugin *) self;
+
+    filter = ccm_config_get_string_list (self->priv->options[CCM_SCREEN_PLUGINS],
+                                         &error);
+    if (error)
+    {
+        gchar **default_plugins = g_strsplit (DEFAULT_PLUGINS, ",", -1);
+        gint cpt;
+
+        g_error_free (error);
+        g_warning ("Error on get plugins list set default");
+        for (cpt = 0; default_plugins[cpt]; ++cpt)
+        {
+            filter = g_slist_prepend (filter, g_strdup (default_plugins[cpt]));
+        }
+        g_strfreev (default_plugins);
+        filter = g_slist_reverse (filter);
+    }
+    if (filter)
+    {
+        plugins = ccm_extension_loader_get_screen_plugins (self->priv->plugin_loader,
+                                                           filter);
+        g_slist_foreach (filter, (GFunc) g_free, NULL);
+        g_slist_free (filter);
+        for (item = plugins; item; item = item->next)
+        {
+            GType type = GPOINTER_TO_INT (item->data);
+            GObject *prev = G_OBJECT (self->priv->plugin);
+            CCMScreenPlugin *plugin = g_object_new (type, "parent", prev,
+                                                    "screen",
+                                                    self->priv->number,
+                                                    NULL);
+
+            if (plugin)
+                self->priv->plugin = plugin;
+        }
+        if (plugins)
+            g_slist_free (plugins);
+        ccm_screen_plugin_load_options (self->priv->plugin, self);
+    }
+}
+
+/*
+ * Number of frames between two repairs of a drawable, damage of windows
+ * not active or in background can be repaired less often than the others
+ */
+static guint
+ccm_screen_get_damage_interval (CCMScreen * self, CCMDrawable * drawable)
+{
+    guint rate = self->priv->damage_rate;
+    CCMWindow *window = NULL;
+
+    if (CCM_IS_PIXMAP (drawable))
+        window = _ccm_window_from_pixmap (CCM_PIXMAP (drawable));
+
+    if (window && self->priv->background_damage_rate &&
+        (window != self->priv->active ||
+         ccm_window_get_hint_type (window) == CCM_WINDOW_TYPE_DESKTOP))
+    {
+        rate = rate ? MIN (rate, self->priv->background_damage_rate) :
+                      self->priv->background_damage_rate;
+    }
+
+    if (!rate || rate >= self->priv->refresh_rate)
+        return 1;
+
+    return (self->priv->refresh_rate + rate - 1) / rate;
+}
+
+static void
+ccm_screen_process_damage (XID damage, gpointer drawable, CCMScreen * self)
+{
+    guint interval = ccm_screen_get_damage_interval (self, drawable);
+
+    if (interval > 1)
+    {
+        guint last = GPOINTER_TO_UINT (ccm_xid_table_lookup (self->priv->damage_frames,
+                                                             damage));
+
+        // Damage stays pending without subtract until the window can be
+        // repaired again, server accumulates it in damage region
+        if (last && self->priv->n_frames - last < interval)
+        {
+            ccm_xid_table_insert (self->priv->damages, damage, drawable);
+            return;
+        }
+        ccm_xid_table_insert (self->priv->damage_frames, damage,
+                              GUINT_TO_POINTER (self->priv->n_frames));
+    }
+    else
+        ccm_xid_table_remove (self->priv->damage_frames, damage);
+
+    ccm_display_process_damage (self->priv->display, damage);
+}
+
+static void
+ccm_screen_update_frame_load (CCMScreen * self, gint64 start)
+{
+    gint64 now = g_get_monotonic_time ();
+    gdouble period = (gdouble)G_USEC_PER_SEC / MAX (self->priv->refresh_rate, 1);
+    gboolean missed;
+
+    // Measure frame cost only while animations run, frames are painted on
+    // demand otherwise
+    if (now > self->priv->animation_end)
+    {
+        self->priv->frame_load = 0.0;
+        self->priv->frame_missed = 0.0;
+    }
+    else
+    {
+        missed = self->priv->frame_start &&
+                 start - self->priv->frame_start > period * 1.5;
+
+        self->priv->frame_load = self->priv->frame_load * 0.8 +
+                                 ((gdouble)(now - start) / period) * 0.2;
+        self->priv->frame_missed = self->priv->frame_missed * 0.8 +
+                                   (missed ? 0.2 : 0.0);
+    }
+
+    self->priv->frame_start = start;
+    self->priv->nb_frame_animations = 0;
+    self->priv->frame_animation_duration = 0;
+}
+
+static gboolean
+ccm_screen_window_is_occluded (CCMScreen * self, CCMWindow * window)
+{
+    const CCMRegion *geometry = ccm_drawable_get_device_geometry (CCM_DRAWABLE (window));
+    gint position = ccm_screen_get_stack_position (self, CCM_WINDOW_XWINDOW (window),
+                                                   window);
+    cairo_rectangle_t clipbox;
+    CCMRegion *visible;
+    GArray *windows;
+    gboolean occluded;
+    guint cpt;
+
+    if (!geometry || position < 0) return FALSE;
+
+    visible = ccm_region_copy ((CCMRegion *) geometry);
+    ccm_region_get_clipbox (visible, &clipbox);
+
+    // Substract opaque region of all windows above
+    windows = ccm_screen_get_windows_in_area (self, &clipbox, window);
+    for (cpt = 0; cpt < windows->len && !ccm_region_empty (visible); ++cpt)
+    {
+        CCMScreenStackWindow *above = &g_array_index (windows,
+                                                      CCMScreenStackWindow,
+                                                      cpt);
+        const CCMRegion *opaque;
+
+        if (above->position < position) break;
+
+        opaque = ccm_window_get_opaque_region (above->window);
+        if (opaque)
+            ccm_region_subtract (visible, (CCMRegion *) opaque);
+    }
+    occluded = ccm_region_empty (visible);
+
+    g_array_free (windows, TRUE);
+    ccm_region_destroy (visible);
+
+    return occluded;
+}
+
+static gint
+ccm_screen_compare_paint_time (CCMWindow ** a, CCMWindow ** b)
+{
+    gint64 a_time = _ccm_window_get_paint_time (*a);
+    gint64 b_time = _ccm_window_get_paint_time (*b);
+
+    return a_time < b_time ? -1 : a_time > b_time ? 1 : 0;
+}
+
+static guint64
+ccm_screen_get_memory_used (CCMScreen * self)
+{
+    guint64 used = 0;
+    gint cpt;
+
+    for (cpt = 0; cpt < CCM_PIXMAP_MEMORY_N; ++cpt)
+        used += self->priv->memory[cpt];
+
+    return used;
+}
+
+static void
+ccm_screen_release_pixmaps (CCMScreen * self)
+{
+    g_return_if_fail (self != NULL);
+
+    gint64 now = g_get_monotonic_time ();
+    GPtrArray *windows;
+    GList *item;
+    guint cpt;
+
+    if (!self->priv->memory_budget ||
+        ccm_screen_get_memory_used (self) <= self->priv->memory_budget ||
+        now - self->priv->memory_check < G_USEC_PER_SEC)
+        return;
+
+    self->priv->memory_check = now;
+
+    // Unmapped (which include minimized) and fully occluded windows are the
+    // candidates, the least recently painted are released first
+    windows = g_ptr_array_new ();
+    for (item = self->priv->windows; item; item = item->next)
+    {
+        CCMWindow *window = item->data;
+
+        if (!_ccm_window_has_pixmap (window)) continue;
+
+        if (ccm_window_is_viewable (window) ?
+            ccm_screen_window_is_occluded (self, window) :
+            !ccm_window_is_shaded (window))
+            g_ptr_array_add (windows, window);
+    }
+    g_ptr_array_sort (windows, (GCompareFunc) ccm_screen_compare_paint_time);
+
+    for (cpt = 0; cpt < windows->len &&
+         ccm_screen_get_memory_used (self) > self->priv->memory_budget; ++cpt)
+        _ccm_window_release_pixmap (g_ptr_array_index (windows, cpt));
+
+    g_ptr_array_free (windows, TRUE);
+}
+
+/* Destroy frame ring, readers must not attach its released segment */
+static void
+ccm_screen_destroy_ring (CCMScreen * self)
+{
+    if (self->priv->ring)
+    {
+        Atom atom = XInternAtom (CCM_DISPLAY_XDISPLAY (self->priv->display),
+                                 "_CCM_FRAME_RING", False);
+
+        XDeleteProperty (CCM_DISPLAY_XDISPLAY (self->priv->display),
+                         RootWindowOfScreen (self->priv->xscreen), atom);
+        ccm_frame_ring_destroy (self->priv->ring);
+        self->priv->ring = NULL;
+    }
+}
+
+static void
+ccm_screen_destroy_frame (CCMScreen * self)
+{
+    ccm_screen_destroy_ring (self);
+
+    if (self->priv->frame)
+    {
+        cairo_surface_destroy (self->priv->frame);
+        self->priv->frame = NULL;
+    }
+
+    if (self->priv->export_image)
+    {
+        cairo_surface_destroy (self->priv->export_image);
+        self->priv->export_image = NULL;
+    }
+    self->priv->ring_synced = FALSE;
+}
+
+/* Get shared memory ring of frames, create it on first use */
+static CCMFrameRing*
+ccm_screen_get_ring (CCMScreen * self)
+{
+    if (!self->priv->ring)
+    {
+        guint size = self->priv->ring_size ? self->priv->ring_size :
+                                             CCM_SCREEN_EXPORT_RING_SIZE;
+
+        self->priv->ring = ccm_frame_ring_new (size,
+                                               self->priv->xscreen->width,
+                                               self->priv->xscreen->height,
+                                               CAIRO_FORMAT_RGB24);
+        if (self->priv->ring)
+        {
+            Atom atom = XInternAtom (CCM_DISPLAY_XDISPLAY (self->priv->display),
+                                     "_CCM_FRAME_RING", False);
+            long id = ccm_frame_ring_get_id (self->priv->ring);
+
+            // Readers find shared memory segment on root window
+            XChangeProperty (CCM_DISPLAY_XDISPLAY (self->priv->display),
+                             RootWindowOfScreen (self->priv->xscreen), atom,
+                             XA_CARDINAL, 32, PropModeReplace,
+                             (unsigned char *) &id, 1);
+        }
+        else
+        {
+            // Do not retry on each frame
+            g_warning ("Error on create frame ring");
+            self->priv->ring_size = 0;
+            if (self->priv->export)
+                ccm_frame_export_destroy (self->priv->export);
+            self->priv->export = NULL;
+        }
+    }
+
+    return self->priv->ring;
+}
+
+/* Push frame in shared memory ring and send its damage to export clients,
+ * a NULL damage stands for the whole screen */
+static void
+ccm_screen_export_frame (CCMScreen * self, cairo_surface_t * source,
+                         CCMRegion * damaged)
+{
+    gboolean exported = self->priv->export &&
+                        ccm_frame_export_has_clients (self->priv->export);
+    cairo_surface_t *image = source;
+    CCMRegion *damage = damaged;
+    CCMFrameRing *ring;
+    guint32 sequence;
+
+    // Frames are pushed without clients only in a requested headless
+    // ring, ring slots miss the other ones so next push is a whole frame
+    if (!exported && (!self->priv->frame || !self->priv->ring_size))
+    {
+        self->priv->ring_synced = FALSE;
+        return;
+    }
 
-static GSList *
-ccm_screen_get_window_plugins (CCMScreen * self)
-{
-    g_return_val_if_fail (self != NULL, NULL);
+    ring = ccm_screen_get_ring (self);
+    if (!ring) return;
 
-    GSList *filter, *plugins = NULL;
-    GError *error = NULL;
+    if (!damage || !self->priv->ring_synced)
+        damage = ccm_region_create (0, 0, self->priv->xscreen->width,
+                                    self->priv->xscreen->height);
 
-    filter =
-        ccm_config_get_string_list (self->priv->options[CCM_SCREEN_PLUGINS],
-                                    &error);
-    if (error)
+    // Back buffer is not an image, copy damaged area in export image
+    if (cairo_surface_get_type (source) != CAIRO_SURFACE_TYPE_IMAGE)
     {
-        gchar **default_plugins = g_strsplit (DEFAULT_PLUGINS, ",", -1);
-        gint cpt;
+        cairo_t *ctx;
 
-        g_error_free (error);
-        g_warning ("Error on get plugins list set default");
-        for (cpt = 0; default_plugins[cpt]; ++cpt)
-        {
-            filter = g_slist_prepend (filter, g_strdup (default_plugins[cpt]));
-        }
-        g_strfreev (default_plugins);
-        filter = g_slist_reverse (filter);
+        if (!self->priv->export_image)
+            self->priv->export_image =
+                cairo_image_surface_create (CAIRO_FORMAT_RGB24,
+                                            self->priv->xscreen->width,
+                                            self->priv->xscreen->height);
+        image = self->priv->export_image;
+
+        ctx = cairo_create (image);
+        ccm_region_clip (damage, ctx);
+        cairo_set_operator (ctx, CAIRO_OPERATOR_SOURCE);
+        cairo_set_source_surface (ctx, source, 0, 0);
+        cairo_paint (ctx);
+        cairo_destroy (ctx);
     }
-    if (filter)
-    {
-        plugins = ccm_extension_loader_get_window_plugins (self->priv->plugin_loader,
-                                                           filter);
-        g_slist_foreach (filter, (GFunc) g_free, NULL);
-        g_slist_free (filter);
-    }
-    return plugins;
+
+    sequence = ccm_frame_ring_push (ring, image, damage);
+    self->priv->ring_synced = sequence != 0;
+    if (sequence && exported)
+        ccm_frame_export_notify (self->priv->export, ring, sequence);
+
+    if (damage != damaged) ccm_region_destroy (damage);
 }
 
+/* Publish finished headless frame and notify it */
 static void
-ccm_screen_get_plugins (CCMScreen * self)
+ccm_screen_publish_frame (CCMScreen * self)
 {
-    g_return_if_fail (self != NULL);
+    CCMRegion *damaged = self->priv->damaged;
 
-    GSList *filter = NULL, *plugins = NULL, *item;
-    GError *error = NULL;
+    if (!damaged)
+        damaged = ccm_region_create (0, 0, self->priv->xscreen->width,
+                                     self->priv->xscreen->height);
 
-    if (self->priv->plugin && CCM_IS_PLUGIN (self->priv->plugin))
-        g_object_unref (self->priv->plugin);
+    ccm_screen_export_frame (self, self->priv->frame, damaged);
+    if (self->priv->recorder)
+        ccm_recorder_push (self->priv->recorder, self->priv->frame, damaged);
 
-    self->priv->plugin = (CCMScreenPlugin *) self;
+    g_signal_emit (self, signals[FRAME_PAINTED], 0, self->priv->frame, damaged);
 
-    filter = ccm_config_get_string_list (self->priv->options[CCM_SCREEN_PLUGINS],
-                                         &error);
-    if (error)
-    {
-        gchar **default_plugins = g_strsplit (DEFAULT_PLUGINS, ",", -1);
-        gint cpt;
+    ccm_region_destroy (damaged);
+    self->priv->damaged = NULL;
+}
 
-        g_error_free (error);
-        g_warning ("Error on get plugins list set default");
-        for (cpt = 0; default_plugins[cpt]; ++cpt)
-        {
-            filter = g_slist_prepend (filter, g_strdup (default_plugins[cpt]));
-        }
-        g_strfreev (default_plugins);
-        filter = g_slist_reverse (filter);
-    }
-    if (filter)
+/* Export and record back buffer of composite overlay window before it is
+ * flushed */
+static void
+ccm_screen_export_overlay (CCMScreen * self)
+{
+    gboolean exported = self->priv->export &&
+                        ccm_frame_export_has_clients (self->priv->export);
+    cairo_surface_t *surface;
+
+    if (!exported)
     {
-        plugins = ccm_extension_loader_get_screen_plugins (self->priv->plugin_loader,
-                                                           filter);
-        g_slist_foreach (filter, (GFunc) g_free, NULL);
-        g_slist_free (filter);
-        for (item = plugins; item; item = item->next)
-        {
-            GType type = GPOINTER_TO_INT (item->data);
-            GObject *prev = G_OBJECT (self->priv->plugin);
-            CCMScreenPlugin *plugin = g_object_new (type, "parent", prev,
-                                                    "screen",
-                                                    self->priv->number,
-                                                    NULL);
+        self->priv->ring_synced = FALSE;
+        if (!self->priv->recorder) return;
+    }
 
-            if (plugin)
-                self->priv->plugin = plugin;
-        }
-        if (plugins)
-            g_slist_free (plugins);
-        ccm_screen_plugin_load_options (self->priv->plugin, self);
+    surface = ccm_drawable_get_surface (CCM_DRAWABLE (self->priv->cow));
+    if (surface)
+    {
+        if (exported)
+            ccm_screen_export_frame (self, surface, self->priv->damaged);
+        if (self->priv->recorder)
+            ccm_recorder_push (self->priv->recorder, surface,
+                               self->priv->damaged);
+        cairo_surface_destroy (surface);
     }
 }
 
@@ -1913,21 +3154,34 @@ ccm_screen_paint (CCMScreen * self, int num_frame, CCMTimeline * timeline)
 {
     g_return_if_fail (self != NULL);
 
-    if (self->priv->cow)
+    gint64 frame_start = g_get_monotonic_time ();
+
+    // Frame counter never gives 0 which means not repaired
+    if (!++self->priv->n_frames) self->priv->n_frames = 1;
+
+    /* Dispatch X events received since last frame */
+    ccm_display_process_frame_events (self->priv->display, self);
+
+    if (self->priv->cow || self->priv->frame)
     {
-        CCMSetIterator* iter = ccm_set_iterator (self->priv->damages);
-        while (ccm_set_iterator_next (iter))
-        {
-            guint damage = (guint)GPOINTER_TO_INT (ccm_set_iterator_get (iter));
-            ccm_display_process_damage (self->priv->display, damage);
-        }
-        g_object_unref (iter);
-        ccm_set_clear (self->priv->damages);
+        CCMXidTable* damages = self->priv->damages;
+
+        // Swap pending damages with back table, damages received or
+        // destroyed while processing only touch the front table
+        self->priv->damages = self->priv->damages_back;
+        self->priv->damages_back = damages;
+        ccm_xid_table_foreach (damages,
+                               (CCMXidTableFunc)ccm_screen_process_damage,
+                               self);
+        ccm_xid_table_remove_all (damages);
 
 
         if (!self->priv->ctx)
         {
-            self->priv->ctx = ccm_drawable_create_context (CCM_DRAWABLE (self->priv->cow));
+            if (self->priv->frame)
+                self->priv->ctx = cairo_create (self->priv->frame);
+            else
+                self->priv->ctx = ccm_drawable_create_context (CCM_DRAWABLE (self->priv->cow));
             if (self->priv->ctx)
             {
                 if (self->priv->geometry == NULL)
@@ -1936,17 +3190,7 @@ ccm_screen_paint (CCMScreen * self, int num_frame, CCMTimeline * timeline)
                     cairo_clip (self->priv->ctx);
                 }
                 else
-                {
-                    cairo_rectangle_t *rects = NULL;
-                    gint cpt, nb_rects;
-
-                    ccm_region_get_rectangles (self->priv->geometry, &rects, &nb_rects);
-                    for (cpt = 0; cpt < nb_rects; ++cpt)
-                        cairo_rectangle (self->priv->ctx, rects[cpt].x, rects[cpt].y,
-                                         rects[cpt].width, rects[cpt].height);
-                    if (rects) cairo_rectangles_free (rects, nb_rects);
-                    cairo_clip (self->priv->ctx);
-                }
+                    ccm_region_clip (self->priv->geometry, self->priv->ctx);
                 cairo_set_operator (self->priv->ctx, CAIRO_OPERATOR_CLEAR);
                 cairo_paint (self->priv->ctx);
                 cairo_set_operator (self->priv->ctx, CAIRO_OPERATOR_OVER);
@@ -1961,17 +3205,7 @@ ccm_screen_paint (CCMScreen * self, int num_frame, CCMTimeline * timeline)
                 cairo_clip (self->priv->ctx);
             }
             else
-            {
-                cairo_rectangle_t *rects = NULL;
-                gint cpt, nb_rects;
-
-                ccm_region_get_rectangles (self->priv->geometry, &rects, &nb_rects);
-                for (cpt = 0; cpt < nb_rects; ++cpt)
-                    cairo_rectangle (self->priv->ctx, rects[cpt].x, rects[cpt].y,
-                                     rects[cpt].width, rects[cpt].height);
-                if (rects) cairo_rectangles_free (rects, nb_rects);
-                cairo_clip (self->priv->ctx);
-            }
+                ccm_region_clip (self->priv->geometry, self->priv->ctx);
         }
 
         if (self->priv->root_damage)
@@ -1980,16 +3214,9 @@ ccm_screen_paint (CCMScreen * self, int num_frame, CCMTimeline * timeline)
             {
                 ccm_screen_update_background (self);
             }
-            cairo_rectangle_t *rects = NULL;
-            gint cpt, nb_rects;
 
             cairo_save (self->priv->ctx);
-            ccm_region_get_rectangles (self->priv->root_damage, &rects, &nb_rects);
-            for (cpt = 0; cpt < nb_rects; ++cpt)
-                cairo_rectangle (self->priv->ctx, rects[cpt].x, rects[cpt].y,
-                                 rects[cpt].width, rects[cpt].height);
-            if (rects) cairo_rectangles_free (rects, nb_rects);
-            cairo_clip (self->priv->ctx);
+            ccm_region_clip (self->priv->root_damage, self->priv->ctx);
 
             if (self->priv->background)
             {
@@ -2010,19 +3237,36 @@ ccm_screen_paint (CCMScreen * self, int num_frame, CCMTimeline * timeline)
             self->priv->root_damage = NULL;
         }
 
-        if (ccm_screen_plugin_paint (self->priv->plugin, self, self->priv->ctx))
+        // Windows moved by a blit have to be flushed even if nothing else
+        // was painted
+        if (ccm_screen_plugin_paint (self->priv->plugin, self, self->priv->ctx) ||
+            self->priv->blitted)
         {
-            if (self->priv->damaged)
+            if (self->priv->frame)
+                ccm_screen_publish_frame (self);
+            else if (self->priv->damaged)
             {
+                if (self->priv->export || self->priv->recorder)
+                    ccm_screen_export_overlay (self);
                 ccm_drawable_flush_region (CCM_DRAWABLE (self->priv->cow),
                                            self->priv->damaged);
                 ccm_region_destroy (self->priv->damaged);
                 self->priv->damaged = NULL;
             }
             else
+            {
+                if (self->priv->export || self->priv->recorder)
+                    ccm_screen_export_overlay (self);
                 ccm_drawable_flush (CCM_DRAWABLE (self->priv->cow));
+            }
         }
+
+        self->priv->blitted = FALSE;
+
+        ccm_screen_release_pixmaps (self);
     }
+
+    ccm_screen_update_frame_load (self, frame_start);
 }
 
 static void
@@ -2046,6 +3290,31 @@ ccm_screen_on_option_changed (CCMScreen * self, CCMConfig * config)
     {
         ccm_screen_update_sync_with_vblank (self);
     }
+    else if (config == self->priv->options[CCM_SCREEN_DAMAGE_RATE] ||
+             config == self->priv->options[CCM_SCREEN_BACKGROUND_DAMAGE_RATE])
+    {
+        ccm_screen_update_damage_rate (self);
+    }
+    else if (config == self->priv->options[CCM_SCREEN_PIXMAP_MEMORY_BUDGET])
+    {
+        ccm_screen_update_memory_budget (self);
+    }
+    else if (config == self->priv->options[CCM_SCREEN_RESIZE_REBIND_DELAY])
+    {
+        ccm_screen_update_rebind_delay (self);
+    }
+    else if (config == self->priv->options[CCM_SCREEN_HEADLESS_RING_SIZE])
+    {
+        ccm_screen_update_ring_size (self);
+    }
+    else if (config == self->priv->options[CCM_SCREEN_EXPORT_SOCKET])
+    {
+        ccm_screen_update_export (self);
+    }
+    else if (config == self->priv->options[CCM_SCREEN_RECORD_FILE])
+    {
+        ccm_screen_update_record (self);
+    }
     else if (config == self->priv->options[CCM_SCREEN_BACKGROUND] ||
              config == self->priv->options[CCM_SCREEN_COLOR_BACKGROUND] ||
              config == self->priv->options[CCM_SCREEN_BACKGROUND_X] ||
@@ -2064,14 +3333,23 @@ impl_ccm_screen_damage (CCMScreenPlugin * plugin, CCMScreen * self,
     g_return_if_fail (area != NULL);
     g_return_if_fail (window != NULL);
 
-    GList *item = NULL;
+    GArray *windows;
+    guint cpt, start;
+    gint position;
     gboolean top = TRUE;
     CCMRegion *damage_above = NULL, *damage_below = NULL;
     const CCMRegion *opaque = NULL;
+    cairo_rectangle_t clipbox;
 
     damage_above = ccm_region_copy (area);
     damage_below = ccm_region_copy (area);
 
+    // Only windows which intersect damaged area are walked
+    ccm_region_get_clipbox (area, &clipbox);
+    windows = ccm_screen_get_windows_in_area (self, &clipbox, window);
+    position = ccm_screen_get_stack_position (self, CCM_WINDOW_XWINDOW (window),
+                                              window);
+
     ccm_debug_region (CCM_DRAWABLE (window), "ON_DAMAGE");
 
     // Substract opaque region of window to damage region below
@@ -2082,80 +3360,77 @@ impl_ccm_screen_damage (CCMScreenPlugin * plugin, CCMScreen * self,
     }
 
     // Substract all obscured area to damage region
-    for (item = self->priv->last_windows; item; item = item->prev)
+    for (cpt = 0; cpt < windows->len &&
+         g_array_index (windows, CCMScreenStackWindow, cpt).position > position;
+         ++cpt)
     {
-        if (!ccm_window_is_input_only (item->data) &&
-            ccm_window_is_viewable (item->data) &&
-            CCM_WINDOW_XWINDOW (item->data) != CCM_WINDOW_XWINDOW (window))
+        CCMWindow *above = g_array_index (windows, CCMScreenStackWindow, cpt).window;
+
+        opaque = ccm_window_get_opaque_region (above);
+        if (opaque)
         {
-            opaque = ccm_window_get_opaque_region (item->data);
-            if (opaque)
+            ccm_debug_window (window, "UNDAMAGE ABOVE 0x%lx", CCM_WINDOW_XWINDOW (above));
+            ccm_drawable_undamage_region (CCM_DRAWABLE (window), (CCMRegion *) opaque);
+            // window is totaly obscured don't damage all other windows
+            if (!ccm_drawable_is_damaged (CCM_DRAWABLE (window)))
             {
-                ccm_debug_window (window, "UNDAMAGE ABOVE 0x%lx", CCM_WINDOW_XWINDOW (item->data));
-                ccm_drawable_undamage_region (CCM_DRAWABLE (window), (CCMRegion *) opaque);
-                // window is totaly obscured don't damage all other windows
-                if (!ccm_drawable_is_damaged (CCM_DRAWABLE (window)))
-                {
-                    ccm_region_destroy (damage_below);
-                    ccm_region_destroy (damage_above);
-                    return;
-                }
-                ccm_region_subtract (damage_above, (CCMRegion *) opaque);
-                ccm_region_subtract (damage_below, (CCMRegion *) opaque);
+                g_array_free (windows, TRUE);
+                ccm_region_destroy (damage_below);
+                ccm_region_destroy (damage_above);
+                return;
             }
+            ccm_region_subtract (damage_above, (CCMRegion *) opaque);
+            ccm_region_subtract (damage_below, (CCMRegion *) opaque);
         }
-        else if (item->data == window)
-            break;
     }
 
     // If no damage on above skip above windows
     if (ccm_region_empty (damage_above))
     {
-        item = g_list_find (self->priv->windows, window);
-        item = item ? item->prev : NULL;
+        start = position < 0 ? windows->len : cpt;
         top = FALSE;
     }
     else
-        item = self->priv->last_windows;
+        start = 0;
 
     // damage now all concurent window
-    for (; item; item = item->prev)
+    for (cpt = start; cpt < windows->len; ++cpt)
     {
-        if (!ccm_window_is_input_only (item->data)
-            && ccm_window_is_viewable (item->data) && item->data != window)
-        {
-            if (top)
-            {
-                ccm_drawable_damage_region_silently (item->data, damage_above);
-            }
-            else
-            {
-                opaque = ccm_window_get_opaque_region (window);
-                if (ccm_window_is_viewable (window) &&
-                    !ccm_window_is_input_only (window) && opaque &&
-                    !ccm_region_empty ((CCMRegion *) opaque))
-                {
-                    ccm_debug_window (item->data, "UNDAMAGE BELOW");
-                    ccm_drawable_undamage_region (CCM_DRAWABLE (item->data), (CCMRegion *) opaque);
-                }
+        CCMScreenStackWindow *item = &g_array_index (windows, CCMScreenStackWindow, cpt);
 
-                ccm_drawable_damage_region_silently (item->data, damage_below);
-                opaque = ccm_window_get_opaque_region (item->data);
-
-                if (opaque)
-                {
-                    ccm_region_subtract (damage_below, (CCMRegion *) opaque);
-                }
-            }
-        }
-        else if (item->data == window)
+        if (top && item->position < position)
         {
             top = FALSE;
             opaque = ccm_window_get_opaque_region (window);
             if (ccm_region_empty (damage_below) && ccm_region_empty ((CCMRegion *) opaque))
                 break;
         }
+
+        if (top)
+        {
+            ccm_drawable_damage_region_silently (CCM_DRAWABLE (item->window), damage_above);
+        }
+        else
+        {
+            opaque = ccm_window_get_opaque_region (window);
+            if (ccm_window_is_viewable (window) &&
+                !ccm_window_is_input_only (window) && opaque &&
+                !ccm_region_empty ((CCMRegion *) opaque))
+            {
+                ccm_debug_window (item->window, "UNDAMAGE BELOW");
+                ccm_drawable_undamage_region (CCM_DRAWABLE (item->window), (CCMRegion *) opaque);
+            }
+
+            ccm_drawable_damage_region_silently (CCM_DRAWABLE (item->window), damage_below);
+            opaque = ccm_window_get_opaque_region (item->window);
+
+            if (opaque)
+            {
+                ccm_region_subtract (damage_below, (CCMRegion *) opaque);
+            }
+        }
     }
+    g_array_free (windows, TRUE);
 
     if (!ccm_region_empty (damage_below))
     {
@@ -2186,13 +3461,14 @@ impl_ccm_screen_damage (CCMScreenPlugin * plugin, CCMScreen * self,
 }
 
 static void
-ccm_screen_on_window_damaged (CCMScreen * self, CCMRegion * area,
-                              CCMWindow * window)
+ccm_screen_on_window_damaged (CCMWindow * window, CCMRegion * area,
+                              CCMScreen * self)
 {
-    if (!self->priv->cow)
+    if (!self->priv->cow && !self->priv->frame)
         ccm_screen_create_overlay_window (self);
 
-    if (self->priv->cow && CCM_WINDOW_XWINDOW (self->priv->cow) != CCM_WINDOW_XWINDOW (window))
+    if (self->priv->frame ||
+        (self->priv->cow && CCM_WINDOW_XWINDOW (self->priv->cow) != CCM_WINDOW_XWINDOW (window)))
     {
         ccm_screen_plugin_damage (self->priv->plugin, self, area, window);
     }
@@ -2203,7 +3479,7 @@ ccm_screen_on_damage_event (CCMScreen * self, guint32 damage, CCMDrawable* drawa
 {
     if (ccm_drawable_get_screen (drawable) == self)
     {
-        ccm_set_insert (self->priv->damages, GINT_TO_POINTER((gint)damage));
+        ccm_xid_table_insert (self->priv->damages, damage, drawable);
     }
 }
 
@@ -2212,7 +3488,8 @@ ccm_screen_on_damage_destroy (CCMScreen * self, guint32 damage, CCMDrawable* dra
 {
     if (ccm_drawable_get_screen (drawable) == self)
     {
-        ccm_set_remove (self->priv->damages, GINT_TO_POINTER((gint)damage));
+        ccm_xid_table_remove (self->priv->damages, damage);
+        ccm_xid_table_remove (self->priv->damage_frames, damage);
     }
 }
 
@@ -2307,7 +3584,7 @@ ccm_screen_on_event (CCMScreen * self, XEvent * event)
                     CCMWindow *root = ccm_screen_get_root_window (self);
                     if (create_event->parent == CCM_WINDOW_XWINDOW (root))
                     {
-                        window = ccm_window_new (self, create_event->window);
+                        window = ccm_screen_create_window (self, create_event->window);
                         if (window)
                         {
                             ccm_debug_window (window, "CREATE");
@@ -2344,7 +3621,7 @@ ccm_screen_on_event (CCMScreen * self, XEvent * event)
                 }
                 else if (((XMapEvent *) event)->event == CCM_WINDOW_XWINDOW (self->priv->root))
                 {
-                    window = ccm_window_new (self, ((XMapEvent *) event)->window);
+                    window = ccm_screen_create_window (self, ((XMapEvent *) event)->window);
                     if (window)
                     {
                         ccm_debug_window (window, "CREATE MAP");
@@ -2390,7 +3667,7 @@ ccm_screen_on_event (CCMScreen * self, XEvent * event)
                 {
                     if (!window)
                     {
-                        window = ccm_window_new (self, ((XReparentEvent *) event)->window);
+                        window = ccm_screen_create_window (self, ((XReparentEvent *) event)->window);
                         if (window)
                         {
                             ccm_debug_window (window, "REPARENT ADD");
@@ -2416,7 +3693,12 @@ ccm_screen_on_event (CCMScreen * self, XEvent * event)
                 if (window)
                 {
                     ccm_debug_window (window, "CIRCULATE");
-                    ccm_screen_add_check_pending (self);
+                    if (circulate_event->place == PlaceOnBottom)
+                        ccm_screen_restack_above (self, window, NULL);
+                    else if (self->priv->last_windows &&
+                             self->priv->last_windows->data != window)
+                        ccm_screen_restack_above (self, window,
+                                                  self->priv->last_windows->data);
                 }
             }
             break;
@@ -2449,23 +3731,25 @@ ccm_screen_on_event (CCMScreen * self, XEvent * event)
                             }
                             configure_event = &ce.xconfigure;
                         }
-                        if (configure_event->above != None)
+                        if (configure_event->above == None)
                         {
-                            if (configure_event->above
-                                && configure_event->above !=
-                                CCM_WINDOW_XWINDOW (self->priv->root)
-                                && configure_event->above !=
-                                CCM_WINDOW_XWINDOW (self->priv->cow)
-                                && configure_event->above !=
-                                self->priv->selection_owner)
-                            {
-                                CCMWindow *above;
-                                above =
-                                    ccm_screen_find_window (self,
-                                                            configure_event->above);
-                                if (above)
-                                    ccm_screen_restack (self, window, above);
-                            }
+                            ccm_screen_restack_above (self, window, NULL);
+                        }
+                        else if (configure_event->above !=
+                                 CCM_WINDOW_XWINDOW (self->priv->root)
+                                 && (!self->priv->cow ||
+                                     configure_event->above !=
+                                     CCM_WINDOW_XWINDOW (self->priv->cow))
+                                 && configure_event->above !=
+                                 self->priv->selection_owner)
+                        {
+                            CCMWindow *above;
+                            above =
+                                ccm_screen_find_window (self,
+                                                        configure_event->above);
+                            // Sibling not tracked is left to stack check
+                            if (above)
+                                ccm_screen_restack_above (self, window, above);
                         }
 
                         ccm_drawable_move (CCM_DRAWABLE (window),
@@ -2497,7 +3781,7 @@ ccm_screen_on_event (CCMScreen * self, XEvent * event)
                     guint n_items;
                     Window active;
 
-                    ccm_screen_add_check_pending (self);
+                    ccm_screen_add_sort_pending (self);
                     data =
                         ccm_window_get_property (self->priv->root,
                                                  CCM_WINDOW_GET_CLASS (self->priv->root)->active_atom,
@@ -2524,7 +3808,7 @@ ccm_screen_on_event (CCMScreen * self, XEvent * event)
                 else if (property_event->atom == CCM_WINDOW_GET_CLASS (self->priv->root)->client_stacking_list_atom ||
                          property_event->atom == CCM_WINDOW_GET_CLASS (self->priv->root)->client_list_atom)
                 {
-                    ccm_screen_add_check_pending (self);
+                    ccm_screen_add_sort_pending (self);
                 }
                 else if (property_event->atom == CCM_WINDOW_GET_CLASS (self->priv->root)->transient_for_atom)
                 {
@@ -2866,6 +4150,11 @@ ccm_screen_new (CCMDisplay * display, guint number)
     root = ccm_screen_get_root_window (self);
     ccm_window_redirect_subwindows (root);
     ccm_screen_query_stack (self);
+    self->priv->id_check_stack =
+        g_timeout_add_seconds_full (G_PRIORITY_LOW,
+                                    CCM_SCREEN_STACK_CHECK_INTERVAL,
+                                    (GSourceFunc) ccm_screen_on_check_stack,
+                                    self, NULL);
 
     _ccm_screen_query_geometry (self);
     self->priv->root_damage = ccm_region_copy (self->priv->geometry);
@@ -2913,6 +4202,25 @@ ccm_screen_get_overlay_window (CCMScreen * self)
     return self->priv->cow;
 }
 
+/**
+ * ccm_screen_get_frame:
+ * @self: #CCMScreen
+ *
+ * Get the offscreen image where a headless screen composites its frames.
+ * Frames are complete when the frame-painted signal is emitted with the
+ * region which changed since previous frame.
+ *
+ * Returns: a new reference on frame surface or %NULL if screen is not
+ * headless
+ **/
+cairo_surface_t *
+ccm_screen_get_frame (CCMScreen * self)
+{
+    g_return_val_if_fail (self != NULL, NULL);
+
+    return self->priv->frame ? cairo_surface_reference (self->priv->frame) : NULL;
+}
+
 G_GNUC_PURE CCMWindow *
 ccm_screen_get_root_window (CCMScreen * self)
 {
@@ -3062,6 +4370,259 @@ ccm_screen_get_primary_geometry (CCMScreen * self)
     return self->priv->primary_geometry;
 }
 
+/**
+ * ccm_screen_admit_animation:
+ * @self: #CCMScreen
+ * @duration: requested animation duration in milliseconds
+ *
+ * Ask screen animation governor to start an animation. When frames
+ * become too expensive or too many animations start in the same frame,
+ * the animation is shortened to the duration given to the first animation
+ * of the frame, so they all complete together. When frames already miss
+ * their deadline, the animation is skipped.
+ *
+ * Returns: duration to use in milliseconds, 0 if animation must be skipped
+ **/
+guint
+ccm_screen_admit_animation (CCMScreen * self, guint duration)
+{
+    g_return_val_if_fail (self != NULL, 0);
+
+    gdouble period = 1000.0 / MAX (self->priv->refresh_rate, 1);
+    gdouble load = MAX (self->priv->frame_load, self->priv->frame_missed * 2.0);
+    gdouble scale = 1.0;
+    guint admitted = duration;
+
+    self->priv->nb_frame_animations++;
+
+    if (load >= CCM_SCREEN_ANIMATION_SKIP_LOAD ||
+        self->priv->nb_frame_animations > CCM_SCREEN_ANIMATION_MAX_PER_FRAME)
+    {
+        self->priv->n_skipped_animations++;
+        return 0;
+    }
+
+    if (load > CCM_SCREEN_ANIMATION_SHORTEN_LOAD)
+        scale = CCM_SCREEN_ANIMATION_SHORTEN_LOAD / load;
+    if (self->priv->nb_frame_animations > CCM_SCREEN_ANIMATION_STORM)
+        scale *= (gdouble)CCM_SCREEN_ANIMATION_STORM / self->priv->nb_frame_animations;
+    admitted = (guint)(duration * scale);
+
+    // Merge with animations started in same frame
+    if (self->priv->frame_animation_duration &&
+        admitted > self->priv->frame_animation_duration)
+        admitted = self->priv->frame_animation_duration;
+
+    // Too short to be seen
+    if (admitted < period * 2)
+    {
+        self->priv->n_skipped_animations++;
+        return 0;
+    }
+
+    if (!self->priv->frame_animation_duration)
+        self->priv->frame_animation_duration = admitted;
+    if (admitted < duration)
+        self->priv->n_shortened_animations++;
+    self->priv->n_animations++;
+
+    self->priv->animation_end = MAX (self->priv->animation_end,
+                                     g_get_monotonic_time () + (gint64)admitted * 1000);
+
+    return admitted;
+}
+
+/**
+ * ccm_screen_get_animation_counters:
+ * @self: #CCMScreen
+ * @admitted: number of animations started
+ * @shortened: number of animations started with a shorter duration
+ * @skipped: number of animations skipped by governor
+ *
+ * Get animation governor counters since screen creation.
+ **/
+void
+ccm_screen_get_animation_counters (CCMScreen * self, guint64 * admitted,
+                                   guint64 * shortened, guint64 * skipped)
+{
+    g_return_if_fail (self != NULL);
+
+    if (admitted) *admitted = self->priv->n_animations;
+    if (shortened) *shortened = self->priv->n_shortened_animations;
+    if (skipped) *skipped = self->priv->n_skipped_animations;
+}
+
+/**
+ * ccm_screen_get_record_counters:
+ * @self: #CCMScreen
+ * @frames: number of frames pushed to current record
+ * @dropped: number of frames dropped because record writer was late
+ *
+ * Get counters of current screen record, counters are 0 if screen is not
+ * recorded.
+ **/
+void
+ccm_screen_get_record_counters (CCMScreen * self, guint64 * frames,
+                                guint64 * dropped)
+{
+    g_return_if_fail (self != NULL);
+
+    if (frames) *frames = 0;
+    if (dropped) *dropped = 0;
+    if (self->priv->recorder)
+        ccm_recorder_get_counters (self->priv->recorder, frames, dropped);
+}
+
+/**
+ * ccm_screen_get_memory_usage:
+ * @self: #CCMScreen
+ * @pixmaps: memory used by window pixmaps in bytes
+ * @images: memory used by client side copies of window pixmaps in bytes
+ * @shadows: memory used by shadow pixmaps and their copies in bytes
+ *
+ * Get memory currently used by window contents of screen.
+ **/
+void
+ccm_screen_get_memory_usage (CCMScreen * self, guint64 * pixmaps,
+                             guint64 * images, guint64 * shadows)
+{
+    g_return_if_fail (self != NULL);
+
+    if (pixmaps) *pixmaps = self->priv->memory[CCM_PIXMAP_MEMORY_PIXMAP];
+    if (images) *images = self->priv->memory[CCM_PIXMAP_MEMORY_IMAGE];
+    if (shadows) *shadows = self->priv->memory[CCM_PIXMAP_MEMORY_SHADOW];
+}
+
+/*
+ * Move content of window in back buffer from an area to another, window
+ * must be opaque and on top of stack and no screen plugin may modify the
+ * frame. Windows below are not repainted in destination area, exposed area
+ * must be damaged by caller.
+ */
+gboolean
+_ccm_screen_blit_window (CCMScreen * self, CCMWindow * window,
+                         const cairo_rectangle_t * from,
+                         const cairo_rectangle_t * to)
+{
+    g_return_val_if_fail (self != NULL, FALSE);
+    g_return_val_if_fail (window != NULL, FALSE);
+
+    CCMRegion *area, *outside;
+    cairo_surface_t *copy;
+    GArray *windows;
+    GList *item;
+    gboolean offscreen;
+    guint cpt;
+    cairo_t *cr;
+
+    if (!self->priv->ctx) return FALSE;
+
+    // Back buffer contains plugin overlays or transformed windows
+    if (ccm_screen_plugin_modify_frame (self->priv->plugin, self))
+        return FALSE;
+
+    for (item = self->priv->last_windows; item; item = item->prev)
+    {
+        if (!ccm_window_is_input_only (item->data) &&
+            ccm_window_is_viewable (item->data))
+            break;
+    }
+    if (!item || item->data != window) return FALSE;
+
+    // Source must be entirely in back buffer
+    outside = ccm_region_rectangle ((cairo_rectangle_t *) from);
+    if (self->priv->geometry)
+        ccm_region_subtract (outside, self->priv->geometry);
+    else
+    {
+        CCMRegion *screen = ccm_region_create (0, 0,
+                                               self->priv->xscreen->width,
+                                               self->priv->xscreen->height);
+
+        ccm_region_subtract (outside, screen);
+        ccm_region_destroy (screen);
+    }
+    offscreen = !ccm_region_empty (outside);
+    ccm_region_destroy (outside);
+    if (offscreen) return FALSE;
+
+    ccm_debug_window (window, "BLIT %f,%f -> %f,%f", from->x, from->y,
+                      to->x, to->y);
+
+    copy = cairo_surface_create_similar (cairo_get_target (self->priv->ctx),
+                                         CAIRO_CONTENT_COLOR,
+                                         from->width, from->height);
+    cr = cairo_create (copy);
+    cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
+    cairo_set_source_surface (cr, cairo_get_target (self->priv->ctx),
+                              -from->x, -from->y);
+    cairo_paint (cr);
+    cairo_destroy (cr);
+
+    cairo_save (self->priv->ctx);
+    cairo_identity_matrix (self->priv->ctx);
+    cairo_set_operator (self->priv->ctx, CAIRO_OPERATOR_SOURCE);
+    cairo_set_source_surface (self->priv->ctx, copy, to->x, to->y);
+    cairo_rectangle (self->priv->ctx, to->x, to->y, to->width, to->height);
+    cairo_fill (self->priv->ctx);
+    cairo_restore (self->priv->ctx);
+    cairo_surface_destroy (copy);
+
+    // Nothing below is visible in destination anymore
+    area = ccm_region_rectangle ((cairo_rectangle_t *) to);
+    windows = ccm_screen_get_windows_in_area (self, to, window);
+    for (cpt = 0; cpt < windows->len; ++cpt)
+        ccm_drawable_undamage_region (CCM_DRAWABLE (g_array_index (windows,
+                                                                   CCMScreenStackWindow,
+                                                                   cpt).window),
+                                      area);
+    g_array_free (windows, TRUE);
+    if (self->priv->root_damage)
+    {
+        ccm_region_subtract (self->priv->root_damage, area);
+        if (ccm_region_empty (self->priv->root_damage))
+        {
+            ccm_region_destroy (self->priv->root_damage);
+            self->priv->root_damage = NULL;
+        }
+    }
+
+    ccm_region_union_with_rect (area, (cairo_rectangle_t *) from);
+    ccm_screen_add_damaged_region (self, area);
+    ccm_region_destroy (area);
+    self->priv->blitted = TRUE;
+
+    return TRUE;
+}
+
+guint
+_ccm_screen_get_rebind_delay (CCMScreen * self)
+{
+    g_return_val_if_fail (self != NULL, 0);
+
+    return self->priv->rebind_delay;
+}
+
+gboolean
+_ccm_screen_use_shm_pixmap (CCMScreen * self)
+{
+    g_return_val_if_fail (self != NULL, FALSE);
+
+    return self->priv->use_shm_pixmap;
+}
+
+void
+_ccm_screen_add_memory (CCMScreen * self, CCMPixmapMemory type, gint64 size)
+{
+    g_return_if_fail (self != NULL);
+    g_return_if_fail (type < CCM_PIXMAP_MEMORY_N);
+
+    if (size < 0 && (guint64) -size > self->priv->memory[type])
+        self->priv->memory[type] = 0;
+    else
+        self->priv->memory[type] += size;
+}
+
 G_GNUC_PURE CCMRegion *
 ccm_screen_get_damaged (CCMScreen * self)
 {
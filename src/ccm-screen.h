@@ -54,6 +54,21 @@ GType            ccm_screen_get_type (void) G_GNUC_CONST;
 
 CCMScreenPlugin* _ccm_screen_get_plugin          (CCMScreen* self, GType type);
 Window           _ccm_screen_get_selection_owner (CCMScreen* self);
+void             _ccm_screen_prefetch_windows    (CCMScreen* self,
+                                                  const Window* windows,
+                                                  guint n_windows);
+void             _ccm_screen_invalidate_property (CCMScreen* self,
+                                                  Window xwindow,
+                                                  Atom property);
+void             _ccm_screen_add_memory          (CCMScreen* self,
+                                                  CCMPixmapMemory type,
+                                                  gint64 size);
+guint            _ccm_screen_get_rebind_delay    (CCMScreen* self);
+gboolean         _ccm_screen_use_shm_pixmap      (CCMScreen* self);
+gboolean         _ccm_screen_blit_window         (CCMScreen* self,
+                                                  CCMWindow* window,
+                                                  const cairo_rectangle_t* from,
+                                                  const cairo_rectangle_t* to);
 
 G_END_DECLS
 
@@ -20,6 +20,80 @@
 #include "ccm-debug.h"
 #include "ccm-window-plugin.h"
 
+enum
+{
+    CCM_WINDOW_PLUGIN_LOAD_OPTIONS,
+    CCM_WINDOW_PLUGIN_QUERY_GEOMETRY,
+    CCM_WINDOW_PLUGIN_PAINT,
+    CCM_WINDOW_PLUGIN_MAP,
+    CCM_WINDOW_PLUGIN_UNMAP,
+    CCM_WINDOW_PLUGIN_QUERY_OPACITY,
+    CCM_WINDOW_PLUGIN_MOVE,
+    CCM_WINDOW_PLUGIN_RESIZE,
+    CCM_WINDOW_PLUGIN_SET_OPAQUE_REGION,
+    CCM_WINDOW_PLUGIN_GET_ORIGIN,
+    CCM_WINDOW_PLUGIN_GET_PIXMAP,
+    CCM_WINDOW_PLUGIN_N_METHODS
+};
+
+/*
+ * A dispatch row is computed for each link of a window plugin chain, its
+ * vtable contains for each method the function which must be called when
+ * the method is invoked on this link (NULL if nobody implement it below or
+ * if the implementation is locked) and plugins the object which own it.
+ */
+typedef struct
+{
+    CCMWindowPluginClass vtable;
+    CCMWindowPlugin*     plugins[CCM_WINDOW_PLUGIN_N_METHODS];
+} CCMWindowPluginDispatchRow;
+
+typedef struct
+{
+    CCMWindowPlugin**           links;
+    CCMWindowPluginDispatchRow* rows;
+    guint                       n_links;
+} CCMWindowPluginDispatch;
+
+/*
+ * Window types and states on which a window plugin type applies, it is
+ * filled from the WindowTypes and WindowStates keys of the plugin
+ * description file. An empty mask means that the plugin applies on all.
+ */
+typedef struct
+{
+    guint types;
+    guint states;
+} CCMWindowPluginFilter;
+
+enum
+{
+    CCM_WINDOW_PLUGIN_STATE_MANAGED = 1 << 0,
+    CCM_WINDOW_PLUGIN_STATE_OVERRIDE_REDIRECT = 1 << 1
+};
+
+static const gchar* CCMWindowPluginTypeNames[] = {
+    "unknown",
+    "desktop",
+    "normal",
+    "dialog",
+    "splash",
+    "utility",
+    "dnd",
+    "tooltip",
+    "notification",
+    "toolbar",
+    "combo",
+    "dropdown-menu",
+    "popup-menu",
+    "menu",
+    "dock",
+    NULL
+};
+
+static GQuark CCMWindowPluginDispatchQuark;
+static GQuark CCMWindowPluginFilterQuark;
+
 static void
 ccm_window_plugin_base_init (gpointer g_class)
 {
@@ -47,6 +121,11 @@ ccm_window_plugin_get_type (void)
         ccm_window_plugin_type =
             g_type_register_static (G_TYPE_INTERFACE, "CCMWindowPlugin",
                                     &ccm_window_plugin_info, 0);
+
+        CCMWindowPluginDispatchQuark =
+            g_quark_from_static_string ("CCMWindowPluginDispatch");
+        CCMWindowPluginFilterQuark =
+            g_quark_from_static_string ("CCMWindowPluginFilter");
     }
 
     return ccm_window_plugin_type;
@@ -65,6 +144,299 @@ _ccm_window_plugin_get_root (CCMWindowPlugin * self)
     return plugin;
 }
 
+#define CCM_WINDOW_PLUGIN_DISPATCH_RESOLVE(row, below, plugin, iface, method, index) \
+{ \
+    if (iface->method) \
+    { \
+        row->vtable.method = _ccm_plugin_method_locked ((GObject *) plugin, \
+                                                        iface->method) ? \
+                             NULL : iface->method; \
+        row->plugins[index] = plugin; \
+    } \
+    else if (below) \
+    { \
+        row->vtable.method = below->vtable.method; \
+        row->plugins[index] = below->plugins[index]; \
+    } \
+    else \
+    { \
+        row->vtable.method = NULL; \
+        row->plugins[index] = NULL; \
+    } \
+}
+
+static void
+ccm_window_plugin_dispatch_update (GObject * root, CCMWindowPluginDispatch * self)
+{
+    gint cpt;
+
+    /* Resolve rows from root to the top of chain, each link inherit of
+     * resolution of the link below for methods it does not implement */
+    for (cpt = self->n_links - 1; cpt >= 0; --cpt)
+    {
+        CCMWindowPlugin *plugin = self->links[cpt];
+        CCMWindowPluginClass *iface = CCM_WINDOW_PLUGIN_GET_INTERFACE (plugin);
+        CCMWindowPluginDispatchRow *row = &self->rows[cpt];
+        CCMWindowPluginDispatchRow *below = cpt < self->n_links - 1 ? &self->rows[cpt + 1] : NULL;
+
+        row->vtable.is_window = iface->is_window;
+        CCM_WINDOW_PLUGIN_DISPATCH_RESOLVE (row, below, plugin, iface, load_options,
+                                            CCM_WINDOW_PLUGIN_LOAD_OPTIONS);
+        CCM_WINDOW_PLUGIN_DISPATCH_RESOLVE (row, below, plugin, iface, query_geometry,
+                                            CCM_WINDOW_PLUGIN_QUERY_GEOMETRY);
+        CCM_WINDOW_PLUGIN_DISPATCH_RESOLVE (row, below, plugin, iface, paint,
+                                            CCM_WINDOW_PLUGIN_PAINT);
+        CCM_WINDOW_PLUGIN_DISPATCH_RESOLVE (row, below, plugin, iface, map,
+                                            CCM_WINDOW_PLUGIN_MAP);
+        CCM_WINDOW_PLUGIN_DISPATCH_RESOLVE (row, below, plugin, iface, unmap,
+                                            CCM_WINDOW_PLUGIN_UNMAP);
+        CCM_WINDOW_PLUGIN_DISPATCH_RESOLVE (row, below, plugin, iface, query_opacity,
+                                            CCM_WINDOW_PLUGIN_QUERY_OPACITY);
+        CCM_WINDOW_PLUGIN_DISPATCH_RESOLVE (row, below, plugin, iface, move,
+                                            CCM_WINDOW_PLUGIN_MOVE);
+        CCM_WINDOW_PLUGIN_DISPATCH_RESOLVE (row, below, plugin, iface, resize,
+                                            CCM_WINDOW_PLUGIN_RESIZE);
+        CCM_WINDOW_PLUGIN_DISPATCH_RESOLVE (row, below, plugin, iface, set_opaque_region,
+                                            CCM_WINDOW_PLUGIN_SET_OPAQUE_REGION);
+        CCM_WINDOW_PLUGIN_DISPATCH_RESOLVE (row, below, plugin, iface, get_origin,
+                                            CCM_WINDOW_PLUGIN_GET_ORIGIN);
+        CCM_WINDOW_PLUGIN_DISPATCH_RESOLVE (row, below, plugin, iface, get_pixmap,
+                                            CCM_WINDOW_PLUGIN_GET_PIXMAP);
+    }
+}
+
+static void
+ccm_window_plugin_dispatch_free (CCMWindowPluginDispatch * self)
+{
+    g_slice_free1 (sizeof (CCMWindowPlugin*) * self->n_links, self->links);
+    g_slice_free1 (sizeof (CCMWindowPluginDispatchRow) * self->n_links, self->rows);
+    g_slice_free (CCMWindowPluginDispatch, self);
+}
+
+static inline CCMWindowPluginDispatchRow *
+ccm_window_plugin_get_dispatch (CCMWindowPlugin * self)
+{
+    CCMWindowPluginDispatch *dispatch;
+
+    if (CCM_IS_PLUGIN (self))
+        return (CCMWindowPluginDispatchRow *) _ccm_plugin_get_dispatch ((CCMPlugin *) self);
+
+    dispatch = g_object_get_qdata (G_OBJECT (self), CCMWindowPluginDispatchQuark);
+
+    return dispatch ? &dispatch->rows[dispatch->n_links - 1] : NULL;
+}
+
+/**
+ * _ccm_window_plugin_set_filter:
+ * @type: window plugin #GType
+ * @types: %NULL terminated list of window type names or %NULL
+ * @states: %NULL terminated list of window state names or %NULL
+ *
+ * Declare window types (normal, dialog, menu, ...) and states (managed,
+ * override-redirect) on which the plugin @type applies. A window plugin
+ * chain then only contains plugins which applies on its window.
+ **/
+void
+_ccm_window_plugin_set_filter (GType type, const gchar ** types,
+                               const gchar ** states)
+{
+    g_return_if_fail (g_type_is_a (type, CCM_TYPE_WINDOW_PLUGIN));
+
+    CCMWindowPluginFilter *filter = g_type_get_qdata (type, CCMWindowPluginFilterQuark);
+    gint cpt, id;
+
+    if (!filter)
+    {
+        filter = g_slice_new (CCMWindowPluginFilter);
+        g_type_set_qdata (type, CCMWindowPluginFilterQuark, filter);
+    }
+    filter->types = 0;
+    filter->states = 0;
+
+    for (cpt = 0; types && types[cpt]; ++cpt)
+    {
+        if (!types[cpt][0]) continue;
+
+        for (id = 0; CCMWindowPluginTypeNames[id]; ++id)
+        {
+            if (!g_ascii_strcasecmp (types[cpt], CCMWindowPluginTypeNames[id]))
+            {
+                filter->types |= 1 << id;
+                break;
+            }
+        }
+        if (!CCMWindowPluginTypeNames[id])
+            g_warning ("%s: unknown window type %s", g_type_name (type),
+                       types[cpt]);
+    }
+
+    for (cpt = 0; states && states[cpt]; ++cpt)
+    {
+        if (!states[cpt][0]) continue;
+
+        if (!g_ascii_strcasecmp (states[cpt], "managed"))
+            filter->states |= CCM_WINDOW_PLUGIN_STATE_MANAGED;
+        else if (!g_ascii_strcasecmp (states[cpt], "override-redirect"))
+            filter->states |= CCM_WINDOW_PLUGIN_STATE_OVERRIDE_REDIRECT;
+        else
+            g_warning ("%s: unknown window state %s", g_type_name (type),
+                       states[cpt]);
+    }
+}
+
+/**
+ * _ccm_window_plugin_applies:
+ * @type: window plugin #GType
+ * @hint_type: #CCMWindowType of window
+ * @managed: %TRUE if window is managed
+ *
+ * Check if the plugin @type must be instanciated in chain of a window of
+ * @hint_type type.
+ *
+ * Returns: %FALSE if plugin does not apply on window
+ **/
+gboolean
+_ccm_window_plugin_applies (GType type, CCMWindowType hint_type,
+                            gboolean managed)
+{
+    CCMWindowPluginFilter *filter = g_type_get_qdata (type, CCMWindowPluginFilterQuark);
+
+    if (!filter)
+        return TRUE;
+
+    if (filter->types && !(filter->types & (1 << hint_type)))
+        return FALSE;
+
+    return _ccm_window_plugin_applies_state (type, managed);
+}
+
+/**
+ * _ccm_window_plugin_applies_state:
+ * @type: window plugin #GType
+ * @managed: %TRUE if window is managed
+ *
+ * Check if the plugin @type applies on a window in @managed state whatever
+ * its type, used while the type of window is not yet known.
+ *
+ * Returns: %FALSE if plugin does not apply on window
+ **/
+gboolean
+_ccm_window_plugin_applies_state (GType type, gboolean managed)
+{
+    CCMWindowPluginFilter *filter = g_type_get_qdata (type, CCMWindowPluginFilterQuark);
+
+    if (!filter)
+        return TRUE;
+
+    if (filter->states &&
+        !(filter->states & (managed ? CCM_WINDOW_PLUGIN_STATE_MANAGED :
+                                      CCM_WINDOW_PLUGIN_STATE_OVERRIDE_REDIRECT)))
+        return FALSE;
+
+    return TRUE;
+}
+
+/**
+ * _ccm_window_plugin_resize_in_burst:
+ * @last: time of previous resize of window in microseconds
+ * @now: time of resize in microseconds
+ * @delay: rebind delay in milliseconds, 0 disables resize bursts
+ * @pending: %TRUE if a rebind of window is already deferred
+ *
+ * Check if a window resize belongs to a resize burst. The window and the
+ * plugins of its chain then keep their current pixmap until the size is
+ * stable for @delay.
+ *
+ * Returns: %TRUE if pixmap must be kept
+ **/
+gboolean
+_ccm_window_plugin_resize_in_burst (gint64 last, gint64 now, guint delay,
+                                    gboolean pending)
+{
+    return delay && (pending || now - last < (gint64) delay * 1000);
+}
+
+/**
+ * _ccm_window_plugin_build_dispatch:
+ * @self: top of window plugin chain
+ *
+ * Flatten the plugin chain which start at @self in a dispatch table. Each
+ * ccm_window_plugin_* call on a link of the chain is then resolved by an
+ * indexed lookup instead of walking and checking locks of each parent.
+ * The table is attached to the chain root and refreshed each time a method
+ * of the root is locked or unlocked.
+ **/
+void
+_ccm_window_plugin_build_dispatch (CCMWindowPlugin * self)
+{
+    g_return_if_fail (CCM_IS_WINDOW_PLUGIN (self));
+
+    CCMWindowPlugin *plugin, *root = _ccm_window_plugin_get_root (self);
+    CCMWindowPluginDispatch *dispatch;
+    guint cpt;
+
+    dispatch = g_object_steal_qdata (G_OBJECT (root), CCMWindowPluginDispatchQuark);
+    if (dispatch) ccm_window_plugin_dispatch_free (dispatch);
+
+    dispatch = g_slice_new (CCMWindowPluginDispatch);
+    dispatch->n_links = 1;
+    for (plugin = self; plugin != root; plugin = CCM_WINDOW_PLUGIN_PARENT (plugin))
+        dispatch->n_links++;
+
+    dispatch->links = g_slice_alloc (sizeof (CCMWindowPlugin*) * dispatch->n_links);
+    dispatch->rows = g_slice_alloc0 (sizeof (CCMWindowPluginDispatchRow) * dispatch->n_links);
+
+    plugin = self;
+    for (cpt = 0; cpt < dispatch->n_links; ++cpt)
+    {
+        dispatch->links[cpt] = plugin;
+        if (plugin != root)
+        {
+            _ccm_plugin_set_dispatch ((CCMPlugin *) plugin, &dispatch->rows[cpt]);
+            plugin = CCM_WINDOW_PLUGIN_PARENT (plugin);
+        }
+    }
+
+    ccm_window_plugin_dispatch_update (G_OBJECT (root), dispatch);
+
+    g_object_set_qdata_full (G_OBJECT (root), CCMWindowPluginDispatchQuark,
+                             dispatch, (GDestroyNotify) ccm_window_plugin_dispatch_free);
+    _ccm_plugin_set_lock_notify (G_OBJECT (root),
+                                 (CCMPluginLockNotifyFunc) ccm_window_plugin_dispatch_update,
+                                 dispatch);
+}
+
+/**
+ * _ccm_window_plugin_clear_dispatch:
+ * @self: a link of window plugin chain
+ *
+ * Remove dispatch table of the chain which contains @self, all links must
+ * be alive when it is called. ccm_window_plugin_* calls on the chain then
+ * fallback to walk it.
+ **/
+void
+_ccm_window_plugin_clear_dispatch (CCMWindowPlugin * self)
+{
+    g_return_if_fail (CCM_IS_WINDOW_PLUGIN (self));
+
+    CCMWindowPlugin *root = _ccm_window_plugin_get_root (self);
+    CCMWindowPluginDispatch *dispatch;
+    guint cpt;
+
+    dispatch = g_object_steal_qdata (G_OBJECT (root), CCMWindowPluginDispatchQuark);
+    if (dispatch)
+    {
+        _ccm_plugin_set_lock_notify (G_OBJECT (root), NULL, NULL);
+
+        for (cpt = 0; cpt < dispatch->n_links; ++cpt)
+        {
+            if (dispatch->links[cpt] != root)
+                _ccm_plugin_set_dispatch ((CCMPlugin *) dispatch->links[cpt], NULL);
+        }
+        ccm_window_plugin_dispatch_free (dispatch);
+    }
+}
+
 void
 ccm_window_plugin_load_options (CCMWindowPlugin * self, CCMWindow * window)
 {
@@ -73,6 +445,14 @@ ccm_window_plugin_load_options (CCMWindowPlugin * self, CCMWindow * window)
 
     CCMWindowPlugin *plugin;
     CCMWindowPluginClass *plugin_class;
+    CCMWindowPluginDispatchRow *row = ccm_window_plugin_get_dispatch (self);
+
+    if (row)
+    {
+        if (row->vtable.load_options)
+            row->vtable.load_options (row->plugins[CCM_WINDOW_PLUGIN_LOAD_OPTIONS], window);
+        return;
+    }
 
     for (plugin = self; plugin_class = CCM_WINDOW_PLUGIN_GET_INTERFACE (plugin), !plugin_class->is_window;
          plugin = CCM_WINDOW_PLUGIN_PARENT (plugin))
@@ -96,6 +476,14 @@ ccm_window_plugin_query_geometry (CCMWindowPlugin * self, CCMWindow * window)
 
     CCMWindowPlugin *plugin;
     CCMWindowPluginClass *plugin_class;
+    CCMWindowPluginDispatchRow *row = ccm_window_plugin_get_dispatch (self);
+
+    if (row)
+    {
+        if (row->vtable.query_geometry)
+            return row->vtable.query_geometry (row->plugins[CCM_WINDOW_PLUGIN_QUERY_GEOMETRY], window);
+        return NULL;
+    }
 
     for (plugin = self; plugin_class = CCM_WINDOW_PLUGIN_GET_INTERFACE (plugin), !plugin_class->is_window;
          plugin = CCM_WINDOW_PLUGIN_PARENT (plugin))
@@ -123,6 +511,14 @@ ccm_window_plugin_paint (CCMWindowPlugin * self, CCMWindow * window,
 
     CCMWindowPlugin *plugin;
     CCMWindowPluginClass *plugin_class;
+    CCMWindowPluginDispatchRow *row = ccm_window_plugin_get_dispatch (self);
+
+    if (row)
+    {
+        if (row->vtable.paint)
+            return row->vtable.paint (row->plugins[CCM_WINDOW_PLUGIN_PAINT], window, ctx, surface);
+        return FALSE;
+    }
 
     for (plugin = self; plugin_class = CCM_WINDOW_PLUGIN_GET_INTERFACE (plugin), !plugin_class->is_window;
          plugin = CCM_WINDOW_PLUGIN_PARENT (plugin))
@@ -148,6 +544,14 @@ ccm_window_plugin_map (CCMWindowPlugin * self, CCMWindow * window)
 
     CCMWindowPlugin *plugin;
     CCMWindowPluginClass *plugin_class;
+    CCMWindowPluginDispatchRow *row = ccm_window_plugin_get_dispatch (self);
+
+    if (row)
+    {
+        if (row->vtable.map)
+            row->vtable.map (row->plugins[CCM_WINDOW_PLUGIN_MAP], window);
+        return;
+    }
 
     for (plugin = self; plugin_class = CCM_WINDOW_PLUGIN_GET_INTERFACE (plugin), !plugin_class->is_window;
          plugin = CCM_WINDOW_PLUGIN_PARENT (plugin))
@@ -171,6 +575,14 @@ ccm_window_plugin_unmap (CCMWindowPlugin * self, CCMWindow * window)
 
     CCMWindowPlugin *plugin;
     CCMWindowPluginClass *plugin_class;
+    CCMWindowPluginDispatchRow *row = ccm_window_plugin_get_dispatch (self);
+
+    if (row)
+    {
+        if (row->vtable.unmap)
+            row->vtable.unmap (row->plugins[CCM_WINDOW_PLUGIN_UNMAP], window);
+        return;
+    }
 
     for (plugin = self; plugin_class = CCM_WINDOW_PLUGIN_GET_INTERFACE (plugin), !plugin_class->is_window;
          plugin = CCM_WINDOW_PLUGIN_PARENT (plugin))
@@ -194,6 +606,14 @@ ccm_window_plugin_query_opacity (CCMWindowPlugin * self, CCMWindow * window)
 
     CCMWindowPlugin *plugin;
     CCMWindowPluginClass *plugin_class;
+    CCMWindowPluginDispatchRow *row = ccm_window_plugin_get_dispatch (self);
+
+    if (row)
+    {
+        if (row->vtable.query_opacity)
+            row->vtable.query_opacity (row->plugins[CCM_WINDOW_PLUGIN_QUERY_OPACITY], window);
+        return;
+    }
 
     for (plugin = self; plugin_class = CCM_WINDOW_PLUGIN_GET_INTERFACE (plugin), !plugin_class->is_window;
          plugin = CCM_WINDOW_PLUGIN_PARENT (plugin))
@@ -218,6 +638,14 @@ ccm_window_plugin_move (CCMWindowPlugin * self, CCMWindow * window, int x,
 
     CCMWindowPlugin *plugin;
     CCMWindowPluginClass *plugin_class;
+    CCMWindowPluginDispatchRow *row = ccm_window_plugin_get_dispatch (self);
+
+    if (row)
+    {
+        if (row->vtable.move)
+            row->vtable.move (row->plugins[CCM_WINDOW_PLUGIN_MOVE], window, x, y);
+        return;
+    }
 
     for (plugin = self; plugin_class = CCM_WINDOW_PLUGIN_GET_INTERFACE (plugin), !plugin_class->is_window;
          plugin = CCM_WINDOW_PLUGIN_PARENT (plugin))
@@ -242,6 +670,14 @@ ccm_window_plugin_resize (CCMWindowPlugin * self, CCMWindow * window, int width,
 
     CCMWindowPlugin *plugin;
     CCMWindowPluginClass *plugin_class;
+    CCMWindowPluginDispatchRow *row = ccm_window_plugin_get_dispatch (self);
+
+    if (row)
+    {
+        if (row->vtable.resize)
+            row->vtable.resize (row->plugins[CCM_WINDOW_PLUGIN_RESIZE], window, width, height);
+        return;
+    }
 
     for (plugin = self; plugin_class = CCM_WINDOW_PLUGIN_GET_INTERFACE (plugin), !plugin_class->is_window;
          plugin = CCM_WINDOW_PLUGIN_PARENT (plugin))
@@ -266,6 +702,14 @@ ccm_window_plugin_set_opaque_region (CCMWindowPlugin * self, CCMWindow * window,
 
     CCMWindowPlugin *plugin;
     CCMWindowPluginClass *plugin_class;
+    CCMWindowPluginDispatchRow *row = ccm_window_plugin_get_dispatch (self);
+
+    if (row)
+    {
+        if (row->vtable.set_opaque_region)
+            row->vtable.set_opaque_region (row->plugins[CCM_WINDOW_PLUGIN_SET_OPAQUE_REGION], window, area);
+        return;
+    }
 
     for (plugin = self; plugin_class = CCM_WINDOW_PLUGIN_GET_INTERFACE (plugin), !plugin_class->is_window;
          plugin = CCM_WINDOW_PLUGIN_PARENT (plugin))
@@ -291,6 +735,14 @@ ccm_window_plugin_get_origin (CCMWindowPlugin * self, CCMWindow * window,
 
     CCMWindowPlugin *plugin;
     CCMWindowPluginClass *plugin_class;
+    CCMWindowPluginDispatchRow *row = ccm_window_plugin_get_dispatch (self);
+
+    if (row)
+    {
+        if (row->vtable.get_origin)
+            row->vtable.get_origin (row->plugins[CCM_WINDOW_PLUGIN_GET_ORIGIN], window, x, y);
+        return;
+    }
 
     for (plugin = self; plugin_class = CCM_WINDOW_PLUGIN_GET_INTERFACE (plugin), !plugin_class->is_window;
          plugin = CCM_WINDOW_PLUGIN_PARENT (plugin))
@@ -314,6 +766,14 @@ ccm_window_plugin_get_pixmap (CCMWindowPlugin * self, CCMWindow * window)
 
     CCMWindowPlugin *plugin;
     CCMWindowPluginClass *plugin_class;
+    CCMWindowPluginDispatchRow *row = ccm_window_plugin_get_dispatch (self);
+
+    if (row)
+    {
+        if (row->vtable.get_pixmap)
+            return row->vtable.get_pixmap (row->plugins[CCM_WINDOW_PLUGIN_GET_PIXMAP], window);
+        return NULL;
+    }
 
     for (plugin = self; plugin_class = CCM_WINDOW_PLUGIN_GET_INTERFACE (plugin), !plugin_class->is_window;
          plugin = CCM_WINDOW_PLUGIN_PARENT (plugin))
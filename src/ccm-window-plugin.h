@@ -84,7 +84,20 @@ struct _CCMWindowPluginClass
 
 GType ccm_window_plugin_get_type (void) G_GNUC_CONST;
 
-CCMWindowPlugin* _ccm_window_plugin_get_root (CCMWindowPlugin* self);
+CCMWindowPlugin* _ccm_window_plugin_get_root       (CCMWindowPlugin* self);
+void             _ccm_window_plugin_build_dispatch (CCMWindowPlugin* self);
+void             _ccm_window_plugin_clear_dispatch (CCMWindowPlugin* self);
+void             _ccm_window_plugin_set_filter     (GType type,
+                                                    const gchar** types,
+                                                    const gchar** states);
+gboolean         _ccm_window_plugin_applies        (GType type,
+                                                    CCMWindowType hint_type,
+                                                    gboolean managed);
+gboolean         _ccm_window_plugin_applies_state  (GType type,
+                                                    gboolean managed);
+gboolean         _ccm_window_plugin_resize_in_burst (gint64 last, gint64 now,
+                                                     guint delay,
+                                                     gboolean pending);
 
 void
 ccm_window_plugin_load_options (CCMWindowPlugin * self, CCMWindow * window);
@@ -0,0 +1,492 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4 -*- */
+/*
+ * ccm-window-prefetch.c
+ * Copyright (C) Nicolas Bruguier 2007-2011 <gandalfn@club-internet.fr>
+ *
+ * cairo-compmgr is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * cairo-compmgr is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Window setup prefetch: the requests needed to create a batch of windows
+ * (attributes, geometry, children and shape extents) are all sent at once
+ * and their replies are caught by a single async handler as xlib reads
+ * them. A window lookup only waits when its replies have not been read yet,
+ * so a whole batch costs one round trip instead of several per window.
+ */
+
+#include <X11/Xlibint.h>
+#include <X11/extensions/shapeproto.h>
+
+#include "ccm-debug.h"
+#include "ccm-display.h"
+#include "ccm-xid-table.h"
+#include "ccm-window-prefetch.h"
+
+enum
+{
+    CCM_WINDOW_PREFETCH_ATTRIBUTES,
+    CCM_WINDOW_PREFETCH_GEOMETRY,
+    CCM_WINDOW_PREFETCH_TREE,
+    CCM_WINDOW_PREFETCH_SHAPE,
+    CCM_WINDOW_PREFETCH_N_REQUESTS
+};
+
+typedef struct
+{
+    Window            window;
+    guint             pending;
+    gboolean          failed;
+    XWindowAttributes attribs;
+    Window*           children;
+    guint             n_children;
+    gboolean          have_shape;
+    gboolean          shaped;
+} CCMWindowPrefetchEntry;
+
+struct _CCMWindowPrefetch
+{
+    Display*                xdisplay;
+    _XAsyncHandler          async;
+    gboolean                queued;
+    gulong                  first_request;
+    gulong                  last_request;
+    guint                   n_requests;
+
+    CCMWindowPrefetchEntry* entries;
+    guint                   n_entries;
+    CCMXidTable*            index;
+
+    Window*                 managed;
+    guint                   n_managed;
+    gboolean                have_managed;
+};
+
+static void
+ccm_window_prefetch_set_geometry (CCMWindowPrefetchEntry* entry, Display* dpy,
+                                  xGetGeometryReply* reply)
+{
+    gint cpt;
+
+    entry->attribs.root = reply->root;
+    entry->attribs.x = cvtINT16toInt (reply->x);
+    entry->attribs.y = cvtINT16toInt (reply->y);
+    entry->attribs.width = reply->width;
+    entry->attribs.height = reply->height;
+    entry->attribs.border_width = reply->borderWidth;
+    entry->attribs.depth = reply->depth;
+
+    for (cpt = 0; cpt < ScreenCount (dpy); ++cpt)
+    {
+        if (RootWindow (dpy, cpt) == reply->root)
+        {
+            entry->attribs.screen = ScreenOfDisplay (dpy, cpt);
+            break;
+        }
+    }
+}
+
+static void
+ccm_window_prefetch_set_attributes (CCMWindowPrefetchEntry* entry,
+                                    Display* dpy,
+                                    xGetWindowAttributesReply* reply)
+{
+    entry->attribs.class = reply->class;
+    entry->attribs.bit_gravity = reply->bitGravity;
+    entry->attribs.win_gravity = reply->winGravity;
+    entry->attribs.backing_store = reply->backingStore;
+    entry->attribs.backing_planes = reply->backingBitPlanes;
+    entry->attribs.backing_pixel = reply->backingPixel;
+    entry->attribs.save_under = reply->saveUnder;
+    entry->attribs.colormap = reply->colormap;
+    entry->attribs.map_installed = reply->mapInstalled;
+    entry->attribs.map_state = reply->mapState;
+    entry->attribs.all_event_masks = reply->allEventMasks;
+    entry->attribs.your_event_mask = reply->yourEventMask;
+    entry->attribs.do_not_propagate_mask = reply->doNotPropagateMask;
+    entry->attribs.override_redirect = reply->override;
+    entry->attribs.visual = _XVIDtoVisual (dpy, reply->visualID);
+}
+
+static void
+ccm_window_prefetch_set_children (CCMWindowPrefetchEntry* entry, Display* dpy,
+                                  xQueryTreeReply* reply, char* buf, int len)
+{
+    gulong netbytes = reply->length << 2;
+
+    if (reply->nChildren)
+    {
+        CARD32* ids = g_new (CARD32, reply->nChildren);
+        guint cpt;
+
+        _XGetAsyncData (dpy, (char*)ids, buf, len, sizeof (xQueryTreeReply),
+                        reply->nChildren << 2, netbytes);
+
+        entry->children = g_new (Window, reply->nChildren);
+        entry->n_children = reply->nChildren;
+        for (cpt = 0; cpt < entry->n_children; ++cpt)
+            entry->children[cpt] = ids[cpt];
+
+        g_free (ids);
+    }
+    else if (netbytes)
+    {
+        _XGetAsyncData (dpy, NULL, buf, len, sizeof (xQueryTreeReply), 0,
+                        netbytes);
+    }
+}
+
+static Bool
+ccm_window_prefetch_handler (Display* dpy, xReply* rep, char* buf, int len,
+                             XPointer data)
+{
+    CCMWindowPrefetch* self = (CCMWindowPrefetch*)data;
+    CCMWindowPrefetchEntry* entry;
+    gulong seq = dpy->last_request_read;
+    guint index;
+    union
+    {
+        xError                    error;
+        xGetWindowAttributesReply attributes;
+        xGetGeometryReply         geometry;
+        xQueryTreeReply           tree;
+        xShapeQueryExtentsReply   shape;
+    } replbuf;
+
+    if (seq < self->first_request || seq > self->last_request)
+        return False;
+
+    index = seq - self->first_request;
+    entry = &self->entries[index / self->n_requests];
+    entry->pending--;
+
+    // Each request gets a reply or an error, the last one ends the batch
+    if (seq == self->last_request)
+    {
+        DeqAsyncHandler (dpy, &self->async);
+        self->queued = FALSE;
+    }
+
+    if (rep->generic.type == X_Error)
+    {
+        _XGetAsyncReply (dpy, (char*)&replbuf, rep, buf, len,
+                         (sizeof (xError) - sizeof (xReply)) >> 2, False);
+        ccm_debug ("PREFETCH ERROR 0x%lx", entry->window);
+        entry->failed = TRUE;
+        return True;
+    }
+
+    switch (index % self->n_requests)
+    {
+        case CCM_WINDOW_PREFETCH_ATTRIBUTES:
+            {
+                xGetWindowAttributesReply* reply;
+
+                reply = (xGetWindowAttributesReply*)
+                    _XGetAsyncReply (dpy, (char*)&replbuf, rep, buf, len,
+                                     (sizeof (xGetWindowAttributesReply) -
+                                      sizeof (xReply)) >> 2, True);
+                ccm_window_prefetch_set_attributes (entry, dpy, reply);
+            }
+            break;
+        case CCM_WINDOW_PREFETCH_GEOMETRY:
+            {
+                xGetGeometryReply* reply;
+
+                reply = (xGetGeometryReply*)
+                    _XGetAsyncReply (dpy, (char*)&replbuf, rep, buf, len,
+                                     (sizeof (xGetGeometryReply) -
+                                      sizeof (xReply)) >> 2, True);
+                ccm_window_prefetch_set_geometry (entry, dpy, reply);
+            }
+            break;
+        case CCM_WINDOW_PREFETCH_TREE:
+            {
+                xQueryTreeReply* reply;
+
+                reply = (xQueryTreeReply*)
+                    _XGetAsyncReply (dpy, (char*)&replbuf, rep, buf, len,
+                                     (sizeof (xQueryTreeReply) -
+                                      sizeof (xReply)) >> 2, False);
+                ccm_window_prefetch_set_children (entry, dpy, reply, buf, len);
+            }
+            break;
+        case CCM_WINDOW_PREFETCH_SHAPE:
+            {
+                xShapeQueryExtentsReply* reply;
+
+                reply = (xShapeQueryExtentsReply*)
+                    _XGetAsyncReply (dpy, (char*)&replbuf, rep, buf, len,
+                                     (sizeof (xShapeQueryExtentsReply) -
+                                      sizeof (xReply)) >> 2, True);
+                entry->have_shape = TRUE;
+                entry->shaped = reply->boundingShaped;
+            }
+            break;
+        default:
+            break;
+    }
+
+    return True;
+}
+
+static CCMWindowPrefetchEntry*
+ccm_window_prefetch_wait (CCMWindowPrefetch* self, Window window)
+{
+    CCMWindowPrefetchEntry* entry = ccm_xid_table_lookup (self->index, window);
+
+    // A sync reads all the replies of batch
+    if (entry && entry->pending && self->queued)
+        XSync (self->xdisplay, False);
+
+    return entry && !entry->pending && !entry->failed ? entry : NULL;
+}
+
+/**
+ * ccm_window_prefetch_new:
+ * @display: #CCMDisplay
+ * @windows: windows to prefetch
+ * @n_windows: number of windows
+ *
+ * Send all the requests needed to setup @windows without waiting for any
+ * reply.
+ *
+ * Returns: #CCMWindowPrefetch
+ **/
+CCMWindowPrefetch*
+ccm_window_prefetch_new (CCMDisplay* display, const Window* windows,
+                         guint n_windows)
+{
+    g_return_val_if_fail (display != NULL, NULL);
+
+    CCMWindowPrefetch* self = g_slice_new0 (CCMWindowPrefetch);
+    Display* dpy = CCM_DISPLAY_XDISPLAY (display);
+    int shape_opcode = _ccm_display_get_shape_opcode (display);
+    guint cpt;
+
+    self->xdisplay = dpy;
+    self->n_requests = shape_opcode ? CCM_WINDOW_PREFETCH_N_REQUESTS :
+                                      CCM_WINDOW_PREFETCH_SHAPE;
+    self->entries = g_new0 (CCMWindowPrefetchEntry, MAX (n_windows, 1));
+    self->index = ccm_xid_table_new (NULL);
+
+    for (cpt = 0; cpt < n_windows; ++cpt)
+    {
+        CCMWindowPrefetchEntry* entry = &self->entries[self->n_entries];
+
+        if (windows[cpt] == None ||
+            ccm_xid_table_contains (self->index, windows[cpt]))
+            continue;
+
+        entry->window = windows[cpt];
+        entry->pending = self->n_requests;
+        ccm_xid_table_insert (self->index, entry->window, entry);
+        self->n_entries++;
+    }
+
+    if (!self->n_entries) return self;
+
+    ccm_debug ("PREFETCH %i windows", self->n_entries);
+
+    LockDisplay (dpy);
+
+    self->first_request = NextRequest (dpy);
+    for (cpt = 0; cpt < self->n_entries; ++cpt)
+    {
+        Window window = self->entries[cpt].window;
+        xResourceReq* req;
+
+        GetResReq (GetWindowAttributes, window, req);
+        GetResReq (GetGeometry, window, req);
+        GetResReq (QueryTree, window, req);
+        if (shape_opcode)
+        {
+            xShapeQueryExtentsReq* shape;
+
+            GetReq (ShapeQueryExtents, shape);
+            shape->reqType = shape_opcode;
+            shape->shapeReqType = X_ShapeQueryExtents;
+            shape->window = window;
+        }
+    }
+    self->last_request = dpy->request;
+
+    self->async.next = dpy->async_handlers;
+    self->async.handler = ccm_window_prefetch_handler;
+    self->async.data = (XPointer) self;
+    dpy->async_handlers = &self->async;
+    self->queued = TRUE;
+
+    UnlockDisplay (dpy);
+    SyncHandle ();
+
+    // Server works on the batch while the caller goes on
+    XFlush (dpy);
+
+    return self;
+}
+
+void
+ccm_window_prefetch_free (CCMWindowPrefetch* self)
+{
+    g_return_if_fail (self != NULL);
+
+    guint cpt;
+
+    // Replies must not be left without handler
+    if (self->queued)
+        XSync (self->xdisplay, False);
+
+    for (cpt = 0; cpt < self->n_entries; ++cpt)
+        g_free (self->entries[cpt].children);
+    g_free (self->entries);
+    g_free (self->managed);
+    ccm_xid_table_free (self->index);
+
+    g_slice_free (CCMWindowPrefetch, self);
+}
+
+guint
+ccm_window_prefetch_get_length (CCMWindowPrefetch* self)
+{
+    g_return_val_if_fail (self != NULL, 0);
+
+    return ccm_xid_table_size (self->index);
+}
+
+gboolean
+ccm_window_prefetch_contains (CCMWindowPrefetch* self, Window window)
+{
+    g_return_val_if_fail (self != NULL, FALSE);
+
+    return ccm_xid_table_contains (self->index, window);
+}
+
+/**
+ * ccm_window_prefetch_remove:
+ * @self: #CCMWindowPrefetch
+ * @window: window
+ *
+ * Forget prefetched data of @window once it has been used, so a later
+ * window which reuses the same xid is not setup with outdated replies.
+ **/
+void
+ccm_window_prefetch_remove (CCMWindowPrefetch* self, Window window)
+{
+    g_return_if_fail (self != NULL);
+
+    ccm_xid_table_remove (self->index, window);
+}
+
+/**
+ * ccm_window_prefetch_get_attribs:
+ * @self: #CCMWindowPrefetch
+ * @window: window
+ * @attribs: #XWindowAttributes to fill
+ *
+ * Get prefetched attributes of @window, wait replies if they have not been
+ * read yet.
+ *
+ * Returns: %FALSE if window is not in prefetch or is gone
+ **/
+gboolean
+ccm_window_prefetch_get_attribs (CCMWindowPrefetch* self, Window window,
+                                 XWindowAttributes* attribs)
+{
+    g_return_val_if_fail (self != NULL, FALSE);
+    g_return_val_if_fail (attribs != NULL, FALSE);
+
+    CCMWindowPrefetchEntry* entry = ccm_window_prefetch_wait (self, window);
+
+    if (!entry) return FALSE;
+
+    *attribs = entry->attribs;
+
+    return TRUE;
+}
+
+gboolean
+ccm_window_prefetch_get_shaped (CCMWindowPrefetch* self, Window window,
+                                gboolean* shaped)
+{
+    g_return_val_if_fail (self != NULL, FALSE);
+    g_return_val_if_fail (shaped != NULL, FALSE);
+
+    CCMWindowPrefetchEntry* entry = ccm_window_prefetch_wait (self, window);
+
+    if (!entry || !entry->have_shape) return FALSE;
+
+    *shaped = entry->shaped;
+
+    return TRUE;
+}
+
+gboolean
+ccm_window_prefetch_get_children (CCMWindowPrefetch* self, Window window,
+                                  const Window** children, guint* n_children)
+{
+    g_return_val_if_fail (self != NULL, FALSE);
+    g_return_val_if_fail (children != NULL && n_children != NULL, FALSE);
+
+    CCMWindowPrefetchEntry* entry = ccm_window_prefetch_wait (self, window);
+
+    if (!entry) return FALSE;
+
+    *children = entry->children;
+    *n_children = entry->n_children;
+
+    return TRUE;
+}
+
+/**
+ * ccm_window_prefetch_get_managed:
+ * @self: #CCMWindowPrefetch
+ * @managed: managed windows
+ * @n_managed: number of managed windows
+ *
+ * Get the managed clients list shared by all windows of batch.
+ *
+ * Returns: %FALSE if list was not set yet
+ **/
+gboolean
+ccm_window_prefetch_get_managed (CCMWindowPrefetch* self,
+                                 const Window** managed, guint* n_managed)
+{
+    g_return_val_if_fail (self != NULL, FALSE);
+    g_return_val_if_fail (managed != NULL && n_managed != NULL, FALSE);
+
+    *managed = self->managed;
+    *n_managed = self->n_managed;
+
+    return self->have_managed;
+}
+
+/**
+ * ccm_window_prefetch_set_managed:
+ * @self: #CCMWindowPrefetch
+ * @managed: managed windows, the prefetch takes ownership
+ * @n_managed: number of managed windows
+ *
+ * Keep the managed clients list so it is read only once per batch.
+ **/
+void
+ccm_window_prefetch_set_managed (CCMWindowPrefetch* self, Window* managed,
+                                 guint n_managed)
+{
+    g_return_if_fail (self != NULL);
+
+    g_free (self->managed);
+    self->managed = managed;
+    self->n_managed = managed ? n_managed : 0;
+    self->have_managed = TRUE;
+}
@@ -0,0 +1,60 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4 -*- */
+/*
+ * ccm-window-prefetch.h
+ * Copyright (C) Nicolas Bruguier 2007-2011 <gandalfn@club-internet.fr>
+ *
+ * cairo-compmgr is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * cairo-compmgr is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CCM_WINDOW_PREFETCH_H_
+#define _CCM_WINDOW_PREFETCH_H_
+
+#include <glib.h>
+#include <X11/Xlib.h>
+
+#include "ccm.h"
+
+G_BEGIN_DECLS
+
+typedef struct _CCMWindowPrefetch CCMWindowPrefetch;
+
+CCMWindowPrefetch* ccm_window_prefetch_new          (CCMDisplay* display,
+                                                     const Window* windows,
+                                                     guint n_windows);
+void               ccm_window_prefetch_free         (CCMWindowPrefetch* self);
+guint              ccm_window_prefetch_get_length   (CCMWindowPrefetch* self);
+gboolean           ccm_window_prefetch_contains     (CCMWindowPrefetch* self,
+                                                     Window window);
+void               ccm_window_prefetch_remove       (CCMWindowPrefetch* self,
+                                                     Window window);
+gboolean           ccm_window_prefetch_get_attribs  (CCMWindowPrefetch* self,
+                                                     Window window,
+                                                     XWindowAttributes* attribs);
+gboolean           ccm_window_prefetch_get_shaped   (CCMWindowPrefetch* self,
+                                                     Window window,
+                                                     gboolean* shaped);
+gboolean           ccm_window_prefetch_get_children (CCMWindowPrefetch* self,
+                                                     Window window,
+                                                     const Window** children,
+                                                     guint* n_children);
+gboolean           ccm_window_prefetch_get_managed  (CCMWindowPrefetch* self,
+                                                     const Window** managed,
+                                                     guint* n_managed);
+void               ccm_window_prefetch_set_managed  (CCMWindowPrefetch* self,
+                                                     Window* managed,
+                                                     guint n_managed);
+
+G_END_DECLS
+
+#endif                          /* _CCM_WINDOW_PREFETCH_H_ */
@@ -19,12 +19,15 @@
 
 #include "ccm-window-xrender.h"
 
+#include <X11/extensions/Xfixes.h>
 #include <cairo-xlib.h>
 #include <cairo-xlib-xrender.h>
 
+#include "ccm-debug.h"
 #include "ccm-display.h"
 #include "ccm-screen.h"
 #include "ccm-pixmap.h"
+#include "ccm-image.h"
 #include "ccm-window-xrender.h"
 
 G_DEFINE_TYPE (CCMWindowXRender, ccm_window_xrender, CCM_TYPE_WINDOW);
@@ -33,6 +36,9 @@ struct _CCMWindowXRenderPrivate
 {
     cairo_surface_t* front;
     cairo_surface_t* back;
+    CCMImage*        image;
+    GC               gc;
+    XserverRegion    clip;
 };
 
 #define CCM_WINDOW_XRENDER_GET_PRIVATE(o)  \
@@ -50,6 +56,9 @@ ccm_window_xrender_init (CCMWindowXRender * self)
     self->priv = CCM_WINDOW_XRENDER_GET_PRIVATE (self);
     self->priv->front = NULL;
     self->priv->back = NULL;
+    self->priv->image = NULL;
+    self->priv->gc = NULL;
+    self->priv->clip = None;
 }
 
 static void
@@ -70,6 +79,22 @@ ccm_window_xrender_finalize (GObject * object)
         self->priv->front = NULL;
     }
 
+    if (self->priv->image)
+    {
+        ccm_image_destroy (self->priv->image);
+        self->priv->image = NULL;
+    }
+
+    if (CCM_IS_DISPLAY (display) && G_OBJECT (display)->ref_count)
+    {
+        if (self->priv->gc)
+            XFreeGC (CCM_DISPLAY_XDISPLAY (display), self->priv->gc);
+        if (self->priv->clip)
+            XFixesDestroyRegion (CCM_DISPLAY_XDISPLAY (display), self->priv->clip);
+    }
+    self->priv->gc = NULL;
+    self->priv->clip = None;
+
     G_OBJECT_CLASS (ccm_window_xrender_parent_class)->finalize (object);
 }
 
@@ -112,6 +137,42 @@ ccm_window_xrender_create_frontbuffer (CCMWindowXRender * self)
     return self->priv->front != NULL;
 }
 
+/* Back buffer is an image in shared memory which server read through
+ * a shared pixmap, cairo render directly in the memory of the pixmap */
+static void
+ccm_window_xrender_create_shm_backbuffer (CCMWindowXRender * self,
+                                          cairo_rectangle_t * geometry)
+{
+    CCMDisplay *display = ccm_drawable_get_display (CCM_DRAWABLE (self));
+    Visual *visual = ccm_drawable_get_visual (CCM_DRAWABLE (self));
+    gint depth = ccm_drawable_get_depth (CCM_DRAWABLE (self));
+
+    // Only x8r8g8b8 layout can be shared with cairo
+    if (!visual || depth != 24 || visual->red_mask != 0xff0000 ||
+        visual->green_mask != 0x00ff00 || visual->blue_mask != 0x0000ff)
+        return;
+
+    self->priv->image = ccm_image_new (display, visual, CAIRO_FORMAT_RGB24,
+                                       geometry->width, geometry->height,
+                                       depth);
+    if (self->priv->image &&
+        ccm_image_use_shm_pixmap (self->priv->image, CCM_WINDOW_XWINDOW (self)))
+    {
+        self->priv->back =
+            cairo_image_surface_create_for_data (ccm_image_get_data (self->priv->image),
+                                                 CAIRO_FORMAT_RGB24,
+                                                 ccm_image_get_width (self->priv->image),
+                                                 ccm_image_get_height (self->priv->image),
+                                                 ccm_image_get_stride (self->priv->image));
+    }
+    else if (self->priv->image)
+    {
+        ccm_debug ("SHM BACKBUFFER ERROR");
+        ccm_image_destroy (self->priv->image);
+        self->priv->image = NULL;
+    }
+}
+
 static gboolean
 ccm_window_xrender_create_backbuffer (CCMWindowXRender * self)
 {
@@ -125,16 +186,96 @@ ccm_window_xrender_create_backbuffer (CCMWindowXRender * self)
             ccm_drawable_get_geometry_clipbox (CCM_DRAWABLE (self),
                                                &geometry))
         {
-            self->priv->back = cairo_surface_create_similar(self->priv->front,
-                                                            CAIRO_CONTENT_COLOR,
-                                                            geometry.width,
-                                                            geometry.height);
+            CCMScreen *screen = ccm_drawable_get_screen (CCM_DRAWABLE (self));
+
+            if (_ccm_screen_use_shm_pixmap (screen))
+                ccm_window_xrender_create_shm_backbuffer (self, &geometry);
+
+            if (!self->priv->back)
+                self->priv->back = cairo_surface_create_similar(self->priv->front,
+                                                                CAIRO_CONTENT_COLOR,
+                                                                geometry.width,
+                                                                geometry.height);
         }
     }
 
     return self->priv->back != NULL;
 }
 
+static gboolean
+ccm_window_xrender_create_gc (CCMWindowXRender * self)
+{
+    g_return_val_if_fail (self != NULL, FALSE);
+
+    if (!self->priv->gc)
+    {
+        CCMDisplay *display = ccm_drawable_get_display (CCM_DRAWABLE (self));
+        XGCValues gcv;
+
+        gcv.graphics_exposures = False;
+        self->priv->gc = XCreateGC (CCM_DISPLAY_XDISPLAY (display),
+                                    CCM_WINDOW_XWINDOW (self),
+                                    GCGraphicsExposures, &gcv);
+        self->priv->clip = XFixesCreateRegion (CCM_DISPLAY_XDISPLAY (display),
+                                               NULL, 0);
+    }
+
+    return self->priv->gc && self->priv->clip;
+}
+
+/* Copy back buffer to window on server side, the whole back buffer is
+ * copied if region is NULL */
+static gboolean
+ccm_window_xrender_copy_backbuffer (CCMWindowXRender * self,
+                                    CCMRegion * region)
+{
+    CCMDisplay *display = ccm_drawable_get_display (CCM_DRAWABLE (self));
+    Drawable back = None;
+    gint width = 0, height = 0;
+
+    if (self->priv->image)
+    {
+        back = ccm_image_get_xpixmap (self->priv->image);
+        width = ccm_image_get_width (self->priv->image);
+        height = ccm_image_get_height (self->priv->image);
+    }
+    else if (cairo_surface_get_type (self->priv->back) == CAIRO_SURFACE_TYPE_XLIB)
+    {
+        back = cairo_xlib_surface_get_drawable (self->priv->back);
+        width = cairo_xlib_surface_get_width (self->priv->back);
+        height = cairo_xlib_surface_get_height (self->priv->back);
+    }
+
+    if (!back || !ccm_window_xrender_create_gc (self))
+        return FALSE;
+
+    if (region)
+    {
+        XRectangle *rects = NULL;
+        gint nb_rects;
+
+        ccm_region_get_xrectangles (region, &rects, &nb_rects);
+        XFixesSetRegion (CCM_DISPLAY_XDISPLAY (display), self->priv->clip,
+                         rects, nb_rects);
+        if (rects) x_rectangles_free (rects, nb_rects);
+        XFixesSetGCClipRegion (CCM_DISPLAY_XDISPLAY (display),
+                               self->priv->gc, 0, 0, self->priv->clip);
+    }
+    else
+        XSetClipMask (CCM_DISPLAY_XDISPLAY (display), self->priv->gc, None);
+
+    cairo_surface_flush (self->priv->back);
+    XCopyArea (CCM_DISPLAY_XDISPLAY (display), back,
+               CCM_WINDOW_XWINDOW (self), self->priv->gc, 0, 0,
+               width, height, 0, 0);
+
+    // Server must have read shared memory before next frame paint in it
+    if (self->priv->image)
+        ccm_display_sync (display);
+
+    return TRUE;
+}
+
 static cairo_surface_t *
 ccm_window_xrender_get_surface (CCMDrawable * drawable)
 {
@@ -166,12 +307,15 @@ ccm_window_xrender_flush (CCMDrawable * drawable)
         ccm_display_sync (display);
         ccm_screen_wait_vblank (screen);
 
-        cairo_t* ctx = cairo_create(self->priv->front);
+        if (!ccm_window_xrender_copy_backbuffer (self, NULL))
+        {
+            cairo_t* ctx = cairo_create(self->priv->front);
 
-        cairo_set_operator(ctx, CAIRO_OPERATOR_SOURCE);
-        cairo_set_source_surface(ctx, self->priv->back, 0, 0);
-        cairo_paint(ctx);
-        cairo_destroy(ctx);
+            cairo_set_operator(ctx, CAIRO_OPERATOR_SOURCE);
+            cairo_set_source_surface(ctx, self->priv->back, 0, 0);
+            cairo_paint(ctx);
+            cairo_destroy(ctx);
+        }
 
         ccm_display_flush(display);
     }
@@ -195,21 +339,18 @@ ccm_window_xrender_flush_region (CCMDrawable * drawable, CCMRegion * region)
         ccm_display_sync (display);
         ccm_screen_wait_vblank (screen);
 
-        cairo_t* ctx = cairo_create(self->priv->front);
-        cairo_rectangle_t *rects = NULL;
-        gint nb_rects, cpt;
-
-        cairo_set_operator(ctx, CAIRO_OPERATOR_SOURCE);
-        ccm_region_get_rectangles (region, &rects, &nb_rects);
-        for (cpt = 0; cpt < nb_rects; ++cpt)
-            cairo_rectangle(ctx, rects[cpt].x, rects[cpt].y,
-                            rects[cpt].width, rects[cpt].height);
-        cairo_clip(ctx);
-        if (rects) cairo_rectangles_free (rects, nb_rects);
-
-        cairo_set_source_surface(ctx, self->priv->back, 0, 0);
-        cairo_paint(ctx);
-        cairo_destroy(ctx);
+        // Back buffer is a server pixmap, copy it with damaged region set
+        // as clip of gc on server side
+        if (!ccm_window_xrender_copy_backbuffer (self, region))
+        {
+            cairo_t* ctx = cairo_create(self->priv->front);
+
+            cairo_set_operator(ctx, CAIRO_OPERATOR_SOURCE);
+            ccm_region_clip (region, ctx);
+            cairo_set_source_surface(ctx, self->priv->back, 0, 0);
+            cairo_paint(ctx);
+            cairo_destroy(ctx);
+        }
 
         ccm_display_flush(display);
     }
@@ -38,7 +38,8 @@
 #include "ccm-display.h"
 #include "ccm-screen.h"
 #include "ccm-pixmap.h"
-#include "ccm-property-async.h"
+#include "ccm-property-cache.h"
+#include "ccm-window-prefetch.h"
 
 #define MWM_HINTS_DECORATIONS (1L << 1)
 
@@ -50,6 +51,7 @@ typedef struct
 } MotifWmHints;
 
 static GQuark CCMWindowPixmapQuark;
+static GQuark CCMWindowContentQuark;
 
 static void ccm_window_iface_init (CCMWindowPluginClass * iface);
 static void ccm_window_query_geometry (CCMDrawable * drawable);
@@ -76,13 +78,10 @@ static void impl_ccm_window_get_origin (CCMWindowPlugin * plugin,
                                         CCMWindow * self, int *x, int *y);
 static CCMPixmap *impl_ccm_window_get_pixmap (CCMWindowPlugin * plugin,
                                               CCMWindow * self);
-static void ccm_window_on_property_async_error (CCMWindow * self,
-                                                CCMPropertyASync * prop);
-static void ccm_window_get_property_async (CCMWindow * self, Atom property_atom,
-                                           Atom req_type, long length);
-static void ccm_window_on_get_property_async (CCMWindow * self, guint n_items,
-                                              gchar * result,
-                                              CCMPropertyASync * property);
+static void ccm_window_query_property (CCMWindow * self, Atom property_atom,
+                                       Atom req_type, long length);
+static void ccm_window_on_get_property_async (CCMWindow * self, Atom property,
+                                              guint n_items, gchar * result);
 static void ccm_window_on_plugins_changed (CCMWindow * self,
                                            CCMScreen * screen);
 static void ccm_window_on_transient_transform_changed (CCMWindow * self,
@@ -121,6 +120,8 @@ G_DEFINE_TYPE_EXTENDED (CCMWindow, ccm_window, CCM_TYPE_DRAWABLE, 0,
 struct _CCMWindowPrivate
 {
     CCMWindowType hint_type;
+    gboolean hint_type_known;
+    guint n_hint_type_replies;
     gchar *name;
     gchar *class_name;
 
@@ -140,6 +141,8 @@ struct _CCMWindowPrivate
     gboolean is_viewable;
     gboolean visible;
     gboolean unmap_pending;
+    gboolean animation_asked;
+    guint animation_duration;
     gboolean is_shaped;
     gboolean is_shaded;
     gboolean is_fullscreen;
@@ -158,8 +161,14 @@ struct _CCMWindowPrivate
     int frame_bottom;
     gulong user_time;
 
-    GSList *properties_pending;
+    CCMPropertyCache *properties;
     CCMPixmap *pixmap;
+    CCMPixmap *content;
+    gint64 paint_time;
+    gdouble pixmap_width;
+    gdouble pixmap_height;
+    gint64 resize_time;
+    guint id_rebind;
     gboolean use_pixmap_image;
     gboolean no_undamage_sibling;
     gboolean redirect;
@@ -176,6 +185,8 @@ struct _CCMWindowPrivate
 
     gulong id_plugins_changed;
     gulong id_transient_transform_changed;
+
+    CCMWindowPrefetch* prefetch;
 };
 
 #define CCM_WINDOW_GET_PRIVATE(o)  \
@@ -279,6 +290,8 @@ ccm_window_init (CCMWindow * self)
 {
     self->priv = CCM_WINDOW_GET_PRIVATE (self);
     self->priv->hint_type = CCM_WINDOW_TYPE_NORMAL;
+    self->priv->hint_type_known = FALSE;
+    self->priv->n_hint_type_replies = 0;
     self->priv->name = NULL;
     self->priv->class_name = NULL;
     self->priv->unmanaged = FALSE;
@@ -296,6 +309,8 @@ ccm_window_init (CCMWindow * self)
     self->priv->visible = FALSE;
     self->priv->is_viewable = FALSE;
     self->priv->unmap_pending = FALSE;
+    self->priv->animation_asked = FALSE;
+    self->priv->animation_duration = 0;
     self->priv->is_shaped = FALSE;
     self->priv->is_shaded = FALSE;
     self->priv->is_fullscreen = FALSE;
@@ -315,8 +330,13 @@ ccm_window_init (CCMWindow * self)
     self->priv->frame_right = 0;
     self->priv->frame_top = 0;
     self->priv->frame_bottom = 0;
-    self->priv->properties_pending = NULL;
+    self->priv->properties = NULL;
     self->priv->pixmap = NULL;
+    self->priv->paint_time = 0;
+    self->priv->pixmap_width = 0;
+    self->priv->pixmap_height = 0;
+    self->priv->resize_time = 0;
+    self->priv->id_rebind = 0;
     self->priv->use_pixmap_image = FALSE;
     self->priv->no_undamage_sibling = FALSE;
     self->priv->redirect = TRUE;
@@ -327,6 +347,7 @@ ccm_window_init (CCMWindow * self)
     self->priv->mask_height = 0;
     self->priv->id_plugins_changed = 0;
     self->priv->id_transient_transform_changed = 0;
+    self->priv->prefetch = NULL;
 }
 
 static void
@@ -375,6 +396,11 @@ ccm_window_finalize (GObject * object)
         cairo_surface_destroy (self->priv->mask);
         self->priv->mask = NULL;
     }
+    if (self->priv->id_rebind)
+    {
+        g_source_remove (self->priv->id_rebind);
+        self->priv->id_rebind = 0;
+    }
     if (self->priv->opaque)
     {
         ccm_region_destroy (self->priv->opaque);
@@ -385,6 +411,9 @@ ccm_window_finalize (GObject * object)
         ccm_region_destroy (self->priv->orig_opaque);
         self->priv->orig_opaque = NULL;
     }
+    if (self->priv->content)
+        g_object_set_qdata (G_OBJECT (self->priv->content),
+                            CCMWindowContentQuark, NULL);
     if (self->priv->pixmap)
     {
         g_object_unref (self->priv->pixmap);
@@ -395,18 +424,17 @@ ccm_window_finalize (GObject * object)
         g_free (self->priv->name);
         self->priv->name = NULL;
     }
+    if (self->priv->plugin)
+        _ccm_window_plugin_clear_dispatch (self->priv->plugin);
     if (self->priv->plugin && CCM_IS_PLUGIN (self->priv->plugin))
     {
         g_object_unref (self->priv->plugin);
         self->priv->plugin = NULL;
     }
-    if (self->priv->properties_pending)
+    if (self->priv->properties)
     {
-        g_slist_foreach (self->priv->properties_pending,
-                         (GFunc) g_object_unref,
-                         NULL);
-        g_slist_free (self->priv->properties_pending);
-        self->priv->properties_pending = NULL;
+        ccm_property_cache_free (self->priv->properties);
+        self->priv->properties = NULL;
     }
 
     G_OBJECT_CLASS (ccm_window_parent_class)->finalize (object);
@@ -420,6 +448,7 @@ ccm_window_class_init (CCMWindowClass * klass)
     g_type_class_add_private (klass, sizeof (CCMWindowPrivate));
 
     CCMWindowPixmapQuark = g_quark_from_static_string("CCMWindowPixmap");
+    CCMWindowContentQuark = g_quark_from_static_string("CCMWindowContent");
 
     object_class->get_property = ccm_window_get_gobject_property;
     object_class->set_property = ccm_window_set_gobject_property;
@@ -690,42 +719,31 @@ ccm_window_get_state_atom_list (CCMWindow * self)
 }
 
 static void
-ccm_window_get_property_async (CCMWindow * self, Atom property_atom,
-                               Atom req_type, long length)
+ccm_window_query_property (CCMWindow * self, Atom property_atom,
+                           Atom req_type, long length)
 {
     g_return_if_fail (self != NULL);
     g_return_if_fail (property_atom != None);
+    g_return_if_fail (self->priv->properties != NULL);
 
     CCMDisplay *display = ccm_drawable_get_display (CCM_DRAWABLE (self));
-    CCMPropertyASync *property;
 
     ccm_debug_atom (display, property_atom, "GET PROPERTY");
 
     if (self->priv->child != None)
-    {
-        property = ccm_property_async_new (display, self->priv->child,
-                                           property_atom,
-                                           req_type, length);
-        g_signal_connect_swapped (property, "reply",
-                                  G_CALLBACK (ccm_window_on_get_property_async),
+        ccm_property_cache_get_async (self->priv->properties,
+                                      self->priv->child, property_atom,
+                                      req_type, length,
+                                      (CCMWindowPropertyFunc)
+                                      ccm_window_on_get_property_async,
+                                      self);
+
+    ccm_property_cache_get_async (self->priv->properties,
+                                  CCM_WINDOW_XWINDOW (self), property_atom,
+                                  req_type, length,
+                                  (CCMWindowPropertyFunc)
+                                  ccm_window_on_get_property_async,
                                   self);
-        g_signal_connect_swapped (property, "error",
-                                  G_CALLBACK
-                                  (ccm_window_on_property_async_error), self);
-        self->priv->properties_pending =
-            g_slist_prepend (self->priv->properties_pending, property);
-    }
-
-    property = ccm_property_async_new (display, CCM_WINDOW_XWINDOW (self),
-                                       property_atom, req_type, length);
-    g_signal_connect_swapped (property, "reply",
-                              G_CALLBACK (ccm_window_on_get_property_async),
-                              self);
-    g_signal_connect_swapped (property, "error",
-                              G_CALLBACK (ccm_window_on_property_async_error),
-                              self);
-    self->priv->properties_pending =
-        g_slist_prepend (self->priv->properties_pending, property);
 }
 
 static gchar *
@@ -859,6 +877,19 @@ ccm_window_get_child_text_property (CCMWindow * self, Atom atom)
     return retval;
 }
 
+static gboolean
+ccm_window_want_plugin (CCMWindow * self, GType type)
+{
+    // Type is only known on reply of server, until then the chain keeps
+    // all plugins which apply on window state
+    if (!self->priv->hint_type_known)
+        return _ccm_window_plugin_applies_state (type,
+                                                 !self->priv->override_redirect);
+
+    return _ccm_window_plugin_applies (type, self->priv->hint_type,
+                                       !self->priv->override_redirect);
+}
+
 static void
 ccm_window_get_plugins (CCMWindow * self)
 {
@@ -873,25 +904,131 @@ ccm_window_get_plugins (CCMWindow * self)
         g_object_get (G_OBJECT (screen), "window_plugins",
                       &CCM_WINDOW_GET_CLASS (self)->plugins, NULL);
 
+    if (self->priv->plugin)
+        _ccm_window_plugin_clear_dispatch (self->priv->plugin);
+
     if (self->priv->plugin && CCM_IS_PLUGIN (self->priv->plugin))
         g_object_unref (self->priv->plugin);
 
     self->priv->plugin = (CCMWindowPlugin *) self;
 
+    /* Input only windows are never painted, they don't need any plugin */
+    if (self->priv->is_input_only) return;
+
     for (item = CCM_WINDOW_GET_CLASS (self)->plugins; item; item = item->next)
     {
         GType type = GPOINTER_TO_INT (item->data);
         GObject *prev = G_OBJECT (self->priv->plugin);
-        CCMWindowPlugin *plugin = g_object_new (type, "parent", prev, "screen",
-                                                ccm_screen_get_number (screen),
-                                                NULL);
+        CCMWindowPlugin *plugin;
+
+        if (!ccm_window_want_plugin (self, type)) continue;
+
+        plugin = g_object_new (type, "parent", prev, "screen",
+                               ccm_screen_get_number (screen), NULL);
 
         if (plugin) self->priv->plugin = plugin;
     }
 
+    _ccm_window_plugin_build_dispatch (self->priv->plugin);
+
     ccm_window_plugin_load_options (self->priv->plugin, self);
 }
 
+/*
+ * Rebuild the plugin chain after a window type change: plugins which still
+ * apply are kept with their state, plugins which does not apply anymore are
+ * destroyed and missing ones are created. New plugins only get events which
+ * happen after their creation.
+ */
+static void
+ccm_window_update_plugins (CCMWindow * self)
+{
+    g_return_if_fail (self != NULL);
+
+    if (self->priv->unmanaged || self->priv->is_input_only ||
+        !self->priv->plugin)
+        return;
+
+    CCMScreen *screen = ccm_drawable_get_screen (CCM_DRAWABLE (self));
+    CCMWindowPlugin *plugin, *prev;
+    GSList *item, *link, *old = NULL;
+    gboolean changed = FALSE;
+
+    for (plugin = self->priv->plugin; plugin != (CCMWindowPlugin *) self;
+         plugin = CCM_WINDOW_PLUGIN_PARENT (plugin))
+        old = g_slist_prepend (old, plugin);
+
+    /* Check if chain content changes for the new window type */
+    link = old;
+    for (item = CCM_WINDOW_GET_CLASS (self)->plugins; item; item = item->next)
+    {
+        GType type = GPOINTER_TO_INT (item->data);
+
+        if (!ccm_window_want_plugin (self, type)) continue;
+
+        if (!link || G_OBJECT_TYPE (link->data) != type)
+        {
+            changed = TRUE;
+            break;
+        }
+        link = link->next;
+    }
+    if (!changed && !link)
+    {
+        g_slist_free (old);
+        return;
+    }
+
+    ccm_debug_window (self, "UPDATE PLUGINS");
+
+    _ccm_window_plugin_clear_dispatch (self->priv->plugin);
+
+    /* Unlink the chain, each plugin keeps the reference owned by its child */
+    for (link = old; link; link = link->next)
+        ccm_plugin_set_parent (CCM_PLUGIN (link->data), G_OBJECT (self));
+    self->priv->plugin = (CCMWindowPlugin *) self;
+
+    prev = (CCMWindowPlugin *) self;
+    for (item = CCM_WINDOW_GET_CLASS (self)->plugins; item; item = item->next)
+    {
+        GType type = GPOINTER_TO_INT (item->data);
+
+        if (!ccm_window_want_plugin (self, type)) continue;
+
+        for (link = old; link && G_OBJECT_TYPE (link->data) != type;
+             link = link->next);
+
+        if (link)
+        {
+            plugin = link->data;
+            old = g_slist_delete_link (old, link);
+        }
+        else
+        {
+            /* Load options of the new plugin alone, the plugins below are
+             * already initialized */
+            plugin = g_object_new (type, "parent", self, "screen",
+                                   ccm_screen_get_number (screen), NULL);
+            if (!plugin) continue;
+            ccm_window_plugin_load_options (plugin, self);
+        }
+
+        ccm_plugin_set_parent (CCM_PLUGIN (plugin), G_OBJECT (prev));
+        prev = plugin;
+    }
+
+    self->priv->plugin = prev;
+    _ccm_window_plugin_build_dispatch (self->priv->plugin);
+
+    /* Remaining plugins does not apply anymore, they are destroyed once the
+     * new chain is complete since they can terminate a pending map or unmap
+     * on it */
+    g_slist_foreach (old, (GFunc) g_object_unref, NULL);
+    g_slist_free (old);
+
+    ccm_drawable_query_geometry (CCM_DRAWABLE (self));
+}
+
 static void
 ccm_window_query_child (CCMWindow * self)
 {
@@ -900,25 +1037,54 @@ ccm_window_query_child (CCMWindow * self)
 
     CCMDisplay *display = ccm_drawable_get_display (CCM_DRAWABLE (self));
     CCMScreen *screen = ccm_drawable_get_screen (CCM_DRAWABLE (self));
-    Window *windows = NULL, w, p;
-    guint n_windows;
+    CCMWindowPrefetch *prefetch = self->priv->prefetch;
+    Window *windows = NULL, *tree = NULL, w, p;
+    guint n_windows = 0;
+    gboolean have_tree = FALSE;
 
     if (CCM_WINDOW_XWINDOW (self) == RootWindowOfScreen (CCM_SCREEN_XSCREEN (screen)))
         return;
 
+    // Values read on previous child are useless now
+    if (self->priv->child != None && self->priv->properties)
+        ccm_property_cache_clear (self->priv->properties);
     self->priv->child = None;
 
-    if (!self->priv->override_redirect &&
-        self->priv->hint_type != CCM_WINDOW_TYPE_DESKTOP &&
+    if (self->priv->override_redirect ||
+        self->priv->hint_type == CCM_WINDOW_TYPE_DESKTOP)
+        return;
+
+    if (prefetch)
+        have_tree = ccm_window_prefetch_get_children (prefetch,
+                                                      CCM_WINDOW_XWINDOW (self),
+                                                      (const Window **) &windows,
+                                                      &n_windows);
+    if (!have_tree &&
         XQueryTree (CCM_DISPLAY_XDISPLAY (display), CCM_WINDOW_XWINDOW (self),
-                    &w, &p, &windows, &n_windows) &&
-        n_windows > 0)
+                    &w, &p, &tree, &n_windows))
+    {
+        windows = tree;
+        have_tree = TRUE;
+    }
+
+    if (have_tree && windows && n_windows > 0)
     {
         CCMWindow *root = ccm_screen_get_root_window (screen);
         guint n_managed = 0;
-        Window *managed = (Window *) ccm_window_get_property (root,
-                                                              CCM_WINDOW_GET_CLASS (root)->client_stacking_list_atom,
-                                                              XA_WINDOW, &n_managed);
+        Window *managed = NULL;
+
+        // Managed list is read once for all windows of a prefetch
+        if (!prefetch ||
+            !ccm_window_prefetch_get_managed (prefetch,
+                                              (const Window **) &managed,
+                                              &n_managed))
+        {
+            managed = (Window *) ccm_window_get_property (root,
+                                                          CCM_WINDOW_GET_CLASS (root)->client_stacking_list_atom,
+                                                          XA_WINDOW, &n_managed);
+            if (prefetch)
+                ccm_window_prefetch_set_managed (prefetch, managed, n_managed);
+        }
 
         if (managed && n_managed)
         {
@@ -942,12 +1108,12 @@ ccm_window_query_child (CCMWindow * self)
                 }
             }
         }
-        if (managed)
+        if (managed && !prefetch)
             g_free (managed);
     }
 
-    if (windows)
-        XFree (windows);
+    if (tree)
+        XFree (tree);
 }
 
 static gboolean
@@ -957,9 +1123,19 @@ ccm_window_get_attribs (CCMWindow * self)
 
     CCMDisplay *display = ccm_drawable_get_display (CCM_DRAWABLE (self));
     XWindowAttributes attribs;
+    gboolean found;
+
+    if (self->priv->prefetch &&
+        ccm_window_prefetch_contains (self->priv->prefetch,
+                                      CCM_WINDOW_XWINDOW (self)))
+        found = ccm_window_prefetch_get_attribs (self->priv->prefetch,
+                                                 CCM_WINDOW_XWINDOW (self),
+                                                 &attribs);
+    else
+        found = XGetWindowAttributes (CCM_DISPLAY_XDISPLAY (display),
+                                      CCM_WINDOW_XWINDOW (self), &attribs);
 
-    if (!XGetWindowAttributes (CCM_DISPLAY_XDISPLAY (display),
-                               CCM_WINDOW_XWINDOW (self), &attribs))
+    if (!found)
     {
         g_signal_emit (self, signals[ERROR], 0);
         return FALSE;
@@ -1038,10 +1214,14 @@ impl_ccm_window_query_geometry (CCMWindowPlugin * plugin, CCMWindow * self)
     if (!ccm_window_get_attribs (self))
         return NULL;
 
-    if (XShapeQueryExtents (CCM_DISPLAY_XDISPLAY (display),
-                            CCM_WINDOW_XWINDOW (self),
-                            &self->priv->is_shaped, &bx, &by, &bw, &bh,
-                            &cs, &cx, &cy, &cw, &ch)
+    if (((self->priv->prefetch &&
+          ccm_window_prefetch_get_shaped (self->priv->prefetch,
+                                          CCM_WINDOW_XWINDOW (self),
+                                          &self->priv->is_shaped)) ||
+         XShapeQueryExtents (CCM_DISPLAY_XDISPLAY (display),
+                             CCM_WINDOW_XWINDOW (self),
+                             &self->priv->is_shaped, &bx, &by, &bw, &bh,
+                             &cs, &cx, &cy, &cw, &ch))
         && self->priv->is_shaped)
     {
         gint cpt, nb;
@@ -1088,6 +1268,62 @@ impl_ccm_window_query_geometry (CCMWindowPlugin * plugin, CCMWindow * self)
     return geometry;
 }
 
+/*
+ * Move painted content of an opaque window on top of stack in screen back
+ * buffer, only the exposed area below is damaged. Windows with content
+ * painted outside of their geometry like shadows, translucent or
+ * transformed windows go through damage.
+ */
+static gboolean
+ccm_window_move_blit (CCMWindow * self, CCMRegion * old_geometry,
+                      cairo_rectangle_t * geometry)
+{
+    CCMScreen *screen = ccm_drawable_get_screen (CCM_DRAWABLE (self));
+    cairo_matrix_t matrix = ccm_drawable_get_transform (CCM_DRAWABLE (self));
+    cairo_rectangle_t from, clipbox;
+    CCMRegion *exposed, *area;
+    gboolean opaque;
+
+    if (!self->priv->is_viewable || self->priv->unmap_pending ||
+        self->priv->opacity < 1.0f || self->priv->mask ||
+        !self->priv->opaque || !self->priv->pixmap ||
+        ccm_drawable_get_format (CCM_DRAWABLE (self)) == CAIRO_FORMAT_ARGB32 ||
+        ccm_drawable_is_damaged (CCM_DRAWABLE (self)))
+        return FALSE;
+
+    if (!(matrix.x0 == 0 && matrix.xy == 0 && matrix.xx == 1 &&
+          matrix.y0 == 0 && matrix.yx == 0 && matrix.yy == 1))
+        return FALSE;
+
+    if (!ccm_drawable_get_geometry_clipbox (CCM_DRAWABLE (self->priv->pixmap),
+                                            &clipbox) ||
+        clipbox.width != geometry->width || clipbox.height != geometry->height)
+        return FALSE;
+
+    area = ccm_region_rectangle (geometry);
+    exposed = ccm_region_copy (area);
+    ccm_region_subtract (exposed, self->priv->opaque);
+    opaque = ccm_region_empty (exposed);
+    ccm_region_destroy (exposed);
+
+    ccm_region_get_clipbox (old_geometry, &from);
+    if (!opaque || !_ccm_screen_blit_window (screen, self, &from, geometry))
+    {
+        ccm_region_destroy (area);
+        return FALSE;
+    }
+
+    // Only damage area uncovered by window
+    exposed = ccm_region_copy (old_geometry);
+    ccm_region_subtract (exposed, area);
+    if (!ccm_region_empty (exposed))
+        ccm_drawable_damage_region (CCM_DRAWABLE (self), exposed);
+    ccm_region_destroy (exposed);
+    ccm_region_destroy (area);
+
+    return TRUE;
+}
+
 static void
 impl_ccm_window_move (CCMWindowPlugin * plugin, CCMWindow * self, int x, int y)
 {
@@ -1113,7 +1349,8 @@ impl_ccm_window_move (CCMWindowPlugin * plugin, CCMWindow * self, int x, int y)
                                y - geometry.y);
         if ((self->priv->is_viewable || self->priv->unmap_pending) &&
             ccm_drawable_get_geometry_clipbox (CCM_DRAWABLE (self),
-                                               &geometry))
+                                               &geometry) &&
+            !ccm_window_move_blit (self, old_geometry, &geometry))
         {
             ccm_region_union_with_rect (old_geometry, &geometry);
             ccm_drawable_damage_region (CCM_DRAWABLE (self), old_geometry);
@@ -1127,6 +1364,51 @@ impl_ccm_window_move (CCMWindowPlugin * plugin, CCMWindow * self, int x, int y)
     }
 }
 
+static gboolean
+ccm_window_on_rebind_timeout (CCMWindow * self)
+{
+    self->priv->id_rebind = 0;
+
+    // Size is stable, bind pixmap of new size
+    ccm_debug_window (self, "REBIND PIXMAP");
+    if (self->priv->pixmap)
+    {
+        g_object_unref (self->priv->pixmap);
+        self->priv->pixmap = NULL;
+    }
+    ccm_drawable_damage (CCM_DRAWABLE (self));
+
+    return FALSE;
+}
+
+/*
+ * During a resize burst the current pixmap is kept and painted scaled to
+ * the new size, it is bound again only once size is stable for the rebind
+ * delay of screen
+ */
+static gboolean
+ccm_window_defer_rebind (CCMWindow * self)
+{
+    CCMScreen *screen = ccm_drawable_get_screen (CCM_DRAWABLE (self));
+    guint delay = _ccm_screen_get_rebind_delay (screen);
+    gboolean burst;
+
+    burst = _ccm_window_rebind_deferred (self);
+    self->priv->resize_time = g_get_monotonic_time ();
+
+    if (burst)
+    {
+        if (self->priv->id_rebind)
+            g_source_remove (self->priv->id_rebind);
+        self->priv->id_rebind = g_timeout_add (delay,
+                                               (GSourceFunc)
+                                               ccm_window_on_rebind_timeout,
+                                               self);
+    }
+
+    return burst;
+}
+
 static void
 impl_ccm_window_resize (CCMWindowPlugin * plugin, CCMWindow * self, int width,
                         int height)
@@ -1169,7 +1451,7 @@ impl_ccm_window_resize (CCMWindowPlugin * plugin, CCMWindow * self, int width,
             ccm_region_destroy (old_geometry);
         }
 
-        if (self->priv->pixmap)
+        if (self->priv->pixmap && !ccm_window_defer_rebind (self))
         {
             g_object_unref (self->priv->pixmap);
             self->priv->pixmap = NULL;
@@ -1387,9 +1669,9 @@ impl_ccm_window_query_opacity (CCMWindowPlugin * plugin, CCMWindow * self)
     g_return_if_fail (CCM_WINDOW_GET_CLASS (self) != NULL);
 
     ccm_debug_window (self, "QUERY OPACITY");
-    ccm_window_get_property_async (self,
-                                   CCM_WINDOW_GET_CLASS (self)->opacity_atom,
-                                   XA_CARDINAL, 32);
+    ccm_window_query_property (self,
+                               CCM_WINDOW_GET_CLASS (self)->opacity_atom,
+                               XA_CARDINAL, 32);
 }
 
 static void
@@ -1439,6 +1721,14 @@ impl_ccm_window_get_origin (CCMWindowPlugin * plugin, CCMWindow * self, int *x,
     }
 }
 
+static void
+ccm_window_on_content_destroyed (CCMWindow * self)
+{
+    g_return_if_fail (self != NULL);
+
+    self->priv->content = NULL;
+}
+
 static CCMPixmap *
 impl_ccm_window_get_pixmap (CCMWindowPlugin * plugin, CCMWindow * self)
 {
@@ -1465,6 +1755,20 @@ impl_ccm_window_get_pixmap (CCMWindowPlugin * plugin, CCMWindow * self)
         }
     }
 
+    // Plugins like shadow wrap the window content in their own pixmap,
+    // tag the real content so its damage can be mapped back to us
+    if (pixmap)
+    {
+        if (self->priv->content)
+            g_object_set_qdata (G_OBJECT (self->priv->content),
+                                CCMWindowContentQuark, NULL);
+        self->priv->content = pixmap;
+        g_object_set_qdata_full (G_OBJECT (pixmap), CCMWindowContentQuark,
+                                 self,
+                                 (GDestroyNotify)
+                                 ccm_window_on_content_destroyed);
+    }
+
     return pixmap;
 }
 
@@ -1486,35 +1790,49 @@ ccm_window_on_pixmap_damaged (CCMPixmap * pixmap, CCMRegion * area,
 }
 
 static void
-ccm_window_on_property_async_error (CCMWindow * self, CCMPropertyASync * prop)
+ccm_window_set_group_leader (CCMWindow * self, Window group_leader)
 {
-    ccm_debug ("PROPERTY ERROR");
-    self->priv->properties_pending = g_slist_remove (self->priv->properties_pending, prop);
-    g_object_unref (prop);
-}
+    CCMScreen *screen = ccm_drawable_get_screen (CCM_DRAWABLE (self));
+    CCMWindow* old = self->priv->group_leader;
+
+    if (old)
+    {
+        old->priv->group = g_slist_remove (old->priv->group, self);
+    }
+
+    self->priv->group_leader = group_leader != None ? ccm_screen_find_window_or_child(screen, group_leader) : NULL;
 
-static void
-ccm_window_on_get_property_async (CCMWindow * self, guint n_items,
-                                  gchar * result, CCMPropertyASync * prop)
-{
-    Atom property = ccm_property_async_get_property (prop);
 
-    if (!CCM_IS_WINDOW (self))
+    if (self->priv->group_leader)
     {
-        self->priv->properties_pending = g_slist_remove (self->priv->properties_pending, prop);
-        g_object_unref (prop);
-        return;
+        self->priv->group_leader->priv->group = g_slist_prepend (self->priv->group_leader->priv->group, self);
     }
 
-    g_return_if_fail (CCM_IS_PROPERTY_ASYNC (prop));
-    g_return_if_fail (CCM_WINDOW_GET_CLASS (self) != NULL);
+    ccm_debug_window(self, "GROUP LEADER 0x%lx", self->priv->group_leader);
 
+    if (old != self->priv->group_leader)
+    {
+        g_signal_emit (self, signals[PROPERTY_CHANGED], 0, CCM_PROPERTY_WM_HINTS);
+    }
+}
+
+static void
+ccm_window_on_get_property_async (CCMWindow * self, Atom property,
+                                  guint n_items, gchar * result)
+{
+    g_return_if_fail (CCM_IS_WINDOW (self));
+    g_return_if_fail (CCM_WINDOW_GET_CLASS (self) != NULL);
 
     if (property == CCM_WINDOW_GET_CLASS (self)->type_atom)
     {
+        CCMWindowType old = self->priv->hint_type;
+        gboolean known = self->priv->hint_type_known;
+
+        if (self->priv->n_hint_type_replies)
+            self->priv->n_hint_type_replies--;
+
         if (result)
         {
-            CCMWindowType old = self->priv->hint_type;
             Atom atom;
             memcpy (&atom, result, sizeof (Atom));
 
@@ -1547,12 +1865,17 @@ ccm_window_on_get_property_async (CCMWindow * self, guint n_items,
             else if (atom == CCM_WINDOW_GET_CLASS (self)->type_dnd_atom)
                 self->priv->hint_type = CCM_WINDOW_TYPE_DND;
 
-            if (old != self->priv->hint_type)
-            {
-                g_signal_emit (self, signals[PROPERTY_CHANGED], 0,
-                               CCM_PROPERTY_HINT_TYPE);
-            }
+            self->priv->hint_type_known = TRUE;
         }
+        // Neither child nor frame has a type, keep the default one
+        else if (!self->priv->n_hint_type_replies)
+            self->priv->hint_type_known = TRUE;
+
+        if (old != self->priv->hint_type || known != self->priv->hint_type_known)
+            ccm_window_update_plugins (self);
+        if (old != self->priv->hint_type)
+            g_signal_emit (self, signals[PROPERTY_CHANGED], 0,
+                           CCM_PROPERTY_HINT_TYPE);
     }
     else if (property == CCM_WINDOW_GET_CLASS (self)->transient_for_atom)
     {
@@ -1597,6 +1920,7 @@ ccm_window_on_get_property_async (CCMWindow * self, guint n_items,
                 if (self->priv->hint_type == CCM_WINDOW_TYPE_NORMAL)
                 {
                     self->priv->hint_type = CCM_WINDOW_TYPE_DIALOG;
+                    ccm_window_update_plugins (self);
                     updated = TRUE;
                 }
             }
@@ -1609,6 +1933,20 @@ ccm_window_on_get_property_async (CCMWindow * self, guint n_items,
                            CCM_PROPERTY_TRANSIENT);
         }
     }
+    else if (property == XA_WM_HINTS)
+    {
+        if (result)
+        {
+            long *hints = (long *) result;
+            Window group_leader = None;
+
+            // Window group is the last field of wire hints
+            if (n_items >= 9 && (hints[0] & WindowGroupHint))
+                group_leader = (Window) hints[8];
+
+            ccm_window_set_group_leader (self, group_leader);
+        }
+    }
     else if (property == CCM_WINDOW_GET_CLASS (self)->mwm_hints_atom)
     {
         if (result)
@@ -1704,10 +2042,6 @@ ccm_window_on_get_property_async (CCMWindow * self, guint n_items,
             }
         }
     }
-
-    self->priv->properties_pending =
-        g_slist_remove (self->priv->properties_pending, prop);
-    g_object_unref (prop);
 }
 
 static void
@@ -1957,6 +2291,75 @@ _ccm_window_get_child (CCMWindow * self)
     return self->priv->child;
 }
 
+CCMWindow*
+_ccm_window_from_pixmap (CCMPixmap * pixmap)
+{
+    g_return_val_if_fail (pixmap != NULL, NULL);
+
+    CCMWindow *window = g_object_get_qdata (G_OBJECT (pixmap),
+                                            CCMWindowPixmapQuark);
+
+    return window ? window : g_object_get_qdata (G_OBJECT (pixmap),
+                                                 CCMWindowContentQuark);
+}
+
+G_GNUC_PURE gboolean
+_ccm_window_has_pixmap (CCMWindow * self)
+{
+    g_return_val_if_fail (self != NULL, FALSE);
+
+    return self->priv->pixmap != NULL;
+}
+
+G_GNUC_PURE gint64
+_ccm_window_get_paint_time (CCMWindow * self)
+{
+    g_return_val_if_fail (self != NULL, 0);
+
+    return self->priv->paint_time;
+}
+
+/*
+ * Check if a resize of window now is in a resize burst: pixmap is then kept
+ * until size is stable. Window plugins which hold a reference on the window
+ * pixmap must keep it too, it is released when window binds the pixmap of
+ * the new size.
+ */
+gboolean
+_ccm_window_rebind_deferred (CCMWindow * self)
+{
+    g_return_val_if_fail (self != NULL, FALSE);
+
+    CCMScreen *screen = ccm_drawable_get_screen (CCM_DRAWABLE (self));
+
+    return _ccm_window_plugin_resize_in_burst (self->priv->resize_time,
+                                               g_get_monotonic_time (),
+                                               _ccm_screen_get_rebind_delay (screen),
+                                               self->priv->id_rebind != 0);
+}
+
+void
+_ccm_window_release_pixmap (CCMWindow * self)
+{
+    g_return_if_fail (self != NULL);
+
+    // Pixmap is bound again by ccm_window_get_pixmap on next paint, detach
+    // it first in case of someone else still holds a reference on it
+    if (self->priv->pixmap)
+    {
+        CCMPixmap *pixmap = self->priv->pixmap;
+
+        ccm_debug_window (self, "RELEASE PIXMAP");
+        ccm_drawable_remove_damage_func (CCM_DRAWABLE (pixmap),
+                                         (CCMDrawableDamageFunc)
+                                         ccm_window_on_pixmap_damaged,
+                                         self);
+        g_object_set_qdata (G_OBJECT (pixmap), CCMWindowPixmapQuark, NULL);
+        self->priv->pixmap = NULL;
+        g_object_unref (pixmap);
+    }
+}
+
 void
 _ccm_window_reparent(CCMWindow* self, CCMWindow* parent)
 {
@@ -1986,6 +2389,30 @@ _ccm_window_reparent(CCMWindow* self, CCMWindow* parent)
     self->priv->transients = NULL;
 }
 
+/*
+ * Events are selected before any property read so a change can not be
+ * missed by the property cache
+ */
+static void
+ccm_window_select_input (CCMWindow * self)
+{
+    CCMDisplay *display = ccm_drawable_get_display (CCM_DRAWABLE (self));
+
+    if (self->priv->is_input_only)
+    {
+        XSelectInput (CCM_DISPLAY_XDISPLAY (display), CCM_WINDOW_XWINDOW (self),
+                      PropertyChangeMask);
+        return;
+    }
+
+    XSelectInput (CCM_DISPLAY_XDISPLAY (display), CCM_WINDOW_XWINDOW (self),
+                  PropertyChangeMask | StructureNotifyMask |
+                  SubstructureNotifyMask);
+
+    XShapeSelectInput (CCM_DISPLAY_XDISPLAY (display),
+                       CCM_WINDOW_XWINDOW (self), ShapeNotifyMask);
+}
+
 /**
  * ccm_window_new:
  * @screen: #CCMScreen of window
@@ -2001,6 +2428,37 @@ ccm_window_new (CCMScreen * screen, Window xwindow)
     g_return_val_if_fail (screen != NULL, NULL);
     g_return_val_if_fail (xwindow != None, NULL);
 
+    CCMWindowPrefetch *prefetch;
+    CCMWindow *self;
+
+    prefetch = ccm_window_prefetch_new (ccm_screen_get_display (screen),
+                                        &xwindow, 1);
+    self = _ccm_window_new_from_prefetch (screen, xwindow, prefetch);
+    ccm_window_prefetch_free (prefetch);
+
+    return self;
+}
+
+/**
+ * _ccm_window_new_from_prefetch:
+ * @screen: #CCMScreen of window
+ * @xwindow: window xid
+ * @prefetch: #CCMWindowPrefetch which contains @xwindow
+ *
+ * Create a new #CCMWindow reference which point on @xwindow from the
+ * replies of @prefetch. Window is ready to be painted on return, its
+ * properties are read asynchronously.
+ *
+ * Returns: #CCMWindow
+ **/
+CCMWindow *
+_ccm_window_new_from_prefetch (CCMScreen * screen, Window xwindow,
+                               CCMWindowPrefetch * prefetch)
+{
+    g_return_val_if_fail (screen != NULL, NULL);
+    g_return_val_if_fail (xwindow != None, NULL);
+    g_return_val_if_fail (prefetch != NULL, NULL);
+
     CCMDisplay *display = ccm_screen_get_display (screen);
     CCMWindow *self = g_object_new (CCM_TYPE_WINDOW,
                                     "screen", screen,
@@ -2009,12 +2467,16 @@ ccm_window_new (CCMScreen * screen, Window xwindow)
 
     create_atoms (self);
 
-    ccm_window_get_plugins (self);
+    self->priv->properties = ccm_property_cache_new (display);
+    self->priv->prefetch = prefetch;
+
     if (!ccm_window_get_attribs (self))
     {
         g_object_unref (self);
         return NULL;
     }
+    ccm_window_select_input (self);
+    ccm_window_get_plugins (self);
 
     if (!self->priv->is_input_only)
         ccm_drawable_query_geometry (CCM_DRAWABLE (self));
@@ -2046,17 +2508,10 @@ ccm_window_new (CCMScreen * screen, Window xwindow)
         ccm_window_query_mwm_hints (self);
         ccm_window_query_state (self);
         ccm_window_query_frame_extends (self);
-
-        XSelectInput (CCM_DISPLAY_XDISPLAY (display), CCM_WINDOW_XWINDOW (self),
-                      PropertyChangeMask | StructureNotifyMask |
-                      SubstructureNotifyMask);
-
-        XShapeSelectInput (CCM_DISPLAY_XDISPLAY (display),
-                           CCM_WINDOW_XWINDOW (self), ShapeNotifyMask);
-
-        ccm_display_sync (display);
     }
 
+    self->priv->prefetch = NULL;
+
     return self;
 }
 
@@ -2076,6 +2531,8 @@ ccm_window_new_unmanaged (CCMScreen * screen, Window xwindow)
     g_return_val_if_fail (xwindow != None, NULL);
 
     CCMDisplay *display = ccm_screen_get_display (screen);
+    CCMWindowPrefetch *prefetch = ccm_window_prefetch_new (display,
+                                                           &xwindow, 1);
     CCMWindow *self = g_object_new (CCM_TYPE_WINDOW,
                                     "screen", screen,
                                     "drawable", xwindow,
@@ -2087,11 +2544,16 @@ ccm_window_new_unmanaged (CCMScreen * screen, Window xwindow)
 
     self->priv->plugin = (CCMWindowPlugin*)self;
 
+    self->priv->properties = ccm_property_cache_new (display);
+    self->priv->prefetch = prefetch;
+
     if (!ccm_window_get_attribs (self))
     {
+        ccm_window_prefetch_free (prefetch);
         g_object_unref (self);
         return NULL;
     }
+    ccm_window_select_input (self);
 
     if (!self->priv->is_input_only)
         ccm_drawable_query_geometry (CCM_DRAWABLE (self));
@@ -2106,17 +2568,11 @@ ccm_window_new_unmanaged (CCMScreen * screen, Window xwindow)
         ccm_window_query_mwm_hints (self);
         ccm_window_query_state (self);
         ccm_window_query_frame_extends (self);
-
-        XSelectInput (CCM_DISPLAY_XDISPLAY (display), CCM_WINDOW_XWINDOW (self),
-                      PropertyChangeMask | StructureNotifyMask |
-                      SubstructureNotifyMask);
-
-        XShapeSelectInput (CCM_DISPLAY_XDISPLAY (display),
-                           CCM_WINDOW_XWINDOW (self), ShapeNotifyMask);
-
-        ccm_display_sync (display);
     }
 
+    self->priv->prefetch = NULL;
+    ccm_window_prefetch_free (prefetch);
+
     return self;
 }
 
@@ -2213,9 +2669,9 @@ ccm_window_query_state (CCMWindow * self)
     g_return_if_fail (self != NULL);
     g_return_if_fail (CCM_WINDOW_GET_CLASS (self) != NULL);
 
-    ccm_window_get_property_async (self,
-                                   CCM_WINDOW_GET_CLASS (self)->state_atom,
-                                   XA_ATOM, sizeof (Atom));
+    ccm_window_query_property (self,
+                               CCM_WINDOW_GET_CLASS (self)->state_atom,
+                               XA_ATOM, sizeof (Atom));
 }
 
 gboolean
@@ -2659,6 +3115,35 @@ ccm_window_unredirect_subwindows (CCMWindow * self)
                                     CompositeRedirectManual);
 }
 
+/**
+ * ccm_window_admit_animation:
+ * @self: #CCMWindow
+ * @duration: requested animation duration in milliseconds
+ *
+ * Ask screen animation governor to start an animation of window on map or
+ * unmap. All plugins animating the same map or unmap of window share one
+ * admission, the duration is the one admitted for the first plugin.
+ *
+ * Returns: duration to use in milliseconds, 0 if animation must be skipped
+ **/
+guint
+ccm_window_admit_animation (CCMWindow * self, guint duration)
+{
+    g_return_val_if_fail (self != NULL, 0);
+
+    if (!self->priv->animation_asked)
+    {
+        CCMScreen *screen = ccm_drawable_get_screen (CCM_DRAWABLE (self));
+
+        self->priv->animation_duration = ccm_screen_admit_animation (screen,
+                                                                     duration);
+        self->priv->animation_asked = TRUE;
+        return self->priv->animation_duration;
+    }
+
+    return MIN (duration, self->priv->animation_duration);
+}
+
 G_GNUC_PURE CCMPixmap *
 ccm_window_get_pixmap (CCMWindow * self)
 {
@@ -2669,17 +3154,27 @@ ccm_window_get_pixmap (CCMWindow * self)
         self->priv->pixmap = ccm_window_plugin_get_pixmap (self->priv->plugin, self);
         if (self->priv->pixmap)
         {
+            cairo_rectangle_t geometry;
+
+            // Keep size of content to scale it during a resize burst
+            if (ccm_drawable_get_geometry_clipbox (CCM_DRAWABLE (self), &geometry))
+            {
+                self->priv->pixmap_width = geometry.width;
+                self->priv->pixmap_height = geometry.height;
+            }
+
             g_object_set_qdata_full (G_OBJECT (self->priv->pixmap),
                                      CCMWindowPixmapQuark,
                                      self,
                                      (GDestroyNotify)
                                      ccm_window_on_pixmap_destroyed);
 
-            // we connect after to be sure an eventually plugin draw before we
-            // call main window callback
-            g_signal_connect_after (self->priv->pixmap, "damaged",
-                                    G_CALLBACK (ccm_window_on_pixmap_damaged),
-                                    self);
+            // damage functions are called after damaged signal handlers so
+            // an eventually plugin draw before we call main window callback
+            ccm_drawable_add_damage_func (CCM_DRAWABLE (self->priv->pixmap),
+                                          (CCMDrawableDamageFunc)
+                                          ccm_window_on_pixmap_damaged,
+                                          self);
         }
     }
 
@@ -2753,8 +3248,7 @@ ccm_window_paint (CCMWindow * self, cairo_t * context)
                 ccm_debug_window (self, "PAINT");
 
                 cairo_save (context);
-                ccm_drawable_get_damage_path (CCM_DRAWABLE (self), context);
-                cairo_clip (context);
+                ccm_drawable_clip_damage (CCM_DRAWABLE (self), context);
                 ret = ccm_window_plugin_paint (self->priv->plugin, self,
                                                context, surface);
                 cairo_surface_destroy (surface);
@@ -2772,7 +3266,10 @@ ccm_window_paint (CCMWindow * self, cairo_t * context)
     }
 
     if (ret)
+    {
+        self->priv->paint_time = g_get_monotonic_time ();
         ccm_drawable_repair (CCM_DRAWABLE (self));
+    }
 
     return ret;
 }
@@ -2798,6 +3295,7 @@ ccm_window_map (CCMWindow * self)
             self->priv->pixmap = NULL;
         }
 
+        self->priv->animation_asked = FALSE;
         ccm_window_plugin_map (self->priv->plugin, self);
     }
 }
@@ -2818,6 +3316,7 @@ ccm_window_unmap (CCMWindow * self)
         if (self->priv->pixmap)
             ccm_pixmap_set_freeze (self->priv->pixmap, TRUE);
         ccm_debug_window (self, "WINDOW UNMAP");
+        self->priv->animation_asked = FALSE;
         ccm_window_plugin_unmap (self->priv->plugin, self);
     }
 }
@@ -2844,9 +3343,9 @@ ccm_window_query_mwm_hints (CCMWindow * self)
     g_return_if_fail (CCM_WINDOW_GET_CLASS (self) != NULL);
 
     ccm_debug_window (self, "QUERY MWM HINTS");
-    ccm_window_get_property_async (self,
-                                   CCM_WINDOW_GET_CLASS (self)->mwm_hints_atom,
-                                   AnyPropertyType, sizeof (MotifWmHints));
+    ccm_window_query_property (self,
+                               CCM_WINDOW_GET_CLASS (self)->mwm_hints_atom,
+                               AnyPropertyType, sizeof (MotifWmHints));
 }
 
 void
@@ -2856,9 +3355,9 @@ ccm_window_query_transient_for (CCMWindow * self)
     g_return_if_fail (CCM_WINDOW_GET_CLASS (self) != NULL);
 
     ccm_debug_window (self, "QUERY TRANSIENT");
-    ccm_window_get_property_async (self,
-                                   CCM_WINDOW_GET_CLASS (self)->transient_for_atom,
-                                   XA_WINDOW, sizeof (Window));
+    ccm_window_query_property (self,
+                               CCM_WINDOW_GET_CLASS (self)->transient_for_atom,
+                               XA_WINDOW, sizeof (Window));
 }
 
 void
@@ -2868,8 +3367,10 @@ ccm_window_query_hint_type (CCMWindow * self)
     g_return_if_fail (CCM_WINDOW_GET_CLASS (self) != NULL);
 
     ccm_debug_window (self, "QUERY HINT TYPE");
-    ccm_window_get_property_async (self, CCM_WINDOW_GET_CLASS (self)->type_atom,
-                                   XA_ATOM, sizeof (Atom));
+    // Type is read on child and frame, cached replies can come right away
+    self->priv->n_hint_type_replies = self->priv->child != None ? 2 : 1;
+    ccm_window_query_property (self, CCM_WINDOW_GET_CLASS (self)->type_atom,
+                               XA_ATOM, sizeof (Atom));
 }
 
 void
@@ -2877,42 +3378,9 @@ ccm_window_query_wm_hints (CCMWindow * self)
 {
     g_return_if_fail (self != NULL);
 
-    XWMHints *hints;
-    CCMDisplay *display = ccm_drawable_get_display (CCM_DRAWABLE (self));
-    CCMScreen *screen = ccm_drawable_get_screen (CCM_DRAWABLE (self));
-
-    hints = XGetWMHints (CCM_DISPLAY_XDISPLAY (display),
-                         self->priv->child ? self->priv->child : CCM_WINDOW_XWINDOW (self));
-    if (hints)
-    {
-        CCMWindow* old = self->priv->group_leader;
-        Window group_leader = None;
-
-        if (hints->flags & WindowGroupHint)
-            group_leader = hints->window_group;
-
-        if (old)
-        {
-            old->priv->group = g_slist_remove (old->priv->transients, self);
-        }
-
-        self->priv->group_leader = group_leader != None ? ccm_screen_find_window_or_child(screen, group_leader) : NULL;
-
-
-        if (self->priv->group_leader)
-        {
-            self->priv->group_leader->priv->group = g_slist_prepend (self->priv->group_leader->priv->group, self);
-        }
-
-        ccm_debug_window(self, "GROUP LEADER 0x%lx", self->priv->group_leader);
-
-        if (old != self->priv->group_leader)
-        {
-            g_signal_emit (self, signals[PROPERTY_CHANGED], 0, CCM_PROPERTY_WM_HINTS);
-        }
-
-        XFree (hints);
-    }
+    ccm_debug_window (self, "QUERY WM HINTS");
+    ccm_window_query_property (self, XA_WM_HINTS, XA_WM_HINTS,
+                               sizeof (XWMHints));
 }
 
 G_GNUC_PURE CCMWindowType
@@ -3051,9 +3519,9 @@ ccm_window_query_frame_extends (CCMWindow * self)
     g_return_if_fail (CCM_WINDOW_GET_CLASS (self) != NULL);
 
     ccm_debug_window (self, "QUERY FRAME EXTENDS");
-    ccm_window_get_property_async (self,
-                                   CCM_WINDOW_GET_CLASS (self)->frame_extends_atom,
-                                   XA_CARDINAL, 32);
+    ccm_window_query_property (self,
+                               CCM_WINDOW_GET_CLASS (self)->frame_extends_atom,
+                               XA_CARDINAL, 32);
 }
 
 void
@@ -3085,53 +3553,116 @@ ccm_window_transform (CCMWindow * self, cairo_t * ctx)
         cairo_identity_matrix (ctx);
         cairo_translate (ctx, geometry.x, geometry.y);
         cairo_transform (ctx, &matrix);
+
+        // Content of pixmap is stale during a resize burst, scale it to
+        // the current size of window
+        if (self->priv->id_rebind && self->priv->pixmap &&
+            self->priv->pixmap_width > 0 && self->priv->pixmap_height > 0 &&
+            ccm_drawable_get_geometry_clipbox (CCM_DRAWABLE (self), &geometry))
+            cairo_scale (ctx, geometry.width / self->priv->pixmap_width,
+                         geometry.height / self->priv->pixmap_height);
     }
 
     return TRUE;
 }
 
-guint32 *
-ccm_window_get_property (CCMWindow * self, Atom property_atom, Atom req_type,
-                         guint * n_items)
+static guint32 *
+ccm_window_read_property (CCMWindow * self, Window window, Atom property_atom,
+                          Atom req_type, guint * n_items)
 {
-    g_return_val_if_fail (self != NULL, NULL);
-    g_return_val_if_fail (property_atom != None, NULL);
-
     CCMDisplay *display = ccm_drawable_get_display (CCM_DRAWABLE (self));
-    int ret;
-    Atom type;
-    int format;
-    gulong n_items_internal;
-    guchar *property = NULL;
-    gulong bytes_after;
+    const gchar *cached = NULL;
+    guint n_cached = 0;
+    gsize size = 0;
     guint32 *result;
 
-    ret = XGetWindowProperty (CCM_DISPLAY_XDISPLAY (display),
-                              CCM_WINDOW_XWINDOW (self), property_atom, 0,
-                              G_MAXLONG, False, req_type, &type, &format,
-                              &n_items_internal, &bytes_after, &property);
-
-    if (ret != Success)
+    if (!self->priv->properties ||
+        !ccm_property_cache_lookup (self->priv->properties, window,
+                                    property_atom, req_type, &n_cached,
+                                    &cached, &size))
     {
-        ccm_debug ("ERROR GET  PROPERTY = %i", ret);
+        int ret;
+        Atom type;
+        int format;
+        gulong n_items_internal;
+        guchar *property = NULL;
+        gulong bytes_after;
+
+        ret = XGetWindowProperty (CCM_DISPLAY_XDISPLAY (display), window,
+                                  property_atom, 0, G_MAXLONG, False, req_type,
+                                  &type, &format, &n_items_internal,
+                                  &bytes_after, &property);
+
+        if (ret != Success)
+        {
+            ccm_debug ("ERROR GET  PROPERTY = %i", ret);
+            if (property) XFree (property);
+            g_signal_emit (self, signals[ERROR], 0);
+            return NULL;
+        }
+        ccm_debug ("PROPERTY = 0x%x, %i", property, n_items_internal);
+
+        if (format == 16)
+            size = n_items_internal * sizeof (short);
+        else if (format == 32)
+            size = n_items_internal * sizeof (long);
+        else
+            size = n_items_internal;
+
+        if (self->priv->properties)
+            ccm_property_cache_store (self->priv->properties, window,
+                                      property_atom, req_type, G_MAXLONG,
+                                      n_items_internal, (gchar *) property,
+                                      size);
+
+        // Xlib keeps values nul terminated
+        result = property ? g_memdup (property, size + 1) : NULL;
         if (property) XFree (property);
-        g_signal_emit (self, signals[ERROR], 0);
-        return NULL;
-    }
-    ccm_debug ("PROPERTY = 0x%x, %i", property, n_items_internal);
+        if (n_items) *n_items = n_items_internal;
 
-    if (req_type == CCM_WINDOW_GET_CLASS (self)->utf8_string_atom)
-        result = g_memdup (property, n_items_internal * sizeof (guchar));
-    else
-        result = g_memdup (property, n_items_internal * sizeof (gulong));
-    XFree (property);
+        return result;
+    }
 
     if (n_items)
-        *n_items = n_items_internal;
+        *n_items = n_cached;
+
+    return cached ? g_memdup (cached, size + 1) : NULL;
+}
+
+/**
+ * ccm_window_get_property:
+ * @self: #CCMWindow
+ * @property_atom: property atom
+ * @req_type: property type
+ * @n_items: number of items read
+ *
+ * Read a property of window, the value is kept until the property changes.
+ *
+ * Returns: a copy of property value to free with g_free()
+ **/
+guint32 *
+ccm_window_get_property (CCMWindow * self, Atom property_atom, Atom req_type,
+                         guint * n_items)
+{
+    g_return_val_if_fail (self != NULL, NULL);
+    g_return_val_if_fail (property_atom != None, NULL);
 
-    return result;
+    return ccm_window_read_property (self, CCM_WINDOW_XWINDOW (self),
+                                     property_atom, req_type, n_items);
 }
 
+/**
+ * ccm_window_get_child_property:
+ * @self: #CCMWindow
+ * @property_atom: property atom
+ * @req_type: property type
+ * @n_items: number of items read
+ *
+ * Read a property of window child, the value is kept until the property
+ * changes.
+ *
+ * Returns: a copy of property value to free with g_free()
+ **/
 guint32 *
 ccm_window_get_child_property (CCMWindow * self, Atom property_atom,
                                Atom req_type, guint * n_items)
@@ -3139,43 +3670,50 @@ ccm_window_get_child_property (CCMWindow * self, Atom property_atom,
     g_return_val_if_fail (self != NULL, NULL);
     g_return_val_if_fail (property_atom != None, NULL);
 
-    CCMDisplay *display = ccm_drawable_get_display (CCM_DRAWABLE (self));
-    int ret;
-    Atom type;
-    int format;
-    gulong n_items_internal;
-    guchar *property = NULL;
-    gulong bytes_after;
-    guint32 *result;
-
     if (!self->priv->child)
         return NULL;
 
-    ret = XGetWindowProperty (CCM_DISPLAY_XDISPLAY (display), self->priv->child,
-                              property_atom, 0, G_MAXLONG, False, req_type, &type,
-                              &format, &n_items_internal, &bytes_after,
-                              &property);
+    return ccm_window_read_property (self, self->priv->child, property_atom,
+                                     req_type, n_items);
+}
 
-    if (ret != Success)
-    {
-        ccm_debug ("ERROR GET  PROPERTY = %i", ret);
-        g_signal_emit (self, signals[ERROR], 0);
-        if (property)
-            XFree (property);
-        return NULL;
-    }
+/**
+ * ccm_window_get_property_async:
+ * @self: #CCMWindow
+ * @property_atom: property atom
+ * @req_type: property type
+ * @length: length in long to read
+ * @func: function called with property value
+ * @data: user data
+ *
+ * Read a property of window child or of window if it has no child. @func
+ * is called immediately if the value is cached else when server replies,
+ * with a %NULL value if the property does not exist. Plugins reading the
+ * same property share the same request.
+ **/
+void
+ccm_window_get_property_async (CCMWindow * self, Atom property_atom,
+                               Atom req_type, long length,
+                               CCMWindowPropertyFunc func, gpointer data)
+{
+    g_return_if_fail (self != NULL);
+    g_return_if_fail (property_atom != None);
+    g_return_if_fail (func != NULL);
 
-    ccm_debug ("PROPERTY = 0x%x, %i", property, n_items_internal);
-    if (req_type == CCM_WINDOW_GET_CLASS (self)->utf8_string_atom)
-        result = g_memdup (property, n_items_internal * sizeof (guchar));
-    else
-        result = g_memdup (property, n_items_internal * sizeof (gulong));
-    XFree (property);
+    Window window = self->priv->child ? self->priv->child :
+                                        CCM_WINDOW_XWINDOW (self);
 
-    if (n_items)
-        *n_items = n_items_internal;
+    ccm_property_cache_get_async (self->priv->properties, window,
+                                  property_atom, req_type, length, func, data);
+}
+
+void
+_ccm_window_invalidate_property (CCMWindow * self, Atom property_atom)
+{
+    g_return_if_fail (self != NULL);
 
-    return result;
+    if (self->priv->properties)
+        ccm_property_cache_invalidate (self->priv->properties, property_atom);
 }
 
 G_GNUC_PURE gboolean
@@ -25,6 +25,7 @@
 #include "ccm.h"
 #include "ccm-drawable.h"
 #include "ccm-window-plugin.h"
+#include "ccm-window-prefetch.h"
 
 G_BEGIN_DECLS
 
@@ -117,7 +118,17 @@ GType            ccm_window_get_type (void) G_GNUC_CONST;
 
 CCMWindowPlugin* _ccm_window_get_plugin (CCMWindow* self, GType type);
 Window           _ccm_window_get_child  (CCMWindow* self);
+CCMWindow*       _ccm_window_from_pixmap (CCMPixmap* pixmap);
+gboolean         _ccm_window_has_pixmap (CCMWindow* self);
+gint64           _ccm_window_get_paint_time (CCMWindow* self);
+void             _ccm_window_release_pixmap (CCMWindow* self);
+gboolean         _ccm_window_rebind_deferred (CCMWindow* self);
+void             _ccm_window_invalidate_property (CCMWindow* self,
+                                                  Atom property_atom);
 void             _ccm_window_reparent   (CCMWindow* self, CCMWindow* parent);
+CCMWindow*       _ccm_window_new_from_prefetch (CCMScreen* screen,
+                                                Window xwindow,
+                                                CCMWindowPrefetch* prefetch);
 
 G_END_DECLS
 
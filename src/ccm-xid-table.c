@@ -0,0 +1,280 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4 -*- */
+/*
+ * ccm-xid-table.c
+ * Copyright (C) Nicolas Bruguier 2007-2011 <gandalfn@club-internet.fr>
+ *
+ * cairo-compmgr is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * cairo-compmgr is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Open addressing hash table keyed by XID with linear probing. Entries are
+ * stored inline in a power of two array so insert and remove never
+ * allocate except when the table grows. None is never a valid key and
+ * marks empty slots, removal shifts back the following entries of the
+ * probe sequence instead of leaving tombstones.
+ */
+
+#include <string.h>
+
+#include "ccm-xid-table.h"
+
+#define CCM_XID_TABLE_MIN_BITS 4
+#define CCM_XID_TABLE_MIN_SIZE (1 << CCM_XID_TABLE_MIN_BITS)
+
+typedef struct
+{
+    XID      xid;
+    gpointer value;
+} CCMXidTableEntry;
+
+struct _CCMXidTable
+{
+    CCMXidTableEntry* entries;
+    guint             mask;
+    guint             shift;
+    guint             nb_entries;
+    GDestroyNotify    value_destroy;
+};
+
+static inline guint
+ccm_xid_table_hash (CCMXidTable* self, XID xid)
+{
+    /* Fibonacci hashing, keep the high bits of the product */
+    return ((guint32)xid * 2654435769U) >> self->shift;
+}
+
+static inline guint
+ccm_xid_table_find (CCMXidTable* self, XID xid)
+{
+    guint pos = ccm_xid_table_hash (self, xid);
+
+    while (self->entries[pos].xid != None && self->entries[pos].xid != xid)
+        pos = (pos + 1) & self->mask;
+
+    return pos;
+}
+
+static void
+ccm_xid_table_grow (CCMXidTable* self)
+{
+    CCMXidTableEntry* old = self->entries;
+    guint old_size = self->mask + 1, size = old_size * 2, cpt;
+
+    self->entries = g_new0 (CCMXidTableEntry, size);
+    self->mask = size - 1;
+    self->shift--;
+
+    for (cpt = 0; cpt < old_size; ++cpt)
+    {
+        if (old[cpt].xid != None)
+            self->entries[ccm_xid_table_find (self, old[cpt].xid)] = old[cpt];
+    }
+
+    g_free (old);
+}
+
+CCMXidTable*
+ccm_xid_table_new (GDestroyNotify value_destroy)
+{
+    CCMXidTable* self = g_slice_new (CCMXidTable);
+
+    self->entries = g_new0 (CCMXidTableEntry, CCM_XID_TABLE_MIN_SIZE);
+    self->mask = CCM_XID_TABLE_MIN_SIZE - 1;
+    self->shift = 32 - CCM_XID_TABLE_MIN_BITS;
+    self->nb_entries = 0;
+    self->value_destroy = value_destroy;
+
+    return self;
+}
+
+void
+ccm_xid_table_free (CCMXidTable* self)
+{
+    g_return_if_fail (self != NULL);
+
+    ccm_xid_table_remove_all (self);
+    g_free (self->entries);
+    g_slice_free (CCMXidTable, self);
+}
+
+guint
+ccm_xid_table_size (CCMXidTable* self)
+{
+    g_return_val_if_fail (self != NULL, 0);
+
+    return self->nb_entries;
+}
+
+gpointer
+ccm_xid_table_lookup (CCMXidTable* self, XID xid)
+{
+    g_return_val_if_fail (self != NULL, NULL);
+
+    if (xid == None) return NULL;
+
+    return self->entries[ccm_xid_table_find (self, xid)].value;
+}
+
+gboolean
+ccm_xid_table_contains (CCMXidTable* self, XID xid)
+{
+    g_return_val_if_fail (self != NULL, FALSE);
+
+    if (xid == None) return FALSE;
+
+    return self->entries[ccm_xid_table_find (self, xid)].xid == xid;
+}
+
+/**
+ * ccm_xid_table_insert:
+ * @self: #CCMXidTable
+ * @xid: key
+ * @value: value associated to @xid
+ *
+ * Insert or replace the value associated to @xid.
+ *
+ * Returns: %TRUE if @xid was not in table
+ **/
+gboolean
+ccm_xid_table_insert (CCMXidTable* self, XID xid, gpointer value)
+{
+    g_return_val_if_fail (self != NULL, FALSE);
+    g_return_val_if_fail (xid != None, FALSE);
+
+    guint pos = ccm_xid_table_find (self, xid);
+
+    if (self->entries[pos].xid == xid)
+    {
+        gpointer old = self->entries[pos].value;
+
+        self->entries[pos].value = value;
+        if (old != value && self->value_destroy && old)
+            self->value_destroy (old);
+
+        return FALSE;
+    }
+
+    /* Keep load factor under 3/4 */
+    if ((self->nb_entries + 1) * 4 > (self->mask + 1) * 3)
+    {
+        ccm_xid_table_grow (self);
+        pos = ccm_xid_table_find (self, xid);
+    }
+
+    self->entries[pos].xid = xid;
+    self->entries[pos].value = value;
+    self->nb_entries++;
+
+    return TRUE;
+}
+
+/**
+ * ccm_xid_table_remove:
+ * @self: #CCMXidTable
+ * @xid: key
+ *
+ * Remove @xid from table and destroy its value.
+ *
+ * Returns: %TRUE if @xid was found
+ **/
+gboolean
+ccm_xid_table_remove (CCMXidTable* self, XID xid)
+{
+    g_return_val_if_fail (self != NULL, FALSE);
+
+    guint pos, next;
+    gpointer value;
+
+    if (xid == None) return FALSE;
+
+    pos = ccm_xid_table_find (self, xid);
+    if (self->entries[pos].xid != xid) return FALSE;
+
+    value = self->entries[pos].value;
+
+    /* Shift back entries which can not be found anymore once pos is empty */
+    for (next = (pos + 1) & self->mask; self->entries[next].xid != None;
+         next = (next + 1) & self->mask)
+    {
+        guint home = ccm_xid_table_hash (self, self->entries[next].xid);
+
+        if (pos <= next ? (pos < home && home <= next) :
+                          (pos < home || home <= next))
+            continue;
+
+        self->entries[pos] = self->entries[next];
+        pos = next;
+    }
+    self->entries[pos].xid = None;
+    self->entries[pos].value = NULL;
+    self->nb_entries--;
+
+    if (self->value_destroy && value)
+        self->value_destroy (value);
+
+    return TRUE;
+}
+
+/**
+ * ccm_xid_table_remove_all:
+ * @self: #CCMXidTable
+ *
+ * Remove all entries of table, the table keeps its size so it can be
+ * filled again without any allocation.
+ **/
+void
+ccm_xid_table_remove_all (CCMXidTable* self)
+{
+    g_return_if_fail (self != NULL);
+
+    guint cpt;
+
+    if (!self->nb_entries) return;
+
+    if (self->value_destroy)
+    {
+        for (cpt = 0; cpt <= self->mask; ++cpt)
+        {
+            if (self->entries[cpt].xid != None && self->entries[cpt].value)
+                self->value_destroy (self->entries[cpt].value);
+        }
+    }
+
+    memset (self->entries, 0, sizeof (CCMXidTableEntry) * (self->mask + 1));
+    self->nb_entries = 0;
+}
+
+/**
+ * ccm_xid_table_foreach:
+ * @self: #CCMXidTable
+ * @func: function called for each entry
+ * @data: user data
+ *
+ * Call @func for each entry of table, the table must not be modified
+ * during iteration.
+ **/
+void
+ccm_xid_table_foreach (CCMXidTable* self, CCMXidTableFunc func, gpointer data)
+{
+    g_return_if_fail (self != NULL);
+    g_return_if_fail (func != NULL);
+
+    guint cpt;
+
+    for (cpt = 0; cpt <= self->mask; ++cpt)
+    {
+        if (self->entries[cpt].xid != None)
+            func (self->entries[cpt].xid, self->entries[cpt].value, data);
+    }
+}
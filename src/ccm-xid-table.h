@@ -0,0 +1,46 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4 -*- */
+/*
+ * ccm-xid-table.h
+ * Copyright (C) Nicolas Bruguier 2007-2011 <gandalfn@club-internet.fr>
+ *
+ * cairo-compmgr is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * cairo-compmgr is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CCM_XID_TABLE_H_
+#define _CCM_XID_TABLE_H_
+
+#include <glib.h>
+#include <X11/X.h>
+
+G_BEGIN_DECLS
+
+typedef struct _CCMXidTable CCMXidTable;
+
+typedef void (*CCMXidTableFunc) (XID xid, gpointer value, gpointer data);
+
+CCMXidTable* ccm_xid_table_new        (GDestroyNotify value_destroy);
+void         ccm_xid_table_free       (CCMXidTable* self);
+guint        ccm_xid_table_size       (CCMXidTable* self);
+gpointer     ccm_xid_table_lookup     (CCMXidTable* self, XID xid);
+gboolean     ccm_xid_table_contains   (CCMXidTable* self, XID xid);
+gboolean     ccm_xid_table_insert     (CCMXidTable* self, XID xid,
+                                       gpointer value);
+gboolean     ccm_xid_table_remove     (CCMXidTable* self, XID xid);
+void         ccm_xid_table_remove_all (CCMXidTable* self);
+void         ccm_xid_table_foreach    (CCMXidTable* self,
+                                       CCMXidTableFunc func, gpointer data);
+
+G_END_DECLS
+
+#endif                          /* _CCM_XID_TABLE_H_ */
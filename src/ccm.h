@@ -79,6 +79,14 @@ typedef struct _CCMWindow CCMWindow;
 /******************************************************************************/
 
 /******************************** Pixmap **************************************/
+typedef enum
+{
+    CCM_PIXMAP_MEMORY_PIXMAP,
+    CCM_PIXMAP_MEMORY_IMAGE,
+    CCM_PIXMAP_MEMORY_SHADOW,
+    CCM_PIXMAP_MEMORY_N
+} CCMPixmapMemory;
+
 typedef struct _CCMPixmapClass CCMPixmapClass;
 typedef struct _CCMPixmap CCMPixmap;
 /******************************************************************************/
@@ -104,6 +112,7 @@ void          ccm_region_get_rectangles   (CCMRegion* self,
                                            cairo_rectangle_t** rectangles,
                                            gint* n_rectangles);
 CCMRegionBox* ccm_region_get_boxes        (CCMRegion* self, gint* n_box);
+void          ccm_region_clip             (CCMRegion* self, cairo_t* context);
 void          ccm_region_get_xrectangles  (CCMRegion* self,
                                            XRectangle** rectangles,
                                            gint* n_rectangles);
@@ -149,6 +158,18 @@ G_GNUC_PURE Display*    ccm_display_get_xdisplay    (CCMDisplay* self);
 G_GNUC_PURE CCMScreen*  ccm_display_get_screen      (CCMDisplay* self,
                                                      guint number);
 G_GNUC_PURE int         ccm_display_get_shape_notify_event_type (CCMDisplay* self);
+void                    ccm_display_get_event_counters (CCMDisplay* self,
+                                                        guint64* received,
+                                                        guint64* dropped);
+void                    ccm_display_get_io_counters (CCMDisplay* self,
+                                                     guint64* reads,
+                                                     guint64* frames);
+void                    ccm_display_get_property_cache_counters (CCMDisplay* self,
+                                                                 guint64* hits,
+                                                                 guint64* misses);
+void                    ccm_display_get_copy_counters (CCMDisplay* self,
+                                                       guint64* bytes,
+                                                       guint64* frames);
 void                    ccm_display_flush           (CCMDisplay* self);
 void                    ccm_display_sync            (CCMDisplay* self);
 void                    ccm_display_grab            (CCMDisplay* self);
@@ -175,6 +196,7 @@ G_GNUC_PURE guint       ccm_screen_get_number           (CCMScreen* self);
 G_GNUC_PURE guint       ccm_screen_get_refresh_rate     (CCMScreen* self);
 G_GNUC_PURE CCMWindow*  ccm_screen_get_root_window      (CCMScreen* self);
 G_GNUC_PURE CCMWindow*  ccm_screen_get_overlay_window   (CCMScreen* self);
+cairo_surface_t*        ccm_screen_get_frame            (CCMScreen* self);
 gboolean                ccm_screen_add_window           (CCMScreen* self,
                                                          CCMWindow* window);
 void                    ccm_screen_remove_window        (CCMScreen* self,
@@ -207,9 +229,25 @@ void                    ccm_screen_wait_vblank          (CCMScreen* self);
 G_GNUC_PURE gboolean    ccm_screen_get_redirect_input   (CCMScreen* self);
 void                    ccm_screen_set_redirect_input   (CCMScreen* self, gboolean redirect_input);
 G_GNUC_PURE CCMRegion* ccm_screen_get_primary_geometry  (CCMScreen * self);
+guint                   ccm_screen_admit_animation      (CCMScreen* self,
+                                                         guint duration);
+void                    ccm_screen_get_animation_counters (CCMScreen* self,
+                                                           guint64* admitted,
+                                                           guint64* shortened,
+                                                           guint64* skipped);
+void                    ccm_screen_get_record_counters  (CCMScreen* self,
+                                                         guint64* frames,
+                                                         guint64* dropped);
+void                    ccm_screen_get_memory_usage     (CCMScreen* self,
+                                                         guint64* pixmaps,
+                                                         guint64* images,
+                                                         guint64* shadows);
 /******************************************************************************/
 
 /****************************** Drawable**************************************/
+typedef void (*CCMDrawableDamageFunc) (CCMDrawable* drawable, CCMRegion* area,
+                                       gpointer data);
+
 G_GNUC_PURE CCMScreen*  ccm_drawable_get_screen         (CCMDrawable* self);
 G_GNUC_PURE CCMDisplay* ccm_drawable_get_display        (CCMDrawable* self);
 G_GNUC_PURE XID         ccm_drawable_get_xid            (CCMDrawable* self);
@@ -235,6 +273,12 @@ void                    ccm_drawable_damage_region      (CCMDrawable* self,
 void                    ccm_drawable_damage_region_silently (CCMDrawable* self,
                                                              const CCMRegion* area);
 void                    ccm_drawable_damage             (CCMDrawable* self);
+void                    ccm_drawable_add_damage_func    (CCMDrawable* self,
+                                                         CCMDrawableDamageFunc func,
+                                                         gpointer data);
+void                    ccm_drawable_remove_damage_func (CCMDrawable* self,
+                                                         CCMDrawableDamageFunc func,
+                                                         gpointer data);
 void                    ccm_drawable_undamage_region    (CCMDrawable* self,
                                                          CCMRegion* region);
 void                    ccm_drawable_repair             (CCMDrawable* self);
@@ -251,6 +295,8 @@ cairo_path_t*           ccm_drawable_get_geometry_path (CCMDrawable* self,
                                                         cairo_t* context);
 void                    ccm_drawable_get_damage_path    (CCMDrawable* self,
                                                          cairo_t* context);
+void                    ccm_drawable_clip_damage        (CCMDrawable* self,
+                                                         cairo_t* context);
 void                    ccm_drawable_push_matrix        (CCMDrawable* self,
                                                          gchar* key,
                                                          cairo_matrix_t* matrix);
@@ -261,6 +307,9 @@ G_GNUC_PURE const CCMRegion* ccm_drawable_get_damaged   (CCMDrawable* self);
 /******************************************************************************/
 
 /******************************** Window**************************************/
+typedef void (*CCMWindowPropertyFunc) (gpointer data, Atom property,
+                                       guint n_items, gchar* result);
+
 CCMWindow*              ccm_window_new                  (CCMScreen* screen,
                                                          Window xwindow);
 CCMWindow*              ccm_window_new_unmanaged        (CCMScreen* screen,
@@ -284,6 +333,8 @@ gboolean                ccm_window_paint                (CCMWindow* self,
                                                          cairo_t* ctx);
 void                    ccm_window_map                  (CCMWindow* self);
 void                    ccm_window_unmap                (CCMWindow* self);
+guint                   ccm_window_admit_animation      (CCMWindow* self,
+                                                         guint duration);
 void                    ccm_window_query_opacity        (CCMWindow* self,
                                                          gboolean deleted);
 void                    ccm_window_query_transient_for  (CCMWindow* self);
@@ -337,6 +388,12 @@ guint32*                ccm_window_get_child_property   (CCMWindow* self,
                                                          Atom property_atom,
                                                          Atom req_type,
                                                          guint* n_items);
+void                    ccm_window_get_property_async   (CCMWindow* self,
+                                                         Atom property_atom,
+                                                         Atom req_type,
+                                                         long length,
+                                                         CCMWindowPropertyFunc func,
+                                                         gpointer data);
 Window                  ccm_window_redirect_event       (CCMWindow* self,
                                                          XEvent* event,
                                                          Window over);
@@ -0,0 +1,157 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4 -*- */
+/*
+ * test-rtree.c
+ * Copyright (C) Nicolas Bruguier 2007-2011 <gandalfn@club-internet.fr>
+ *
+ * cairo-compmgr is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * cairo-compmgr is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Window geometry index check and benchmark: windows spread on a wide
+ * multi head desktop are moved, removed and searched, each query result
+ * is checked against a linear walk of all windows like the screen did
+ * before.
+ */
+
+#include "ccm-rtree.h"
+
+#define DESKTOP_WIDTH  11520
+#define DESKTOP_HEIGHT 2160
+#define N_OPERATIONS   100000
+
+typedef struct
+{
+    cairo_rectangle_t area;
+    gboolean          indexed;
+    guint             found;
+} TestWindow;
+
+static gboolean
+test_intersects (cairo_rectangle_t * a, cairo_rectangle_t * b)
+{
+    return a->x < b->x + b->width && b->x < a->x + a->width &&
+           a->y < b->y + b->height && b->y < a->y + a->height;
+}
+
+static void
+test_random_area (cairo_rectangle_t * area, gint max_width, gint max_height)
+{
+    area->x = g_random_int_range (0, DESKTOP_WIDTH);
+    area->y = g_random_int_range (0, DESKTOP_HEIGHT);
+    area->width = g_random_int_range (1, max_width);
+    area->height = g_random_int_range (1, max_height);
+}
+
+static void
+test_on_found (XID xid, TestWindow * window, gpointer data)
+{
+    window->found++;
+}
+
+static void
+test_run (guint n_windows)
+{
+    GTimer *timer = g_timer_new ();
+    TestWindow *windows = g_new0 (TestWindow, n_windows);
+    CCMRTree *tree = ccm_rtree_new ();
+    gdouble tree_time = 0, linear_time = 0;
+    guint cpt, n, n_queries = 0;
+
+    for (cpt = 0; cpt < n_windows; ++cpt)
+    {
+        test_random_area (&windows[cpt].area, 1600, 1200);
+        ccm_rtree_insert (tree, cpt + 1, &windows[cpt], &windows[cpt].area);
+        windows[cpt].indexed = TRUE;
+    }
+
+    for (cpt = 0; cpt < N_OPERATIONS; ++cpt)
+    {
+        guint index = g_random_int_range (0, n_windows);
+        TestWindow *window = &windows[index];
+        cairo_rectangle_t damage;
+        guint count = 0, found = 0;
+
+        switch (g_random_int_range (0, 4))
+        {
+            case 0:
+                // Move or resize
+                test_random_area (&window->area, 1600, 1200);
+                ccm_rtree_insert (tree, index + 1, window, &window->area);
+                window->indexed = TRUE;
+                break;
+            case 1:
+                // Unmap
+                if (ccm_rtree_remove (tree, index + 1) != window->indexed)
+                    g_error ("%u windows: remove failed", n_windows);
+                window->indexed = FALSE;
+                break;
+            default:
+                // Damage
+                test_random_area (&damage, 400, 300);
+                g_timer_start (timer);
+                count = ccm_rtree_query (tree, &damage,
+                                         (CCMRTreeFunc) test_on_found, NULL);
+                tree_time += g_timer_elapsed (timer, NULL);
+
+                g_timer_start (timer);
+                for (n = 0; n < n_windows; ++n)
+                {
+                    if (windows[n].indexed &&
+                        test_intersects (&windows[n].area, &damage))
+                        found++;
+                }
+                linear_time += g_timer_elapsed (timer, NULL);
+
+                for (n = 0; n < n_windows; ++n)
+                {
+                    if (windows[n].found !=
+                        (windows[n].indexed &&
+                         test_intersects (&windows[n].area, &damage)))
+                        g_error ("%u windows: query failed", n_windows);
+                    windows[n].found = 0;
+                }
+                if (count != found)
+                    g_error ("%u windows: query count failed", n_windows);
+                n_queries++;
+                break;
+        }
+    }
+
+    for (cpt = 0, n = 0; cpt < n_windows; ++cpt)
+        n += windows[cpt].indexed;
+    if (ccm_rtree_size (tree) != n)
+        g_error ("%u windows: size failed", n_windows);
+
+    ccm_rtree_free (tree);
+    g_free (windows);
+    g_timer_destroy (timer);
+
+    g_print ("%u windows\n", n_windows);
+    g_print ("  linear : query %8.1f ns\n",
+             linear_time * 1000000000.0 / (gdouble) n_queries);
+    g_print ("  rtree  : query %8.1f ns\n",
+             tree_time * 1000000000.0 / (gdouble) n_queries);
+}
+
+gint
+main (gint argc, gchar ** argv)
+{
+    guint sizes[] = { 20, 100, 1000 };
+    guint size;
+
+    for (size = 0; size < G_N_ELEMENTS (sizes); ++size)
+        test_run (sizes[size]);
+
+    return 0;
+}
@@ -0,0 +1,357 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4 -*- */
+/*
+ * test-window-plugin.c
+ * Copyright (C) Nicolas Bruguier 2007-2011 <gandalfn@club-internet.fr>
+ *
+ * cairo-compmgr is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * cairo-compmgr is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Window plugin dispatch benchmark: build a plugin chain like the default
+ * one for each fake window and measure the cost of a paint dispatch per
+ * window per frame with and without the flattened dispatch table.
+ *
+ * Before it, check that a resize burst keeps the pixmap of a window with
+ * a shadow like link which holds a reference on window content.
+ */
+
+#include <stdlib.h>
+#include <cairo.h>
+
+#include "ccm-plugin.h"
+#include "ccm-window-plugin.h"
+
+#define N_PLUGINS 12
+
+typedef struct
+{
+    GObject  parent_instance;
+    guint    count;
+
+    // Resize burst state of fake window
+    GObject* pixmap;
+    gint64   last;
+    gint64   now;
+    guint    delay;
+    gboolean pending;
+} TestRoot;
+
+typedef struct
+{
+    GObjectClass parent_class;
+} TestRootClass;
+
+typedef struct
+{
+    CCMPlugin parent_instance;
+} TestPlugin;
+
+typedef struct
+{
+    CCMPluginClass parent_class;
+} TestPluginClass;
+
+typedef struct
+{
+    CCMPlugin parent_instance;
+    GObject*  content;
+} TestShadow;
+
+static void test_root_iface_init    (CCMWindowPluginClass * iface);
+static void test_paint_iface_init   (CCMWindowPluginClass * iface);
+static void test_passive_iface_init (CCMWindowPluginClass * iface);
+static void test_shadow_iface_init  (CCMWindowPluginClass * iface);
+
+GType test_root_get_type    (void);
+GType test_paint_get_type   (void);
+GType test_passive_get_type (void);
+GType test_shadow_get_type  (void);
+
+G_DEFINE_TYPE_WITH_CODE (TestRoot, test_root, G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (CCM_TYPE_WINDOW_PLUGIN,
+                                                test_root_iface_init))
+
+typedef TestPlugin      TestPaint;
+typedef TestPluginClass TestPaintClass;
+
+G_DEFINE_TYPE_WITH_CODE (TestPaint, test_paint, CCM_TYPE_PLUGIN,
+                         G_IMPLEMENT_INTERFACE (CCM_TYPE_WINDOW_PLUGIN,
+                                                test_paint_iface_init))
+
+typedef TestPlugin      TestPassive;
+typedef TestPluginClass TestPassiveClass;
+
+G_DEFINE_TYPE_WITH_CODE (TestPassive, test_passive, CCM_TYPE_PLUGIN,
+                         G_IMPLEMENT_INTERFACE (CCM_TYPE_WINDOW_PLUGIN,
+                                                test_passive_iface_init))
+
+typedef TestPluginClass TestShadowClass;
+
+G_DEFINE_TYPE_WITH_CODE (TestShadow, test_shadow, CCM_TYPE_PLUGIN,
+                         G_IMPLEMENT_INTERFACE (CCM_TYPE_WINDOW_PLUGIN,
+                                                test_shadow_iface_init))
+
+static void test_root_init    (TestRoot * self) { self->count = 0; self->pixmap = NULL; }
+static void test_root_class_init (TestRootClass * klass) { }
+static void test_paint_init   (TestPaint * self) { }
+static void test_paint_class_init (TestPaintClass * klass) { }
+static void test_passive_init (TestPassive * self) { }
+static void test_passive_class_init (TestPassiveClass * klass) { }
+static void test_shadow_init  (TestShadow * self) { self->content = NULL; }
+static void test_shadow_class_init (TestShadowClass * klass) { }
+
+static gboolean
+test_root_paint (CCMWindowPlugin * plugin, CCMWindow * window, cairo_t * ctx,
+                 cairo_surface_t * surface)
+{
+    ((TestRoot *) plugin)->count++;
+
+    return TRUE;
+}
+
+static gboolean
+test_paint_paint (CCMWindowPlugin * plugin, CCMWindow * window, cairo_t * ctx,
+                  cairo_surface_t * surface)
+{
+    return ccm_window_plugin_paint (CCM_WINDOW_PLUGIN_PARENT (plugin), window,
+                                    ctx, surface);
+}
+
+static void
+test_passive_map (CCMWindowPlugin * plugin, CCMWindow * window)
+{
+    ccm_window_plugin_map (CCM_WINDOW_PLUGIN_PARENT (plugin), window);
+}
+
+/* Window releases its pixmap on resize unless resize is in a burst */
+static void
+test_root_resize (CCMWindowPlugin * plugin, CCMWindow * window, int width,
+                  int height)
+{
+    TestRoot *self = (TestRoot *) plugin;
+
+    self->pending = _ccm_window_plugin_resize_in_burst (self->last, self->now,
+                                                        self->delay,
+                                                        self->pending);
+    self->last = self->now;
+    if (!self->pending && self->pixmap)
+    {
+        g_object_unref (self->pixmap);
+        self->pixmap = NULL;
+    }
+}
+
+/* Like shadow, releasing content destroys the window pixmap */
+static void
+test_shadow_on_content_destroyed (TestRoot * root)
+{
+    if (root->pixmap)
+    {
+        g_object_unref (root->pixmap);
+        root->pixmap = NULL;
+    }
+}
+
+static void
+test_shadow_resize (CCMWindowPlugin * plugin, CCMWindow * window, int width,
+                    int height)
+{
+    TestShadow *self = (TestShadow *) plugin;
+    TestRoot *root = (TestRoot *) window;
+
+    if (!_ccm_window_plugin_resize_in_burst (root->last, root->now,
+                                             root->delay, root->pending) &&
+        self->content)
+    {
+        g_object_unref (self->content);
+        self->content = NULL;
+    }
+
+    ccm_window_plugin_resize (CCM_WINDOW_PLUGIN_PARENT (plugin), window,
+                              width, height);
+}
+
+static void
+test_root_iface_init (CCMWindowPluginClass * iface)
+{
+    iface->is_window = TRUE;
+    iface->paint = test_root_paint;
+    iface->resize = test_root_resize;
+}
+
+static void
+test_paint_iface_init (CCMWindowPluginClass * iface)
+{
+    iface->is_window = FALSE;
+    iface->paint = test_paint_paint;
+}
+
+static void
+test_passive_iface_init (CCMWindowPluginClass * iface)
+{
+    iface->is_window = FALSE;
+    iface->map = test_passive_map;
+}
+
+static void
+test_shadow_iface_init (CCMWindowPluginClass * iface)
+{
+    iface->is_window = FALSE;
+    iface->resize = test_shadow_resize;
+}
+
+/* Bind a new window pixmap and shadow content like on paint */
+static void
+test_bind (TestRoot * root, TestShadow * shadow)
+{
+    root->pixmap = g_object_new (G_TYPE_OBJECT, NULL);
+    shadow->content = g_object_new (G_TYPE_OBJECT, NULL);
+    g_object_set_data_full (shadow->content, "test-shadow", root,
+                            (GDestroyNotify) test_shadow_on_content_destroyed);
+}
+
+static gboolean
+test_resize_burst (void)
+{
+    TestRoot *root = g_object_new (test_root_get_type (), NULL);
+    TestShadow *shadow = g_object_new (test_shadow_get_type (), "parent", root,
+                                       NULL);
+    CCMWindowPlugin *chain = (CCMWindowPlugin *) shadow;
+    GObject *pixmap;
+    gboolean ok = TRUE;
+    gint cpt;
+
+    root->delay = 100;
+    root->last = -G_USEC_PER_SEC;
+    test_bind (root, shadow);
+
+    // Isolated resize binds a new pixmap
+    root->now = 0;
+    ccm_window_plugin_resize (chain, (CCMWindow *) root, 10, 10);
+    ok &= root->pixmap == NULL && !root->pending;
+    test_bind (root, shadow);
+    pixmap = root->pixmap;
+
+    // Following resizes keep the same pixmap
+    for (cpt = 1; cpt <= 5; ++cpt)
+    {
+        root->now = cpt * 20 * 1000;
+        ccm_window_plugin_resize (chain, (CCMWindow *) root, 10 + cpt, 10);
+        ok &= root->pixmap == pixmap && shadow->content != NULL &&
+              root->pending;
+    }
+
+    // Rebind timeout releases window pixmap and shadow content
+    root->pending = FALSE;
+    g_object_unref (shadow->content);
+    shadow->content = NULL;
+    ok &= root->pixmap == NULL;
+
+    // Size is stable, next resize is not in burst
+    test_bind (root, shadow);
+    root->now = G_USEC_PER_SEC;
+    ccm_window_plugin_resize (chain, (CCMWindow *) root, 20, 20);
+    ok &= root->pixmap == NULL && !root->pending;
+
+    g_object_unref (shadow);
+    g_object_unref (root);
+
+    return ok;
+}
+
+static gdouble
+test_run (CCMWindowPlugin ** chains, TestRoot ** roots, guint n_windows,
+          guint n_frames, cairo_t * ctx, cairo_surface_t * surface)
+{
+    GTimer *timer = g_timer_new ();
+    guint frame, cpt;
+    gdouble elapsed;
+
+    for (frame = 0; frame < n_frames; ++frame)
+    {
+        for (cpt = 0; cpt < n_windows; ++cpt)
+            ccm_window_plugin_paint (chains[cpt], (CCMWindow *) roots[cpt],
+                                     ctx, surface);
+    }
+
+    elapsed = g_timer_elapsed (timer, NULL);
+    g_timer_destroy (timer);
+
+    return (elapsed * 1000000000.0) / ((gdouble) n_windows * n_frames);
+}
+
+gint
+main (gint argc, gchar ** argv)
+{
+    guint n_windows = argc > 1 ? atoi (argv[1]) : 100;
+    guint n_frames = argc > 2 ? atoi (argv[2]) : 1000;
+    CCMWindowPlugin **chains;
+    TestRoot **roots;
+    cairo_surface_t *surface;
+    cairo_t *ctx;
+    gdouble walk, table;
+    guint cpt, link;
+
+    g_type_init ();
+
+    if (!test_resize_burst ())
+    {
+        g_print ("resize burst : FAILED\n");
+        return 1;
+    }
+    g_print ("resize burst : ok\n");
+
+    surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, 1, 1);
+    ctx = cairo_create (surface);
+
+    chains = g_new0 (CCMWindowPlugin *, n_windows);
+    roots = g_new0 (TestRoot *, n_windows);
+
+    for (cpt = 0; cpt < n_windows; ++cpt)
+    {
+        roots[cpt] = g_object_new (test_root_get_type (), NULL);
+        chains[cpt] = (CCMWindowPlugin *) roots[cpt];
+        for (link = 0; link < N_PLUGINS; ++link)
+        {
+            GType type = link % 2 ? test_paint_get_type () : test_passive_get_type ();
+
+            chains[cpt] = g_object_new (type, "parent", chains[cpt], NULL);
+        }
+    }
+
+    walk = test_run (chains, roots, n_windows, n_frames, ctx, surface);
+
+    for (cpt = 0; cpt < n_windows; ++cpt)
+        _ccm_window_plugin_build_dispatch (chains[cpt]);
+
+    table = test_run (chains, roots, n_windows, n_frames, ctx, surface);
+
+    g_print ("%u windows, %u plugins, %u frames\n", n_windows, N_PLUGINS, n_frames);
+    g_print ("chain walk     : %8.1f ns/window/frame\n", walk);
+    g_print ("dispatch table : %8.1f ns/window/frame\n", table);
+
+    for (cpt = 0; cpt < n_windows; ++cpt)
+    {
+        _ccm_window_plugin_clear_dispatch (chains[cpt]);
+        g_object_unref (chains[cpt]);
+        g_object_unref (roots[cpt]);
+    }
+    g_free (chains);
+    g_free (roots);
+
+    cairo_destroy (ctx);
+    cairo_surface_destroy (surface);
+
+    return 0;
+}
@@ -0,0 +1,114 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4 -*- */
+/*
+ * test-xid-table.c
+ * Copyright (C) Nicolas Bruguier 2007-2011 <gandalfn@club-internet.fr>
+ *
+ * cairo-compmgr is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * cairo-compmgr is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Damage handle lookup benchmark: compare a GHashTable with the XID open
+ * addressing table for insert, lookup and remove of damage like keys.
+ */
+
+#include <stdlib.h>
+
+#include "ccm-xid-table.h"
+
+#define N_LOOKUPS 1000000
+
+static gdouble
+test_elapsed (GTimer * timer, guint n)
+{
+    gdouble elapsed = g_timer_elapsed (timer, NULL);
+
+    g_timer_start (timer);
+
+    return (elapsed * 1000000000.0) / (gdouble) n;
+}
+
+static void
+test_run (XID * keys, guint n_keys)
+{
+    GTimer *timer = g_timer_new ();
+    GHashTable *hash;
+    CCMXidTable *table;
+    gdouble hash_insert, hash_lookup, hash_remove;
+    gdouble table_insert, table_lookup, table_remove;
+    guint cpt, found = 0;
+
+    hash = g_hash_table_new (g_direct_hash, g_direct_equal);
+    g_timer_start (timer);
+    for (cpt = 0; cpt < n_keys; ++cpt)
+        g_hash_table_insert (hash, GSIZE_TO_POINTER (keys[cpt]),
+                             GSIZE_TO_POINTER (keys[cpt]));
+    hash_insert = test_elapsed (timer, n_keys);
+    for (cpt = 0; cpt < N_LOOKUPS; ++cpt)
+        found += g_hash_table_lookup (hash,
+                                      GSIZE_TO_POINTER (keys[cpt % n_keys])) != NULL;
+    hash_lookup = test_elapsed (timer, N_LOOKUPS);
+    for (cpt = 0; cpt < n_keys; ++cpt)
+        g_hash_table_remove (hash, GSIZE_TO_POINTER (keys[cpt]));
+    hash_remove = test_elapsed (timer, n_keys);
+    g_hash_table_destroy (hash);
+
+    table = ccm_xid_table_new (NULL);
+    g_timer_start (timer);
+    for (cpt = 0; cpt < n_keys; ++cpt)
+        ccm_xid_table_insert (table, keys[cpt], GINT_TO_POINTER (keys[cpt]));
+    table_insert = test_elapsed (timer, n_keys);
+    for (cpt = 0; cpt < N_LOOKUPS; ++cpt)
+        found += ccm_xid_table_lookup (table, keys[cpt % n_keys]) != NULL;
+    table_lookup = test_elapsed (timer, N_LOOKUPS);
+    for (cpt = 0; cpt < n_keys; ++cpt)
+        ccm_xid_table_remove (table, keys[cpt]);
+    table_remove = test_elapsed (timer, n_keys);
+    ccm_xid_table_free (table);
+
+    g_timer_destroy (timer);
+
+    if (found != 2 * N_LOOKUPS)
+        g_error ("%u entries: lookup failed", n_keys);
+
+    g_print ("%u entries\n", n_keys);
+    g_print ("  hash  : insert %6.1f ns, lookup %6.1f ns, remove %6.1f ns\n",
+             hash_insert, hash_lookup, hash_remove);
+    g_print ("  table : insert %6.1f ns, lookup %6.1f ns, remove %6.1f ns\n",
+             table_insert, table_lookup, table_remove);
+}
+
+gint
+main (gint argc, gchar ** argv)
+{
+    guint sizes[] = { 1000, 10000 };
+    guint cpt, size;
+
+    g_type_init ();
+
+    for (size = 0; size < G_N_ELEMENTS (sizes); ++size)
+    {
+        XID *keys = g_new (XID, sizes[size]);
+
+        // Damage handles are allocated from the client resource base
+        // with some holes left by destroyed resources
+        for (cpt = 0; cpt < sizes[size]; ++cpt)
+            keys[cpt] = 0x01e00000 + cpt * 2 + g_random_int_range (0, 2);
+
+        test_run (keys, sizes[size]);
+
+        g_free (keys);
+    }
+
+    return 0;
+}